@@ -0,0 +1,264 @@
+#!/usr/bin/env python
+# Test vector compiler : turns Hashish's test files (*.testvecs) into C++ tables, so that the
+# test suite does not need to parse hexadecimal text at runtime.
+#
+#      Copyright (C) 2011  Hadrien Grasland
+#
+#    This program is free software; you can redistribute it and/or modify
+#    it under the terms of the GNU General Public License as published by
+#    the Free Software Foundation; either version 2 of the License, or
+#    (at your option) any later version.
+#
+#    This program is distributed in the hope that it will be useful,
+#    but WITHOUT ANY WARRANTY; without even the implied warranty of
+#    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#    GNU General Public License for more details.
+#
+#    You should have received a copy of the GNU General Public License
+#    along with this program; if not, write to the Free Software
+#    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+#
+# Usage : testvecs_to_cpp.py <test file directory> <output file>
+#
+# Each test file is named after the cryptographic function it tests. It starts with a header
+# line, followed by file-wide settings (hash, hmac) and by test vectors. Each vector ends with
+# its "result" line, every other parameter of a vector must be specified before it.
+
+import glob
+import os
+import sys
+
+TEST_FILE_HEADER = "*** Hashish test file v1 ***"
+
+ID_CACHED_DATA = "cached_data : "
+ID_CONSTRAINTS = "constraints : "
+ID_HASH = "hash : "
+ID_HMAC = "hmac : "
+ID_KEY = "key : "
+ID_MESSAGE = "message : "
+ID_MONTE_CARLO = "monte_carlo : "
+ID_REPEAT = "repeat : "
+ID_RESULT = "result : "
+
+ID_CASE_SENSITIVITY = "case_sensitivity : "
+ID_CONSTRAINT_COUNTER = "constraint_counter : "
+ID_EXTRA_SYMBOLS = "extra_symbols : "
+ID_MAXIMAL_LENGTH = "maximal_length : "
+ID_NUMBER_OF_CAPS = "number_of_caps : "
+ID_NUMBER_OF_DIGITS = "number_of_digits : "
+
+
+class TestFileError(Exception):
+    pass
+
+
+def new_vector():
+    return {"key": [],
+            "message": [],
+            "repeat": 1,
+            "monte_carlo": 0,
+            "case_sensitivity": False,
+            "number_of_caps": 0,
+            "number_of_digits": 0,
+            "maximal_length": 15,
+            "extra_symbols": b"",
+            "constraint_counter": 0,
+            "result": [],
+            "result_text": None}
+
+
+def isolate_content(line):
+    # Same rules as the C++ parser : left spacing is removed, '#' starts a comment line
+    line = line.rstrip("\r\n").lstrip(" ")
+    if line.startswith("#"):
+        return ""
+    return line
+
+
+def parse_qwords(text, file_path, line_number):
+    text = text.strip()
+    if not text.startswith("0x"):
+        raise TestFileError("%s:%d: bad hexadecimal data" % (file_path, line_number))
+    qwords = text[2:].split()
+    for qword in qwords:
+        if len(qword) != 16:
+            raise TestFileError("%s:%d: qwords must have 16 hex digits" % (file_path, line_number))
+        int(qword, 16)
+    return qwords
+
+
+def parse_block(lines, position, file_path, vector, fields):
+    # Parse a "{ ... }" block, such as constraints or cached data. Returns the next position.
+    while position < len(lines):
+        line_number, line = lines[position]
+        position += 1
+        if not line:
+            continue
+        if line.startswith("}"):
+            return position
+        for identifier, key, convert in fields:
+            if line.startswith(identifier):
+                vector[key] = convert(line[len(identifier):])
+                break
+    raise TestFileError("%s: unterminated block" % file_path)
+
+
+def parse_bool(text):
+    if text == "true":
+        return True
+    if text == "false":
+        return False
+    raise TestFileError("non-boolean value : %s" % text)
+
+
+def parse_test_file(file_path):
+    with open(file_path, "rb") as test_file:
+        raw_lines = test_file.read().decode("utf-8").split("\n")
+    if not raw_lines or raw_lines[0].rstrip("\r") != TEST_FILE_HEADER:
+        raise TestFileError("%s: header is incorrect" % file_path)
+
+    lines = [(i + 2, isolate_content(line)) for i, line in enumerate(raw_lines[1:])]
+    test_file = {"hash": None, "hmac": None, "vectors": []}
+    vector = new_vector()
+    position = 0
+    while position < len(lines):
+        line_number, line = lines[position]
+        position += 1
+        if not line:
+            continue
+
+        if line.startswith(ID_HASH):
+            test_file["hash"] = line[len(ID_HASH):]
+        elif line.startswith(ID_HMAC):
+            test_file["hmac"] = line[len(ID_HMAC):]
+        elif line.startswith(ID_KEY):
+            vector["key"] = parse_qwords(line[len(ID_KEY):], file_path, line_number)
+        elif line.startswith(ID_MESSAGE):
+            vector["message"] = parse_qwords(line[len(ID_MESSAGE):], file_path, line_number)
+        elif line.startswith(ID_REPEAT):
+            vector["repeat"] = int(line[len(ID_REPEAT):])
+        elif line.startswith(ID_MONTE_CARLO):
+            vector["monte_carlo"] = int(line[len(ID_MONTE_CARLO):])
+        elif line.startswith(ID_CONSTRAINTS):
+            position = parse_block(lines, position, file_path, vector,
+                                   [(ID_CASE_SENSITIVITY, "case_sensitivity", parse_bool),
+                                    (ID_NUMBER_OF_CAPS, "number_of_caps", int),
+                                    (ID_NUMBER_OF_DIGITS, "number_of_digits", int),
+                                    (ID_MAXIMAL_LENGTH, "maximal_length", int),
+                                    (ID_EXTRA_SYMBOLS, "extra_symbols", lambda s: s.encode("utf-8"))])
+        elif line.startswith(ID_CACHED_DATA):
+            position = parse_block(lines, position, file_path, vector,
+                                   [(ID_CONSTRAINT_COUNTER, "constraint_counter", int)])
+        elif line.startswith(ID_RESULT):
+            result = line[len(ID_RESULT):]
+            if result.startswith("0x"):
+                vector["result"] = parse_qwords(result, file_path, line_number)
+            else:
+                vector["result_text"] = result.encode("utf-8")
+            if vector["repeat"] < 1:
+                raise TestFileError("%s:%d: messages must be repeated at least once" % (file_path, line_number))
+            test_file["vectors"].append(vector)
+            vector = new_vector()
+        else:
+            raise TestFileError("%s:%d: unknown identifier" % (file_path, line_number))
+
+    return test_file
+
+
+def c_string(data):
+    if data is None:
+        return "NULL"
+    # Escape everything that is not plain printable ASCII, using octal escapes so that the
+    # following characters cannot be mistaken for part of the escape sequence
+    result = '"'
+    for byte in bytearray(data):
+        character = chr(byte)
+        if character in '"\\?' or byte < 0x20 or byte > 0x7e:
+            result += "\\%03o" % byte
+        else:
+            result += character
+    return result + '"'
+
+
+def c_identifier(name):
+    return "".join(c if c.isalnum() else "_" for c in name).upper()
+
+
+def qword_array(name, qwords):
+    lines = ["constexpr uint64_t %s[] = {" % name]
+    for i in range(0, len(qwords), 4):
+        lines.append("    " + ", ".join("0x" + qword for qword in qwords[i:i + 4]) + ",")
+    lines.append("};")
+    return lines
+
+
+def generate_cpp(test_files):
+    output = ["// Generated by Tests/testvecs_to_cpp.py from the Tests/*.testvecs files, do not edit.",
+              "",
+              "#include <stddef.h>",
+              "#include <stdint.h>",
+              "",
+              "#include <test_vectors.h>",
+              ""]
+
+    file_entries = []
+    for function_name, test_file in test_files:
+        prefix = c_identifier(function_name)
+        vector_entries = []
+        for index, vector in enumerate(test_file["vectors"]):
+            arrays = {}
+            for field in ("key", "message", "result"):
+                if vector[field]:
+                    arrays[field] = "%s_%d_%s" % (prefix, index, field.upper())
+                    output.extend(qword_array(arrays[field], vector[field]))
+                else:
+                    arrays[field] = "NULL"
+            vector_entries.append("    {%d, %s, %d, %s, %dULL, %dULL, %s, %d, %d, %d, %s, %dULL, %d, %s, %s}," % (
+                len(vector["key"]), arrays["key"],
+                len(vector["message"]), arrays["message"],
+                vector["repeat"], vector["monte_carlo"],
+                "true" if vector["case_sensitivity"] else "false",
+                vector["number_of_caps"], vector["number_of_digits"], vector["maximal_length"],
+                c_string(vector["extra_symbols"]), vector["constraint_counter"],
+                len(vector["result"]), arrays["result"],
+                c_string(vector["result_text"])))
+        output.append("constexpr TestVector %s_VECTORS[] = {" % prefix)
+        output.extend(vector_entries)
+        output.append("};")
+        output.append("")
+
+        file_entries.append("    {%s, %s, %s, %d, %s_VECTORS}," % (
+            c_string(function_name.encode("utf-8")),
+            c_string(test_file["hash"].encode("utf-8")) if test_file["hash"] else "NULL",
+            c_string(test_file["hmac"].encode("utf-8")) if test_file["hmac"] else "NULL",
+            len(test_file["vectors"]), prefix))
+
+    output.append("constexpr TestVectorFile TEST_VECTOR_FILES[] = {")
+    output.extend(file_entries)
+    output.append("};")
+    output.append("constexpr size_t TEST_VECTOR_FILE_COUNT = %d;" % len(file_entries))
+    output.append("")
+    return "\n".join(output)
+
+
+def main(argv):
+    if len(argv) != 3:
+        sys.stderr.write("Usage : %s <test file directory> <output file>\n" % argv[0])
+        return 2
+
+    test_files = []
+    for file_path in sorted(glob.glob(os.path.join(argv[1], "*.testvecs"))):
+        function_name = os.path.basename(file_path)[:-len(".testvecs")]
+        try:
+            test_files.append((function_name, parse_test_file(file_path)))
+        except (TestFileError, ValueError) as error:
+            sys.stderr.write("%s\n" % error)
+            return 1
+
+    with open(argv[2], "w") as output_file:
+        output_file.write(generate_cpp(test_files))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
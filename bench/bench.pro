@@ -0,0 +1,21 @@
+# Benchmarks : measure the throughput of performance-sensitive code paths on synthetic data, and
+# check that optimized code paths give the same results as the code they replace ("make bench"
+# runs them, preferably from a release build).
+
+TARGET = hashish-bench
+CONFIG += console
+CONFIG -= app_bundle
+QT -= gui
+
+QMAKE_CXXFLAGS += -std=c++0x -U__STRICT_ANSI__ -Wall
+
+include(../core/hashish-core.pri)
+
+SOURCES += main.cpp \
+    benchmark_runner.cpp
+
+HEADERS += benchmark_runner.h
+
+bench.commands = ./$$TARGET
+bench.depends = $$TARGET
+QMAKE_EXTRA_TARGETS += bench
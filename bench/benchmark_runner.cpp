@@ -0,0 +1,155 @@
+/* Benchmark runner : times operations in batches, and reports per-operation statistics in a
+   human-readable or machine-readable (CSV) way, optionally compared with a baseline run.
+
+      Copyright (C) 2011  Hadrien Grasland
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA */
+
+#include <QFile>
+#include <QStringList>
+#include <algorithm>
+
+#include <benchmark_runner.h>
+
+const QString CSV_HEADER("name,bytes_per_op,samples,ops_per_sample,mean_ns,min_ns,p50_ns,p90_ns,p99_ns,max_ns,"
+                         "cycles_per_op,cycles_per_byte,mib_per_s,baseline_p50_ns,speedup");
+const int NAME_COLUMN_WIDTH = 40; //In text output
+
+QTextStream failure_stream(stderr); //Keeps machine-readable output clean
+
+BenchmarkRunner::BenchmarkRunner(QTextStream& output,
+                                 const OutputFormat format) : out(output),
+                                                              output_format(format),
+                                                              sampling_time(DEFAULT_SAMPLING_TIME),
+                                                              header_written(false) {}
+
+bool BenchmarkRunner::load_baseline(const QString& filepath) {
+    QFile baseline_file(filepath);
+    if(!baseline_file.open(QIODevice::ReadOnly | QIODevice::Text)) return false;
+    QTextStream baseline_stream(&baseline_file);
+
+    //Locate the median column, which is the one results are compared on
+    QStringList header = baseline_stream.readLine().split(',');
+    int p50_column = header.indexOf("p50_ns");
+    if((header.value(0) != "name") || (p50_column < 0)) return false;
+
+    while(!baseline_stream.atEnd()) {
+        QStringList fields = baseline_stream.readLine().split(',');
+        bool valid_time;
+        double p50_ns = fields.value(p50_column).toDouble(&valid_time);
+        if(valid_time) baseline_p50_ns.insert(fields.at(0), p50_ns);
+    }
+
+    return true;
+}
+
+bool BenchmarkRunner::failed(const QString& name) {
+    failure_stream << "FAIL : " << name << endl;
+    return false;
+}
+
+double percentile(const QVector<double>& sorted_values, const int percent) {
+    //Nearest-rank percentile
+    int rank = (percent*sorted_values.size() + 99)/100;
+    if(rank < 1) rank = 1;
+    return sorted_values.at(rank-1);
+}
+
+void BenchmarkRunner::report(const QString& name,
+                             const size_t bytes_per_op,
+                             const uint64_t ops_per_sample,
+                             const QVector<qint64>& sample_times,
+                             const QVector<uint64_t>& sample_cycles) {
+    BenchmarkResult result;
+    result.name = name;
+    result.bytes_per_op = bytes_per_op;
+    result.sample_count = sample_times.size();
+    result.ops_per_sample = ops_per_sample;
+
+    //Per-operation times of each sample, sorted for percentiles
+    QVector<double> op_times(result.sample_count);
+    QVector<double> op_cycles(result.sample_count);
+    double total_time = 0;
+    for(int i = 0; i < result.sample_count; ++i) {
+        op_times[i] = (double) sample_times.at(i) / ops_per_sample;
+        op_cycles[i] = (double) sample_cycles.at(i) / ops_per_sample;
+        total_time+= op_times.at(i);
+    }
+    std::sort(op_times.begin(), op_times.end());
+    std::sort(op_cycles.begin(), op_cycles.end());
+
+    result.mean_ns = total_time / result.sample_count;
+    result.min_ns = op_times.first();
+    result.p50_ns = percentile(op_times, 50);
+    result.p90_ns = percentile(op_times, 90);
+    result.p99_ns = percentile(op_times, 99);
+    result.max_ns = op_times.last();
+    result.cycles_per_op = -1;
+    #ifdef HAVE_CYCLE_COUNTER
+        result.cycles_per_op = percentile(op_cycles, 50);
+    #endif
+
+    write_result(result);
+}
+
+void BenchmarkRunner::write_result(const BenchmarkResult& result) {
+    double cycles_per_byte = -1;
+    if((result.cycles_per_op >= 0) && result.bytes_per_op) cycles_per_byte = result.cycles_per_op / result.bytes_per_op;
+    double mib_per_s = -1;
+    if(result.bytes_per_op) mib_per_s = (result.bytes_per_op / 1048576.0) / (result.p50_ns / 1e9);
+    double baseline_ns = baseline_p50_ns.value(result.name, -1);
+    double speedup = -1;
+    if(baseline_ns > 0) speedup = baseline_ns / result.p50_ns;
+
+    switch(output_format) {
+      case CSV_OUTPUT: {
+        //Unavailable values are left empty
+        if(!header_written) out << CSV_HEADER << endl;
+        QStringList fields;
+        fields << result.name
+               << QString::number((qulonglong) result.bytes_per_op)
+               << QString::number(result.sample_count)
+               << QString::number((qulonglong) result.ops_per_sample)
+               << QString::number(result.mean_ns, 'f', 2)
+               << QString::number(result.min_ns, 'f', 2)
+               << QString::number(result.p50_ns, 'f', 2)
+               << QString::number(result.p90_ns, 'f', 2)
+               << QString::number(result.p99_ns, 'f', 2)
+               << QString::number(result.max_ns, 'f', 2)
+               << ((result.cycles_per_op >= 0) ? QString::number(result.cycles_per_op, 'f', 1) : QString())
+               << ((cycles_per_byte >= 0) ? QString::number(cycles_per_byte, 'f', 3) : QString())
+               << ((mib_per_s >= 0) ? QString::number(mib_per_s, 'f', 1) : QString())
+               << ((baseline_ns > 0) ? QString::number(baseline_ns, 'f', 2) : QString())
+               << ((speedup >= 0) ? QString::number(speedup, 'f', 3) : QString());
+        out << fields.join(",") << endl;
+        break;
+      }
+      case TEXT_OUTPUT:
+        out << result.name.leftJustified(NAME_COLUMN_WIDTH-1) << ' '
+            << QString::number(result.p50_ns, 'f', 1) << " ns/op (p90 "
+            << QString::number(result.p90_ns, 'f', 1) << ", p99 "
+            << QString::number(result.p99_ns, 'f', 1) << ")";
+        if(cycles_per_byte >= 0) {
+            out << ", " << QString::number(cycles_per_byte, 'f', 2) << " cycles/B";
+        } else if(result.cycles_per_op >= 0) {
+            out << ", " << QString::number(result.cycles_per_op, 'f', 0) << " cycles/op";
+        }
+        if(mib_per_s >= 0) out << ", " << QString::number(mib_per_s, 'f', 1) << " MiB/s";
+        if(speedup >= 0) out << ", " << QString::number(speedup, 'f', 2) << "x baseline";
+        out << endl;
+        break;
+    }
+    header_written = true;
+}
@@ -0,0 +1,134 @@
+/* Benchmark runner : times operations in batches, and reports per-operation statistics in a
+   human-readable or machine-readable (CSV) way, optionally compared with a baseline run.
+
+      Copyright (C) 2011  Hadrien Grasland
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA */
+
+#ifndef BENCHMARK_RUNNER_H
+#define BENCHMARK_RUNNER_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QString>
+#include <QTextStream>
+#include <QVector>
+#include <stddef.h>
+#include <stdint.h>
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+    #include <x86intrin.h>
+    #define HAVE_CYCLE_COUNTER
+#endif
+
+#define SAMPLE_DURATION 20000 //Minimal duration of a timed sample in ns. Operations are batched to reach it,
+                              //so that timer overhead does not matter.
+#define MIN_SAMPLE_COUNT 30 //Samples taken for each benchmark, whatever its duration
+#define MAX_SAMPLE_COUNT 10000
+#define DEFAULT_SAMPLING_TIME 300 //Time spent sampling each benchmark, in ms
+
+enum OutputFormat {TEXT_OUTPUT = 0, CSV_OUTPUT};
+
+//Cycle counter (time stamp counter on x86), 0 where there is none
+inline uint64_t read_cycle_counter() {
+    #ifdef HAVE_CYCLE_COUNTER
+        return __rdtsc();
+    #else
+        return 0;
+    #endif
+}
+
+//Timing statistics of one benchmark, per operation
+struct BenchmarkResult {
+    QString name;
+    size_t bytes_per_op; //0 when throughput is meaningless
+    int sample_count;
+    uint64_t ops_per_sample;
+    double mean_ns;
+    double min_ns;
+    double p50_ns;
+    double p90_ns;
+    double p99_ns;
+    double max_ns;
+    double cycles_per_op; //Median, negative without a cycle counter
+};
+
+//Operations are functors whose operator() returns false on failure. They are called many times,
+//and must leave their inputs ready for the next call.
+class BenchmarkRunner {
+  public:
+    BenchmarkRunner(QTextStream& output, const OutputFormat format);
+    void set_filter(const QString& filter) {name_filter = filter;} //Only run benchmarks whose name contains this
+    void set_sampling_time(const int milliseconds) {sampling_time = milliseconds;}
+    bool load_baseline(const QString& filepath); //CSV output of a previous run
+
+    bool selected(const QString& name) const {return name.contains(name_filter);}
+    template <class Operation> bool run(const QString& name,
+                                        const size_t bytes_per_op,
+                                        Operation& operation);
+  private:
+    QTextStream& out;
+    OutputFormat output_format;
+    QString name_filter;
+    int sampling_time;
+    QHash<QString, double> baseline_p50_ns;
+    bool header_written;
+
+    bool failed(const QString& name);
+    void report(const QString& name,
+                const size_t bytes_per_op,
+                const uint64_t ops_per_sample,
+                const QVector<qint64>& sample_times,
+                const QVector<uint64_t>& sample_cycles);
+    void write_result(const BenchmarkResult& result);
+};
+
+template <class Operation> bool BenchmarkRunner::run(const QString& name,
+                                                     const size_t bytes_per_op,
+                                                     Operation& operation) {
+    if(!selected(name)) return true;
+
+    //Find how many operations are needed to make a sample (this also warms caches up)
+    uint64_t ops_per_sample = 1;
+    QElapsedTimer timer;
+    while(true) {
+        timer.start();
+        for(uint64_t i = 0; i < ops_per_sample; ++i) {
+            if(!operation()) return failed(name);
+        }
+        if(timer.nsecsElapsed() >= SAMPLE_DURATION) break;
+        ops_per_sample*= 2;
+    }
+
+    //Take samples until both the minimal sample count and the sampling time are reached
+    QVector<qint64> sample_times;
+    QVector<uint64_t> sample_cycles;
+    QElapsedTimer sampling_timer;
+    sampling_timer.start();
+    while((sample_times.size() < MIN_SAMPLE_COUNT)
+          || ((sampling_timer.elapsed() < sampling_time) && (sample_times.size() < MAX_SAMPLE_COUNT))) {
+        uint64_t initial_cycles = read_cycle_counter();
+        timer.start();
+        for(uint64_t i = 0; i < ops_per_sample; ++i) {
+            if(!operation()) return failed(name);
+        }
+        sample_times.append(timer.nsecsElapsed());
+        sample_cycles.append(read_cycle_counter() - initial_cycles);
+    }
+
+    report(name, bytes_per_op, ops_per_sample, sample_times, sample_cycles);
+    return true;
+}
+
+#endif // BENCHMARK_RUNNER_H
@@ -0,0 +1,728 @@
+/* Hashish's benchmarks : measure the throughput of performance-sensitive code paths on synthetic
+   data, so that optimizations can be checked and compared.
+
+      Copyright (C) 2011  Hadrien Grasland
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA */
+
+#include <QByteArray>
+#include <QCoreApplication>
+#include <QDir>
+#include <QFileInfo>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QTextStream>
+#include <QVector>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <benchmark_runner.h>
+#include <crypto_hash.h>
+#include <hmac.h>
+#include <parsing_tools.h>
+#include <password_cipher.h>
+#include <password_generator.h>
+#include <pbkdf2.h>
+#include <qstring_to_qwords.h>
+#include <service_descriptor.h>
+#include <service_manager.h>
+
+const QString USAGE("Usage : hashish-bench [--csv] [--filter <text>] [--time <ms>] [--baseline <file>]\n"
+                    "\n"
+                    "  --csv              Machine-readable output, one line per benchmark\n"
+                    "  --filter <text>    Only runs benchmarks whose name contains this text\n"
+                    "  --time <ms>        Time spent sampling each benchmark (default : %1 ms)\n"
+                    "  --baseline <file>  Compares results with a previous --csv output");
+
+const char* const BENCHMARKED_HASHES[][2] = {{"SHA-512", "sha512"}, //Name, benchmark prefix
+                                              {"BLAKE2b-512", "blake2b"},
+                                              {"SHA3-512", "sha3_512"}};
+const size_t HASH_MESSAGE_LENGTHS[] = {8, 16, 128, 1024}; //In qwords
+const size_t CIPHER_MESSAGE_LENGTHS[] = {4, 32};
+const int HEX_QWORD_COUNT = 1024;
+const int RAW_STRING_LENGTH = 30; //Characters, about the size of a password or service name
+const uint64_t STRETCHING_ITERATIONS = 1000; //Also used for descriptors, instead of calibrated values
+const int STORE_SERVICE_COUNT = 200;
+const int SYNTHETIC_SERVICE_COUNT = 50000;
+
+//Service database format, see service_manager.cpp
+const QString ID_FILENAME("file_name : ");
+const QString ID_SERVICE("service : ");
+const QString SERVICE_DATABASE_HEADER("*** Hashish service database v1 ***");
+
+enum ServiceDatabaseID {SERVICE = 0, FILENAME};
+const QString* const SERVICE_DB_IDS[] = {&ID_SERVICE, &ID_FILENAME};
+const KeywordTable service_db_keywords(SERVICE_DB_IDS, sizeof(SERVICE_DB_IDS)/sizeof(QString*));
+
+QTextStream err_stream(stderr);
+QTextStream out_stream(stdout);
+
+struct ServiceIndex {
+    QStringList service_names;
+    QHash<QString, QString> service_filenames;
+};
+
+QVector<uint64_t> pseudo_random_qwords(const int length) {
+    //Xorshift generator, as in encrypted passwords and keys but reproducible
+    QVector<uint64_t> result(length);
+    uint64_t state = 88172645463325252ULL;
+    for(int i = 0; i < length; ++i) {
+        state^= state << 13;
+        state^= state >> 7;
+        state^= state << 17;
+        result[i] = state;
+    }
+
+    return result;
+}
+
+QString size_name(const size_t bytes) {
+    if(bytes % 1024) return QString::number((qulonglong) bytes) + "B";
+    return QString::number((qulonglong) (bytes / 1024)) + "KiB";
+}
+
+QByteArray synthetic_service_database(const int service_count) {
+    //Written the way ServiceManager writes it, with a few comments and indented lines thrown in
+    QByteArray result;
+    QTextStream service_db_ostream(&result);
+    service_db_ostream << SERVICE_DATABASE_HEADER << endl << endl;
+    for(int i = 0; i < service_count; ++i) {
+        if(i % 100 == 0) service_db_ostream << "# Services " << i << " and later" << endl;
+        service_db_ostream << ID_SERVICE << "Service number " << i << endl;
+        if(i % 10 == 0) service_db_ostream << "    ";
+        service_db_ostream << ID_FILENAME << i << ".txt" << endl << endl;
+    }
+    service_db_ostream.flush();
+
+    return result;
+}
+
+//Line-by-line parser that was used before ConfigTokenizer : every line is read into a QString,
+//which is then trimmed and checked against each identifier in turn
+bool legacy_has_id(const QString& config_file_line, const QString& identifier) {
+    return (config_file_line.left(identifier.count()) == identifier);
+}
+
+void legacy_isolate_content(QString& config_file_line) {
+    int i;
+    for(i = 0; i < config_file_line.count(); ++i) {
+        if(config_file_line.at(i) != ' ') break;
+    }
+    config_file_line.remove(0, i);
+    if(config_file_line.isEmpty()) return;
+    if(config_file_line.at(0) == '#') config_file_line.clear();
+}
+
+bool legacy_parse_service_db(const QByteArray& service_db_data, ServiceIndex& index) {
+    QTextStream service_db_istream(service_db_data);
+    if(service_db_istream.readLine() != SERVICE_DATABASE_HEADER) return false;
+
+    QString line, service_name;
+    while(service_db_istream.atEnd() == false) {
+        line = service_db_istream.readLine();
+        legacy_isolate_content(line);
+        if(line.isEmpty()) continue;
+
+        if(legacy_has_id(line, ID_SERVICE)) {
+            line.remove(0, ID_SERVICE.count());
+            service_name = line;
+            continue;
+        }
+        if(legacy_has_id(line, ID_FILENAME) && (service_name.isEmpty() == false)) {
+            line.remove(0, ID_FILENAME.count());
+            index.service_names.append(service_name);
+            index.service_filenames[service_name] = line;
+            service_name.clear();
+            continue;
+        }
+    }
+
+    return true;
+}
+
+//Same loop as ServiceManager::parse_service_db()
+bool tokenizer_parse_service_db(const QByteArray& service_db_data, ServiceIndex& index) {
+    ConfigTokenizer service_db_tokenizer(service_db_data);
+    if(!service_db_tokenizer.read_header(SERVICE_DATABASE_HEADER)) return false;
+
+    QString service_name;
+    ConfigField field;
+    while(service_db_tokenizer.next_field(service_db_keywords, field)) {
+        switch(field.id) {
+          case SERVICE:
+            service_name = field.to_string();
+            break;
+          case FILENAME:
+            if(service_name.isEmpty()) break;
+            index.service_names.append(service_name);
+            index.service_filenames[service_name] = field.to_string();
+            service_name.clear();
+            break;
+        }
+    }
+
+    return true;
+}
+
+//Hex conversions that were used before the qword hex codec, one character at a time
+QString* legacy_qwords_to_hex_str(const size_t data_length,
+                                  const uint64_t* data,
+                                  QString& dest_buffer) {
+    dest_buffer = "0x";
+    char hex_digits[18];
+    hex_digits[16] = ' ';
+    hex_digits[17] = '\0';
+    for(size_t i = 0; i < data_length; ++i) {
+        uint64_t tmp_buff = data[i];
+        for(int j = 15; j >= 0; --j) {
+            int hex_digit = tmp_buff % 16;
+            hex_digits[j] = (hex_digit < 10) ? '0'+hex_digit : 'a'+(hex_digit-10);
+            tmp_buff/= 16;
+        }
+        dest_buffer.append(hex_digits);
+    }
+    dest_buffer.remove(dest_buffer.size()-1, 1);
+
+    return &dest_buffer;
+}
+
+uint64_t* legacy_qwords_from_hex_str(const QString& data,
+                                     uint64_t* dest_buffer) {
+    if((data.at(0) != '0') || (data.at(1) != 'x')) return NULL;
+    if((data.count() - 1) % 17) return NULL;
+    size_t qw_length = (data.count() - 1)/17;
+    for(size_t i = 0; i < qw_length; ++i) {
+        int string_offset = 2+17*i;
+        dest_buffer[i] = 0;
+        for(int j = 0; j < 16; ++j) {
+            char ch = data.at(string_offset+j).toAscii();
+            dest_buffer[i] = dest_buffer[i]*16 + ((ch <= '9') ? ch-'0' : ch-'a'+10);
+        }
+    }
+
+    return dest_buffer;
+}
+
+//Raw conversions that were used before the vectorized ones, one character at a time
+uint64_t* legacy_qwords_from_raw_str(const QString& data,
+                                     uint64_t* dest_buffer) {
+    uint64_t* result_parser = dest_buffer-1;
+    for(int i = 0; i < data.size(); ++i) {
+        if(i%4 == 0) {
+            ++result_parser;
+            *result_parser = 0;
+        }
+        *result_parser*= 65536;
+        *result_parser+= data.at(i).unicode();
+    }
+
+    return dest_buffer;
+}
+
+QString* legacy_qwords_to_raw_str(const size_t data_length,
+                                  const uint64_t* data,
+                                  QString& dest_buffer) {
+    dest_buffer.clear();
+    uint64_t current_data;
+    ushort c1 = 0, c2 = 0, c3 = 0, c4 = 0;
+    for(size_t i = 0; i < data_length; ++i) {
+        current_data = data[i];
+        c4 = current_data % 65536;
+        current_data/= 65536;
+        c3 = current_data % 65536;
+        current_data/= 65536;
+        c2 = current_data % 65536;
+        current_data/= 65536;
+        c1 = current_data % 65536;
+        if(i == data_length - 1) break;
+        dest_buffer.append(QChar(c1));
+        dest_buffer.append(QChar(c2));
+        dest_buffer.append(QChar(c3));
+        dest_buffer.append(QChar(c4));
+    }
+    if(c1) dest_buffer.append(QChar(c1));
+    if(c2) dest_buffer.append(QChar(c2));
+    if(c3) dest_buffer.append(QChar(c3));
+    if(c4) dest_buffer.append(QChar(c4));
+
+    return &dest_buffer;
+}
+
+//Operations measured by the benchmarks below, see benchmark_runner.h
+struct HashOperation {
+    CryptoHash* hash;
+    QVector<uint64_t> message;
+    QVector<uint64_t> digest;
+    bool operator()() {return hash->hash(message.size(), message.constData(), digest.data()) != NULL;}
+};
+
+struct StretchingOperation {
+    //Same loop as ServiceDescriptor::compute_hashed_key()
+    CryptoHash* hash;
+    QVector<uint64_t> key;
+    bool operator()() {
+        for(uint64_t i = 0; i < STRETCHING_ITERATIONS; ++i) {
+            if(!hash->hash(key.size(), key.constData(), key.data())) return false;
+        }
+        return true;
+    }
+};
+
+struct PBKDF2Operation {
+    //Same derivation as ServiceDescriptor::compute_pbkdf2_key()
+    PBKDF2HMACSHA512* pbkdf2;
+    QByteArray salt;
+    QVector<uint64_t> key;
+    bool operator()() {
+        return pbkdf2->derive_qwords(salt.constData(), salt.size(), STRETCHING_ITERATIONS, key.size(), key.data()) != NULL;
+    }
+};
+
+struct HMACOperation {
+    HMAC* hmac;
+    CryptoHash* hash;
+    QVector<uint64_t> key;
+    QVector<uint64_t> message;
+    QVector<uint64_t> result;
+    bool operator()() {
+        return hmac->hmac(key.size(), key.constData(), message.size(), message.constData(), hash, result.data()) != NULL;
+    }
+};
+
+struct GeneratorOperation {
+    PasswordGenerator* generator;
+    HMAC* hmac;
+    CryptoHash* hash;
+    QVector<uint64_t> hashed_key;
+    PwdGenConstraints constraints;
+    PwdGenCachedData cached_data;
+    QString password;
+    bool operator()() {
+        //Include the search for a counter which matches constraints
+        cached_data.constraint_counter = 0;
+        return generator->generate_password(hashed_key.constData(),
+                                            hmac,
+                                            hash,
+                                            &constraints,
+                                            &cached_data,
+                                            password) != NULL;
+    }
+};
+
+struct CipherRoundTripOperation {
+    PasswordCipher* cipher;
+    CryptoHash* hash;
+    QVector<uint64_t> hashed_key;
+    QVector<uint64_t> message;
+    QVector<uint64_t> encrypted_message;
+    QVector<uint64_t> decrypted_message;
+    bool operator()() {
+        if(!cipher->encrypt(hashed_key.constData(), message.size(), message.constData(), hash, encrypted_message.data())) {
+            return false;
+        }
+        return cipher->decrypt(hashed_key.constData(),
+                               encrypted_message.size(),
+                               encrypted_message.constData(),
+                               hash,
+                               decrypted_message.data()) != NULL;
+    }
+};
+
+struct HexEncodingOperation {
+    QString* (*encode)(const size_t, const uint64_t*, QString&);
+    QVector<uint64_t> data;
+    QString text;
+    bool operator()() {return encode(data.size(), data.constData(), text) != NULL;}
+};
+
+struct HexDecodingOperation {
+    uint64_t* (*decode)(const QString&, uint64_t*);
+    QString text;
+    QVector<uint64_t> data;
+    bool operator()() {return decode(text, data.data()) != NULL;}
+};
+
+struct RawPackingOperation {
+    uint64_t* (*pack)(const QString&, uint64_t*);
+    QString text;
+    QVector<uint64_t> data;
+    bool operator()() {return pack(text, data.data()) != NULL;}
+};
+
+struct RawUnpackingOperation {
+    QString* (*unpack)(const size_t, const uint64_t*, QString&);
+    QVector<uint64_t> data;
+    QString text;
+    bool operator()() {return unpack(data.size(), data.constData(), text) != NULL;}
+};
+
+struct ServiceDatabaseParsingOperation {
+    bool (*parser)(const QByteArray&, ServiceIndex&);
+    QByteArray service_db_data;
+    bool operator()() {
+        ServiceIndex index;
+        return parser(service_db_data, index);
+    }
+};
+
+struct DescriptorOperation {
+    enum Action {LOAD_FROM_FILE = 0, SAVE_TO_FILE, SAVE_TO_STRING, COMPUTE_PASSWORD};
+    Action action;
+    ServiceDescriptor service;
+    QString filepath;
+    QString master_password;
+    QString result;
+    bool operator()() {
+        switch(action) {
+          case LOAD_FROM_FILE:
+            return service.load_from_file(filepath);
+          case SAVE_TO_FILE:
+            return service.save_to_file(filepath);
+          case SAVE_TO_STRING:
+            return service.save_to_string(result) != NULL;
+          case COMPUTE_PASSWORD:
+            return service.compute_password(master_password, result) != NULL;
+        }
+        return false;
+    }
+};
+
+struct ServiceStoreOperation {
+    enum Action {OPEN = 0, LOOKUP, SAVE};
+    Action action;
+    ServiceManager* service_manager;
+    QString data_location;
+    int current_service;
+    ServiceDescriptor service;
+    bool operator()() {
+        switch(action) {
+          case OPEN: {
+            ServiceManager opened_manager(CLIENT_INSTANCE, data_location);
+            return opened_manager.service_names().count() == STORE_SERVICE_COUNT;
+          }
+          case LOOKUP: {
+            //Cycle through services, as a password manager's users would
+            current_service = (current_service + 1) % STORE_SERVICE_COUNT;
+            return service_manager->copy_service(service_manager->service_names().at(current_service), service);
+          }
+          case SAVE:
+            return service_manager->write_service(service.service_name, service.service_name, service);
+        }
+        return false;
+    }
+};
+
+bool remove_directory(const QString& directory_path) {
+    QDir directory(directory_path);
+    QFileInfoList entries = directory.entryInfoList(QDir::AllEntries | QDir::NoDotAndDotDot | QDir::Hidden);
+    for(int i = 0; i < entries.count(); ++i) {
+        const QFileInfo& entry = entries.at(i);
+        bool removed = entry.isDir() ? remove_directory(entry.absoluteFilePath())
+                                     : directory.remove(entry.fileName());
+        if(!removed) return false;
+    }
+
+    return directory.rmdir(directory.absolutePath());
+}
+
+bool benchmark_cryptography(BenchmarkRunner& runner) {
+    bool success = true;
+    QVector<uint64_t> key = pseudo_random_qwords(default_hash.hash_length());
+
+    HashOperation hash_operation;
+    for(size_t h = 0; h < sizeof(BENCHMARKED_HASHES)/sizeof(BENCHMARKED_HASHES[0]); ++h) {
+        hash_operation.hash = crypto_hash_database(BENCHMARKED_HASHES[h][0]);
+        hash_operation.digest.resize(hash_operation.hash->hash_length());
+        for(size_t i = 0; i < sizeof(HASH_MESSAGE_LENGTHS)/sizeof(size_t); ++i) {
+            hash_operation.message = pseudo_random_qwords(HASH_MESSAGE_LENGTHS[i]);
+            size_t message_bytes = HASH_MESSAGE_LENGTHS[i]*sizeof(uint64_t);
+            QString name = QString(BENCHMARKED_HASHES[h][1]) + '/' + size_name(message_bytes);
+            success&= runner.run(name, message_bytes, hash_operation);
+        }
+    }
+
+    StretchingOperation stretching_operation;
+    stretching_operation.hash = &default_hash;
+    stretching_operation.key = key;
+    success&= runner.run(QString("stretching/%1_iterations").arg((qulonglong) STRETCHING_ITERATIONS),
+                         STRETCHING_ITERATIONS*key.size()*sizeof(uint64_t),
+                         stretching_operation);
+
+    QByteArray password("Benchmark master password");
+    PBKDF2HMACSHA512 pbkdf2(password.constData(), password.size());
+    PBKDF2Operation pbkdf2_operation;
+    pbkdf2_operation.pbkdf2 = &pbkdf2;
+    pbkdf2_operation.salt = "Benchmark service";
+    pbkdf2_operation.key.resize(default_hash.hash_length());
+    success&= runner.run(QString("pbkdf2/%1_iterations").arg((qulonglong) STRETCHING_ITERATIONS),
+                         STRETCHING_ITERATIONS*key.size()*sizeof(uint64_t),
+                         pbkdf2_operation);
+
+    //The generator computes HMACs of a 1-qword counter, the cipher of an 8-qword block
+    HMACOperation hmac_operation;
+    hmac_operation.hmac = &default_hmac;
+    hmac_operation.hash = &default_hash;
+    hmac_operation.key = key;
+    hmac_operation.result.resize(default_hash.hash_length());
+    hmac_operation.message = pseudo_random_qwords(1);
+    success&= runner.run("hmac/8B", 8, hmac_operation);
+    hmac_operation.message = pseudo_random_qwords(default_hash.hash_length());
+    success&= runner.run("hmac/64B", 64, hmac_operation);
+
+    CipherRoundTripOperation cipher_operation;
+    cipher_operation.cipher = &default_cipher;
+    cipher_operation.hash = &default_hash;
+    cipher_operation.hashed_key = key;
+    for(size_t i = 0; i < sizeof(CIPHER_MESSAGE_LENGTHS)/sizeof(size_t); ++i) {
+        cipher_operation.message = pseudo_random_qwords(CIPHER_MESSAGE_LENGTHS[i]);
+        cipher_operation.encrypted_message.resize(CIPHER_MESSAGE_LENGTHS[i]);
+        cipher_operation.decrypted_message.resize(CIPHER_MESSAGE_LENGTHS[i]);
+        size_t message_bytes = CIPHER_MESSAGE_LENGTHS[i]*sizeof(uint64_t);
+        QString name = "cipher_round_trip/" + size_name(message_bytes);
+        if(!runner.selected(name)) continue;
+        if(!cipher_operation() || !(cipher_operation.decrypted_message == cipher_operation.message)) {
+            err_stream << "FAIL : " << name << " does not give the initial message back" << endl;
+            success = false;
+            continue;
+        }
+        success&= runner.run(name, message_bytes, cipher_operation);
+    }
+
+    return success;
+}
+
+bool benchmark_password_generation(BenchmarkRunner& runner) {
+    GeneratorOperation generator_operation;
+    generator_operation.generator = &default_generator;
+    generator_operation.hmac = &default_hmac;
+    generator_operation.hash = &default_hash;
+    generator_operation.hashed_key = pseudo_random_qwords(default_hash.hash_length());
+
+    bool success = runner.run("generator/default", 0, generator_operation);
+    generator_operation.constraints.case_sensitivity = true;
+    generator_operation.constraints.maximal_length = 0;
+    success&= runner.run("generator/case_sensitive_unlimited", 0, generator_operation);
+    generator_operation.constraints.number_of_caps = 2;
+    generator_operation.constraints.number_of_digits = 2;
+    generator_operation.constraints.maximal_length = 12;
+    success&= runner.run("generator/caps_digits_length_12", 0, generator_operation);
+    generator_operation.constraints = default_constraints;
+    generator_operation.constraints.extra_symbols = "&_@$-+";
+    generator_operation.constraints.maximal_length = 8;
+    success&= runner.run("generator/extra_symbols_length_8", 0, generator_operation);
+
+    return success;
+}
+
+bool benchmark_conversions(BenchmarkRunner& runner) {
+    //Optimized conversions must give the same results as the code they replace
+    QVector<uint64_t> data = pseudo_random_qwords(HEX_QWORD_COUNT);
+    QVector<uint64_t> legacy_data(HEX_QWORD_COUNT), codec_data(HEX_QWORD_COUNT);
+    QString legacy_text, codec_text;
+    legacy_qwords_to_hex_str(HEX_QWORD_COUNT, data.constData(), legacy_text);
+    qwords_to_hex_str(HEX_QWORD_COUNT, data.constData(), codec_text);
+    legacy_qwords_from_hex_str(legacy_text, legacy_data.data());
+    if(!qwords_from_hex_str(codec_text, codec_data.data())) codec_data.fill(0);
+    if(!(legacy_text == codec_text) || !(legacy_data == data) || !(codec_data == data)) {
+        err_stream << "FAIL : hex conversions disagree" << endl;
+        return false;
+    }
+    size_t hex_text_bytes = codec_text.size()*sizeof(QChar);
+    QString string = QString("Service number 42, with a longer name").left(RAW_STRING_LENGTH);
+    QVector<uint64_t> legacy_qwords(qword_length_raw(string)), qwords(qword_length_raw(string));
+    legacy_qwords_from_raw_str(string, legacy_qwords.data());
+    qwords_from_raw_str(string, qwords.data());
+    legacy_qwords_to_raw_str(qwords.size(), qwords.constData(), legacy_text);
+    qwords_to_raw_str(qwords.size(), qwords.constData(), codec_text);
+    if(!(legacy_qwords == qwords) || !(legacy_text == string) || !(codec_text == string)) {
+        err_stream << "FAIL : raw conversions disagree" << endl;
+        return false;
+    }
+
+    bool success = true;
+    size_t raw_text_bytes = string.size()*sizeof(QChar);
+    RawPackingOperation packing_operation;
+    packing_operation.text = string;
+    packing_operation.data = qwords;
+    packing_operation.pack = legacy_qwords_from_raw_str;
+    success&= runner.run("raw_pack/per_char", raw_text_bytes, packing_operation);
+    packing_operation.pack = qwords_from_raw_str;
+    success&= runner.run("raw_pack/vectorized", raw_text_bytes, packing_operation);
+    RawUnpackingOperation unpacking_operation;
+    unpacking_operation.data = qwords;
+    unpacking_operation.unpack = legacy_qwords_to_raw_str;
+    success&= runner.run("raw_unpack/per_char", raw_text_bytes, unpacking_operation);
+    unpacking_operation.unpack = qwords_to_raw_str;
+    success&= runner.run("raw_unpack/vectorized", raw_text_bytes, unpacking_operation);
+
+    HexEncodingOperation encoding_operation;
+    encoding_operation.data = data;
+    encoding_operation.encode = legacy_qwords_to_hex_str;
+    success&= runner.run("hex_encode/per_char", hex_text_bytes, encoding_operation);
+    encoding_operation.encode = qwords_to_hex_str;
+    success&= runner.run("hex_encode/codec", hex_text_bytes, encoding_operation);
+    HexDecodingOperation decoding_operation;
+    decoding_operation.text = encoding_operation.text;
+    decoding_operation.data.resize(HEX_QWORD_COUNT);
+    decoding_operation.decode = legacy_qwords_from_hex_str;
+    success&= runner.run("hex_decode/per_char", hex_text_bytes, decoding_operation);
+    decoding_operation.decode = qwords_from_hex_str;
+    success&= runner.run("hex_decode/codec", hex_text_bytes, decoding_operation);
+
+    return success;
+}
+
+bool benchmark_service_db_parsing(BenchmarkRunner& runner) {
+    if(!runner.selected("service_db/line_parser") && !runner.selected("service_db/tokenizer")) return true;
+    QByteArray service_db_data = synthetic_service_database(SYNTHETIC_SERVICE_COUNT);
+
+    //Both parsers must produce the same structures
+    ServiceIndex legacy_index, tokenizer_index;
+    if(!legacy_parse_service_db(service_db_data, legacy_index)
+       || !tokenizer_parse_service_db(service_db_data, tokenizer_index)) {
+        err_stream << "FAIL : the synthetic service database could not be parsed" << endl;
+        return false;
+    }
+    bool same_result = (legacy_index.service_names == tokenizer_index.service_names)
+                    && (legacy_index.service_names.count() == SYNTHETIC_SERVICE_COUNT);
+    for(int i = 0; same_result && (i < legacy_index.service_names.count()); ++i) {
+        const QString& service_name = legacy_index.service_names.at(i);
+        same_result = (legacy_index.service_filenames.value(service_name)
+                       == tokenizer_index.service_filenames.value(service_name));
+    }
+    if(!same_result) {
+        err_stream << "FAIL : parsers disagree on the synthetic service database" << endl;
+        return false;
+    }
+
+    ServiceDatabaseParsingOperation parsing_operation;
+    parsing_operation.service_db_data = service_db_data;
+    parsing_operation.parser = legacy_parse_service_db;
+    bool success = runner.run("service_db/line_parser", service_db_data.size(), parsing_operation);
+    parsing_operation.parser = tokenizer_parse_service_db;
+    success&= runner.run("service_db/tokenizer", service_db_data.size(), parsing_operation);
+
+    return success;
+}
+
+bool benchmark_descriptors(BenchmarkRunner& runner, const QString& work_directory) {
+    DescriptorOperation descriptor_operation;
+    descriptor_operation.service.reset("Benchmark service", STRETCHING_ITERATIONS);
+    descriptor_operation.filepath = QDir(work_directory).filePath("descriptor.txt");
+    descriptor_operation.master_password = "Benchmark master password";
+
+    descriptor_operation.action = DescriptorOperation::SAVE_TO_STRING;
+    bool success = runner.run("descriptor/save_to_string", 0, descriptor_operation);
+    descriptor_operation.action = DescriptorOperation::COMPUTE_PASSWORD;
+    success&= runner.run(QString("descriptor/compute_password_%1_iterations").arg((qulonglong) STRETCHING_ITERATIONS),
+                         0,
+                         descriptor_operation);
+    descriptor_operation.service.key_derivation = PBKDF2_HMAC_SHA512;
+    success&= runner.run(QString("descriptor/compute_password_pbkdf2_%1_iterations").arg((qulonglong) STRETCHING_ITERATIONS),
+                         0,
+                         descriptor_operation);
+    descriptor_operation.service.key_derivation = ITERATED_HASH;
+    descriptor_operation.action = DescriptorOperation::SAVE_TO_FILE;
+    success&= runner.run("descriptor/save_to_file", 0, descriptor_operation);
+    descriptor_operation.action = DescriptorOperation::LOAD_FROM_FILE;
+    success&= runner.run("descriptor/load_from_file", 0, descriptor_operation);
+
+    return success;
+}
+
+bool benchmark_service_store(BenchmarkRunner& runner, const QString& work_directory) {
+    if(!runner.selected("store/open") && !runner.selected("store/lookup") && !runner.selected("store/save")) return true;
+
+    //Fill a data directory of our own with services
+    ServiceStoreOperation store_operation;
+    store_operation.data_location = QDir(work_directory).filePath("data");
+    store_operation.current_service = 0;
+    ServiceManager service_manager(CLIENT_INSTANCE, store_operation.data_location);
+    store_operation.service_manager = &service_manager;
+    for(int i = 0; i < STORE_SERVICE_COUNT; ++i) {
+        store_operation.service.reset(QString("Service number %1").arg(i), STRETCHING_ITERATIONS);
+        if(!service_manager.write_service(QString(), store_operation.service.service_name, store_operation.service)) {
+            err_stream << "FAIL : the benchmark's service store could not be created" << endl;
+            return false;
+        }
+    }
+
+    store_operation.action = ServiceStoreOperation::OPEN;
+    bool success = runner.run("store/open", 0, store_operation);
+    store_operation.action = ServiceStoreOperation::LOOKUP;
+    success&= runner.run("store/lookup", 0, store_operation);
+    store_operation.action = ServiceStoreOperation::SAVE;
+    success&= runner.run("store/save", 0, store_operation);
+
+    return success;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    //Parse options
+    QStringList arguments = app.arguments();
+    arguments.removeFirst();
+    OutputFormat format = TEXT_OUTPUT;
+    QString filter, baseline_filepath;
+    int sampling_time = DEFAULT_SAMPLING_TIME;
+    while(!arguments.isEmpty()) {
+        QString option = arguments.takeFirst();
+        bool valid_option = true;
+        if(option == "--csv") {
+            format = CSV_OUTPUT;
+        } else if((option == "--filter") && !arguments.isEmpty()) {
+            filter = arguments.takeFirst();
+        } else if((option == "--time") && !arguments.isEmpty()) {
+            sampling_time = arguments.takeFirst().toInt(&valid_option);
+        } else if((option == "--baseline") && !arguments.isEmpty()) {
+            baseline_filepath = arguments.takeFirst();
+        } else {
+            valid_option = false;
+        }
+        if(!valid_option) {
+            err_stream << USAGE.arg(DEFAULT_SAMPLING_TIME) << endl;
+            return 2;
+        }
+    }
+
+    BenchmarkRunner runner(out_stream, format);
+    runner.set_filter(filter);
+    runner.set_sampling_time(sampling_time);
+    if(!baseline_filepath.isEmpty() && !runner.load_baseline(baseline_filepath)) {
+        err_stream << "Could not read the baseline file " << baseline_filepath << endl;
+        return 2;
+    }
+
+    //Files are written in a temporary directory, removed afterwards
+    QString work_directory = QDir::temp().filePath(QString("hashish-bench-%1").arg(app.applicationPid()));
+    if(!QDir().mkpath(work_directory)) {
+        err_stream << "Could not create the temporary directory " << work_directory << endl;
+        return 1;
+    }
+
+    bool success = benchmark_cryptography(runner);
+    success&= benchmark_password_generation(runner);
+    success&= benchmark_conversions(runner);
+    success&= benchmark_service_db_parsing(runner);
+    success&= benchmark_descriptors(runner, work_directory);
+    success&= benchmark_service_store(runner, work_directory);
+
+    remove_directory(work_directory);
+    return success ? 0 : 1;
+}
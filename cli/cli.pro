@@ -0,0 +1,25 @@
+# Hashish's command line front end : only depends on QtCore and QtNetwork (through the core
+# library), so that it starts quickly enough to be used from scripts.
+
+TARGET = hashish-cli
+CONFIG += console
+CONFIG -= app_bundle
+QT -= gui
+
+QMAKE_CXXFLAGS += -std=c++0x -U__STRICT_ANSI__ -Wall
+
+include(../core/hashish-core.pri)
+
+SOURCES += main.cpp
+
+# make install rule
+unix {
+    isEmpty(PREFIX) {
+        PREFIX = /usr/local
+    }
+
+    binaries.path  = $$PREFIX/bin
+    binaries.files = $$TARGET
+
+    INSTALLS += binaries
+}
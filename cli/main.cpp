@@ -0,0 +1,579 @@
+/* Hashish's command line front end : generates and manages service passwords without loading
+   the graphical interface, so that Hashish can be used from scripts.
+
+      Copyright (C) 2011  Hadrien Grasland
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA */
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QStringList>
+#include <QTextStream>
+#include <stdio.h>
+#ifdef Q_OS_UNIX
+    #include <termios.h>
+    #include <unistd.h>
+#endif
+#ifdef Q_OS_WIN32
+    #include <windows.h>
+#endif
+
+#include <file_hash.h>
+#include <parsing_tools.h>
+#include <password_batch.h>
+#include <service_descriptor.h>
+#include <service_import.h>
+#include <service_manager.h>
+#include <store_snapshot.h>
+
+const QString USAGE("Usage : hashish-cli [--data-dir <directory>] <command> [arguments]\n"
+                    "\n"
+                    "Commands :\n"
+                    "  list                     Lists registered services\n"
+                    "  generate <service>...    Prints the password of a service. With several services,\n"
+                    "                           prints \"<service><tab><password>\" lines as passwords are\n"
+                    "                           computed in parallel\n"
+                    "  encrypt <service>        Stores a password of your choice for a service, encrypted\n"
+                    "                           with the master password (creates the service if needed)\n"
+                    "  export <service> [file]  Writes the descriptor of a service to a file, or to the\n"
+                    "                           standard output\n"
+                    "  import <file> [service]  Registers a service from a descriptor file, optionally\n"
+                    "                           under another name\n"
+                    "  import-passwords [--pbkdf2] <file>\n"
+                    "                           Stores every password of a CSV or KeePass XML export as a\n"
+                    "                           new service, encrypted with the master password\n"
+                    "  snapshot [--full] <directory>\n"
+                    "                           Saves an encrypted snapshot of the services and settings\n"
+                    "                           in a directory, with only what changed since the last one\n"
+                    "                           unless --full is given\n"
+                    "  check-snapshot <directory> [number]\n"
+                    "                           Checks the integrity of a snapshot (the last one by\n"
+                    "                           default) and of those it depends on\n"
+                    "  restore-snapshot <directory> [number]\n"
+                    "                           Replaces the services and settings with those of a\n"
+                    "                           snapshot, once it has been checked\n"
+                    "  sha512sum <file>...      Prints the SHA-512 digests of files in sha512sum's format\n"
+                    "                           (\"-\" is the standard input), hashing them concurrently\n"
+                    "  sha512sum --check <file>...\n"
+                    "                           Checks files against digests listed in sha512sum's format\n"
+                    "  lock                     Makes the running Hashish instance forget its cached\n"
+                    "                           stretched keys (e.g. from a screen locker hook)\n"
+                    "\n"
+                    "Passwords are read from the standard input, one per line, and are not echoed on\n"
+                    "terminals.");
+
+const QString ERR_ALREADY_EXISTS("A service called %1 already exists.");
+const QString ERR_BAD_CHECKSUM_LINES("%1 : %2 line(s) are not properly formatted.");
+const QString ERR_BAD_SNAPSHOT_NUMBER("%1 is not a snapshot number.");
+const QString ERR_CHECKSUM_MISMATCH("%1 computed checksum(s) did not match.");
+const QString ERR_INSTANCE_NOT_RUNNING("Hashish is not running, no key is cached.");
+const QString ERR_INSTANCE_RUNNING("Hashish is running. Please close it before modifying services.");
+const QString ERR_OPERATION_FAILED("%1 failed, see the error log for details.");
+const QString ERR_SELF_TEST_FAILED("Cryptographic self-test failed, Hashish cannot be used safely.");
+const QString ERR_UNKNOWN_FORMAT("%1 : unknown export format (expected a .csv or .xml file).");
+const QString ERR_UNKNOWN_SERVICE("Unknown service : %1");
+const QString ERR_UNREADABLE_FILE("%1 could not be read.");
+
+const int SHA512_HEX_LENGTH = 128;
+
+enum ExitCode {SUCCESS = 0, FAILURE, BAD_USAGE};
+
+QTextStream err_stream(stderr);
+QTextStream in_stream(stdin);
+QTextStream out_stream(stdout);
+
+bool read_secret(const QString& prompt, QString& dest_buffer) {
+    //Prompts are only useful (and passwords only need hiding) on terminals
+    bool terminal = false;
+    #ifdef Q_OS_UNIX
+        struct termios previous_settings;
+        terminal = isatty(STDIN_FILENO) && (tcgetattr(STDIN_FILENO, &previous_settings) == 0);
+        if(terminal) {
+            struct termios silent_settings = previous_settings;
+            silent_settings.c_lflag&= ~ECHO;
+            tcsetattr(STDIN_FILENO, TCSAFLUSH, &silent_settings);
+        }
+    #endif
+    #ifdef Q_OS_WIN32
+        HANDLE console = GetStdHandle(STD_INPUT_HANDLE);
+        DWORD previous_mode;
+        terminal = GetConsoleMode(console, &previous_mode);
+        if(terminal) SetConsoleMode(console, previous_mode & ~ENABLE_ECHO_INPUT);
+    #endif
+    if(terminal) err_stream << prompt << " : " << flush;
+
+    dest_buffer = in_stream.readLine();
+
+    if(terminal) err_stream << endl;
+    #ifdef Q_OS_UNIX
+        if(terminal) tcsetattr(STDIN_FILENO, TCSAFLUSH, &previous_settings);
+    #endif
+    #ifdef Q_OS_WIN32
+        if(terminal) SetConsoleMode(console, previous_mode);
+    #endif
+
+    return !dest_buffer.isNull();
+}
+
+bool service_exists(ServiceManager& service_manager, const QString& service_name) {
+    //Service names are unique regardless of case
+    const QStringList& service_names = service_manager.service_names();
+    int position = case_insensitive_lower_bound(service_names, service_name);
+    if(position == service_names.count()) return false;
+    return (service_names.at(position).compare(service_name, Qt::CaseInsensitive) == 0);
+}
+
+int check_snapshot(ServiceManager& service_manager, const QString& snapshot_location, const uint64_t number) {
+    QString password;
+    if(!read_secret("Snapshot password", password)) return FAILURE;
+    if(!service_manager.wait_for_self_test()) {
+        err_stream << ERR_SELF_TEST_FAILED << endl;
+        return FAILURE;
+    }
+    SnapshotReport report;
+    bool success = restore_snapshot(QDir(snapshot_location), number, password, NULL, QStringList(), report);
+    password.clear();
+    if(!success) {
+        err_stream << ERR_OPERATION_FAILED.arg("Snapshot check") << endl;
+        return FAILURE;
+    }
+
+    out_stream << "Snapshot " << report.number << " is intact (" << report.total_files << " files)." << endl;
+    return SUCCESS;
+}
+
+int encrypt(ServiceManager& service_manager, const QString& service_name) {
+    if(service_manager.already_running()) {
+        err_stream << ERR_INSTANCE_RUNNING << endl;
+        return FAILURE;
+    }
+
+    //Encrypt the password of existing services, create a default descriptor for other ones
+    ServiceDescriptor service(service_name, service_manager.current_iterations());
+    bool existing_service = (case_insensitive_find(service_manager.service_names(), service_name) != -1);
+    if(existing_service) {
+        if(!service_manager.copy_service(service_name, service)) {
+            err_stream << ERR_OPERATION_FAILED.arg("Service loading") << endl;
+            return FAILURE;
+        }
+    } else if(service_exists(service_manager, service_name)) {
+        err_stream << ERR_ALREADY_EXISTS.arg(service_name) << endl;
+        return FAILURE;
+    }
+
+    QString master_pw, service_pw;
+    if(!read_secret("Master password", master_pw)) return FAILURE;
+    if(!read_secret("Service password", service_pw)) return FAILURE;
+    if(!service_manager.wait_for_self_test()) {
+        err_stream << ERR_SELF_TEST_FAILED << endl;
+        return FAILURE;
+    }
+    bool success = service.encrypt_password(master_pw, service_pw);
+    master_pw.clear();
+    service_pw.clear();
+    if(success) {
+        success = service_manager.write_service(existing_service ? service_name : QString(),
+                                                service_name,
+                                                service);
+    }
+    if(!success) {
+        err_stream << ERR_OPERATION_FAILED.arg("Encryption") << endl;
+        return FAILURE;
+    }
+
+    return SUCCESS;
+}
+
+int export_service(ServiceManager& service_manager, const QString& service_name, const QString& filepath) {
+    ServiceDescriptor service;
+    if(!service_manager.copy_service(service_name, service)) {
+        err_stream << ERR_UNKNOWN_SERVICE.arg(service_name) << endl;
+        return FAILURE;
+    }
+
+    //Write the descriptor to the requested file, or to the standard output
+    bool success;
+    if(filepath.isEmpty()) {
+        QString descriptor;
+        success = (service.save_to_string(descriptor) != NULL);
+        if(success) out_stream << descriptor << flush;
+    } else {
+        success = service.save_to_file(filepath);
+    }
+    if(!success) {
+        err_stream << ERR_OPERATION_FAILED.arg("Export") << endl;
+        return FAILURE;
+    }
+
+    return SUCCESS;
+}
+
+//Prints the results of a password batch as they come
+class BatchPrinter : public PasswordBatchReceiver {
+  public:
+    BatchPrinter(const QStringList& service_names) : service_names(service_names), failures(0) {}
+    int failure_count() {return failures;}
+    void password_computed(int service_index, bool success, const QString& password) {
+        QMutexLocker lock(&output_mutex);
+        if(success) {
+            out_stream << service_names.at(service_index) << '\t' << password << endl;
+        } else {
+            err_stream << ERR_OPERATION_FAILED.arg("Password generation for " + service_names.at(service_index)) << endl;
+            ++failures;
+        }
+    }
+
+  private:
+    QMutex output_mutex;
+    QStringList service_names;
+    int failures;
+};
+
+int generate_batch(ServiceManager& service_manager, const QStringList& service_names) {
+    QString master_pw;
+    if(!read_secret("Master password", master_pw)) return FAILURE;
+    PasswordBatch batch(master_pw);
+    master_pw.clear();
+    for(int i = 0; i < service_names.count(); ++i) {
+        ServiceDescriptor service;
+        if(!service_manager.copy_service(service_names.at(i), service)) {
+            err_stream << ERR_UNKNOWN_SERVICE.arg(service_names.at(i)) << endl;
+            return FAILURE;
+        }
+        if(batch.add_service(service) < 0) {
+            err_stream << ERR_OPERATION_FAILED.arg("Password generation") << endl;
+            return FAILURE;
+        }
+    }
+    if(!service_manager.wait_for_self_test()) {
+        err_stream << ERR_SELF_TEST_FAILED << endl;
+        return FAILURE;
+    }
+
+    BatchPrinter printer(service_names);
+    if(!batch.start(&printer)) {
+        err_stream << ERR_OPERATION_FAILED.arg("Password generation") << endl;
+        return FAILURE;
+    }
+    batch.wait();
+
+    return printer.failure_count() ? FAILURE : SUCCESS;
+}
+
+int generate(ServiceManager& service_manager, const QString& service_name) {
+    ServiceDescriptor service;
+    if(!service_manager.copy_service(service_name, service)) {
+        err_stream << ERR_UNKNOWN_SERVICE.arg(service_name) << endl;
+        return FAILURE;
+    }
+
+    QString master_pw, service_pw;
+    if(!read_secret("Master password", master_pw)) return FAILURE;
+    if(!service_manager.wait_for_self_test()) {
+        err_stream << ERR_SELF_TEST_FAILED << endl;
+        return FAILURE;
+    }
+    bool success = (service.compute_password(master_pw, service_pw) != NULL);
+    master_pw.clear();
+    if(!success) {
+        err_stream << ERR_OPERATION_FAILED.arg("Password generation") << endl;
+        return FAILURE;
+    }
+    out_stream << service_pw << endl;
+    service_pw.clear();
+
+    return SUCCESS;
+}
+
+int import_service(ServiceManager& service_manager, const QString& filepath, const QString& new_name) {
+    if(service_manager.already_running()) {
+        err_stream << ERR_INSTANCE_RUNNING << endl;
+        return FAILURE;
+    }
+
+    ServiceDescriptor service;
+    if(!service.load_from_file(filepath)) {
+        err_stream << ERR_OPERATION_FAILED.arg("Import") << endl;
+        return FAILURE;
+    }
+    if(!new_name.isEmpty()) service.service_name = new_name;
+    if(service_exists(service_manager, service.service_name)) {
+        err_stream << ERR_ALREADY_EXISTS.arg(service.service_name) << endl;
+        return FAILURE;
+    }
+    if(!service_manager.write_service(QString(), service.service_name, service)) {
+        err_stream << ERR_OPERATION_FAILED.arg("Import") << endl;
+        return FAILURE;
+    }
+
+    return SUCCESS;
+}
+
+int import_passwords(ServiceManager& service_manager, const QString& filepath, const KeyDerivation key_derivation) {
+    if(service_manager.already_running()) {
+        err_stream << ERR_INSTANCE_RUNNING << endl;
+        return FAILURE;
+    }
+
+    QString format = credential_format(filepath);
+    if(format.isEmpty()) {
+        err_stream << ERR_UNKNOWN_FORMAT.arg(filepath) << endl;
+        return FAILURE;
+    }
+    QFile input(filepath);
+    if(!input.open(QIODevice::ReadOnly)) {
+        err_stream << ERR_UNREADABLE_FILE.arg(filepath) << endl;
+        return FAILURE;
+    }
+    CredentialReader* reader = new_credential_reader(format, &input);
+    if(!reader) return FAILURE;
+
+    QString master_pw;
+    bool success = read_secret("Master password", master_pw);
+    if(success && !service_manager.wait_for_self_test()) {
+        err_stream << ERR_SELF_TEST_FAILED << endl;
+        success = false;
+    }
+    ImportReport report;
+    if(success) {
+        success = service_manager.import_services(*reader, master_pw, key_derivation, report);
+        if(!success) err_stream << ERR_OPERATION_FAILED.arg("Import") << endl;
+    }
+    master_pw.clear();
+    delete reader;
+    if(!success) return FAILURE;
+
+    for(int i = 0; i < report.skipped.count(); ++i) err_stream << "Skipped : " << report.skipped.at(i) << endl;
+    out_stream << report.imported << " service(s) imported." << endl;
+    return SUCCESS;
+}
+
+int list(ServiceManager& service_manager) {
+    const QStringList& service_names = service_manager.service_names();
+    for(int i = 0; i < service_names.count(); ++i) out_stream << service_names.at(i) << endl;
+
+    return SUCCESS;
+}
+
+int lock(ServiceManager& service_manager) {
+    if(!service_manager.lock_running_instance()) err_stream << ERR_INSTANCE_NOT_RUNNING << endl;
+
+    return SUCCESS;
+}
+
+int restore(ServiceManager& service_manager, const QString& snapshot_location, const uint64_t number) {
+    if(service_manager.already_running()) {
+        err_stream << ERR_INSTANCE_RUNNING << endl;
+        return FAILURE;
+    }
+
+    QString password;
+    if(!read_secret("Snapshot password", password)) return FAILURE;
+    if(!service_manager.wait_for_self_test()) {
+        err_stream << ERR_SELF_TEST_FAILED << endl;
+        return FAILURE;
+    }
+    SnapshotReport report;
+    bool success = service_manager.restore_snapshot(snapshot_location, number, password, report);
+    password.clear();
+    if(!success) {
+        err_stream << ERR_OPERATION_FAILED.arg("Snapshot restoration") << endl;
+        return FAILURE;
+    }
+
+    out_stream << "Snapshot " << report.number << " restored (" << report.total_files << " files)." << endl;
+    return SUCCESS;
+}
+
+int sha512sum(const QStringList& file_paths) {
+    QList<QByteArray> hex_digests = sha512_files(file_paths);
+    int failures = 0;
+    for(int i = 0; i < file_paths.count(); ++i) {
+        if(hex_digests.at(i).isEmpty()) {
+            err_stream << ERR_UNREADABLE_FILE.arg(file_paths.at(i)) << endl;
+            ++failures;
+            continue;
+        }
+        out_stream << hex_digests.at(i).constData() << "  " << file_paths.at(i) << endl;
+    }
+
+    return failures ? FAILURE : SUCCESS;
+}
+
+int sha512sum_check(const QStringList& checksum_paths) {
+    //Gather "<digest>  <file>" lines (or "<digest> *<file>" for binary mode), then hash all files
+    QStringList file_paths;
+    QList<QByteArray> expected_digests;
+    int failures = 0;
+    for(int i = 0; i < checksum_paths.count(); ++i) {
+        QFile checksum_file(checksum_paths.at(i));
+        if(!checksum_file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+            err_stream << ERR_UNREADABLE_FILE.arg(checksum_paths.at(i)) << endl;
+            ++failures;
+            continue;
+        }
+        QTextStream checksum_stream(&checksum_file);
+        int bad_lines = 0;
+        while(!checksum_stream.atEnd()) {
+            QString line = checksum_stream.readLine();
+            if(line.isEmpty()) continue;
+            QString separator = line.mid(SHA512_HEX_LENGTH, 2);
+            if((line.length() <= SHA512_HEX_LENGTH + 2) || ((separator != "  ") && (separator != " *"))) {
+                ++bad_lines;
+                continue;
+            }
+            expected_digests.append(line.left(SHA512_HEX_LENGTH).toLower().toLatin1());
+            file_paths.append(line.mid(SHA512_HEX_LENGTH + 2));
+        }
+        if(bad_lines) err_stream << ERR_BAD_CHECKSUM_LINES.arg(checksum_paths.at(i)).arg(bad_lines) << endl;
+    }
+
+    QList<QByteArray> hex_digests = sha512_files(file_paths);
+    int mismatches = 0;
+    for(int i = 0; i < file_paths.count(); ++i) {
+        if(hex_digests.at(i).isEmpty()) {
+            err_stream << ERR_UNREADABLE_FILE.arg(file_paths.at(i)) << endl;
+            ++failures;
+            continue;
+        }
+        bool match = (hex_digests.at(i) == expected_digests.at(i));
+        out_stream << file_paths.at(i) << (match ? ": OK" : ": FAILED") << endl;
+        if(!match) ++mismatches;
+    }
+    if(mismatches) err_stream << ERR_CHECKSUM_MISMATCH.arg(mismatches) << endl;
+
+    return (failures || mismatches) ? FAILURE : SUCCESS;
+}
+
+int snapshot(ServiceManager& service_manager, const QString& snapshot_location, const bool full) {
+    QString password;
+    if(!read_secret("Snapshot password", password)) return FAILURE;
+    if(!service_manager.wait_for_self_test()) {
+        err_stream << ERR_SELF_TEST_FAILED << endl;
+        return FAILURE;
+    }
+    SnapshotReport report;
+    bool success = service_manager.create_snapshot(snapshot_location, password, full, report);
+    password.clear();
+    if(!success) {
+        err_stream << ERR_OPERATION_FAILED.arg("Snapshot") << endl;
+        return FAILURE;
+    }
+
+    out_stream << "Snapshot " << report.number << " written (" << report.stored_files << " of "
+               << report.total_files << " files stored";
+    if(report.base) out_stream << ", incremental to snapshot " << report.base;
+    out_stream << ")." << endl;
+    return SUCCESS;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    app.setApplicationName("Hashish"); //Locates the data shared with the graphical interface
+
+    //Parse options, then the command and its arguments
+    QStringList arguments = app.arguments();
+    arguments.removeFirst();
+    QString data_location = ServiceManager::default_data_location();
+    if((arguments.count() >= 2) && (arguments.at(0) == "--data-dir")) {
+        data_location = arguments.at(1);
+        arguments.removeFirst();
+        arguments.removeFirst();
+    }
+    if(arguments.isEmpty()) {
+        err_stream << USAGE << endl;
+        return BAD_USAGE;
+    }
+    QString command = arguments.takeFirst();
+    QString first_argument = arguments.value(0);
+    QString second_argument = arguments.value(1);
+
+    //File hashing does not involve the service store
+    if((command == "sha512sum") && (first_argument == "--check") && (arguments.count() >= 2)) {
+        return sha512sum_check(arguments.mid(1));
+    }
+    if((command == "sha512sum") && (arguments.count() >= 1)) {
+        return sha512sum(arguments);
+    }
+
+    ServiceManager service_manager(CLIENT_INSTANCE, data_location);
+
+    if((command == "list") && (arguments.count() == 0)) {
+        return list(service_manager);
+    }
+    if((command == "export") && (arguments.count() >= 1) && (arguments.count() <= 2)) {
+        return export_service(service_manager, first_argument, second_argument);
+    }
+    if((command == "import") && (arguments.count() >= 1) && (arguments.count() <= 2)) {
+        return import_service(service_manager, first_argument, second_argument);
+    }
+    if((command == "lock") && (arguments.count() == 0)) {
+        return lock(service_manager);
+    }
+    uint64_t snapshot_number = 0;
+    if(((command == "check-snapshot") || (command == "restore-snapshot")) && (arguments.count() == 2)) {
+        bool valid_number;
+        snapshot_number = second_argument.toULongLong(&valid_number);
+        if(!valid_number || !snapshot_number) {
+            err_stream << ERR_BAD_SNAPSHOT_NUMBER.arg(second_argument) << endl;
+            return BAD_USAGE;
+        }
+    }
+
+    //Check cryptographic functions while the user types passwords
+    if((command == "generate") && (arguments.count() == 1)) {
+        service_manager.start_self_test();
+        return generate(service_manager, first_argument);
+    }
+    if((command == "generate") && (arguments.count() > 1)) {
+        service_manager.start_self_test();
+        return generate_batch(service_manager, arguments);
+    }
+    if((command == "encrypt") && (arguments.count() == 1)) {
+        service_manager.start_self_test();
+        return encrypt(service_manager, first_argument);
+    }
+    if((command == "import-passwords") && (first_argument == "--pbkdf2") && (arguments.count() == 2)) {
+        service_manager.start_self_test();
+        return import_passwords(service_manager, second_argument, PBKDF2_HMAC_SHA512);
+    }
+    if((command == "import-passwords") && (arguments.count() == 1)) {
+        service_manager.start_self_test();
+        return import_passwords(service_manager, first_argument, ITERATED_HASH);
+    }
+    if((command == "snapshot") && (first_argument == "--full") && (arguments.count() == 2)) {
+        service_manager.start_self_test();
+        return snapshot(service_manager, second_argument, true);
+    }
+    if((command == "snapshot") && (arguments.count() == 1)) {
+        service_manager.start_self_test();
+        return snapshot(service_manager, first_argument, false);
+    }
+    if((command == "check-snapshot") && (arguments.count() >= 1) && (arguments.count() <= 2)) {
+        service_manager.start_self_test();
+        return check_snapshot(service_manager, first_argument, snapshot_number);
+    }
+    if((command == "restore-snapshot") && (arguments.count() >= 1) && (arguments.count() <= 2)) {
+        service_manager.start_self_test();
+        return restore(service_manager, first_argument, snapshot_number);
+    }
+
+    err_stream << USAGE << endl;
+    return BAD_USAGE;
+}
@@ -0,0 +1,474 @@
+/* Command server : serves requests from other processes (scripts, command line tools, new
+   instances of Hashish) on Hashish's per-user local socket.
+
+      Copyright (C) 2011  Hadrien Grasland
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA */
+
+#include <QMetaObject>
+#include <QStringList>
+#ifdef Q_OS_UNIX
+    #include <sys/stat.h>
+#endif
+
+#include <command_server.h>
+#include <delayed_deletion.h>
+#include <key_cache.h>
+#include <error_management.h>
+#include <service_manager.h>
+#include <tracing.h>
+
+const QString COMMAND_SERVER_NAME("CommandServer");
+
+const QByteArray CMD_BATCH("BATCH");
+const QByteArray CMD_GENERATE("GENERATE");
+const QByteArray CMD_LIST("LIST");
+const QByteArray CMD_LOAD("LOAD");
+const QByteArray CMD_LOCK("LOCK");
+const QByteArray CMD_PING("PING");
+const QByteArray CMD_SHOW("SHOW");
+const QByteArray CMD_STATS("STATS");
+const QByteArray CMD_TRACE("TRACE");
+
+const QByteArray PERCENT_ENCODING_EXCLUDE("="); //Keeps STATS values readable
+
+const QByteArray RESPONSE_ERROR("ERROR");
+const QByteArray RESPONSE_OK("OK");
+const QByteArray RESPONSE_PART("PART");
+
+const QString ERR_BAD_ARGUMENT_COUNT("%1 expects %2 argument(s)");
+const QString ERR_BATCH_TOO_SHORT("BATCH expects a master password and at least one service name");
+const QString ERR_GENERATION_FAILED("Password generation failed");
+const QString ERR_LOADING_FAILED("Service loading failed");
+const QString ERR_MALFORMED_REQUEST("Malformed request");
+const QString ERR_SELF_TEST_FAILED("Cryptographic self-test failed, password generation is disabled");
+const QString ERR_UNKNOWN_COMMAND("Unknown command : %1");
+const QString ERR_UNKNOWN_SERVICE("Unknown service : %1");
+
+CommandServer::CommandServer(ServiceManager& service_manager,
+                             QObject* parent) : QObject(parent),
+                                                next_batch_id(0),
+                                                next_job_id(0),
+                                                server(NULL),
+                                                service_man(&service_manager),
+                                                connections(0),
+                                                errors(0),
+                                                requests(0) {
+    uptime.start();
+}
+
+CommandServer::~CommandServer() {
+    close();
+
+    //Jobs report to this object, so they must be done before it goes away
+    worker_pool.waitForDone();
+    while(queued_jobs.isEmpty() == false) delete queued_jobs.takeFirst();
+    QList<int> batch_ids = pending_batches.keys();
+    for(int i = 0; i < batch_ids.count(); ++i) {
+        PendingBatch pending_batch = pending_batches.take(batch_ids.at(i));
+        delete pending_batch.batch;
+        delete pending_batch.reporter;
+    }
+}
+
+bool CommandServer::listen(const QString& socket_name) {
+    if(!server) server = new QLocalServer(this);
+    if(!server) {
+        log_error(COMMAND_SERVER_NAME, ERR_BAD_ALLOC.arg(QString("server")));
+        return false;
+    }
+    connect(server, SIGNAL(newConnection()), this, SLOT(new_connection()), Qt::UniqueConnection);
+
+    //Master passwords go through the socket, so only its owner may access it
+    #ifdef Q_OS_UNIX
+        mode_t previous_umask = umask(S_IRWXG | S_IRWXO);
+    #endif
+    bool success = server->listen(socket_name);
+    #ifdef Q_OS_UNIX
+        umask(previous_umask);
+    #endif
+    if(!success) {
+        static const QString ERR_LISTEN_FAILED("Could not listen on socket %1 : %2");
+        log_error(COMMAND_SERVER_NAME, ERR_LISTEN_FAILED.arg(socket_name).arg(server->errorString()));
+        return false;
+    }
+
+    return true;
+}
+
+void CommandServer::close() {
+    if(server) server->close();
+}
+
+void CommandServer::self_test_finished(bool passed) {
+    //Start or reject the password generation jobs which were waiting for the test results
+    while(queued_jobs.isEmpty() == false) {
+        PasswordJob* job = queued_jobs.takeFirst();
+        if(passed) {
+            worker_pool.start(job);
+        } else {
+            PendingJob pending_job = pending_jobs.take(job->id());
+            delete job;
+            send_error(pending_job.client, pending_job.tag, ERR_SELF_TEST_FAILED);
+        }
+    }
+    while(queued_batches.isEmpty() == false) {
+        int batch_id = queued_batches.takeFirst();
+        PendingBatch& pending_batch = pending_batches[batch_id];
+        if(!passed || !pending_batch.batch->start(pending_batch.reporter)) {
+            send_error(pending_batch.client, pending_batch.tag, passed ? ERR_GENERATION_FAILED : ERR_SELF_TEST_FAILED);
+            finish_batch(batch_id);
+        }
+    }
+}
+
+void CommandServer::client_disconnected() {
+    QLocalSocket* client = qobject_cast<QLocalSocket*>(sender());
+    if(!client) return;
+
+    //Responses to pending jobs of that client will be dropped
+    --connections;
+    client->deleteLater();
+}
+
+void CommandServer::batch_password_computed(int batch_id, int service_index, bool success, const QString& password) {
+    if(!pending_batches.contains(batch_id)) return;
+    PendingBatch& pending_batch = pending_batches[batch_id];
+    QList<QByteArray> values;
+    values << pending_batch.service_names.value(service_index);
+    if(success) {
+        values << RESPONSE_OK << password.toUtf8();
+    } else {
+        ++errors;
+        values << RESPONSE_ERROR << ERR_GENERATION_FAILED.toUtf8();
+    }
+    send_part(pending_batch.client, pending_batch.tag, values);
+
+    //Answer the request once every password has been sent
+    --pending_batch.passwords_left;
+    if(pending_batch.passwords_left == 0) {
+        send_response(pending_batch.client, pending_batch.tag, QList<QByteArray>());
+        finish_batch(batch_id);
+    }
+}
+
+void CommandServer::job_finished(int job_id, bool success, const QString& password) {
+    PendingJob pending_job = pending_jobs.take(job_id);
+    if(success) {
+        send_response(pending_job.client, pending_job.tag, QList<QByteArray>() << password.toUtf8());
+    } else {
+        send_error(pending_job.client, pending_job.tag, ERR_GENERATION_FAILED);
+    }
+}
+
+void CommandServer::new_connection() {
+    QLocalSocket* client = server->nextPendingConnection();
+    while(client) {
+        ++connections;
+        connect(client, SIGNAL(readyRead()), this, SLOT(read_requests()));
+        connect(client, SIGNAL(disconnected()), this, SLOT(client_disconnected()));
+        client = server->nextPendingConnection();
+    }
+}
+
+void CommandServer::read_requests() {
+    QLocalSocket* client = qobject_cast<QLocalSocket*>(sender());
+    if(!client) return;
+
+    //Handle every complete request line, in order
+    bool too_long = false;
+    while(client->canReadLine()) {
+        QByteArray request = client->readLine();
+        too_long = (request.size() > MAX_REQUEST_LENGTH);
+        if(too_long) break;
+        while(request.endsWith('\n') || request.endsWith('\r')) request.chop(1);
+        handle_request(client, request);
+        request.fill(0); //May contain a master password
+    }
+
+    //Do not let a client make us buffer data forever
+    if(too_long || client->bytesAvailable() > MAX_REQUEST_LENGTH) {
+        static const QString ERR_REQUEST_TOO_LONG("Request too long, dropping connection");
+        log_event(LOG_WARNING, COMMAND_SERVER_NAME, ERR_REQUEST_TOO_LONG);
+        ++errors;
+        client->abort();
+    }
+}
+
+void CommandServer::handle_request(QLocalSocket* client, const QByteArray& request) {
+    ++requests;
+
+    //Split the request into tag, command and arguments
+    QList<QByteArray> arguments = request.split(' ');
+    if(arguments.count() < 2) {
+        send_error(client, arguments.first(), ERR_MALFORMED_REQUEST);
+        return;
+    }
+    QByteArray tag = arguments.takeFirst();
+    QByteArray command = arguments.takeFirst();
+    for(int i = 0; i < arguments.count(); ++i) {
+        QByteArray decoded_argument = QByteArray::fromPercentEncoding(arguments.at(i));
+        arguments[i].fill(0);
+        arguments[i] = decoded_argument;
+    }
+
+    //Run the command
+    if(command == CMD_BATCH) {
+        handle_batch(client, tag, arguments);
+    } else if(command == CMD_GENERATE) {
+        handle_generate(client, tag, arguments);
+    } else if(command == CMD_LIST) {
+        handle_list(client, tag);
+    } else if(command == CMD_LOAD) {
+        handle_load(client, tag, arguments);
+    } else if(command == CMD_LOCK) {
+        stretched_key_cache.lock();
+        send_response(client, tag, QList<QByteArray>());
+    } else if(command == CMD_PING) {
+        send_response(client, tag, QList<QByteArray>());
+    } else if(command == CMD_SHOW) {
+        send_response(client, tag, QList<QByteArray>());
+        emit show_requested();
+    } else if(command == CMD_STATS) {
+        handle_stats(client, tag);
+    } else if(command == CMD_TRACE) {
+        send_response(client, tag, QList<QByteArray>() << pipeline_tracer.chrome_trace());
+    } else {
+        send_error(client, tag, ERR_UNKNOWN_COMMAND.arg(QString::fromUtf8(command)));
+    }
+
+    //Master passwords have been converted by the jobs which need them, wipe the decoded ones
+    for(int i = 0; i < arguments.count(); ++i) arguments[i].fill(0);
+}
+
+void CommandServer::finish_batch(const int batch_id) {
+    //Deleting the batch waits for its last job to return
+    PendingBatch pending_batch = pending_batches.take(batch_id);
+    delete pending_batch.batch;
+    delete pending_batch.reporter;
+}
+
+void CommandServer::handle_batch(QLocalSocket* client, const QByteArray& tag, const QList<QByteArray>& arguments) {
+    if(arguments.count() < 2) {
+        send_error(client, tag, ERR_BATCH_TOO_SHORT);
+        return;
+    }
+    if(service_man->crypto_function_tests_done() && !service_man->crypto_function_tests_passed()) {
+        send_error(client, tag, ERR_SELF_TEST_FAILED);
+        return;
+    }
+
+    //Set up the batch on copies of the service descriptors. Batches share the server's worker pool,
+    //so that concurrent clients do not get one thread per core each.
+    PendingBatch pending_batch;
+    pending_batch.client = client;
+    pending_batch.tag = tag;
+    QString master_password = QString::fromUtf8(arguments.at(0));
+    pending_batch.batch = new PasswordBatch(master_password, &worker_pool);
+    master_password.fill(QChar(0));
+    pending_batch.reporter = new BatchReporter(this, next_batch_id);
+    if(!pending_batch.batch || !pending_batch.reporter) {
+        log_error(COMMAND_SERVER_NAME, ERR_BAD_ALLOC.arg(QString("pending_batch")));
+        if(pending_batch.batch) delete pending_batch.batch;
+        if(pending_batch.reporter) delete pending_batch.reporter;
+        send_error(client, tag, ERR_GENERATION_FAILED);
+        return;
+    }
+    for(int i = 1; i < arguments.count(); ++i) {
+        QString service_name = QString::fromUtf8(arguments.at(i));
+        ServiceDescriptor service;
+        bool success = service_man->copy_service(service_name, service);
+        if(success) success = (pending_batch.batch->add_service(service) >= 0);
+        if(!success) {
+            delete pending_batch.batch;
+            delete pending_batch.reporter;
+            send_error(client, tag, ERR_UNKNOWN_SERVICE.arg(service_name));
+            return;
+        }
+        pending_batch.service_names.append(arguments.at(i));
+    }
+    pending_batch.passwords_left = pending_batch.service_names.count();
+    int batch_id = next_batch_id;
+    pending_batches.insert(batch_id, pending_batch);
+    ++next_batch_id;
+
+    //Password generation must wait until cryptographic functions have been checked
+    if(service_man->crypto_function_tests_done()) {
+        if(!pending_batch.batch->start(pending_batch.reporter)) {
+            send_error(client, tag, ERR_GENERATION_FAILED);
+            finish_batch(batch_id);
+        }
+    } else {
+        queued_batches.append(batch_id);
+    }
+}
+
+void CommandServer::handle_generate(QLocalSocket* client, const QByteArray& tag, const QList<QByteArray>& arguments) {
+    if(arguments.count() != 2) {
+        send_error(client, tag, ERR_BAD_ARGUMENT_COUNT.arg(QString(CMD_GENERATE)).arg(2));
+        return;
+    }
+    if(service_man->crypto_function_tests_done() && !service_man->crypto_function_tests_passed()) {
+        send_error(client, tag, ERR_SELF_TEST_FAILED);
+        return;
+    }
+
+    //Jobs work on a copy of the service descriptor, so that the GUI may keep using the original
+    QString service_name = QString::fromUtf8(arguments.at(0));
+    ServiceDescriptor service;
+    if(!service_man->copy_service(service_name, service)) {
+        send_error(client, tag, ERR_UNKNOWN_SERVICE.arg(service_name));
+        return;
+    }
+    PasswordJob* job = new PasswordJob(this, next_job_id, service, QString::fromUtf8(arguments.at(1)));
+    if(!job) {
+        log_error(COMMAND_SERVER_NAME, ERR_BAD_ALLOC.arg(QString("job")));
+        send_error(client, tag, ERR_GENERATION_FAILED);
+        return;
+    }
+
+    //Keep track of who is waiting for the result
+    PendingJob pending_job;
+    pending_job.client = client;
+    pending_job.tag = tag;
+    pending_jobs.insert(next_job_id, pending_job);
+    ++next_job_id;
+
+    //Password generation must wait until cryptographic functions have been checked
+    if(service_man->crypto_function_tests_done()) {
+        worker_pool.start(job);
+    } else {
+        queued_jobs.append(job);
+    }
+}
+
+void CommandServer::handle_list(QLocalSocket* client, const QByteArray& tag) {
+    QList<QByteArray> values;
+    const QStringList& service_names = service_man->service_names();
+    for(int i = 0; i < service_names.count(); ++i) values.append(service_names.at(i).toUtf8());
+    send_response(client, tag, values);
+}
+
+void CommandServer::handle_load(QLocalSocket* client, const QByteArray& tag, const QList<QByteArray>& arguments) {
+    if(arguments.count() != 1) {
+        send_error(client, tag, ERR_BAD_ARGUMENT_COUNT.arg(QString(CMD_LOAD)).arg(1));
+        return;
+    }
+
+    QString service_name = QString::fromUtf8(arguments.at(0));
+    ServiceDescriptor service;
+    if(!service_man->copy_service(service_name, service)) {
+        send_error(client, tag, ERR_UNKNOWN_SERVICE.arg(service_name));
+        return;
+    }
+    QString descriptor;
+    if(!service.save_to_string(descriptor)) {
+        send_error(client, tag, ERR_LOADING_FAILED);
+        return;
+    }
+    send_response(client, tag, QList<QByteArray>() << descriptor.toUtf8());
+}
+
+void CommandServer::handle_stats(QLocalSocket* client, const QByteArray& tag) {
+    QList<QByteArray> values;
+    values << "uptime_ms=" + QByteArray::number(uptime.elapsed());
+    values << "connections=" + QByteArray::number(connections);
+    values << "requests=" + QByteArray::number((qulonglong) requests);
+    values << "errors=" + QByteArray::number((qulonglong) errors);
+    values << "pending_jobs=" + QByteArray::number(pending_jobs.count());
+    values << "pending_batches=" + QByteArray::number(pending_batches.count());
+    values << "worker_threads=" + QByteArray::number(worker_pool.maxThreadCount());
+    values << "services=" + QByteArray::number(service_man->service_names().count());
+    values << "key_cache_ttl_s=" + QByteArray::number(stretched_key_cache.ttl());
+    values << "cached_keys=" + QByteArray::number(stretched_key_cache.entry_count());
+    values << QByteArray("self_test=") + (service_man->crypto_function_tests_done() ?
+                                           (service_man->crypto_function_tests_passed() ? "passed" : "failed") :
+                                           "running");
+    DelayedDeletionQueue* deletion_queue = delayed_deletions();
+    if(deletion_queue) {
+        values << "delayed_deletions_pending=" + QByteArray::number(deletion_queue->pending_count());
+        values << "delayed_deletions_done=" + QByteArray::number((qulonglong) deletion_queue->deleted_count());
+    }
+    values << QByteArray("tracing=") + (TRACING_ENABLED ? "enabled" : "disabled");
+    values << pipeline_tracer.stats_values();
+    send_response(client, tag, values);
+}
+
+void CommandServer::send_error(QLocalSocket* client, const QByteArray& tag, const QString& message) {
+    ++errors;
+    if(!client || client->state() != QLocalSocket::ConnectedState) return;
+
+    client->write(tag + ' ' + RESPONSE_ERROR + ' ' + message.toUtf8().toPercentEncoding(PERCENT_ENCODING_EXCLUDE) + '\n');
+}
+
+void CommandServer::send_part(QLocalSocket* client, const QByteArray& tag, const QList<QByteArray>& values) {
+    if(!client || client->state() != QLocalSocket::ConnectedState) return;
+
+    QByteArray part = tag + ' ' + RESPONSE_PART;
+    for(int i = 0; i < values.count(); ++i) part += ' ' + values.at(i).toPercentEncoding(PERCENT_ENCODING_EXCLUDE);
+    part += '\n';
+    client->write(part);
+}
+
+void CommandServer::send_response(QLocalSocket* client, const QByteArray& tag, const QList<QByteArray>& values) {
+    if(!client || client->state() != QLocalSocket::ConnectedState) return;
+
+    QByteArray response = tag + ' ' + RESPONSE_OK;
+    for(int i = 0; i < values.count(); ++i) response += ' ' + values.at(i).toPercentEncoding(PERCENT_ENCODING_EXCLUDE);
+    response += '\n';
+    client->write(response);
+}
+
+void BatchReporter::password_computed(int service_index, bool success, const QString& password) {
+    QMetaObject::invokeMethod(server,
+                              "batch_password_computed",
+                              Qt::QueuedConnection,
+                              Q_ARG(int, batch_id),
+                              Q_ARG(int, service_index),
+                              Q_ARG(bool, success),
+                              Q_ARG(QString, password));
+}
+
+PasswordJob::PasswordJob(CommandServer* server,
+                         int job_id,
+                         const ServiceDescriptor& service,
+                         const QString& master_password) : master_pw(master_password),
+                                                           server(server),
+                                                           service(service),
+                                                           job_id(job_id) {
+    //The server keeps track of jobs until they have reported
+    setAutoDelete(true);
+}
+
+PasswordJob::~PasswordJob() {
+    master_pw.fill(QChar(0));
+    master_pw.clear();
+}
+
+void PasswordJob::run() {
+    QString password;
+    bool success = (service.compute_password(master_pw, password) != NULL);
+    master_pw.fill(QChar(0));
+    master_pw.clear();
+
+    //Report to the server in its own thread
+    QMetaObject::invokeMethod(server,
+                              "job_finished",
+                              Qt::QueuedConnection,
+                              Q_ARG(int, job_id),
+                              Q_ARG(bool, success),
+                              Q_ARG(QString, password));
+    password.clear();
+}
@@ -0,0 +1,165 @@
+/* Command server : serves requests from other processes (scripts, command line tools, new
+   instances of Hashish) on Hashish's per-user local socket.
+
+      Copyright (C) 2011  Hadrien Grasland
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA */
+
+#ifndef COMMAND_SERVER_H
+#define COMMAND_SERVER_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QObject>
+#include <QPointer>
+#include <QRunnable>
+#include <QString>
+#include <QThreadPool>
+#include <stdint.h>
+
+#include <password_batch.h>
+#include <service_descriptor.h>
+
+class BatchReporter;
+class PasswordJob;
+class ServiceManager;
+
+#define MAX_REQUEST_LENGTH 65536 //Connections sending longer lines than this are dropped
+
+//Protocol : one request or response per line, encoded in UTF-8.
+//  Request  : <tag> <COMMAND> [argument...]
+//  Response : <tag> OK [value...]
+//             <tag> ERROR <message>
+//Tags are chosen by the client and echoed back, so that requests may be pipelined : password
+//generation is performed on a pool of worker threads, and its results are sent as soon as they
+//are ready, possibly out of order. BATCH requests get one PART line per service before their
+//final response. Tags, arguments and values are percent-encoded ('=' may be
+//left as is), so that they contain neither spaces nor line breaks.
+//
+//Commands :
+//  PING                                      -> OK
+//  SHOW                                      -> OK (the GUI, if any, shows its main window)
+//  LIST                                      -> OK <service name>...
+//  LOAD <service name>                       -> OK <descriptor, in descriptor file format>
+//  LOCK                                      -> OK (cached stretched keys are wiped, see key_cache.h)
+//  GENERATE <service name> <master password> -> OK <service password>
+//  BATCH <master password> <service name>... -> PART <service name> OK <service password>
+//                                               PART <service name> ERROR <message>
+//                                               ... (in completion order), then OK
+//  STATS                                     -> OK <name>=<value>... (including per-stage
+//                                               latencies of password computations, see tracing.h)
+//  TRACE                                     -> OK <recent spans, in Chrome trace-event JSON>
+//
+//The socket is only accessible to the user running Hashish, but master passwords and service
+//passwords go through it in clear text.
+class CommandServer : public QObject {
+    Q_OBJECT
+
+  public:
+    CommandServer(ServiceManager& service_manager, QObject* parent = NULL);
+    ~CommandServer();
+    bool listen(const QString& socket_name);
+    void close();
+
+  signals:
+    void show_requested(); //A SHOW command has been received
+
+  public slots:
+    void self_test_finished(bool passed); //Password generation waits for the self-test to finish
+
+  private slots:
+    void client_disconnected();
+    void batch_password_computed(int batch_id, int service_index, bool success, const QString& password);
+    void job_finished(int job_id, bool success, const QString& password);
+    void new_connection();
+    void read_requests();
+
+  private:
+    struct PendingJob {
+        QPointer<QLocalSocket> client;
+        QByteArray tag;
+    };
+
+    struct PendingBatch {
+        QPointer<QLocalSocket> client;
+        QByteArray tag;
+        QList<QByteArray> service_names;
+        int passwords_left;
+        PasswordBatch* batch;
+        BatchReporter* reporter;
+    };
+
+    int next_batch_id;
+    int next_job_id;
+    QHash<int, PendingBatch> pending_batches; //Batches which have not fully answered yet
+    QHash<int, PendingJob> pending_jobs; //Jobs which have not answered yet
+    QList<int> queued_batches; //Batches waiting for the self-test to finish
+    QList<PasswordJob*> queued_jobs; //Jobs waiting for the self-test to finish
+    QLocalServer* server;
+    ServiceManager* service_man;
+    QThreadPool worker_pool;
+
+    //Statistics
+    int connections;
+    uint64_t errors;
+    uint64_t requests;
+    QElapsedTimer uptime;
+
+    void finish_batch(const int batch_id);
+    void handle_batch(QLocalSocket* client, const QByteArray& tag, const QList<QByteArray>& arguments);
+    void handle_request(QLocalSocket* client, const QByteArray& request);
+    void handle_generate(QLocalSocket* client, const QByteArray& tag, const QList<QByteArray>& arguments);
+    void handle_list(QLocalSocket* client, const QByteArray& tag);
+    void handle_load(QLocalSocket* client, const QByteArray& tag, const QList<QByteArray>& arguments);
+    void handle_stats(QLocalSocket* client, const QByteArray& tag);
+    void send_error(QLocalSocket* client, const QByteArray& tag, const QString& message);
+    void send_part(QLocalSocket* client, const QByteArray& tag, const QList<QByteArray>& values);
+    void send_response(QLocalSocket* client, const QByteArray& tag, const QList<QByteArray>& values);
+};
+
+//Forwards the results of a batch to the server, in its own thread
+class BatchReporter : public PasswordBatchReceiver {
+  public:
+    BatchReporter(CommandServer* server, int batch_id) : server(server), batch_id(batch_id) {}
+    void password_computed(int service_index, bool success, const QString& password);
+
+  private:
+    CommandServer* server; //Waits for all of its batches before being destroyed
+    int batch_id;
+};
+
+//Computes a service password on a copy of its descriptor, then reports to the server
+class PasswordJob : public QRunnable {
+  public:
+    PasswordJob(CommandServer* server,
+                int job_id,
+                const ServiceDescriptor& service,
+                const QString& master_password);
+    ~PasswordJob();
+    int id() {return job_id;}
+    void run();
+
+  private:
+    QString master_pw;
+    CommandServer* server; //Waits for all of its jobs before being destroyed
+    ServiceDescriptor service;
+    int job_id;
+};
+
+#endif // COMMAND_SERVER_H
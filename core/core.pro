@@ -0,0 +1,61 @@
+# Hashish's core library : cryptographic functions, service storage and local socket server.
+# It does not depend on QtGui, so that command line tools start quickly. Front ends link it
+# through hashish-core.pri.
+
+TARGET = hashish-core
+TEMPLATE = lib
+CONFIG += staticlib
+QT -= gui
+QT += network
+
+QMAKE_CXXFLAGS += -std=c++0x -U__STRICT_ANSI__ -Wall
+
+include(test_vectors.pri)
+
+# "qmake CONFIG+=no_tracing" compiles pipeline tracing spans out (see tracing.h)
+no_tracing: DEFINES += HASHISH_NO_TRACING
+
+SOURCES += crypto_hash.cpp \
+    password_generator.cpp \
+    hmac.cpp \
+    key_cache.cpp \
+    qstring_to_qwords.cpp \
+    password_cipher.cpp \
+    password_batch.cpp \
+    service_descriptor.cpp \
+    service_import.cpp \
+    service_manager.cpp \
+    parsing_tools.cpp \
+    pbkdf2.cpp \
+    error_management.cpp \
+    file_hash.cpp \
+    command_server.cpp \
+    delayed_deletion.cpp \
+    self_test.cpp \
+    store_snapshot.cpp \
+    test_suite.cpp \
+    tracing.cpp
+
+HEADERS += service_descriptor.h \
+    crypto_hash.h \
+    password_generator.h \
+    hmac.h \
+    key_cache.h \
+    qstring_to_qwords.h \
+    password_cipher.h \
+    password_batch.h \
+    service_import.h \
+    service_manager.h \
+    parsing_tools.h \
+    pbkdf2.h \
+    error_management.h \
+    file_hash.h \
+    command_server.h \
+    delayed_deletion.h \
+    self_test.h \
+    store_snapshot.h \
+    test_suite.h \
+    test_vectors.h \
+    tracing.h
+
+OTHER_FILES += hashish-core.pri
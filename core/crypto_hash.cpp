@@ -0,0 +1,749 @@
+/* CryptoHash class : implements an abstraction for managing several cryptographic hashes,
+   which is useful as the software grows old and former hashes are broken.
+
+      Copyright (C) 2011  Hadrien Grasland
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA */
+
+#include <string.h>
+
+#include <crypto_hash.h>
+#include <error_management.h>
+#include <test_suite.h>
+
+SHA512Hash sha_512_hash;
+BLAKE2bHash blake2b_hash;
+SHA3_512Hash sha3_512_hash;
+CryptoHash& default_hash = sha_512_hash;
+
+CryptoHash* crypto_hash_database(const QString& hash_name) {
+    if(hash_name == sha_512_hash.name()) {
+        return &sha_512_hash;
+    }
+    if(hash_name == blake2b_hash.name()) {
+        return &blake2b_hash;
+    }
+    if(hash_name == sha3_512_hash.name()) {
+        return &sha3_512_hash;
+    }
+
+    return NULL;
+}
+
+bool test_crypto_hashes() {
+    bool result = sha_512_hash.test();
+    if(!result) return false;
+    result = test_sha512_stream();
+    if(!result) return false;
+    result = blake2b_hash.test();
+    if(!result) return false;
+    result = sha3_512_hash.test();
+    if(!result) return false;
+
+    return true;
+}
+
+const QString CRYPTO_HASH_NAME("CryptoHash");
+
+bool CryptoHash::test() {
+    const TestVectorFile* test_file = test_vector_file(name());
+    if(!test_file) {
+        log_error(CRYPTO_HASH_NAME, ERR_NO_TEST_VECTORS.arg(name()));
+        return false;
+    }
+
+    size_t result_length = hash_length();
+    uint64_t result[result_length];
+    for(size_t i = 0; i < test_file->vector_count; ++i) {
+        const TestVector& vector = test_file->vectors[i];
+        if(vector.result_length != result_length) {
+            log_error(CRYPTO_HASH_NAME, ERR_BAD_TEST_VECTOR.arg(i).arg(name()));
+            return false;
+        }
+
+        //Hash message, check result
+        uint64_t* hash_result;
+        if(vector.monte_carlo) {
+            if(vector.message_length != result_length) {
+                log_error(CRYPTO_HASH_NAME, ERR_BAD_TEST_VECTOR.arg(i).arg(name()));
+                return false;
+            }
+            hash_result = monte_carlo(vector.monte_carlo, vector.message, result);
+        } else if(vector.repeat > 1) {
+            uint64_t* long_message = new_repeated_message(CRYPTO_HASH_NAME, vector);
+            if(!long_message) return false;
+            hash_result = hash(vector.message_length*vector.repeat, long_message, result);
+            delete[] long_message;
+        } else {
+            hash_result = hash(vector.message_length, vector.message, result);
+        }
+        if(!hash_result) return false;
+        if(!check_test_result(CRYPTO_HASH_NAME, result_length, result, vector.result)) return false;
+    }
+
+    return true;
+}
+
+uint64_t* CryptoHash::monte_carlo(uint64_t checkpoints, const uint64_t* seed, uint64_t* dest_buffer) {
+    //NIST's Monte Carlo procedure : starting from MD0 = MD1 = MD2 = seed, compute
+    //MDi = hash(MDi-3 + MDi-2 + MDi-1) up to i = 1002, where + is concatenation. MD1002 is a
+    //checkpoint, and becomes the seed of the next round.
+    size_t length = hash_length();
+    uint64_t window[3*length];
+    memcpy((void*) dest_buffer, (const void*) seed, length*sizeof(uint64_t));
+    for(uint64_t checkpoint = 0; checkpoint < checkpoints; ++checkpoint) {
+        for(int i = 0; i < 3; ++i) {
+            memcpy((void*) (window + i*length), (const void*) dest_buffer, length*sizeof(uint64_t));
+        }
+        for(int i = 3; i < 1003; ++i) {
+            if(!hash(3*length, window, dest_buffer)) return NULL;
+            memmove((void*) window, (const void*) (window + length), 2*length*sizeof(uint64_t));
+            memcpy((void*) (window + 2*length), (const void*) dest_buffer, length*sizeof(uint64_t));
+        }
+    }
+
+    return dest_buffer;
+}
+
+const QString SHA_512_HASH_NAME("SHA512Hash");
+
+SHA512Hash::SHA512Hash() {
+    //Set initial hash value
+    H0[0] = 0x6a09e667f3bcc908;
+    H0[1] = 0xbb67ae8584caa73b;
+    H0[2] = 0x3c6ef372fe94f82b;
+    H0[3] = 0xa54ff53a5f1d36f1;
+    H0[4] = 0x510e527fade682d1;
+    H0[5] = 0x9b05688c2b3e6c1f;
+    H0[6] = 0x1f83d9abfb41bd6b;
+    H0[7] = 0x5be0cd19137e2179;
+
+    //Set constants
+    K[0] = 0x428a2f98d728ae22;
+    K[1] = 0x7137449123ef65cd;
+    K[2] = 0xb5c0fbcfec4d3b2f;
+    K[3] = 0xe9b5dba58189dbbc;
+
+    K[4] = 0x3956c25bf348b538;
+    K[5] = 0x59f111f1b605d019;
+    K[6] = 0x923f82a4af194f9b;
+    K[7] = 0xab1c5ed5da6d8118;
+
+    K[8] = 0xd807aa98a3030242;
+    K[9] = 0x12835b0145706fbe;
+    K[10] = 0x243185be4ee4b28c;
+    K[11] = 0x550c7dc3d5ffb4e2;
+
+    K[12] = 0x72be5d74f27b896f;
+    K[13] = 0x80deb1fe3b1696b1;
+    K[14] = 0x9bdc06a725c71235;
+    K[15] = 0xc19bf174cf692694;
+
+    K[16] = 0xe49b69c19ef14ad2;
+    K[17] = 0xefbe4786384f25e3;
+    K[18] = 0x0fc19dc68b8cd5b5;
+    K[19] = 0x240ca1cc77ac9c65;
+
+    K[20] = 0x2de92c6f592b0275;
+    K[21] = 0x4a7484aa6ea6e483;
+    K[22] = 0x5cb0a9dcbd41fbd4;
+    K[23] = 0x76f988da831153b5;
+
+    K[24] = 0x983e5152ee66dfab;
+    K[25] = 0xa831c66d2db43210;
+    K[26] = 0xb00327c898fb213f;
+    K[27] = 0xbf597fc7beef0ee4;
+
+    K[28] = 0xc6e00bf33da88fc2;
+    K[29] = 0xd5a79147930aa725;
+    K[30] = 0x06ca6351e003826f;
+    K[31] = 0x142929670a0e6e70;
+
+    K[32] = 0x27b70a8546d22ffc;
+    K[33] = 0x2e1b21385c26c926;
+    K[34] = 0x4d2c6dfc5ac42aed;
+    K[35] = 0x53380d139d95b3df;
+
+    K[36] = 0x650a73548baf63de;
+    K[37] = 0x766a0abb3c77b2a8;
+    K[38] = 0x81c2c92e47edaee6;
+    K[39] = 0x92722c851482353b;
+
+    K[40] = 0xa2bfe8a14cf10364;
+    K[41] = 0xa81a664bbc423001;
+    K[42] = 0xc24b8b70d0f89791;
+    K[43] = 0xc76c51a30654be30;
+
+    K[44] = 0xd192e819d6ef5218;
+    K[45] = 0xd69906245565a910;
+    K[46] = 0xf40e35855771202a;
+    K[47] = 0x106aa07032bbd1b8;
+
+    K[48] = 0x19a4c116b8d2d0c8;
+    K[49] = 0x1e376c085141ab53;
+    K[50] = 0x2748774cdf8eeb99;
+    K[51] = 0x34b0bcb5e19b48a8;
+
+    K[52] = 0x391c0cb3c5c95a63;
+    K[53] = 0x4ed8aa4ae3418acb;
+    K[54] = 0x5b9cca4f7763e373;
+    K[55] = 0x682e6ff3d6b2b8a3;
+
+    K[56] = 0x748f82ee5defb2fc;
+    K[57] = 0x78a5636f43172f60;
+    K[58] = 0x84c87814a1f0ab72;
+    K[59] = 0x8cc702081a6439ec;
+
+    K[60] = 0x90befffa23631e28;
+    K[61] = 0xa4506cebde82bde9;
+    K[62] = 0xbef9a3f7b2c67915;
+    K[63] = 0xc67178f2e372532b;
+
+    K[64] = 0xca273eceea26619c;
+    K[65] = 0xd186b8c721c0c207;
+    K[66] = 0xeada7dd6cde0eb1e;
+    K[67] = 0xf57d4f7fee6ed178;
+
+    K[68] = 0x06f067aa72176fba;
+    K[69] = 0x0a637dc5a2c898a6;
+    K[70] = 0x113f9804bef90dae;
+    K[71] = 0x1b710b35131c471b;
+
+    K[72] = 0x28db77f523047d84;
+    K[73] = 0x32caab7b40c72493;
+    K[74] = 0x3c9ebe0a15c9bebc;
+    K[75] = 0x431d67c49c100d4c;
+
+    K[76] = 0x4cc5d4becb3e42b6;
+    K[77] = 0x597f299cfc657e2a;
+    K[78] = 0x5fcb6fab3ad6faec;
+    K[79] = 0x6c44198c4a475817;
+}
+
+uint64_t* SHA512Hash::hash(size_t data_length, const uint64_t* data, uint64_t* dest_buffer) {
+    uint64_t hash_value[8];
+
+    //Set the initial hash value
+    memcpy((void*) hash_value, (const void*) H0, 8*sizeof(uint64_t));
+
+    //Generate a padded copy of the message
+    size_t work_data_length = padded_message_length(data_length);
+    uint64_t* work_data = new uint64_t[work_data_length];
+    if(!work_data) {
+        log_error(SHA_512_HASH_NAME, ERR_BAD_ALLOC.arg(QString("work_data")));
+        return NULL;
+    }
+    gen_padded_message(data_length, data, work_data);
+
+    //Slice padded data in blocks of 16 quadwords, process each block.
+    uint64_t* final_block = work_data+work_data_length;
+    for(uint64_t* current_block = work_data; current_block < final_block; current_block+=16) {
+        compress(hash_value, current_block);
+    }
+
+    //Copy hash value to destination, clean up, return final hash value
+    memcpy((void*) dest_buffer, (const void*) hash_value, 8*sizeof(uint64_t));
+
+    memset((void*) hash_value, 0, 8*sizeof(uint64_t));
+    memset((void*) work_data, 0, work_data_length*sizeof(uint64_t));
+    delete[] work_data;
+
+    return dest_buffer;
+}
+
+void SHA512Hash::compress(uint64_t* hash_value, const uint64_t* current_block) {
+    uint64_t a, b, c, d, e, f, g, h, T1, T2; //Working and temporary variables
+    uint64_t W[80];
+
+    prepare_message_schedule(current_block, W);
+
+    a = hash_value[0];
+    b = hash_value[1];
+    c = hash_value[2];
+    d = hash_value[3];
+    e = hash_value[4];
+    f = hash_value[5];
+    g = hash_value[6];
+    h = hash_value[7];
+
+    for(int t=0; t<80; ++t) {
+        T1 = h + capital_sigma_1(e) + ch(e,f,g) + K[t] + W[t];
+        T2 = capital_sigma_0(a) + maj(a,b,c);
+        h = g;
+        g = f;
+        f = e;
+        e = d + T1;
+        d = c;
+        c = b;
+        b = a;
+        a = T1 + T2;
+    }
+
+    hash_value[0]+= a;
+    hash_value[1]+= b;
+    hash_value[2]+= c;
+    hash_value[3]+= d;
+    hash_value[4]+= e;
+    hash_value[5]+= f;
+    hash_value[6]+= g;
+    hash_value[7]+= h;
+
+    memset((void*) W, 0, 80*sizeof(uint64_t));
+    a = 0, b = 0, c = 0, d = 0, e = 0, f = 0, g = 0, h = 0, T1 = 0, T2 = 0;
+}
+
+uint64_t* SHA512Hash::gen_padded_message(size_t message_length, const uint64_t* message, uint64_t* dest_buffer) {
+    //Final padded message is made of
+    // -Original message
+    // -Bit "1" (endianness-dependent ?)
+    // -k zeroed bits so that the final message is padded on a 1024 bits boundary
+    // -Original message size in bits (128-bit number)
+
+    //So in a quadword (QW) representation, we have :
+    // -The original message
+    // -Quadword "1 << 63"
+    // -(k-63)/64 zeroed QWs so that final message is padded on a 16 QW boundary
+    // -Original message size in bits (2 quadwords)
+
+    //In the end, we know how much padding QWs we have, and we can allocate a
+    //memory block of the right size for this new data
+    memcpy((void*) dest_buffer, (const void*) message, message_length*sizeof(uint64_t));
+    uint64_t* dest_buffer_parser = dest_buffer + message_length;
+    *dest_buffer_parser = 1;
+    *dest_buffer_parser<<= 63;
+    dest_buffer_parser++;
+    size_t zeroed_QWs = 16-((message_length+3)%16);
+    if(zeroed_QWs == 16) zeroed_QWs = 0;
+    memset((void*) dest_buffer_parser, 0, (zeroed_QWs+1)*sizeof(uint64_t));
+    dest_buffer_parser+= zeroed_QWs+1;
+    *dest_buffer_parser = message_length*64;
+
+    return dest_buffer;
+}
+
+void SHA512Hash::initial_hash_value(uint64_t* hash_value) {
+    memcpy((void*) hash_value, (const void*) H0, 8*sizeof(uint64_t));
+}
+
+size_t SHA512Hash::padded_message_length(size_t message_length) {
+    //Cf gen_padded_message() above for a description of the padded message
+    size_t zeroed_QWs = 16-((message_length+3)%16);
+    if(zeroed_QWs == 16) zeroed_QWs = 0;
+    size_t total_padding_QWs = zeroed_QWs+3;
+    return message_length + total_padding_QWs;
+}
+
+void SHA512Hash::prepare_message_schedule(const uint64_t* current_block, uint64_t* W) {
+    //Set W[0] to W[15] according to the current message block
+    memcpy((void*) W, (const void*) current_block, 16*sizeof(uint64_t));
+
+    //Set other values of W
+    for(int t = 16; t<80; ++t) {
+        W[t] = sigma_1(W[t-2]) + W[t-7] + sigma_0(W[t-15]) + W[t-16];
+    }
+}
+
+uint64_t SHA512Hash::rotr(int n, uint64_t x) {
+    //return (x >> n)|(x << (64-n));
+    uint64_t tmp1 = x;
+    tmp1>>= n;
+    uint64_t tmp2 = x;
+    tmp2<<= (64-n);
+    tmp1|= tmp2;
+    return tmp1;
+}
+
+uint64_t SHA512Hash::shr(int n, uint64_t x) {
+    //return x >> n;
+    uint64_t tmp = x;
+    tmp>>= n;
+    return tmp;
+}
+
+const QString SHA_512_STREAM_NAME("SHA512Stream");
+
+void SHA512Stream::reset() {
+    sha_512_hash.initial_hash_value(hash_value);
+    memset((void*) block, 0, 16*sizeof(uint64_t));
+    memset((void*) buffer, 0, 128);
+    buffered_length = 0;
+    total_length = 0;
+}
+
+void SHA512Stream::update(const char* bytes, size_t length) {
+    const unsigned char* input = (const unsigned char*) bytes;
+    total_length+= length;
+
+    //Complete the buffered block first, then process full blocks straight from the input
+    if(buffered_length) {
+        size_t missing_length = 128 - buffered_length;
+        if(length < missing_length) {
+            memcpy((void*) (buffer + buffered_length), (const void*) input, length);
+            buffered_length+= length;
+            return;
+        }
+        memcpy((void*) (buffer + buffered_length), (const void*) input, missing_length);
+        compress_bytes(buffer);
+        input+= missing_length;
+        length-= missing_length;
+        buffered_length = 0;
+    }
+    while(length >= 128) {
+        compress_bytes(input);
+        input+= 128;
+        length-= 128;
+    }
+    memcpy((void*) buffer, (const void*) input, length);
+    buffered_length = length;
+}
+
+void SHA512Stream::finish(unsigned char* digest) {
+    //Padding : bit "1", zeroes up to 16 bytes before a block boundary, then the message length in
+    //bits as a 128-bit big-endian number
+    uint64_t bit_length = total_length << 3;
+    buffer[buffered_length++] = 0x80;
+    if(buffered_length > 112) {
+        memset((void*) (buffer + buffered_length), 0, 128 - buffered_length);
+        compress_bytes(buffer);
+        buffered_length = 0;
+    }
+    memset((void*) (buffer + buffered_length), 0, 120 - buffered_length);
+    buffer[119] = (unsigned char) (total_length >> 61);
+    for(int i = 0; i < 8; ++i) buffer[120 + i] = (unsigned char) (bit_length >> (56 - 8*i));
+    compress_bytes(buffer);
+
+    for(int i = 0; i < 64; ++i) digest[i] = (unsigned char) (hash_value[i/8] >> (56 - 8*(i%8)));
+    reset();
+}
+
+QByteArray SHA512Stream::hex_digest() {
+    unsigned char digest[64];
+    finish(digest);
+    QByteArray result = QByteArray((const char*) digest, 64).toHex();
+    memset((void*) digest, 0, 64);
+    return result;
+}
+
+void SHA512Stream::compress_bytes(const unsigned char* bytes) {
+    for(int i = 0; i < 16; ++i) {
+        const unsigned char* qword = bytes + 8*i;
+        block[i] = ((uint64_t) qword[0] << 56) | ((uint64_t) qword[1] << 48) | ((uint64_t) qword[2] << 40)
+                 | ((uint64_t) qword[3] << 32) | ((uint64_t) qword[4] << 24) | ((uint64_t) qword[5] << 16)
+                 | ((uint64_t) qword[6] << 8) | (uint64_t) qword[7];
+    }
+    sha_512_hash.compress(hash_value, block);
+}
+
+bool test_sha512_stream() {
+    //FIPS 180-2 examples, fed in pieces which do not fall on block boundaries
+    static const char* const MESSAGES[] = {"",
+                                           "abc",
+                                           "abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmn"
+                                           "hijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu"};
+    static const char* const DIGESTS[] = {"cf83e1357eefb8bdf1542850d66d8007d620e4050b5715dc83f4a921d36ce9ce"
+                                          "47d0d13c5d85f2b0ff8318d2877eec2f63b931bd47417a81a538327af927da3e",
+                                          "ddaf35a193617abacc417349ae20413112e6fa4e89a97ea20a9eeee64b55d39a"
+                                          "2192992a274fc1a836ba3c23a3feebbd454d4423643ce80e2a9ac94fa54ca49f",
+                                          "8e959b75dae313da8cf4f72814fc143f8f7779c6eb9f7fa17299aeadb6889018"
+                                          "501d289e4900f7e4331b99dec4b5433ac7d329eeb6dd26545e96e55b874be909",
+                                          "e718483d0ce769644e2e42c7bc15b4638e1f98b13b2044285632a803afa973eb"
+                                          "de0ff244877ea60a4cb0432ce577c31beb009c5c2c49aa2e4eadb217ad8cc09b"};
+    static const QString ERR_STREAM_MISMATCH("Got digest : %1\nExpected   : %2");
+    const size_t piece_length = 37;
+
+    SHA512Stream stream;
+    for(int i = 0; i < 4; ++i) {
+        if(i < 3) {
+            size_t length = strlen(MESSAGES[i]);
+            for(size_t offset = 0; offset < length; offset+= piece_length) {
+                stream.update(MESSAGES[i] + offset, (length - offset < piece_length) ? length - offset : piece_length);
+            }
+        } else {
+            //One million "a"
+            QByteArray piece(1000, 'a');
+            for(int j = 0; j < 1000; ++j) stream.update(piece.constData(), piece.size());
+        }
+        QByteArray digest = stream.hex_digest();
+        if(digest != DIGESTS[i]) {
+            log_error(SHA_512_STREAM_NAME, ERR_STREAM_MISMATCH.arg(QString(digest)).arg(DIGESTS[i]));
+            return false;
+        }
+    }
+
+    return true;
+}
+
+//Message word permutations of the BLAKE2b rounds (rounds 10 and 11 reuse the first two)
+const unsigned char BLAKE2B_SIGMA[12][16] = {{0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
+                                             {14, 10, 4, 8, 9, 15, 13, 6, 1, 12, 0, 2, 11, 7, 5, 3},
+                                             {11, 8, 12, 0, 5, 2, 15, 13, 10, 14, 3, 6, 7, 1, 9, 4},
+                                             {7, 9, 3, 1, 13, 12, 11, 14, 2, 6, 5, 10, 4, 0, 15, 8},
+                                             {9, 0, 5, 7, 2, 4, 10, 15, 14, 1, 11, 12, 6, 8, 3, 13},
+                                             {2, 12, 6, 10, 0, 11, 8, 3, 4, 13, 7, 5, 15, 14, 1, 9},
+                                             {12, 5, 1, 15, 14, 13, 4, 10, 0, 7, 6, 3, 9, 2, 8, 11},
+                                             {13, 11, 7, 14, 12, 1, 3, 9, 5, 0, 15, 4, 8, 6, 2, 10},
+                                             {6, 15, 14, 9, 11, 3, 0, 8, 12, 2, 13, 7, 1, 4, 10, 5},
+                                             {10, 2, 8, 4, 7, 6, 1, 5, 15, 11, 9, 14, 3, 12, 13, 0},
+                                             {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
+                                             {14, 10, 4, 8, 9, 15, 13, 6, 1, 12, 0, 2, 11, 7, 5, 3}};
+
+inline uint64_t blake2b_rotr(uint64_t x, int n) {
+    return (x >> n) | (x << (64-n));
+}
+
+//Mixing function, applied to the columns then to the diagonals of the 4x4 working state
+#define BLAKE2B_G(r, i, a, b, c, d) \
+    a = a + b + block[BLAKE2B_SIGMA[r][2*i]]; \
+    d = blake2b_rotr(d ^ a, 32); \
+    c = c + d; \
+    b = blake2b_rotr(b ^ c, 24); \
+    a = a + b + block[BLAKE2B_SIGMA[r][2*i+1]]; \
+    d = blake2b_rotr(d ^ a, 16); \
+    c = c + d; \
+    b = blake2b_rotr(b ^ c, 63);
+
+#define BLAKE2B_ROUND(r) \
+    BLAKE2B_G(r, 0, v0, v4, v8, v12) \
+    BLAKE2B_G(r, 1, v1, v5, v9, v13) \
+    BLAKE2B_G(r, 2, v2, v6, v10, v14) \
+    BLAKE2B_G(r, 3, v3, v7, v11, v15) \
+    BLAKE2B_G(r, 4, v0, v5, v10, v15) \
+    BLAKE2B_G(r, 5, v1, v6, v11, v12) \
+    BLAKE2B_G(r, 6, v2, v7, v8, v13) \
+    BLAKE2B_G(r, 7, v3, v4, v9, v14)
+
+const QString BLAKE2B_HASH_NAME("BLAKE2bHash");
+
+BLAKE2bHash::BLAKE2bHash() {
+    //Set initial hash value : the IV (same as SHA-512's), xored with the parameter block of
+    //an unkeyed hash with a 64-byte digest, fanout 1 and depth 1.
+    H0[0] = 0x6a09e667f3bcc908 ^ 0x0000000001010040;
+    H0[1] = 0xbb67ae8584caa73b;
+    H0[2] = 0x3c6ef372fe94f82b;
+    H0[3] = 0xa54ff53a5f1d36f1;
+    H0[4] = 0x510e527fade682d1;
+    H0[5] = 0x9b05688c2b3e6c1f;
+    H0[6] = 0x1f83d9abfb41bd6b;
+    H0[7] = 0x5be0cd19137e2179;
+}
+
+uint64_t* BLAKE2bHash::hash(size_t data_length, const uint64_t* data, uint64_t* dest_buffer) {
+    uint64_t hash_value[8];
+    uint64_t last_block[16];
+
+    //Set the initial hash value
+    memcpy((void*) hash_value, (const void*) H0, 8*sizeof(uint64_t));
+
+    //Full blocks are compressed in place. The last block, which may be partial or empty, is
+    //zero-padded and flagged, so no padded copy of the message is needed.
+    size_t remaining_length = data_length;
+    const uint64_t* current_block = data;
+    uint64_t byte_counter = 0;
+    while(remaining_length > 16) {
+        byte_counter+= 16*sizeof(uint64_t);
+        compress(hash_value, current_block, byte_counter, false);
+        current_block+= 16;
+        remaining_length-= 16;
+    }
+    memset((void*) last_block, 0, 16*sizeof(uint64_t));
+    memcpy((void*) last_block, (const void*) current_block, remaining_length*sizeof(uint64_t));
+    byte_counter+= remaining_length*sizeof(uint64_t);
+    compress(hash_value, last_block, byte_counter, true);
+
+    //Copy hash value to destination, clean up, return final hash value
+    memcpy((void*) dest_buffer, (const void*) hash_value, 8*sizeof(uint64_t));
+
+    memset((void*) hash_value, 0, 8*sizeof(uint64_t));
+    memset((void*) last_block, 0, 16*sizeof(uint64_t));
+
+    return dest_buffer;
+}
+
+void BLAKE2bHash::compress(uint64_t* hash_value, const uint64_t* block, uint64_t byte_counter, bool last_block) {
+    //Working state, kept in local variables so that the unrolled rounds work on registers.
+    //Messages never reach 2^64 bytes, so the high word of the counter is always zero.
+    uint64_t v0 = hash_value[0], v1 = hash_value[1], v2 = hash_value[2], v3 = hash_value[3];
+    uint64_t v4 = hash_value[4], v5 = hash_value[5], v6 = hash_value[6], v7 = hash_value[7];
+    uint64_t v8 = 0x6a09e667f3bcc908, v9 = 0xbb67ae8584caa73b;
+    uint64_t v10 = 0x3c6ef372fe94f82b, v11 = 0xa54ff53a5f1d36f1;
+    uint64_t v12 = 0x510e527fade682d1 ^ byte_counter, v13 = 0x9b05688c2b3e6c1f;
+    uint64_t v14 = 0x1f83d9abfb41bd6b, v15 = 0x5be0cd19137e2179;
+    if(last_block) v14 = ~v14;
+
+    BLAKE2B_ROUND(0);
+    BLAKE2B_ROUND(1);
+    BLAKE2B_ROUND(2);
+    BLAKE2B_ROUND(3);
+    BLAKE2B_ROUND(4);
+    BLAKE2B_ROUND(5);
+    BLAKE2B_ROUND(6);
+    BLAKE2B_ROUND(7);
+    BLAKE2B_ROUND(8);
+    BLAKE2B_ROUND(9);
+    BLAKE2B_ROUND(10);
+    BLAKE2B_ROUND(11);
+
+    hash_value[0]^= v0 ^ v8;
+    hash_value[1]^= v1 ^ v9;
+    hash_value[2]^= v2 ^ v10;
+    hash_value[3]^= v3 ^ v11;
+    hash_value[4]^= v4 ^ v12;
+    hash_value[5]^= v5 ^ v13;
+    hash_value[6]^= v6 ^ v14;
+    hash_value[7]^= v7 ^ v15;
+
+    //Message words are read from the block in place, only the working state needs clearing
+    v0 = 0, v1 = 0, v2 = 0, v3 = 0, v4 = 0, v5 = 0, v6 = 0, v7 = 0;
+    v8 = 0, v9 = 0, v10 = 0, v11 = 0, v12 = 0, v13 = 0, v14 = 0, v15 = 0;
+}
+
+const uint64_t KECCAK_ROUND_CONSTANTS[24] = {0x0000000000000001, 0x0000000000008082, 0x800000000000808a,
+                                             0x8000000080008000, 0x000000000000808b, 0x0000000080000001,
+                                             0x8000000080008081, 0x8000000000008009, 0x000000000000008a,
+                                             0x0000000000000088, 0x0000000080008009, 0x000000008000000a,
+                                             0x000000008000808b, 0x800000000000008b, 0x8000000000008089,
+                                             0x8000000000008003, 0x8000000000008002, 0x8000000000000080,
+                                             0x000000000000800a, 0x800000008000000a, 0x8000000080008081,
+                                             0x8000000000008080, 0x0000000080000001, 0x8000000080008008};
+
+inline uint64_t keccak_rotl(uint64_t x, int n) {
+    return (n == 0) ? x : ((x << n) | (x >> (64-n)));
+}
+
+//One full round of Keccak-f, from the lanes of state A to those of state E. Lanes are named
+//<state><row><column>, with rows b, g, k, m, s (y = 0..4) and columns a, e, i, o, u (x = 0..4).
+//Theta is applied to each lane as it is loaded, then rho and pi (rotation and move to B), then
+//chi and iota on each output row.
+#define KECCAK_CHI_ROW(E, row, Ba, Be, Bi, Bo, Bu) \
+    E##row##a = Ba ^ ((~Be) & Bi); \
+    E##row##e = Be ^ ((~Bi) & Bo); \
+    E##row##i = Bi ^ ((~Bo) & Bu); \
+    E##row##o = Bo ^ ((~Bu) & Ba); \
+    E##row##u = Bu ^ ((~Ba) & Be);
+
+#define KECCAK_ROUND(A, E, round) \
+    Ca = A##ba ^ A##ga ^ A##ka ^ A##ma ^ A##sa; \
+    Ce = A##be ^ A##ge ^ A##ke ^ A##me ^ A##se; \
+    Ci = A##bi ^ A##gi ^ A##ki ^ A##mi ^ A##si; \
+    Co = A##bo ^ A##go ^ A##ko ^ A##mo ^ A##so; \
+    Cu = A##bu ^ A##gu ^ A##ku ^ A##mu ^ A##su; \
+    Da = Cu ^ keccak_rotl(Ce, 1); \
+    De = Ca ^ keccak_rotl(Ci, 1); \
+    Di = Ce ^ keccak_rotl(Co, 1); \
+    Do = Ci ^ keccak_rotl(Cu, 1); \
+    Du = Co ^ keccak_rotl(Ca, 1); \
+    \
+    Ba = A##ba ^ Da; \
+    Be = keccak_rotl(A##ge ^ De, 44); \
+    Bi = keccak_rotl(A##ki ^ Di, 43); \
+    Bo = keccak_rotl(A##mo ^ Do, 21); \
+    Bu = keccak_rotl(A##su ^ Du, 14); \
+    KECCAK_CHI_ROW(E, b, Ba, Be, Bi, Bo, Bu) \
+    E##ba^= KECCAK_ROUND_CONSTANTS[round]; \
+    \
+    Ba = keccak_rotl(A##bo ^ Do, 28); \
+    Be = keccak_rotl(A##gu ^ Du, 20); \
+    Bi = keccak_rotl(A##ka ^ Da, 3); \
+    Bo = keccak_rotl(A##me ^ De, 45); \
+    Bu = keccak_rotl(A##si ^ Di, 61); \
+    KECCAK_CHI_ROW(E, g, Ba, Be, Bi, Bo, Bu) \
+    \
+    Ba = keccak_rotl(A##be ^ De, 1); \
+    Be = keccak_rotl(A##gi ^ Di, 6); \
+    Bi = keccak_rotl(A##ko ^ Do, 25); \
+    Bo = keccak_rotl(A##mu ^ Du, 8); \
+    Bu = keccak_rotl(A##sa ^ Da, 18); \
+    KECCAK_CHI_ROW(E, k, Ba, Be, Bi, Bo, Bu) \
+    \
+    Ba = keccak_rotl(A##bu ^ Du, 27); \
+    Be = keccak_rotl(A##ga ^ Da, 36); \
+    Bi = keccak_rotl(A##ke ^ De, 10); \
+    Bo = keccak_rotl(A##mi ^ Di, 15); \
+    Bu = keccak_rotl(A##so ^ Do, 56); \
+    KECCAK_CHI_ROW(E, m, Ba, Be, Bi, Bo, Bu) \
+    \
+    Ba = keccak_rotl(A##bi ^ Di, 62); \
+    Be = keccak_rotl(A##go ^ Do, 55); \
+    Bi = keccak_rotl(A##ku ^ Du, 39); \
+    Bo = keccak_rotl(A##ma ^ Da, 41); \
+    Bu = keccak_rotl(A##se ^ De, 2); \
+    KECCAK_CHI_ROW(E, s, Ba, Be, Bi, Bo, Bu)
+
+#define KECCAK_LANES(X) X##ba, X##be, X##bi, X##bo, X##bu, \
+                        X##ga, X##ge, X##gi, X##go, X##gu, \
+                        X##ka, X##ke, X##ki, X##ko, X##ku, \
+                        X##ma, X##me, X##mi, X##mo, X##mu, \
+                        X##sa, X##se, X##si, X##so, X##su
+
+const QString SHA3_512_HASH_NAME("SHA3_512Hash");
+
+uint64_t* SHA3_512Hash::hash(size_t data_length, const uint64_t* data, uint64_t* dest_buffer) {
+    uint64_t state[25];
+    uint64_t last_block[9];
+
+    //Absorb full blocks in place, then the padded last block, which may be empty. As the
+    //message is made of whole quadwords, padding is a lane of value 0x06 (SHA-3 domain bits
+    //and the first bit of pad10*1), and the last bit of pad10*1 is the top bit of the block.
+    memset((void*) state, 0, 25*sizeof(uint64_t));
+    size_t remaining_length = data_length;
+    const uint64_t* current_block = data;
+    while(remaining_length >= 9) {
+        absorb(state, current_block);
+        current_block+= 9;
+        remaining_length-= 9;
+    }
+    memset((void*) last_block, 0, 9*sizeof(uint64_t));
+    memcpy((void*) last_block, (const void*) current_block, remaining_length*sizeof(uint64_t));
+    last_block[remaining_length]^= 0x06;
+    last_block[8]^= 0x8000000000000000;
+    absorb(state, last_block);
+
+    //Squeeze the hash value (it fits in a single block), clean up
+    memcpy((void*) dest_buffer, (const void*) state, 8*sizeof(uint64_t));
+
+    memset((void*) state, 0, 25*sizeof(uint64_t));
+    memset((void*) last_block, 0, 9*sizeof(uint64_t));
+
+    return dest_buffer;
+}
+
+void SHA3_512Hash::absorb(uint64_t* state, const uint64_t* block) {
+    for(int i = 0; i < 9; ++i) state[i]^= block[i];
+    keccak_f(state);
+}
+
+void SHA3_512Hash::keccak_f(uint64_t* state) {
+    //Lanes are kept in local variables, so that the unrolled rounds work on registers. Rounds go
+    //by pairs, from A to E then back to A, which avoids copying the state after each round.
+    uint64_t KECCAK_LANES(A), KECCAK_LANES(E);
+    uint64_t Ba, Be, Bi, Bo, Bu, Ca, Ce, Ci, Co, Cu, Da, De, Di, Do, Du;
+
+    Aba = state[0], Abe = state[1], Abi = state[2], Abo = state[3], Abu = state[4];
+    Aga = state[5], Age = state[6], Agi = state[7], Ago = state[8], Agu = state[9];
+    Aka = state[10], Ake = state[11], Aki = state[12], Ako = state[13], Aku = state[14];
+    Ama = state[15], Ame = state[16], Ami = state[17], Amo = state[18], Amu = state[19];
+    Asa = state[20], Ase = state[21], Asi = state[22], Aso = state[23], Asu = state[24];
+
+    for(int round = 0; round < 24; round+= 2) {
+        KECCAK_ROUND(A, E, round)
+        KECCAK_ROUND(E, A, round+1)
+    }
+
+    state[0] = Aba, state[1] = Abe, state[2] = Abi, state[3] = Abo, state[4] = Abu;
+    state[5] = Aga, state[6] = Age, state[7] = Agi, state[8] = Ago, state[9] = Agu;
+    state[10] = Aka, state[11] = Ake, state[12] = Aki, state[13] = Ako, state[14] = Aku;
+    state[15] = Ama, state[16] = Ame, state[17] = Ami, state[18] = Amo, state[19] = Amu;
+    state[20] = Asa, state[21] = Ase, state[22] = Asi, state[23] = Aso, state[24] = Asu;
+}
@@ -0,0 +1,132 @@
+/* CryptoHash class : implements an abstraction for managing several cryptographic hashes,
+   which is useful as the software grows old and former hashes are broken.
+
+      Copyright (C) 2011  Hadrien Grasland
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA */
+
+#ifndef CRYPTO_HASH_H
+#define CRYPTO_HASH_H
+
+#include <QByteArray>
+#include <QString>
+#include <stddef.h>
+#include <stdint.h>
+
+//Abstract interface to a cryptographic hash which acts on 64-bit data.
+//A word of caution to hash implementers : dest_buffer may be equal to data.
+class CryptoHash {
+  public:
+    virtual uint64_t* hash(size_t data_length, const uint64_t* data, uint64_t* dest_buffer) = 0;
+    virtual size_t block_length() = 0; //Input block size in quadwords.
+    virtual size_t hash_length() = 0; //Hashed data length in quadwords
+    virtual QString name() = 0; //Name of the hash (used in service descriptor files)
+    bool test(); //Check the function against its known-good test vectors (if available)
+  private:
+    uint64_t* monte_carlo(uint64_t checkpoints, const uint64_t* seed, uint64_t* dest_buffer);
+};
+extern CryptoHash& default_hash;
+CryptoHash* crypto_hash_database(const QString& hash_name); //Fetch the hash that bears a given name, if it exists
+bool test_crypto_hashes(); //Check all finalized cryptographic hashes against their known test vectors
+
+
+//Implements a quadword variant of the 512-bit version of SHA-2 (cf NIST's Secure Hash Standard for extensive
+//documentation on SHA-2 and the algorithms and constants at work). Working variables live on the
+//stack, so that a single instance may be used by several threads at once.
+class SHA512Hash : public CryptoHash {
+  public:
+    SHA512Hash();
+    uint64_t* hash(size_t data_length, const uint64_t* data, uint64_t* dest_buffer);
+    size_t block_length() {return 16;}
+    size_t hash_length() {return 8;}
+    QString name() {return "SHA-512";}
+
+    //Block-level interface, for byte-oriented SHA-512 and for constructions which resume saved
+    //intermediate states (e.g. HMAC midstates). Blocks are 16 big-endian quadwords, already padded.
+    void compress(uint64_t* hash_value, const uint64_t* current_block); //Process one 16-quadword block
+    void initial_hash_value(uint64_t* hash_value); //Writes the 8 quadwords of H0
+  private:
+    uint64_t H0[8];
+    uint64_t K[80];
+
+    uint64_t capital_sigma_0(uint64_t x) {return rotr(28, x)^rotr(34, x)^rotr(39, x);}
+    uint64_t capital_sigma_1(uint64_t x) {return rotr(14, x)^rotr(18, x)^rotr(41, x);}
+    uint64_t ch(uint64_t x, uint64_t y, uint64_t z) {return (x&y)^((~x)&z);}
+    uint64_t* gen_padded_message(size_t message_length, const uint64_t* message, uint64_t* dest_buffer);
+    uint64_t maj(uint64_t x, uint64_t y, uint64_t z) {return (x&y)^(x&z)^(y&z);}
+    size_t padded_message_length(size_t message_length);
+    void prepare_message_schedule(const uint64_t* current_block, uint64_t* W);
+    uint64_t rotr(int n, uint64_t x);
+    uint64_t shr(int n, uint64_t x);
+    uint64_t sigma_0(uint64_t x) {return rotr(1, x)^rotr(8, x)^shr(7, x);}
+    uint64_t sigma_1(uint64_t x) {return rotr(19, x)^rotr(61, x)^shr(6, x);}
+};
+extern SHA512Hash sha_512_hash;
+
+//Byte-oriented SHA-512, fed incrementally, which produces standard digests (e.g. those of
+//sha512sum). Bytes are read as big-endian quadwords, as the standard requires, and go through
+//SHA512Hash's compression function.
+class SHA512Stream {
+  public:
+    SHA512Stream() {reset();}
+    ~SHA512Stream() {reset();} //Wipes the state
+    void reset();
+    void update(const char* bytes, size_t length);
+    void finish(unsigned char* digest); //Writes the 64-byte digest, then resets the stream
+    QByteArray hex_digest(); //finish(), in lowercase hexadecimal
+  private:
+    uint64_t hash_value[8];
+    uint64_t block[16];
+    unsigned char buffer[128]; //Bytes which do not make a full block yet
+    size_t buffered_length;
+    uint64_t total_length; //In bytes. Inputs stay below 2^61 bytes, so that the bit length fits a quadword.
+
+    void compress_bytes(const unsigned char* bytes); //One 128-byte block
+};
+bool test_sha512_stream(); //Check standard digests of byte strings
+
+
+//Implements the 512-bit version of BLAKE2b (cf RFC 7693), unkeyed. BLAKE2b reads its message as
+//little-endian 64-bit words, so quadwords are used as message words as-is : hashing a quadword
+//message is hashing its little-endian byte serialization, and the digest words are those of the
+//little-endian digest bytes. Working variables live on the stack, as in SHA512Hash.
+class BLAKE2bHash : public CryptoHash {
+  public:
+    BLAKE2bHash();
+    uint64_t* hash(size_t data_length, const uint64_t* data, uint64_t* dest_buffer);
+    size_t block_length() {return 16;}
+    size_t hash_length() {return 8;}
+    QString name() {return "BLAKE2b-512";}
+  private:
+    uint64_t H0[8]; //IV, with the parameter block applied
+
+    void compress(uint64_t* hash_value, const uint64_t* block, uint64_t byte_counter, bool last_block);
+};
+
+//Implements SHA3-512 (cf NIST's FIPS 202). Like BLAKE2b, Keccak reads its message as little-endian
+//64-bit lanes, so quadwords are absorbed as lanes as-is and the digest words are those of the
+//little-endian digest bytes. Each hash uses its own state, on the stack.
+class SHA3_512Hash : public CryptoHash {
+  public:
+    uint64_t* hash(size_t data_length, const uint64_t* data, uint64_t* dest_buffer);
+    size_t block_length() {return 9;} //Rate of 576 bits
+    size_t hash_length() {return 8;}
+    QString name() {return "SHA3-512";}
+  private:
+    void absorb(uint64_t* state, const uint64_t* block);
+    void keccak_f(uint64_t* state); //Keccak-f[1600] permutation
+};
+
+#endif // CRYPTO_HASH_H
@@ -0,0 +1,220 @@
+/* This unit provides facilities for deleting objects after a short time has elapsed.
+   This is typically useful when an object wants to destroy itself, which it obviously
+   cannot do in one of its methods.
+
+      Copyright (C) 2011-2012  Hadrien Grasland
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA */
+
+#include <QCoreApplication>
+#include <QMetaObject>
+#include <QMutexLocker>
+#include <QThread>
+
+#include <delayed_deletion.h>
+#include <error_management.h>
+
+const QString DELAYED_DELETION_QUEUE_NAME("DelayedDeletionQueue");
+
+QMutex main_deletion_queue_mutex;
+DelayedDeletionQueue* main_deletion_queue = NULL;
+
+DelayedDeletionQueue* delayed_deletions() {
+    QMutexLocker lock(&main_deletion_queue_mutex);
+    if(main_deletion_queue) return main_deletion_queue;
+    QCoreApplication* application = QCoreApplication::instance();
+    if(!application) return NULL;
+
+    //The first user may be a worker thread, so the queue is moved to the main thread before
+    //being given to the application
+    main_deletion_queue = new DelayedDeletionQueue;
+    if(!main_deletion_queue) {
+        log_error(DELAYED_DELETION_QUEUE_NAME, ERR_BAD_ALLOC.arg(QString("main_deletion_queue")));
+        return NULL;
+    }
+    main_deletion_queue->moveToThread(application->thread());
+    main_deletion_queue->setParent(application);
+    return main_deletion_queue;
+}
+
+DelayedDeletionQueue::DelayedDeletionQueue() : current_slot(0),
+                                               pending(0),
+                                               deleted(0),
+                                               ticking(false),
+                                               timer(NULL) {}
+
+DelayedDeletionQueue::~DelayedDeletionQueue() {
+    main_deletion_queue_mutex.lock();
+    if(main_deletion_queue == this) main_deletion_queue = NULL;
+    main_deletion_queue_mutex.unlock();
+    flush();
+}
+
+void DelayedDeletionQueue::schedule(void* target, void (*deleter)(void*), const int delay_ms) {
+    //Round the delay up to a whole number of ticks, then find its place on the wheel
+    int ticks = (delay_ms + DELETION_TICK - 1) / DELETION_TICK;
+    if(ticks < 1) ticks = 1;
+    PendingDeletion deletion;
+    deletion.target = target;
+    deletion.deleter = deleter;
+    deletion.turns = (ticks - 1) / DELETION_WHEEL_SLOTS;
+
+    bool start_timer;
+    {
+        QMutexLocker lock(&mutex);
+        if(target_slots.contains(target)) {
+            //Targets are only deleted once, at the time they were last scheduled for
+            QList<PendingDeletion>& former_slot = wheel[target_slots[target]];
+            for(int i = 0; i < former_slot.count(); ++i) {
+                if(former_slot.at(i).target == target) {
+                    former_slot.removeAt(i);
+                    break;
+                }
+            }
+            --pending;
+        }
+        int slot = (current_slot + ticks) % DELETION_WHEEL_SLOTS;
+        wheel[slot].append(deletion);
+        target_slots.insert(target, slot);
+        ++pending;
+        start_timer = !ticking;
+        ticking = true;
+    }
+
+    //The timer is only running while there are pending deletions, and belongs to the queue's thread
+    if(!start_timer) return;
+    if(QThread::currentThread() == thread()) {
+        start_ticking();
+    } else {
+        QMetaObject::invokeMethod(this, "start_ticking", Qt::QueuedConnection);
+    }
+}
+
+void DelayedDeletionQueue::flush() {
+    QList<PendingDeletion> deletions;
+    {
+        QMutexLocker lock(&mutex);
+        for(int i = 0; i < DELETION_WHEEL_SLOTS; ++i) {
+            deletions << wheel[i];
+            wheel[i].clear();
+        }
+        target_slots.clear();
+    }
+    perform(deletions);
+}
+
+int DelayedDeletionQueue::pending_count() {
+    QMutexLocker lock(&mutex);
+    return pending;
+}
+
+uint64_t DelayedDeletionQueue::deleted_count() {
+    QMutexLocker lock(&mutex);
+    return deleted;
+}
+
+void DelayedDeletionQueue::start_ticking() {
+    if(!timer) timer = new QTimer(this);
+    if(!timer) {
+        log_error(DELAYED_DELETION_QUEUE_NAME, ERR_BAD_ALLOC.arg(QString("timer")));
+        return;
+    }
+    connect(timer, SIGNAL(timeout()), this, SLOT(tick()), Qt::UniqueConnection);
+    if(!timer->isActive()) timer->start(DELETION_TICK);
+}
+
+void DelayedDeletionQueue::tick() {
+    //Take the deletions which are due out of the current slot, leave the others for a later turn
+    QList<PendingDeletion> deletions;
+    {
+        QMutexLocker lock(&mutex);
+        current_slot = (current_slot + 1) % DELETION_WHEEL_SLOTS;
+        QList<PendingDeletion>& slot = wheel[current_slot];
+        for(int i = 0; i < slot.count(); ++i) {
+            if(slot.at(i).turns == 0) {
+                deletions.append(slot.at(i));
+                target_slots.remove(slot.at(i).target);
+                slot.removeAt(i--);
+            } else {
+                --slot[i].turns;
+            }
+        }
+    }
+    perform(deletions);
+
+    //Stop ticking once there is nothing left to delete
+    QMutexLocker lock(&mutex);
+    if(pending == 0) {
+        ticking = false;
+        if(timer) timer->stop();
+    }
+}
+
+void DelayedDeletionQueue::perform(const QList<PendingDeletion>& deletions) {
+    //Deleters run without the lock held, since destructors may schedule other deletions
+    for(int i = 0; i < deletions.count(); ++i) deletions.at(i).deleter(deletions.at(i).target);
+
+    QMutexLocker lock(&mutex);
+    pending-= deletions.count();
+    deleted+= deletions.count();
+}
+
+//Counts the deletions of test objects
+class DeletionProbe {
+  public:
+    DeletionProbe(int& deletions) : deletions(deletions) {}
+    ~DeletionProbe() {++deletions;}
+  private:
+    int& deletions;
+};
+
+bool test_delayed_deletion() {
+    static const QString ERR_DELETION_MISMATCH("Unexpected %1 of delayed deletions");
+
+    //A short delay, a delay longer than a turn of the wheel, and an object scheduled twice
+    DelayedDeletionQueue queue;
+    int short_deletions = 0;
+    int long_deletions = 0;
+    int rescheduled_deletions = 0;
+    const int short_ticks = 4;
+    const int long_ticks = DELETION_WHEEL_SLOTS + 2;
+    const int rescheduled_ticks = 6;
+    queue.schedule(new DeletionProbe(short_deletions), delete_object<DeletionProbe>, short_ticks*DELETION_TICK);
+    queue.schedule(new DeletionProbe(long_deletions), delete_object<DeletionProbe>, long_ticks*DELETION_TICK);
+    DeletionProbe* rescheduled = new DeletionProbe(rescheduled_deletions);
+    queue.schedule(rescheduled, delete_object<DeletionProbe>, 2*DELETION_TICK);
+    queue.schedule(rescheduled, delete_object<DeletionProbe>, rescheduled_ticks*DELETION_TICK);
+    if(queue.pending_count() != 3) {
+        log_error(DELAYED_DELETION_QUEUE_NAME, ERR_DELETION_MISMATCH.arg("pending count"));
+        return false;
+    }
+
+    //Objects must be deleted once, on the tick they are due, and not before
+    for(int tick = 1; tick <= long_ticks + 1; ++tick) {
+        queue.tick();
+        if((short_deletions != (tick >= short_ticks ? 1 : 0)) ||
+           (long_deletions != (tick >= long_ticks ? 1 : 0)) ||
+           (rescheduled_deletions != (tick >= rescheduled_ticks ? 1 : 0))) {
+            log_error(DELAYED_DELETION_QUEUE_NAME, ERR_DELETION_MISMATCH.arg("timing"));
+            return false;
+        }
+    }
+    if(queue.pending_count() || (queue.deleted_count() != 3)) {
+        log_error(DELAYED_DELETION_QUEUE_NAME, ERR_DELETION_MISMATCH.arg("metrics"));
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,99 @@
+/* This unit provides facilities for deleting objects after a short time has elapsed.
+   This is typically useful when an object wants to destroy itself, which it obviously
+   cannot do in one of its methods.
+
+      Copyright (C) 2011-2012  Hadrien Grasland
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA */
+
+
+#ifndef DELAYED_DELETION_H
+#define DELAYED_DELETION_H
+
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QTimer>
+#include <stdint.h>
+
+#define DELETION_TICK 25 //Time between two deletion passes, in ms
+#define DELETION_WHEEL_SLOTS 64 //Ticks in a turn of the timer wheel, longer delays take several turns
+#define DEFAULT_DELETION_DELAY 100 //In ms
+
+//Shared timer wheel : deletions which are due in the same tick are performed together, in the
+//thread of the queue (the main thread, for delayed_deletions()). Objects may be scheduled for
+//deletion from any thread. QObjects owned by another thread should use deleteLater() instead.
+class DelayedDeletionQueue : public QObject {
+    Q_OBJECT
+
+  public:
+    DelayedDeletionQueue();
+    ~DelayedDeletionQueue(); //Pending deletions are performed right away
+    void schedule(void* target, void (*deleter)(void*), const int delay_ms); //Scheduling a pending
+                                                                            //target again moves it
+    void flush(); //Perform all pending deletions now, must be called from the queue's thread
+
+    //Metrics
+    int pending_count();
+    uint64_t deleted_count();
+
+  private slots:
+    void start_ticking();
+    void tick();
+
+  private:
+    struct PendingDeletion {
+        void* target;
+        void (*deleter)(void*);
+        int turns; //Full wheel turns left before deletion
+    };
+
+    QMutex mutex;
+    QList<PendingDeletion> wheel[DELETION_WHEEL_SLOTS];
+    int current_slot;
+    int pending;
+    uint64_t deleted;
+    bool ticking;
+    QHash<void*, int> target_slots; //Wheel slot of each pending target
+    QTimer* timer; //Created when first needed
+
+    void perform(const QList<PendingDeletion>& deletions);
+    friend bool test_delayed_deletion();
+};
+
+//Queue of the main thread. It is created on first use, as a child of the application object, so
+//that it lives within the application's lifetime. NULL when there is no application object.
+DelayedDeletionQueue* delayed_deletions();
+
+template <typename T> void delete_object(void* target) {
+    delete static_cast<T*>(target);
+}
+
+//Delete target after at least delay_ms milliseconds. Without an event loop to wait for, it is
+//deleted right away.
+template <typename T> void delayed_delete(T* target, const int delay_ms = DEFAULT_DELETION_DELAY) {
+    if(!target) return;
+    DelayedDeletionQueue* queue = delayed_deletions();
+    if(queue) {
+        queue->schedule((void*) target, delete_object<T>, delay_ms);
+    } else {
+        delete target;
+    }
+}
+
+bool test_delayed_deletion(); //Drive a queue's wheel by hand, check deletion times and metrics
+
+#endif // DELAYED_DELETION_H
@@ -0,0 +1,369 @@
+/* Error management routines : centralize all functions related to error management :
+   generating error messages, saving error logs... Logged events go through a lock-free ring
+   buffer and are written to disk by a background thread.
+
+      Copyright (C) 2011  Hadrien Grasland
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA */
+
+#include <QAtomicInt>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+#include <QWaitCondition>
+
+#include <error_management.h>
+
+const QString ERROR_MANAGEMENT_NAME("ErrorManagement");
+
+const QString ERR_BAD_ALLOC("Allocation of dynamic variable %1 failed.");
+const QString ERR_BAD_HEX_DATA("Bad hexadecimal data : %1");
+const QString ERR_FILE_HEADER_INCORRECT("Header of file %1 is incorrect.");
+const QString ERR_FILE_NOT_FOUND("File %1 not found.");
+const QString ERR_FILE_OPEN_FAILURE("File %1 could not be opened.");
+const QString ERR_FILE_READ_FAILURE("File %1 could not be read.");
+const QString ERR_FOLDER_CREATION_FAILURE("Folder %1 could not be created.");
+const QString ERR_NOT_AN_HASHED_KEY("Provided input is not an hashed key : %1");
+const QString ERR_UNSUPPORTED_CIPHER("Unsupported password cipher : %1");
+const QString ERR_UNSUPPORTED_HASH("Unsupported hash : %1");
+const QString ERR_UNSUPPORTED_HMAC("Unsupported HMAC : %1");
+const QString ERR_UNSUPPORTED_KEY_DERIVATION("Unsupported key derivation : %1");
+const QString ERR_UNSUPPORTED_PW_GEN("Unsupported password generator : %1");
+
+const QString LOG_LEVEL_NAMES[] = {"DEBUG", "INFO", "WARNING", "ERROR"};
+const QString MSG_EVENTS_DROPPED("%1 events were dropped because the log buffer was full");
+const QString MSG_EVENTS_SUPPRESSED("%1 more events were suppressed");
+const QString MSG_SESSION_START("Session started on %1");
+const qint64 RATE_WINDOW = 1000000000LL; //Rate limiting window, in ns
+
+//One slot of the log ring buffer. Its sequence number tells whether the slot is free for the
+//producer of a given position or holds an event for the log writer (see log_event())
+struct LogRecord {
+    QAtomicInt sequence;
+    LogLevel level;
+    qint64 timestamp; //Nanoseconds since logging was started
+    QString component;
+    QString description;
+};
+
+//Rate limiting state of a logging component
+struct ComponentRate {
+    ComponentRate() : events(0), suppressed(0), window_start(0) {}
+    int events;
+    int suppressed;
+    qint64 window_start;
+};
+
+//Writes logged events to their destination in the background, so that logging threads never
+//wait for the disk. Events are written in batches, with one flush per batch.
+class LogWriter : public QThread {
+  public:
+    LogWriter(QTextStream& error_output);
+    LogWriter(const QString& log_filepath);
+    ~LogWriter();
+    bool is_ready() const {return (output != NULL);}
+    void stop();
+  protected:
+    void run();
+  private:
+    QHash<QString, ComponentRate> component_rates;
+    bool header_written;
+    QFile* log_file;
+    QString log_filepath;
+    QTextStream* output;
+    QDateTime session_start;
+    bool stop_requested;
+
+    bool rate_limited(const QString& component, const qint64 timestamp);
+    void rotate_log_file();
+    void write_event(const LogLevel level,
+                     const qint64 timestamp,
+                     const QString& component,
+                     const QString& description);
+    void write_pending_events();
+    void write_suppressed_events(const QString& component, ComponentRate& rate, const qint64 timestamp);
+};
+
+//Bounded multi-producer ring buffer, after D. Vyukov's MPMC queue. Producers claim positions
+//with a CAS on log_enqueue_position and never block, the log writer is the only consumer.
+//Positions wrap around, so they are compared with unsigned arithmetic.
+LogRecord log_ring[LOG_RING_SIZE];
+bool log_ring_initialized = false;
+QAtomicInt log_enqueue_position;
+int log_dequeue_position = 0; //Only used by the log writer
+QAtomicInt log_dropped_events;
+
+QAtomicInt log_level(LOG_WARNING);
+QAtomicInt logging_active;
+QElapsedTimer log_clock;
+QMutex log_control_mutex; //Serializes start and stop, never taken by log_event()
+LogWriter* log_writer = NULL;
+QMutex log_wakeup_mutex;
+QWaitCondition log_wakeup;
+bool log_wakeup_pending = false; //Guarded by log_wakeup_mutex, so that wakeups which come while
+                                 //the log writer is busy are not lost
+
+inline int position_difference(const int position1, const int position2) {
+    return (int) ((unsigned int) position1 - (unsigned int) position2);
+}
+
+inline int position_after(const int position, const unsigned int distance = 1) {
+    return (int) ((unsigned int) position + distance);
+}
+
+inline LogRecord& ring_slot(const int position) {
+    return log_ring[(unsigned int) position % LOG_RING_SIZE];
+}
+
+LogWriter::LogWriter(QTextStream& error_output) : header_written(false),
+                                                  log_file(NULL),
+                                                  output(&error_output),
+                                                  session_start(QDateTime::currentDateTime()),
+                                                  stop_requested(false) {}
+
+LogWriter::LogWriter(const QString& log_filepath) : header_written(false),
+                                                    log_file(NULL),
+                                                    log_filepath(log_filepath),
+                                                    output(NULL),
+                                                    session_start(QDateTime::currentDateTime()),
+                                                    stop_requested(false) {
+    log_file = new QFile(log_filepath);
+    if(!log_file) return;
+    if(!log_file->open(QIODevice::WriteOnly | QIODevice::Append)) return;
+    output = new QTextStream(log_file);
+}
+
+LogWriter::~LogWriter() {
+    //Borrowed streams are left to their owner
+    if(log_file) {
+        delete output;
+        delete log_file;
+    }
+}
+
+void LogWriter::stop() {
+    log_wakeup_mutex.lock();
+    stop_requested = true;
+    log_wakeup.wakeAll();
+    log_wakeup_mutex.unlock();
+    wait();
+}
+
+void LogWriter::run() {
+    bool stopping = false;
+    while(!stopping) {
+        log_wakeup_mutex.lock();
+        if(!stop_requested && !log_wakeup_pending) log_wakeup.wait(&log_wakeup_mutex, LOG_FLUSH_PERIOD);
+        log_wakeup_pending = false;
+        stopping = stop_requested;
+        log_wakeup_mutex.unlock();
+        write_pending_events();
+    }
+
+    //Report suppressed events before leaving
+    qint64 timestamp = log_clock.nsecsElapsed();
+    QHash<QString, ComponentRate>::iterator rate;
+    for(rate = component_rates.begin(); rate != component_rates.end(); ++rate) {
+        write_suppressed_events(rate.key(), rate.value(), timestamp);
+    }
+    output->flush();
+}
+
+bool LogWriter::rate_limited(const QString& component, const qint64 timestamp) {
+    ComponentRate& rate = component_rates[component];
+    if(timestamp - rate.window_start >= RATE_WINDOW) {
+        write_suppressed_events(component, rate, timestamp);
+        rate.events = 0;
+        rate.window_start = timestamp;
+    }
+    if(rate.events >= LOG_RATE_LIMIT) {
+        ++rate.suppressed;
+        return true;
+    }
+    ++rate.events;
+    return false;
+}
+
+void LogWriter::rotate_log_file() {
+    //error_log.txt becomes error_log.txt.1, which becomes error_log.txt.2...
+    output->flush();
+    log_file->close();
+    for(int backup = LOG_ROTATION_BACKUPS; backup > 0; --backup) {
+        QString older_filepath = log_filepath + "." + QString::number(backup);
+        QString newer_filepath = log_filepath;
+        if(backup > 1) newer_filepath+= "." + QString::number(backup-1);
+        QFile::remove(older_filepath);
+        QFile::rename(newer_filepath, older_filepath);
+    }
+
+    //Events will be lost if the new file cannot be opened, but logging must not fail
+    log_file->open(QIODevice::WriteOnly | QIODevice::Append);
+    output->setDevice(log_file);
+    header_written = false;
+}
+
+void LogWriter::write_event(const LogLevel level,
+                            const qint64 timestamp,
+                            const QString& component,
+                            const QString& description) {
+    //Timestamps are relative to the session header, and monotonic
+    if(!header_written) {
+        *output << endl << MSG_SESSION_START.arg(session_start.toString(Qt::ISODate)) << endl;
+        header_written = true;
+    }
+    *output << "+" << QString::number(timestamp / 1e9, 'f', 6) << " " << LOG_LEVEL_NAMES[level]
+            << " [" << component << "] " << description << '\n';
+}
+
+void LogWriter::write_pending_events() {
+    //Take events out of the ring buffer, then release their slot for producers
+    while(true) {
+        LogRecord& record = ring_slot(log_dequeue_position);
+        int next_position = position_after(log_dequeue_position);
+        if(!record.sequence.testAndSetAcquire(next_position, next_position)) break;
+        LogLevel level = record.level;
+        qint64 timestamp = record.timestamp;
+        QString component = record.component;
+        QString description = record.description;
+        record.component.clear();
+        record.description.clear();
+        record.sequence.fetchAndStoreRelease(position_after(log_dequeue_position, LOG_RING_SIZE));
+        log_dequeue_position = next_position;
+
+        if(!rate_limited(component, timestamp)) write_event(level, timestamp, component, description);
+    }
+
+    int dropped_events = log_dropped_events.fetchAndStoreRelaxed(0);
+    if(dropped_events) {
+        write_event(LOG_WARNING,
+                    log_clock.nsecsElapsed(),
+                    ERROR_MANAGEMENT_NAME,
+                    MSG_EVENTS_DROPPED.arg(dropped_events));
+    }
+
+    output->flush();
+    if(log_file && (log_file->size() > LOG_ROTATION_SIZE)) rotate_log_file();
+}
+
+void LogWriter::write_suppressed_events(const QString& component,
+                                        ComponentRate& rate,
+                                        const qint64 timestamp) {
+    if(rate.suppressed == 0) return;
+    write_event(LOG_WARNING, timestamp, component, MSG_EVENTS_SUPPRESSED.arg(rate.suppressed));
+    rate.suppressed = 0;
+}
+
+QString generate_error_message(const QString& error_description) {
+    static const QString output(QCoreApplication::translate("CoreApplication", "%1\nIf this is a persistent problem, please contact us using the information that you will find in the \"About\" tab."));
+    return output.arg(error_description);
+}
+
+void log_error(const QString& failing_component,
+               const QString& error_description) {
+    log_event(LOG_ERROR, failing_component, error_description);
+}
+
+void log_event(const LogLevel level,
+               const QString& component,
+               const QString& description) {
+    if(!logging_active || (level < log_level)) return;
+
+    //Claim a slot of the ring buffer, or drop the event if the log writer is late
+    int position = log_enqueue_position;
+    LogRecord* record;
+    while(true) {
+        record = &ring_slot(position);
+        if(record->sequence.testAndSetAcquire(position, position)) {
+            //The slot was released by the log writer, try to take it before other producers
+            if(log_enqueue_position.testAndSetOrdered(position, position_after(position))) break;
+        } else if(position_difference(record->sequence, position) < 0) {
+            log_dropped_events.ref();
+            return;
+        }
+        position = log_enqueue_position;
+    }
+
+    //Fill it, then hand it over to the log writer
+    record->level = level;
+    record->timestamp = log_clock.nsecsElapsed();
+    record->component = component;
+    record->description = description;
+    record->sequence.fetchAndStoreRelease(position_after(position));
+
+    //Errors are written at once, in case the application is about to crash. The writer also
+    //gets woken up when half of the ring buffer is used. Only then is a lock taken.
+    if((level == LOG_ERROR) || ((unsigned int) position % (LOG_RING_SIZE/2) == 0)) {
+        log_wakeup_mutex.lock();
+        log_wakeup_pending = true;
+        log_wakeup.wakeOne();
+        log_wakeup_mutex.unlock();
+    }
+}
+
+void set_log_level(const LogLevel minimal_level) {
+    log_level = minimal_level;
+}
+
+void stop_log_writer() {
+    //Caller must hold log_control_mutex
+    if(!log_writer) return;
+    logging_active = 0;
+    log_writer->stop();
+    delete log_writer;
+    log_writer = NULL;
+}
+
+bool start_log_writer(LogWriter* writer) {
+    if(!writer) return false;
+    if(!writer->is_ready()) {
+        delete writer;
+        return false;
+    }
+
+    QMutexLocker lock(&log_control_mutex);
+    stop_log_writer();
+    if(!log_ring_initialized) {
+        for(int position = 0; position < LOG_RING_SIZE; ++position) log_ring[position].sequence = position;
+        log_ring_initialized = true;
+    }
+    log_clock.start();
+    log_writer = writer;
+    log_writer->start(QThread::LowPriority);
+    logging_active = 1;
+
+    return true;
+}
+
+bool start_error_logging(const QString& log_filepath) {
+    return start_log_writer(new LogWriter(log_filepath));
+}
+
+bool start_error_logging(QTextStream& error_output) {
+    return start_log_writer(new LogWriter(error_output));
+}
+
+bool error_logging_active() {
+    return logging_active;
+}
+
+void stop_error_logging() {
+    QMutexLocker lock(&log_control_mutex);
+    stop_log_writer();
+}
@@ -1,6 +1,6 @@
 /* Error management routines : centralize all functions related to error management :
-   generating error messages, displaying them to users, saving error logs...
-   Also includes a few common error messages.
+   generating error messages, saving error logs... Also includes a few common error messages.
+   Displaying errors to users is left to front-ends (see gui/error_display.h).
 
       Copyright (C) 2011  Hadrien Grasland
 
@@ -24,7 +24,6 @@
 
 #include <QString>
 #include <QTextStream>
-#include <QWidget>
 
 //A few common error messages first
 extern const QString ERR_BAD_ALLOC; //Used when a variable was not properly allocated. First
@@ -38,6 +37,8 @@ extern const QString ERR_FILE_NOT_FOUND; //A file was not found, and could not b
                                          //generated. First argument is the filename.
 extern const QString ERR_FILE_OPEN_FAILURE; //A file could not be opened as intended. First
                                             //argument is the filename.
+extern const QString ERR_FILE_READ_FAILURE; //Reading an opened file failed. First argument is the
+                                            //filename.
 extern const QString ERR_FOLDER_CREATION_FAILURE; //A folder could not be created. First argument
                                                   //is the filename.
 extern const QString ERR_NOT_AN_HASHED_KEY; //Some cryptographic functions specifically take an hashed
@@ -53,17 +54,33 @@ extern const QString ERR_UNSUPPORTED_HASH; //An external file specifies the name
 extern const QString ERR_UNSUPPORTED_HMAC; //An external file specifies the name of a HMAC that is
                                            //not implemented in this version of Hashish. First
                                            //argument is the name of the HMAC
+extern const QString ERR_UNSUPPORTED_KEY_DERIVATION; //An external file specifies a key derivation
+                                                     //that is not implemented in this version of
+                                                     //Hashish. First argument is its number
 extern const QString ERR_UNSUPPORTED_PW_GEN; //An external file specifies the name of a password
                                              //generator that is not implemented in this version of
                                              //Hashish. First argument is the name of the generator
 
-void display_error_message(QWidget* host_window,
-                           const QString& error_summary,
-                           const QString& error_description);
+//Tunables of the error log
+#define LOG_RING_SIZE 1024 //Events which may be waiting for the log writer, must be a power of 2
+#define LOG_FLUSH_PERIOD 100 //Maximal time (in ms) between an event and its writing
+#define LOG_RATE_LIMIT 20 //Events that one component may log per second, others are suppressed
+#define LOG_ROTATION_SIZE 1048576 //Size (in bytes) above which the log file is rotated
+#define LOG_ROTATION_BACKUPS 2 //Rotated log files which are kept (error_log.txt.1, .2...)
+
+//Severity of logged events, events below the current log level are discarded
+enum LogLevel {LOG_DEBUG = 0, LOG_INFO, LOG_WARNING, LOG_ERROR};
+
 QString generate_error_message(const QString& error_description);
 void log_error(const QString& failing_component,
                const QString& error_description);
-void start_error_logging(QTextStream& error_output);
+void log_event(const LogLevel level,
+               const QString& component,
+               const QString& description);
+void set_log_level(const LogLevel minimal_level);
+bool error_logging_active(); //Between start_error_logging() and stop_error_logging()
+bool start_error_logging(const QString& log_filepath);
+bool start_error_logging(QTextStream& error_output);
 void stop_error_logging();
 
 #endif // ERROR_MANAGEMENT_H
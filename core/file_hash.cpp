@@ -0,0 +1,104 @@
+/* File hashing : standard SHA-512 digests of files, as printed by sha512sum, so that backup
+   archives and the service store can be checked with Hashish's own SHA-512 implementation.
+
+      Copyright (C) 2011  Hadrien Grasland
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA */
+
+#include <QFile>
+#include <QRunnable>
+#include <QThreadPool>
+#include <QVector>
+#include <stdio.h>
+
+#include <crypto_hash.h>
+#include <error_management.h>
+#include <file_hash.h>
+
+const QString FILE_HASH_NAME("FileHash");
+
+//Hashes one file of a list into its slot of the result array
+class FileHashJob : public QRunnable {
+  public:
+    FileHashJob(const QString& file_path, QByteArray& hex_digest) : file_path(file_path),
+                                                                    hex_digest(hex_digest) {
+        setAutoDelete(true);
+    }
+    void run() {
+        if(!sha512_file(file_path, hex_digest)) hex_digest.clear();
+    }
+  private:
+    QString file_path;
+    QByteArray& hex_digest;
+};
+
+bool sha512_file(const QString& file_path, QByteArray& hex_digest) {
+    QFile file(file_path);
+    bool opened = (file_path == "-") ? file.open(stdin, QIODevice::ReadOnly) : file.open(QIODevice::ReadOnly);
+    if(!opened) {
+        log_error(FILE_HASH_NAME, ERR_FILE_OPEN_FAILURE.arg(file_path));
+        return false;
+    }
+    SHA512Stream stream;
+
+    //Map regular files window by window, which spares a copy of their contents
+    qint64 file_size = (file_path == "-") ? 0 : file.size();
+    qint64 hashed_size = 0;
+    while(hashed_size < file_size) {
+        qint64 window_size = file_size - hashed_size;
+        if(window_size > FILE_HASH_MAP_LENGTH) window_size = FILE_HASH_MAP_LENGTH;
+        uchar* window = file.map(hashed_size, window_size);
+        if(!window) break;
+        stream.update((const char*) window, window_size);
+        file.unmap(window);
+        hashed_size+= window_size;
+    }
+
+    //Read what could not be mapped, until the end of the file (which may have grown)
+    if(hashed_size && !file.seek(hashed_size)) {
+        log_error(FILE_HASH_NAME, ERR_FILE_READ_FAILURE.arg(file_path));
+        return false;
+    }
+    QByteArray read_buffer(FILE_HASH_READ_LENGTH, 0);
+    qint64 read_length;
+    while((read_length = file.read(read_buffer.data(), FILE_HASH_READ_LENGTH)) > 0) {
+        stream.update(read_buffer.constData(), read_length);
+    }
+    if(read_length < 0) {
+        log_error(FILE_HASH_NAME, ERR_FILE_READ_FAILURE.arg(file_path));
+        return false;
+    }
+
+    hex_digest = stream.hex_digest();
+    return true;
+}
+
+QList<QByteArray> sha512_files(const QStringList& file_paths) {
+    //Each job writes to its own digest, which must not move while jobs run
+    QVector<QByteArray> hex_digests(file_paths.count());
+    QByteArray* digest_slots = hex_digests.data();
+    QThreadPool workers;
+    for(int i = 0; i < file_paths.count(); ++i) {
+        FileHashJob* job = new FileHashJob(file_paths.at(i), digest_slots[i]);
+        if(!job) {
+            log_error(FILE_HASH_NAME, ERR_BAD_ALLOC.arg(QString("job")));
+            continue;
+        }
+        workers.start(job);
+    }
+    workers.waitForDone();
+
+    return hex_digests.toList();
+}
@@ -0,0 +1,38 @@
+/* File hashing : standard SHA-512 digests of files, as printed by sha512sum, so that backup
+   archives and the service store can be checked with Hashish's own SHA-512 implementation.
+
+      Copyright (C) 2011  Hadrien Grasland
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA */
+
+#ifndef FILE_HASH_H
+#define FILE_HASH_H
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+#define FILE_HASH_MAP_LENGTH 67108864 //Bytes mapped at once (64 MiB), so that large files fit in 32-bit address spaces
+#define FILE_HASH_READ_LENGTH 1048576 //Bytes read at once from files which cannot be mapped (pipes, devices...)
+
+//Regular files are memory-mapped, one window at a time. "-" stands for the standard input.
+bool sha512_file(const QString& file_path, QByteArray& hex_digest); //Lowercase hexadecimal digest
+
+//Hashes files concurrently, one thread per core. Digests are returned in the order of
+//file_paths, empty for files which could not be read.
+QList<QByteArray> sha512_files(const QStringList& file_paths);
+
+#endif // FILE_HASH_H
@@ -0,0 +1,18 @@
+# Links a front end to Hashish's core library (see core.pro), which must be built first.
+
+QT += network
+INCLUDEPATH += $$PWD
+DEPENDPATH += $$PWD
+no_tracing: DEFINES += HASHISH_NO_TRACING # Must match the core library's build
+
+CORE_BUILD_DIR = $$OUT_PWD/../core
+win32:CONFIG(release, debug|release): CORE_BUILD_DIR = $$CORE_BUILD_DIR/release
+win32:CONFIG(debug, debug|release): CORE_BUILD_DIR = $$CORE_BUILD_DIR/debug
+
+LIBS += -L$$CORE_BUILD_DIR -lhashish-core
+win32: LIBS += -ladvapi32 # RtlGenRandom, which salts snapshots
+win32-msvc* {
+    PRE_TARGETDEPS += $$CORE_BUILD_DIR/hashish-core.lib
+} else {
+    PRE_TARGETDEPS += $$CORE_BUILD_DIR/libhashish-core.a
+}
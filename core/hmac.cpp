@@ -17,14 +17,11 @@
     along with this program; if not, write to the Free Software
     Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA */
 
-#include <QFile>
 #include <string.h>
 
 #include <crypto_hash.h>
 #include <error_management.h>
 #include <hmac.h>
-#include <parsing_tools.h>
-#include <qstring_to_qwords.h>
 #include <test_suite.h>
 
 RFC2104HMAC rfc_2104_hmac;
@@ -48,143 +45,54 @@ bool test_hmacs() {
 const QString HMAC_NAME("HMAC");
 
 bool HMAC::test() {
-    const QString file_path = TEST_VEC_FILEPATH.arg(name());
-    CryptoHash* hash = NULL;
-    QString line, result;
-    size_t qw_key_length = 0;
-    uint64_t* qw_key = NULL;
-    size_t qw_message_length = 0;
-    uint64_t* qw_message = NULL;
-    size_t qw_result_length = 0;
-    uint64_t* qw_result = NULL;
-
-    //Open test file
-    QFile test_file(file_path);
-    if(test_file.exists() == false) {
-        log_error(HMAC_NAME, ERR_FILE_NOT_FOUND.arg(file_path));
+    const TestVectorFile* test_file = test_vector_file(name());
+    if(!test_file) {
+        log_error(HMAC_NAME, ERR_NO_TEST_VECTORS.arg(name()));
         return false;
     }
-    if(test_file.open(QIODevice::ReadOnly) == false) {
-        log_error(HMAC_NAME, ERR_FILE_OPEN_FAILURE.arg(file_path));
+    CryptoHash* hash = crypto_hash_database(test_file->hash);
+    if(!hash) {
+        log_error(HMAC_NAME, ERR_UNSUPPORTED_HASH.arg(test_file->hash));
         return false;
     }
-    QTextStream test_istream(&test_file);
-    if(test_istream.readLine() != TEST_FILE_HEADER) {
-        log_error(HMAC_NAME, ERR_FILE_HEADER_INCORRECT.arg(file_path));
-        return false;
-    }
-
-    //Perform tests
-    while(test_istream.atEnd() == false) {
-        //Read and clean up a line of text, ignoring comments and spacing
-        line = test_istream.readLine();
-        isolate_content(line);
-        if(line.isEmpty()) continue;
-
-        if(has_id(line, ID_HASH)) {
-            //When encountering a hash, prepare to use it
-            remove_id(line, ID_HASH);
-            hash = crypto_hash_database(line);
-            if(!hash) {
-                if(qw_result) delete[] qw_result;
-                log_error(HMAC_NAME, ERR_UNSUPPORTED_HASH.arg(line));
-                return false;
-            }
-
-            //Setup qw_result and its length
-            qw_result_length = hash->hash_length();
-            if(qw_result) delete[] qw_result;
-            qw_result = new uint64_t[qw_result_length];
-            if(!qw_result) {
-                log_error(HMAC_NAME, ERR_BAD_ALLOC.arg(QString("qw_result")));
-                return false;
-            }
-            continue;
-        }
 
-        //When encountering a key, store it
-        if(has_id(line, ID_KEY)) {
-            remove_id(line, ID_KEY);
-            qw_key_length = qword_length_hex(line);
-            if(qw_key_length == 0) {
-                if(qw_message) delete[] qw_message;
-                if(qw_result) delete[] qw_result;
-                log_error(HMAC_NAME, ERR_BAD_HEX_DATA.arg(line));
-                return false;
-            }
-            qw_key = new uint64_t[qw_key_length];
-            if(!qw_key) {
-                if(qw_message) delete[] qw_message;
-                if(qw_result) delete[] qw_result;
-                log_error(HMAC_NAME, ERR_BAD_ALLOC.arg(QString("qw_key")));
-                return false;
-            }
-            if(qwords_from_hex_str(line, qw_key) == false) {
-                if(qw_message) delete[] qw_message;
-                if(qw_result) delete[] qw_result;
-                delete[] qw_key;
-                log_error(HMAC_NAME, ERR_BAD_HEX_DATA.arg(line));
-                return false;
-            }
-            continue;
+    size_t result_length = hash->hash_length();
+    uint64_t result[result_length];
+    for(size_t i = 0; i < test_file->vector_count; ++i) {
+        const TestVector& vector = test_file->vectors[i];
+        if(vector.result_length != result_length) {
+            log_error(HMAC_NAME, ERR_BAD_TEST_VECTOR.arg(i).arg(name()));
+            return false;
         }
 
-        //When encountering a message, store it
-        if(has_id(line, ID_MESSAGE)) {
-            remove_id(line, ID_MESSAGE);
-            qw_message_length = qword_length_hex(line);
-            if(qw_message_length == 0) {
-                if(qw_key) delete[] qw_key;
-                if(qw_result) delete[] qw_result;
-                log_error(HMAC_NAME, ERR_BAD_HEX_DATA.arg(line));
-                return false;
-            }
-            qw_message = new uint64_t[qw_message_length];
-            if(!qw_message) {
-                if(qw_key) delete[] qw_key;
-                if(qw_result) delete[] qw_result;
-                log_error(HMAC_NAME, ERR_BAD_ALLOC.arg(QString("qw_message")));
-                return false;
-            }
-            if(qwords_from_hex_str(line, qw_message) == false) {
-                if(qw_key) delete[] qw_key;
-                if(qw_result) delete[] qw_result;
-                delete[] qw_message;
-                log_error(HMAC_NAME, ERR_BAD_HEX_DATA.arg(line));
-                return false;
-            }
-
-            continue;
-        }
-
-        if(has_id(line, ID_RESULT)) {
-            //Compute HMAC, check result
-            remove_id(line, ID_RESULT);
-            hmac(qw_key_length, qw_key, qw_message_length, qw_message, hash, qw_result);
-            qwords_to_hex_str(qw_result_length, qw_result, result);
-            delete[] qw_key;
-            delete[] qw_message;
-
-            if(result!=line) {
-                if(qw_result) delete[] qw_result;
-                log_error(HMAC_NAME, ERR_WRONG_RESULT.arg(result).arg(line));
-                return false;
-            }
-            continue;
+        //Compute HMAC, check result
+        uint64_t* hmac_result;
+        if(vector.repeat > 1) {
+            uint64_t* long_message = new_repeated_message(HMAC_NAME, vector);
+            if(!long_message) return false;
+            hmac_result = hmac(vector.key_length,
+                               vector.key,
+                               vector.message_length*vector.repeat,
+                               long_message,
+                               hash,
+                               result);
+            delete[] long_message;
+        } else {
+            hmac_result = hmac(vector.key_length, vector.key, vector.message_length, vector.message, hash, result);
         }
+        if(!hmac_result) return false;
+        if(!check_test_result(HMAC_NAME, result_length, result, vector.result)) return false;
     }
 
-    if(qw_result) delete[] qw_result;
-
     return true;
 }
 
 const QString RFC_2104_HMAC_NAME("RFC2104HMAC");
 
 uint64_t* RFC2104HMAC::hmac(size_t secret_key_length,
-                     uint64_t* secret_key,
+                     const uint64_t* secret_key,
                      size_t message_length,
-                     uint64_t* message,
+                     const uint64_t* message,
                      CryptoHash* hash,
                      uint64_t* dest_buffer) {
     //Generate a "key block" from the secret key, that has the hash's input block size
@@ -242,10 +150,10 @@ uint64_t* RFC2104HMAC::hmac(size_t secret_key_length,
     return result;
 }
 
-uint64_t* RFC2104HMAC::compute_hmac(uint64_t* outer_key_pad,
-                                    uint64_t* inner_key_pad,
+uint64_t* RFC2104HMAC::compute_hmac(const uint64_t* outer_key_pad,
+                                    const uint64_t* inner_key_pad,
                                     size_t message_length,
-                                    uint64_t* message,
+                                    const uint64_t* message,
                                     CryptoHash* hash,
                                     uint64_t* dest_buffer) {
     //Result = hash(outer_key_pad + hash(inner_key_pad + qw_service)) where + is concatenation
@@ -303,7 +211,7 @@ uint64_t* RFC2104HMAC::compute_hmac(uint64_t* outer_key_pad,
 }
 
 uint64_t* RFC2104HMAC::generate_key_block(size_t secret_key_length,
-                                   uint64_t* secret_key,
+                                   const uint64_t* secret_key,
                                    CryptoHash* hash,
                                    uint64_t* dest_buffer) {
     if(secret_key_length > hash->block_length()) {
@@ -325,7 +233,7 @@ uint64_t* RFC2104HMAC::generate_key_block(size_t secret_key_length,
 }
 
 uint64_t* RFC2104HMAC::generate_key_pad(size_t block_length,
-                                 uint64_t* key_block,
+                                 const uint64_t* key_block,
                                  uint64_t padding,
                                  uint64_t* dest_buffer) {
     //Compute periodized padding ^ key_block, return it in dest buffer
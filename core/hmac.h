@@ -31,9 +31,9 @@
 class HMAC {
   public:
     virtual uint64_t* hmac(size_t secret_key_length,
-                           uint64_t* secret_key,
+                           const uint64_t* secret_key,
                            size_t message_length,
-                           uint64_t* message,
+                           const uint64_t* message,
                            CryptoHash* hash,
                            uint64_t* dest_buffer) = 0;
     virtual QString name() = 0;
@@ -48,25 +48,25 @@ bool test_hmacs(); //Check all finalized HMACs against their known test vectors
 class RFC2104HMAC : public HMAC {
   public:
     virtual uint64_t* hmac(size_t secret_key_length,
-                           uint64_t* secret_key,
+                           const uint64_t* secret_key,
                            size_t message_length,
-                           uint64_t* message,
+                           const uint64_t* message,
                            CryptoHash* hash,
                            uint64_t* dest_buffer);
     virtual QString name() {return "RFC 2104";}
   private:
-    uint64_t* compute_hmac(uint64_t* outer_key_pad,
-                           uint64_t* inner_key_pad,
+    uint64_t* compute_hmac(const uint64_t* outer_key_pad,
+                           const uint64_t* inner_key_pad,
                            size_t message_length,
-                           uint64_t* message,
+                           const uint64_t* message,
                            CryptoHash* hash,
                            uint64_t* dest_buffer);
     uint64_t* generate_key_block(size_t secret_key_length,
-                                 uint64_t* secret_key,
+                                 const uint64_t* secret_key,
                                  CryptoHash* hash,
                                  uint64_t* dest_buffer);
     uint64_t* generate_key_pad(size_t block_length,
-                               uint64_t* key_block,
+                               const uint64_t* key_block,
                                uint64_t padding,
                                uint64_t* dest_buffer);
 };
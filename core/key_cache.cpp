@@ -0,0 +1,274 @@
+/* Stretched key cache : keeps the stretched keys of recently unlocked services in locked memory
+   for a while, so that asking for their passwords again does not go through key stretching.
+
+      Copyright (C) 2011  Hadrien Grasland
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA */
+
+#include <QMutexLocker>
+#include <string.h>
+#ifdef Q_OS_UNIX
+    #include <sys/mman.h>
+#endif
+#ifdef Q_OS_WIN32
+    #include <windows.h>
+#endif
+
+#include <error_management.h>
+#include <key_cache.h>
+
+const QString STRETCHED_KEY_CACHE_NAME("StretchedKeyCache");
+
+struct KeyCacheEntry {
+    CryptoHash* hash; //NULL for free entries
+    uint64_t iterations;
+    size_t key_length;
+    qint64 last_used; //In ms, on the cache's clock
+    uint64_t last_use; //Value of use_count
+    uint64_t initial_key[KEY_CACHE_KEY_LENGTH];
+    uint64_t stretched_key[KEY_CACHE_KEY_LENGTH];
+};
+
+struct KeyCacheMemory {
+    KeyCacheEntry entries[KEY_CACHE_ENTRIES];
+};
+
+StretchedKeyCache stretched_key_cache;
+
+KeyCacheMemory* allocate_locked_memory() {
+    //Locked pages are never written to swap, and are left out of core dumps where possible
+    void* memory = NULL;
+    #if defined(Q_OS_UNIX)
+        memory = mmap(NULL, sizeof(KeyCacheMemory), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if(memory == MAP_FAILED) return NULL;
+        if(mlock(memory, sizeof(KeyCacheMemory)) != 0) {
+            munmap(memory, sizeof(KeyCacheMemory));
+            return NULL;
+        }
+        #ifdef MADV_DONTDUMP
+            madvise(memory, sizeof(KeyCacheMemory), MADV_DONTDUMP);
+        #endif
+    #elif defined(Q_OS_WIN32)
+        memory = VirtualAlloc(NULL, sizeof(KeyCacheMemory), MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+        if(!memory) return NULL;
+        if(!VirtualLock(memory, sizeof(KeyCacheMemory))) {
+            VirtualFree(memory, 0, MEM_RELEASE);
+            return NULL;
+        }
+    #endif
+
+    //Freshly mapped memory is zeroed, so every entry starts free
+    return (KeyCacheMemory*) memory;
+}
+
+void free_locked_memory(KeyCacheMemory* memory) {
+    #if defined(Q_OS_UNIX)
+        munlock((void*) memory, sizeof(KeyCacheMemory));
+        munmap((void*) memory, sizeof(KeyCacheMemory));
+    #elif defined(Q_OS_WIN32)
+        VirtualUnlock((void*) memory, sizeof(KeyCacheMemory));
+        VirtualFree((void*) memory, 0, MEM_RELEASE);
+    #endif
+}
+
+bool same_qwords(const size_t length, const uint64_t* first, const uint64_t* second) {
+    //Compare all qwords, so that timing does not tell where keys differ
+    uint64_t difference = 0;
+    for(size_t i = 0; i < length; ++i) difference|= first[i] ^ second[i];
+    return (difference == 0);
+}
+
+StretchedKeyCache::StretchedKeyCache(const bool locked_memory) : locked_memory(locked_memory),
+                                                                 memory(NULL),
+                                                                 ttl_s(0),
+                                                                 use_count(0) {
+    clock.start();
+}
+
+StretchedKeyCache::~StretchedKeyCache() {
+    if(!memory) return;
+    lock();
+    if(locked_memory) {
+        free_locked_memory(memory);
+    } else {
+        delete memory;
+    }
+}
+
+bool StretchedKeyCache::set_ttl(const int seconds) {
+    QMutexLocker locker(&mutex);
+    if(seconds <= 0) {
+        ttl_s = 0;
+        if(memory) {
+            for(int i = 0; i < KEY_CACHE_ENTRIES; ++i) wipe_entry(i);
+        }
+        return true;
+    }
+
+    if(!memory) memory = locked_memory ? allocate_locked_memory() : new KeyCacheMemory(); //Zeroed
+    if(!memory) {
+        static const QString ERR_NO_LOCKED_MEMORY("Could not lock memory for the stretched key cache, which stays disabled");
+        log_error(STRETCHED_KEY_CACHE_NAME, ERR_NO_LOCKED_MEMORY);
+        ttl_s = 0;
+        return false;
+    }
+    ttl_s = seconds;
+    return true;
+}
+
+int StretchedKeyCache::entry_count() {
+    QMutexLocker locker(&mutex);
+    if(!memory) return 0;
+
+    int count = 0;
+    for(int i = 0; i < KEY_CACHE_ENTRIES; ++i) {
+        if(memory->entries[i].hash) ++count;
+    }
+    return count;
+}
+
+bool StretchedKeyCache::fetch(CryptoHash* hash,
+                              const uint64_t iterations,
+                              const size_t key_length,
+                              const uint64_t* initial_key,
+                              uint64_t* dest_buffer) {
+    QMutexLocker locker(&mutex);
+    if(!ttl_s || (key_length > KEY_CACHE_KEY_LENGTH)) return false;
+
+    qint64 now = clock.elapsed();
+    for(int i = 0; i < KEY_CACHE_ENTRIES; ++i) {
+        KeyCacheEntry& entry = memory->entries[i];
+        if((entry.hash != hash) || (entry.iterations != iterations) || (entry.key_length != key_length)) continue;
+        if(!same_qwords(key_length, entry.initial_key, initial_key)) continue;
+
+        //Idle entries are only wiped periodically, so check that this one is still valid
+        if(now - entry.last_used > ttl_s*(qint64) 1000) {
+            wipe_entry(i);
+            return false;
+        }
+        entry.last_used = now;
+        entry.last_use = ++use_count;
+        memcpy((void*) dest_buffer, (const void*) entry.stretched_key, key_length*sizeof(uint64_t));
+        return true;
+    }
+
+    return false;
+}
+
+void StretchedKeyCache::store(CryptoHash* hash,
+                              const uint64_t iterations,
+                              const size_t key_length,
+                              const uint64_t* initial_key,
+                              const uint64_t* stretched_key) {
+    QMutexLocker locker(&mutex);
+    if(!ttl_s || (key_length > KEY_CACHE_KEY_LENGTH)) return;
+
+    //Replace a free entry, or else the least recently used one
+    int replaced = 0;
+    for(int i = 0; i < KEY_CACHE_ENTRIES; ++i) {
+        const KeyCacheEntry& entry = memory->entries[i];
+        if(!entry.hash) {
+            replaced = i;
+            break;
+        }
+        if(entry.last_use < memory->entries[replaced].last_use) replaced = i;
+    }
+    wipe_entry(replaced);
+
+    KeyCacheEntry& entry = memory->entries[replaced];
+    entry.hash = hash;
+    entry.iterations = iterations;
+    entry.key_length = key_length;
+    entry.last_used = clock.elapsed();
+    entry.last_use = ++use_count;
+    memcpy((void*) entry.initial_key, (const void*) initial_key, key_length*sizeof(uint64_t));
+    memcpy((void*) entry.stretched_key, (const void*) stretched_key, key_length*sizeof(uint64_t));
+}
+
+void StretchedKeyCache::expire() {
+    QMutexLocker locker(&mutex);
+    if(!memory) return;
+
+    qint64 now = clock.elapsed();
+    for(int i = 0; i < KEY_CACHE_ENTRIES; ++i) {
+        const KeyCacheEntry& entry = memory->entries[i];
+        if(entry.hash && (now - entry.last_used > ttl_s*(qint64) 1000)) wipe_entry(i);
+    }
+}
+
+void StretchedKeyCache::lock() {
+    QMutexLocker locker(&mutex);
+    if(!memory) return;
+
+    for(int i = 0; i < KEY_CACHE_ENTRIES; ++i) wipe_entry(i);
+}
+
+void StretchedKeyCache::wipe_entry(const int index) {
+    memset((void*) &(memory->entries[index]), 0, sizeof(KeyCacheEntry));
+}
+
+bool test_key_cache() {
+    static const QString ERR_KEY_CACHE_MISMATCH("Unexpected %1 on synthetic keys");
+    const size_t key_length = default_hash.hash_length();
+    uint64_t first_key[KEY_CACHE_KEY_LENGTH], initial_key[KEY_CACHE_KEY_LENGTH];
+    uint64_t stretched_key[KEY_CACHE_KEY_LENGTH], result[KEY_CACHE_KEY_LENGTH];
+    for(size_t j = 0; j < key_length; ++j) first_key[j] = j;
+
+    //Locked memory may legitimately be unavailable (e.g. with a low RLIMIT_MEMLOCK). The cache's
+    //logic is then checked in ordinary memory, rather than not at all.
+    StretchedKeyCache locked_cache;
+    StretchedKeyCache unlocked_cache(false);
+    bool locked = locked_cache.set_ttl(60);
+    if(!locked && !unlocked_cache.set_ttl(60)) return false;
+    StretchedKeyCache& cache = locked ? locked_cache : unlocked_cache;
+
+    //Fill the cache beyond its capacity, looking up the first key every time so that it stays in
+    for(int i = 0; i <= KEY_CACHE_ENTRIES; ++i) {
+        for(size_t j = 0; j < key_length; ++j) {
+            initial_key[j] = i*key_length + j;
+            stretched_key[j] = ~initial_key[j];
+        }
+        cache.store(&default_hash, 1000, key_length, initial_key, stretched_key);
+        cache.fetch(&default_hash, 1000, key_length, first_key, result);
+    }
+    if(cache.entry_count() != KEY_CACHE_ENTRIES) {
+        log_error(STRETCHED_KEY_CACHE_NAME, ERR_KEY_CACHE_MISMATCH.arg("entry count"));
+        return false;
+    }
+
+    //The first key is still there, the second one has been replaced, and parameters must match
+    bool first_found = cache.fetch(&default_hash, 1000, key_length, first_key, result);
+    if(!first_found || (result[1] != ~(uint64_t) 1)) {
+        log_error(STRETCHED_KEY_CACHE_NAME, ERR_KEY_CACHE_MISMATCH.arg("lookup result"));
+        return false;
+    }
+    if(cache.fetch(&default_hash, 999, key_length, first_key, result)) {
+        log_error(STRETCHED_KEY_CACHE_NAME, ERR_KEY_CACHE_MISMATCH.arg("lookup with other parameters"));
+        return false;
+    }
+    for(size_t j = 0; j < key_length; ++j) initial_key[j] = key_length + j;
+    if(cache.fetch(&default_hash, 1000, key_length, initial_key, result)) {
+        log_error(STRETCHED_KEY_CACHE_NAME, ERR_KEY_CACHE_MISMATCH.arg("replacement"));
+        return false;
+    }
+
+    cache.lock();
+    if(cache.entry_count() || cache.fetch(&default_hash, 1000, key_length, first_key, result)) {
+        log_error(STRETCHED_KEY_CACHE_NAME, ERR_KEY_CACHE_MISMATCH.arg("lock"));
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,80 @@
+/* Stretched key cache : keeps the stretched keys of recently unlocked services in locked memory
+   for a while, so that asking for their passwords again does not go through key stretching.
+
+      Copyright (C) 2011  Hadrien Grasland
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA */
+
+#ifndef KEY_CACHE_H
+#define KEY_CACHE_H
+
+#include <QElapsedTimer>
+#include <QMutex>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <crypto_hash.h>
+
+#define KEY_CACHE_ENTRIES 64 //Services whose stretched key may be cached at once
+#define KEY_CACHE_KEY_LENGTH 16 //Longest cacheable key, in qwords
+#define KEY_CACHE_EXPIRY_PERIOD 1000 //Time between two checks for idle entries, in ms
+
+struct KeyCacheMemory;
+
+//The cache is disabled until a TTL is set. Entries are looked up with the initial key, which is
+//HMAC(master password, service name and nonce) and thus fingerprints both, along with the
+//stretching parameters. They are kept in memory which is locked (never swapped out) and excluded
+//from core dumps where the OS allows it, and wiped when evicted, idle for longer than the TTL,
+//or when the cache is locked.
+class StretchedKeyCache {
+  public:
+    StretchedKeyCache(const bool locked_memory = true); //Unlocked caches are only meant for tests
+    ~StretchedKeyCache();
+    bool set_ttl(const int seconds); //0 disables the cache. Fails if locked memory is unavailable.
+    int ttl() {return ttl_s;}
+    bool enabled() {return (ttl_s != 0);}
+    int entry_count();
+
+    //Copy the stretched key matching an initial key to dest_buffer, if it is cached
+    bool fetch(CryptoHash* hash,
+               const uint64_t iterations,
+               const size_t key_length,
+               const uint64_t* initial_key,
+               uint64_t* dest_buffer);
+    void store(CryptoHash* hash,
+               const uint64_t iterations,
+               const size_t key_length,
+               const uint64_t* initial_key,
+               const uint64_t* stretched_key);
+
+    void expire(); //Wipe entries which have been idle for longer than the TTL
+    void lock(); //Wipe every entry now
+  private:
+    QMutex mutex;
+    bool locked_memory;
+    KeyCacheMemory* memory; //Allocated when the cache is first enabled, kept until exit
+    QElapsedTimer clock;
+    int ttl_s;
+    uint64_t use_count; //Orders entries by last use, more finely than the clock
+
+    void wipe_entry(const int index);
+};
+
+extern StretchedKeyCache stretched_key_cache;
+
+bool test_key_cache(); //Check lookups, replacement and wiping on synthetic keys, in locked memory
+                       //when it is available
+
+#endif // KEY_CACHE_H
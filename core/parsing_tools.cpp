@@ -0,0 +1,232 @@
+/* Service functions that are useful for parsing Hashish's various configuration files
+
+      Copyright (C) 2011  Hadrien Grasland
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA */
+
+#include <string.h>
+
+#include <error_management.h>
+#include <parsing_tools.h>
+
+const QString PARSING_TOOLS_NAME("KeywordTable");
+
+int case_insensitive_lower_bound(const QStringList& list, const QString& name) {
+    //Binary search for the first entry of the list which is not lower than name
+    int first = 0;
+    int count = list.count();
+    while(count > 0) {
+        int step = count/2;
+        int middle = first + step;
+        if(list.at(middle).compare(name, Qt::CaseInsensitive) < 0) {
+            first = middle+1;
+            count-= step+1;
+        } else {
+            count = step;
+        }
+    }
+
+    return first;
+}
+
+int case_insensitive_find(const QStringList& list, const QString& name) {
+    //Case-insensitively equal names are contiguous in the list, look for an exact match among them
+    for(int i = case_insensitive_lower_bound(list, name); i < list.count(); ++i) {
+        const QString& current_name = list.at(i);
+        if(current_name.compare(name, Qt::CaseInsensitive) != 0) break;
+        if(current_name == name) return i;
+    }
+
+    return -1;
+}
+
+const char ID_SEPARATOR[] = " : ";
+const int ID_SEPARATOR_LENGTH = 3;
+const int MAX_SEED_ATTEMPTS = 256; //Attempts at finding a perfect hash before growing the table
+
+bool is_spacing(const char c) {
+    return (c == ' ') || (c == '\t');
+}
+
+bool parse_decimal(const char* text, const int length, bool& negative, uint64_t& magnitude) {
+    //Surrounding spacing and a sign are accepted, anything else makes the number invalid
+    int begin = 0, end = length;
+    while((begin < end) && is_spacing(text[begin])) ++begin;
+    while((end > begin) && is_spacing(text[end-1])) --end;
+    negative = (begin < end) && (text[begin] == '-');
+    if((begin < end) && ((text[begin] == '-') || (text[begin] == '+'))) ++begin;
+    if(begin == end) return false;
+
+    magnitude = 0;
+    for(int i = begin; i < end; ++i) {
+        unsigned int digit = (unsigned char) text[i] - '0';
+        if(digit > 9) return false;
+        if(magnitude > (UINT64_MAX - digit) / 10) return false; //Overflow
+        magnitude = magnitude*10 + digit;
+    }
+
+    return true;
+}
+
+KeywordTable::KeywordTable(const QString* const identifiers[], const int identifier_count) : seed(0) {
+    //Identifiers are looked up without their separator
+    keywords.resize(identifier_count);
+    for(int i = 0; i < identifier_count; ++i) {
+        QString identifier = *(identifiers[i]);
+        if(identifier.endsWith(ID_SEPARATOR)) identifier.chop(ID_SEPARATOR_LENGTH);
+        keywords[i] = identifier.toLatin1();
+    }
+
+    //No seed can tell equal keywords apart, so only the first of duplicates gets a slot
+    QVector<int> distinct_keywords;
+    for(int i = 0; i < identifier_count; ++i) {
+        bool duplicate = false;
+        for(int j = 0; (j < i) && !duplicate; ++j) duplicate = (keywords[j] == keywords[i]);
+        if(duplicate) {
+            static const QString ERR_DUPLICATE_KEYWORD("Keyword %1 is listed twice, only its first occurrence is used");
+            log_error(PARSING_TOOLS_NAME, ERR_DUPLICATE_KEYWORD.arg(QString::fromLatin1(keywords[i].constData())));
+            continue;
+        }
+        distinct_keywords.append(i);
+    }
+
+    //Look for a hash seed which sends every keyword to its own slot, in a table with at least
+    //twice as many keyword_slots as keywords, growing it if no seed is found
+    int table_size = 4;
+    while(table_size < 2*distinct_keywords.count()) table_size*= 2;
+    while(true) {
+        keyword_slots.fill(-1, table_size);
+        for(seed = 0; seed < MAX_SEED_ATTEMPTS; ++seed) {
+            bool collision = false;
+            keyword_slots.fill(-1);
+            for(int i = 0; (i < distinct_keywords.count()) && !collision; ++i) {
+                const QByteArray& keyword = keywords[distinct_keywords[i]];
+                int& slot = keyword_slots[hash(keyword.constData(), keyword.size())];
+                collision = (slot != -1);
+                slot = distinct_keywords[i];
+            }
+            if(!collision) return;
+        }
+        table_size*= 2;
+    }
+}
+
+int KeywordTable::find(const char* key, const int key_length) const {
+    int index = keyword_slots[hash(key, key_length)];
+    if(index == -1) return -1;
+    const QByteArray& keyword = keywords[index];
+    if((keyword.size() != key_length) || (memcmp(keyword.constData(), key, key_length) != 0)) return -1;
+
+    return index;
+}
+
+unsigned int KeywordTable::hash(const char* key, const int key_length) const {
+    //Seeded FNV-1a, folded so that short tables still see the high bits
+    uint32_t result = 2166136261U ^ (seed * 0x9E3779B9U);
+    for(int i = 0; i < key_length; ++i) {
+        result^= (unsigned char) key[i];
+        result*= 16777619U;
+    }
+    result^= result >> 16;
+
+    return result & (keyword_slots.size()-1);
+}
+
+int ConfigField::to_int() const {
+    bool negative;
+    uint64_t magnitude;
+    if(!parse_decimal(value, value_length, negative, magnitude)) return 0;
+    if(magnitude > (negative ? 2147483648ULL : 2147483647ULL)) return 0;
+
+    return negative ? (int) -(int64_t) magnitude : (int) magnitude;
+}
+
+uint64_t ConfigField::to_ulonglong() const {
+    bool negative;
+    uint64_t magnitude;
+    if(!parse_decimal(value, value_length, negative, magnitude)) return 0;
+    if(negative && magnitude) return 0;
+
+    return magnitude;
+}
+
+QString ConfigField::to_string() const {
+    //Files are written by QTextStream, using the locale's codec
+    return QString::fromLocal8Bit(value, value_length);
+}
+
+bool ConfigField::value_is(const char* text) const {
+    int text_length = strlen(text);
+    return (text_length == value_length) && (memcmp(value, text, text_length) == 0);
+}
+
+ConfigTokenizer::ConfigTokenizer(const QByteArray& file_data) : end(file_data.constData()+file_data.size()),
+                                                               position(file_data.constData()) {}
+
+bool ConfigTokenizer::next_field(const KeywordTable& keywords, ConfigField& field) {
+    while(position < end) {
+        //Remove indentation, skip empty lines and comments
+        const char* line;
+        int line_length = next_line(line);
+        int indentation = 0;
+        while((indentation < line_length) && (line[indentation] == ' ')) ++indentation;
+        if((indentation == line_length) || (line[indentation] == '#')) continue;
+        field.content = line + indentation;
+        field.content_length = line_length - indentation;
+
+        //Split "identifier : value" lines, other lines only have a value
+        field.id = -1;
+        field.value = field.content;
+        field.value_length = field.content_length;
+        for(int i = 0; i+ID_SEPARATOR_LENGTH <= field.content_length; ++i) {
+            if(field.content[i] != ID_SEPARATOR[0]) continue;
+            if(memcmp(field.content+i, ID_SEPARATOR, ID_SEPARATOR_LENGTH) != 0) continue;
+            field.id = keywords.find(field.content, i);
+            if(field.id != -1) {
+                field.value = field.content + i + ID_SEPARATOR_LENGTH;
+                field.value_length = field.content_length - i - ID_SEPARATOR_LENGTH;
+            }
+            break;
+        }
+        return true;
+    }
+
+    return false;
+}
+
+bool ConfigTokenizer::read_header(const QString& expected_header) {
+    //A byte order mark may come first
+    static const char UTF8_BOM[] = "\xEF\xBB\xBF";
+    if((end - position >= 3) && (memcmp(position, UTF8_BOM, 3) == 0)) position+= 3;
+
+    const char* line;
+    int line_length = next_line(line);
+    QByteArray header = expected_header.toLocal8Bit();
+    return (header.size() == line_length) && (memcmp(header.constData(), line, line_length) == 0);
+}
+
+int ConfigTokenizer::next_line(const char*& line) {
+    line = position;
+    const char* line_end = (const char*) memchr(position, '\n', end - position);
+    if(line_end) {
+        position = line_end + 1;
+    } else {
+        line_end = end;
+        position = end;
+    }
+    if((line_end > line) && (line_end[-1] == '\r')) --line_end;
+
+    return line_end - line;
+}
@@ -0,0 +1,79 @@
+/* Service functions that are useful for parsing Hashish's various configuration files
+
+      Copyright (C) 2011  Hadrien Grasland
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA */
+
+#ifndef PARSING_TOOLS_H
+#define PARSING_TOOLS_H
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <stdint.h>
+
+//Binary searches in a case-insensitively sorted list of names
+int case_insensitive_lower_bound(const QStringList& list, const QString& name); //Index of the first
+                                                                               //name >= name
+int case_insensitive_find(const QStringList& list, const QString& name); //Index of name, or -1
+
+//Hashish's config files are made of "identifier : value" lines, possibly indented, with '#'
+//comments and '}' lines closing blocks. They are read in one go, then tokenized in place : lines
+//are views into the raw file data, and values are only converted to QStrings when stored.
+
+//Perfect hash table of the identifiers that a file section may contain, so that a line is
+//dispatched with one hash and one comparison. Identifiers are given the way they are written to
+//files ("name : "), and should be distinct: only the first of duplicates can be found.
+class KeywordTable {
+  public:
+    KeywordTable(const QString* const identifiers[], const int identifier_count);
+    int find(const char* key, const int key_length) const; //Index of an identifier, or -1
+  private:
+    QVector<QByteArray> keywords;
+    unsigned int seed;
+    QVector<int> keyword_slots; //Keyword index for each hash value, or -1
+    unsigned int hash(const char* key, const int key_length) const;
+};
+
+//One line of a config file, as a view into the file data
+struct ConfigField {
+    int id; //Index of the line's identifier in the KeywordTable, -1 if it has none
+    const char* content; //Line without its indentation
+    int content_length;
+    const char* value; //What follows the identifier, or the whole content if there is none
+    int value_length;
+
+    bool closes_block() const {return (content_length > 0) && (content[0] == '}');}
+    int to_int() const; //Like QString::toInt(), 0 if the value is not a number
+    uint64_t to_ulonglong() const; //Like QString::toULongLong(), 0 if the value is not a number
+    QString to_string() const;
+    bool value_is(const char* text) const;
+};
+
+class ConfigTokenizer {
+  public:
+    ConfigTokenizer(const QByteArray& file_data); //file_data must outlive the tokenizer
+    bool at_end() const {return (position >= end);}
+    bool next_field(const KeywordTable& keywords, ConfigField& field); //Skips comments and empty
+                                                                       //lines, false at the end
+    bool read_header(const QString& expected_header); //Checks the first line of the file
+  private:
+    const char* end;
+    const char* position;
+    int next_line(const char*& line); //Returns the line length, without line terminators
+};
+
+#endif // PARSING_TOOLS_H
@@ -0,0 +1,107 @@
+/* Password batches : compute the passwords of many services under one master password, in
+   parallel on a pool of worker threads.
+
+      Copyright (C) 2011  Hadrien Grasland
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA */
+
+#include <QRunnable>
+
+#include <error_management.h>
+#include <password_batch.h>
+
+const QString PASSWORD_BATCH_NAME("PasswordBatch");
+
+//Computes one password of a batch, which outlives it
+class PasswordBatchJob : public QRunnable {
+  public:
+    PasswordBatchJob(const QwordPassword& master_pw,
+                     ServiceDescriptor& service,
+                     int service_index,
+                     PasswordBatchReceiver* receiver,
+                     QSemaphore& finished_jobs) : master_pw(master_pw),
+                                                  service(service),
+                                                  service_index(service_index),
+                                                  receiver(receiver),
+                                                  finished_jobs(finished_jobs) {
+        setAutoDelete(true);
+    }
+    void run() {
+        QString password;
+        bool success = (service.compute_password(master_pw, password) != NULL);
+        receiver->password_computed(service_index, success, password);
+        password.fill(QChar(0));
+        password.clear();
+
+        //The batch may be destroyed from then on
+        finished_jobs.release();
+    }
+  private:
+    const QwordPassword& master_pw;
+    ServiceDescriptor& service;
+    int service_index;
+    PasswordBatchReceiver* receiver;
+    QSemaphore& finished_jobs;
+};
+
+PasswordBatch::PasswordBatch(const QString& master_password,
+                             QThreadPool* pool) : master_pw(master_password),
+                                                  started(false),
+                                                  started_jobs(0),
+                                                  workers(pool ? pool : &own_workers) {}
+
+PasswordBatch::~PasswordBatch() {
+    wait();
+    while(services.isEmpty() == false) delete services.takeFirst();
+}
+
+int PasswordBatch::add_service(const ServiceDescriptor& service) {
+    if(started) return -1;
+
+    //Each job works on its own copy, since computing a password may update cached data
+    ServiceDescriptor* service_copy = new ServiceDescriptor(service);
+    if(!service_copy) {
+        log_error(PASSWORD_BATCH_NAME, ERR_BAD_ALLOC.arg(QString("service_copy")));
+        return -1;
+    }
+    services.append(service_copy);
+
+    return services.count() - 1;
+}
+
+bool PasswordBatch::start(PasswordBatchReceiver* receiver) {
+    if(started || !receiver) return false;
+    if(!master_pw.qwords) return false;
+    started = true;
+
+    for(int i = 0; i < services.count(); ++i) {
+        PasswordBatchJob* job = new PasswordBatchJob(master_pw, *(services[i]), i, receiver, finished_jobs);
+        if(!job) {
+            log_error(PASSWORD_BATCH_NAME, ERR_BAD_ALLOC.arg(QString("job")));
+            receiver->password_computed(i, false, QString());
+            continue;
+        }
+        workers->start(job);
+        ++started_jobs;
+    }
+
+    return true;
+}
+
+void PasswordBatch::wait() {
+    //Shared pools also run other work, so only this batch's jobs are waited for
+    finished_jobs.acquire(started_jobs);
+    finished_jobs.release(started_jobs);
+}
@@ -0,0 +1,59 @@
+/* Password batches : compute the passwords of many services under one master password, in
+   parallel on a pool of worker threads.
+
+      Copyright (C) 2011  Hadrien Grasland
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA */
+
+#ifndef PASSWORD_BATCH_H
+#define PASSWORD_BATCH_H
+
+#include <QList>
+#include <QSemaphore>
+#include <QString>
+#include <QThreadPool>
+
+#include <service_descriptor.h>
+
+//Receives the results of a batch as they complete. Called from the batch's worker threads, so
+//implementations must be thread-safe.
+class PasswordBatchReceiver {
+  public:
+    virtual ~PasswordBatchReceiver() {}
+    virtual void password_computed(int service_index, bool success, const QString& password) = 0;
+};
+
+//Services are independent, so each one is computed by its own job. The master password is
+//converted to qwords once for the whole batch. Jobs run on the given pool, which may be shared by
+//several batches, or else on a pool of the batch's own.
+class PasswordBatch {
+  public:
+    PasswordBatch(const QString& master_password, QThreadPool* pool = NULL);
+    ~PasswordBatch(); //Waits for running computations, then wipes the master password
+    int add_service(const ServiceDescriptor& service); //Returns the index results will be reported with, or -1
+    int count() const {return services.count();}
+    bool start(PasswordBatchReceiver* receiver); //Can only be done once
+    void wait(); //Returns once every result has been reported
+  private:
+    QwordPassword master_pw;
+    QList<ServiceDescriptor*> services;
+    bool started;
+    int started_jobs;
+    QSemaphore finished_jobs; //Released by each job once it has reported
+    QThreadPool* workers;
+    QThreadPool own_workers; //One thread per core by default
+};
+
+#endif // PASSWORD_BATCH_H
@@ -0,0 +1,149 @@
+/* PasswordCipher class : implements a method for storing legacy passwords in an encrypted form,
+   using a generated hash as the encryption key and an OFB algorithm for block cipher chaining.
+
+      Copyright (C) 2011  Hadrien Grasland
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA */
+
+#include <string.h>
+
+#include <error_management.h>
+#include <password_cipher.h>
+#include <test_suite.h>
+
+OFBChainedXorCipher ofb_chained_xor_cipher;
+PasswordCipher& default_cipher = ofb_chained_xor_cipher;
+
+PasswordCipher* cipher_database(const QString& cipher_name) {
+    if(cipher_name == ofb_chained_xor_cipher.name()) {
+        return &ofb_chained_xor_cipher;
+    }
+
+    return NULL;
+}
+
+bool test_password_ciphers() {
+    bool result = ofb_chained_xor_cipher.test();
+    if(!result) return false;
+
+    return true;
+}
+
+const QString PASSWORD_CIPHER_NAME("PasswordCipher");
+
+bool PasswordCipher::test() {
+    const TestVectorFile* test_file = test_vector_file(name());
+    if(!test_file) {
+        log_error(PASSWORD_CIPHER_NAME, ERR_NO_TEST_VECTORS.arg(name()));
+        return false;
+    }
+    CryptoHash* hash = crypto_hash_database(test_file->hash);
+    if(!hash) {
+        log_error(PASSWORD_CIPHER_NAME, ERR_UNSUPPORTED_HASH.arg(test_file->hash));
+        return false;
+    }
+
+    for(size_t i = 0; i < test_file->vector_count; ++i) {
+        const TestVector& vector = test_file->vectors[i];
+        if((vector.key_length != hash->hash_length()) || (vector.result_length != vector.message_length)) {
+            log_error(PASSWORD_CIPHER_NAME, ERR_BAD_TEST_VECTOR.arg(i).arg(name()));
+            return false;
+        }
+
+        //Compute encrypted message, check it against a known good result
+        uint64_t* result = new uint64_t[vector.result_length];
+        if(!result) {
+            log_error(PASSWORD_CIPHER_NAME, ERR_BAD_ALLOC.arg(QString("result")));
+            return false;
+        }
+        bool passed = (encrypt(vector.key, vector.message_length, vector.message, hash, result) != NULL);
+        if(passed) passed = check_test_result(PASSWORD_CIPHER_NAME, vector.result_length, result, vector.result);
+        delete[] result;
+        if(!passed) return false;
+    }
+
+    return true;
+}
+
+const QString OFB_CHAINED_XOR_CIPHER_NAME("OFBChainedXorCipher");
+
+uint64_t* OFBChainedXorCipher::decrypt(const uint64_t* hashed_key,
+                                       size_t enc_message_length,
+                                       const uint64_t* enc_message,
+                                       CryptoHash* hash,
+                                       uint64_t* dest_buffer) {
+    //This is a symmetric cipher, so decryption is rigorously identical to encryption
+    return encrypt(hashed_key, enc_message_length, enc_message, hash, dest_buffer);
+}
+
+uint64_t* OFBChainedXorCipher::encrypt(const uint64_t* hashed_key,
+                                       size_t message_length,
+                                       const uint64_t* message,
+                                       CryptoHash* hash,
+                                       uint64_t* dest_buffer) {
+    //Prepare the initial "key block", to be XORed with the password for encryption
+    size_t key_block_length = hash->hash_length();
+    uint64_t* key_block = new uint64_t[key_block_length];
+    if(!key_block) {
+        log_error(OFB_CHAINED_XOR_CIPHER_NAME, ERR_BAD_ALLOC.arg(QString("key_block")));
+        return NULL;
+    }
+    uint64_t* hash_result = hash->hash(hash->hash_length(), hashed_key, key_block);
+    if(!hash_result) {
+        memset((void*) key_block, 0, key_block_length*sizeof(uint64_t));
+        delete[] key_block;
+        return NULL;
+    }
+
+    //Begin encryption. Algorithm cuts the message in a number of blocks, then uses an
+    //OFB-chained XOR block cipher
+    size_t remaining_len = message_length;
+    const uint64_t* source_block = message;
+    uint64_t* dest_block = dest_buffer;
+    while(remaining_len > key_block_length) {
+        //encrypted[i] = data[i] ^ key_block[i]
+        block_xor(key_block_length, source_block, key_block, dest_block);
+
+        //key_block[i+1] = hash(key_block[i] ^ hashed_key)
+        block_xor(key_block_length, key_block, hashed_key, key_block);
+        hash_result = hash->hash(key_block_length, key_block, key_block);
+        if(!hash_result) {
+            memset((void*) key_block, 0, key_block_length*sizeof(uint64_t));
+            delete[] key_block;
+            memset((void*) dest_buffer, 0, message_length*sizeof(uint64_t));
+            return NULL;
+        }
+
+        remaining_len-= key_block_length;
+        source_block+= key_block_length;
+        dest_block+= key_block_length;
+    }
+    //Final step uses block XOR too, but with a different block length
+    block_xor(remaining_len, source_block, key_block, dest_block);
+
+    memset((void*) key_block, 0, key_block_length*sizeof(uint64_t));
+    delete[] key_block;
+    return dest_buffer;
+}
+
+uint64_t* OFBChainedXorCipher::block_xor(size_t block_length,
+                                    const uint64_t* block1,
+                                    const uint64_t* block2,
+                                    uint64_t* dest_buffer) {
+    for(size_t i = 0; i < block_length; ++i) {
+        dest_buffer[i] = block1[i] ^ block2[i];
+    }
+    return dest_buffer;
+}
@@ -28,14 +28,14 @@
 
 class PasswordCipher {
   public:
-    virtual uint64_t* decrypt(uint64_t* hashed_key,
+    virtual uint64_t* decrypt(const uint64_t* hashed_key,
                               size_t enc_message_length,
-                              uint64_t* enc_message,
+                              const uint64_t* enc_message,
                               CryptoHash* hash,
                               uint64_t* dest_buffer) = 0;
-    virtual uint64_t* encrypt(uint64_t* hashed_key,
+    virtual uint64_t* encrypt(const uint64_t* hashed_key,
                               size_t message_length,
-                              uint64_t* message,
+                              const uint64_t* message,
                               CryptoHash* hash,
                               uint64_t* dest_buffer) = 0;
     virtual QString name() = 0;
@@ -48,21 +48,21 @@ bool test_password_ciphers(); //Check all finalized ciphers against their known
 
 class OFBChainedXorCipher : public PasswordCipher {
   public:
-    virtual uint64_t* decrypt(uint64_t* hashed_key,
+    virtual uint64_t* decrypt(const uint64_t* hashed_key,
                               size_t enc_message_length,
-                              uint64_t* enc_message,
+                              const uint64_t* enc_message,
                               CryptoHash* hash,
                               uint64_t* dest_buffer);
-    virtual uint64_t* encrypt(uint64_t* hashed_key,
+    virtual uint64_t* encrypt(const uint64_t* hashed_key,
                               size_t message_length,
-                              uint64_t* message,
+                              const uint64_t* message,
                               CryptoHash* hash,
                               uint64_t* dest_buffer);
     virtual QString name() {return "OFB-chained XOR cipher";}
   private:
     uint64_t* block_xor(size_t block_length,
-                        uint64_t* block1,
-                        uint64_t* block2,
+                        const uint64_t* block1,
+                        const uint64_t* block2,
                         uint64_t* dest_buffer);
 };
 
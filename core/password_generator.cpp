@@ -0,0 +1,519 @@
+/* Service classes and methods used for generating alphanumeric (and beyond)
+   passwords that match certain constraints.
+
+      Copyright (C) 2011  Hadrien Grasland
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA */
+
+#include <QFile>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <string.h>
+
+#include <error_management.h>
+#include <parsing_tools.h>
+#include <password_generator.h>
+#include <qstring_to_qwords.h>
+#include <test_suite.h>
+#include <tracing.h>
+
+const PwdGenConstraints default_constraints;
+
+bool PwdGenConstraints::operator==(const PwdGenConstraints& other) const {
+    return (case_sensitivity == other.case_sensitivity)
+        && (number_of_caps == other.number_of_caps)
+        && (number_of_digits == other.number_of_digits)
+        && (maximal_length == other.maximal_length)
+        && (extra_symbols == other.extra_symbols);
+}
+
+const QString PWD_GEN_CONSTRAINTS_NAME("PwdGenConstraints");
+
+const QString ID_CASE_SENSITIVITY("case_sensitivity : ");
+const QString ID_EXTRA_SYMBOLS("extra_symbols : ");
+const QString ID_MAXIMAL_LENGTH("maximal_length : ");
+const QString ID_NUMBER_OF_DIGITS("number_of_digits : ");
+const QString ID_NUMBER_OF_CAPS("number_of_caps : ");
+
+enum ConstraintID {CASE_SENSITIVITY = 0, NUMBER_OF_CAPS, NUMBER_OF_DIGITS, MAXIMAL_LENGTH, EXTRA_SYMBOLS};
+const QString* const CONSTRAINT_IDS[] = {&ID_CASE_SENSITIVITY,
+                                         &ID_NUMBER_OF_CAPS,
+                                         &ID_NUMBER_OF_DIGITS,
+                                         &ID_MAXIMAL_LENGTH,
+                                         &ID_EXTRA_SYMBOLS};
+const KeywordTable constraint_keywords(CONSTRAINT_IDS, sizeof(CONSTRAINT_IDS)/sizeof(QString*));
+
+bool PwdGenConstraints::parse_constraint_desc(ConfigTokenizer &service_tokenizer) {
+    ConfigField field;
+    while(service_tokenizer.next_field(constraint_keywords, field)) {
+        //Check if we have reached the end of constraint declaration
+        if(field.closes_block()) break;
+
+        switch(field.id) {
+          case CASE_SENSITIVITY:
+            if(field.value_is("true")) {
+                case_sensitivity = true;
+            } else if(field.value_is("false")) {
+                case_sensitivity = false;
+            } else {
+                static const QString ERR_NONBOOL_CASE_SENS("Non-boolean value of case_sensitivity.");
+                log_error(PWD_GEN_CONSTRAINTS_NAME, ERR_NONBOOL_CASE_SENS);
+                return false;
+            }
+            break;
+          case NUMBER_OF_CAPS:
+            number_of_caps = field.to_int();
+            break;
+          case NUMBER_OF_DIGITS:
+            number_of_digits = field.to_int();
+            break;
+          case MAXIMAL_LENGTH:
+            maximal_length = field.to_int();
+            break;
+          case EXTRA_SYMBOLS:
+            extra_symbols = field.to_string();
+            break;
+        }
+    }
+
+    return true;
+}
+
+bool PwdGenConstraints::write_constraint_desc(QTextStream &service_ostream) {
+    QString case_sens;
+    if(case_sensitivity) {
+        case_sens = "true";
+    } else {
+        case_sens = "false";
+    }
+    service_ostream << "    " << ID_CASE_SENSITIVITY << case_sens << endl;
+    service_ostream << "    " << ID_NUMBER_OF_CAPS << number_of_caps << endl;
+    service_ostream << "    " << ID_NUMBER_OF_DIGITS << number_of_digits << endl;
+    service_ostream << "    " << ID_MAXIMAL_LENGTH << maximal_length << endl;
+    service_ostream << "    " << ID_EXTRA_SYMBOLS << extra_symbols << endl;
+
+    return true;
+}
+
+const PwdGenCachedData default_cached_data;
+
+const QString ID_CONSTRAINT_COUNTER("constraint_counter : ");
+
+enum CachedDataID {CONSTRAINT_COUNTER = 0};
+const QString* const CACHED_DATA_IDS[] = {&ID_CONSTRAINT_COUNTER};
+const KeywordTable cached_data_keywords(CACHED_DATA_IDS, sizeof(CACHED_DATA_IDS)/sizeof(QString*));
+
+bool PwdGenCachedData::parse_cached_data_desc(ConfigTokenizer &service_tokenizer) {
+    ConfigField field;
+    while(service_tokenizer.next_field(cached_data_keywords, field)) {
+        //Check if we have reached the end of cached data declaration
+        if(field.closes_block()) break;
+
+        if(field.id == CONSTRAINT_COUNTER) constraint_counter = field.to_ulonglong();
+    }
+
+    return true;
+}
+
+bool PwdGenCachedData::write_cached_data_desc(QTextStream &service_ostream) {
+    service_ostream << "    " << ID_CONSTRAINT_COUNTER << constraint_counter << endl;
+
+    return true;
+}
+
+DefaultPasswordGenerator default_pw_generator;
+PasswordGenerator& default_generator = default_pw_generator;
+
+PasswordGenerator* generator_database(const QString& generator_name) {
+    if(generator_name == default_pw_generator.name()) {
+        return &default_pw_generator;
+    }
+
+    return NULL;
+}
+
+bool test_password_generators() {
+    bool result = default_pw_generator.test();
+    if(!result) return false;
+
+    return true;
+}
+
+const QString PASSWORD_GENERATOR_NAME("PasswordGenerator");
+
+bool PasswordGenerator::test() {
+    const TestVectorFile* test_file = test_vector_file(name());
+    if(!test_file) {
+        log_error(PASSWORD_GENERATOR_NAME, ERR_NO_TEST_VECTORS.arg(name()));
+        return false;
+    }
+    CryptoHash* hash = crypto_hash_database(test_file->hash);
+    if(!hash) {
+        log_error(PASSWORD_GENERATOR_NAME, ERR_UNSUPPORTED_HASH.arg(test_file->hash));
+        return false;
+    }
+    HMAC* hmac = hmac_database(test_file->hmac);
+    if(!hmac) {
+        log_error(PASSWORD_GENERATOR_NAME, ERR_UNSUPPORTED_HMAC.arg(test_file->hmac));
+        return false;
+    }
+
+    QString result;
+    PwdGenConstraints constraints;
+    PwdGenCachedData cached_data;
+    for(size_t i = 0; i < test_file->vector_count; ++i) {
+        const TestVector& vector = test_file->vectors[i];
+        if((vector.key_length != hash->hash_length()) || (!vector.result_text)) {
+            log_error(PASSWORD_GENERATOR_NAME, ERR_BAD_TEST_VECTOR.arg(i).arg(name()));
+            return false;
+        }
+
+        //Generate a password and check it against the known good result
+        constraints.case_sensitivity = vector.case_sensitivity;
+        constraints.number_of_caps = vector.number_of_caps;
+        constraints.number_of_digits = vector.number_of_digits;
+        constraints.maximal_length = vector.maximal_length;
+        constraints.extra_symbols = QString::fromUtf8(vector.extra_symbols);
+        cached_data.constraint_counter = vector.constraint_counter;
+        if(!generate_password(vector.key, hmac, hash, &constraints, &cached_data, result)) return false;
+
+        const QString expected_result = QString::fromUtf8(vector.result_text);
+        if(result != expected_result) {
+            log_error(PASSWORD_GENERATOR_NAME, ERR_WRONG_RESULT.arg(result).arg(expected_result));
+            return false;
+        }
+    }
+
+    return true;
+}
+
+const QString DEFAULT_PASSWORD_GENERATOR_NAME("DefaultPasswordGenerator");
+
+const size_t HMAC_STACK_LENGTH = 16; //Longer HMACs are stored on the heap
+
+//Each HMAC qword is written in base table_length, least significant digit first, using as many
+//digits as UINT64_MAX needs. Divisions by the table length are the bottleneck of that
+//conversion, so they are replaced by multiplications : the compiler does it for the usual
+//36 and 62 characters tables, other lengths use a reciprocal stored in the generation plan.
+template <uint64_t DIVISOR> struct ConstantDivisor {
+    uint64_t divisor() const {return DIVISOR;}
+    uint64_t quotient(const uint64_t dividend) const {return dividend/DIVISOR;}
+};
+
+class RuntimeDivisor {
+  public:
+    RuntimeDivisor(const uint64_t divisor);
+    uint64_t divisor() const {return value;}
+    uint64_t quotient(const uint64_t dividend) const;
+  private:
+    uint64_t value;
+  #ifdef __SIZEOF_INT128__
+    //quotient = ((dividend * magic) >> 64 with a 65-bit magic if add_dividend) >> shift
+    uint64_t magic;
+    int shift;
+    bool add_dividend;
+  #endif
+};
+
+#ifdef __SIZEOF_INT128__
+
+RuntimeDivisor::RuntimeDivisor(const uint64_t divisor) : value(divisor), magic(0), add_dividend(false) {
+    shift = 0;
+    while((divisor >> shift) > 1) ++shift; //floor(log2(divisor))
+    if((divisor & (divisor-1)) == 0) return; //Powers of two only need a shift
+
+    //magic = floor(2^(64+shift)/divisor)+1 if that fits in 64 bits, else its 65-bit version
+    unsigned __int128 numerator = (unsigned __int128) 1 << (64+shift);
+    uint64_t proposed_magic = (uint64_t) (numerator/divisor);
+    uint64_t remainder = (uint64_t) (numerator % divisor);
+    if(divisor - remainder < ((uint64_t) 1 << shift)) {
+        magic = proposed_magic + 1;
+    } else {
+        uint64_t twice_remainder = remainder + remainder;
+        proposed_magic+= proposed_magic;
+        if((twice_remainder >= divisor) || (twice_remainder < remainder)) proposed_magic+= 1;
+        magic = proposed_magic + 1;
+        add_dividend = true;
+    }
+}
+
+inline uint64_t RuntimeDivisor::quotient(const uint64_t dividend) const {
+    if(!magic) return dividend >> shift;
+    uint64_t high_product = (uint64_t) (((unsigned __int128) dividend * magic) >> 64);
+    if(!add_dividend) return high_product >> shift;
+    return (((dividend - high_product) >> 1) + high_product) >> shift;
+}
+
+#else
+
+//Without 128-bit multiplications, the hardware division is the fastest option
+RuntimeDivisor::RuntimeDivisor(const uint64_t divisor) : value(divisor) {}
+
+inline uint64_t RuntimeDivisor::quotient(const uint64_t dividend) const {
+    return dividend/value;
+}
+
+#endif
+
+//Everything the default generator derives from a set of constraints. Plans are immutable once
+//built, and hash-consed : a single plan is built for each distinct set of constraints, and shared
+//by all services and threads using it.
+class PwdGenPlan {
+  public:
+    PwdGenPlan(const PwdGenConstraints& source);
+    bool is_cap(const QChar ch) const {return in_bitmap(caps_bitmap, ch.unicode());}
+    bool is_digit(const QChar ch) const {return in_bitmap(digit_bitmap, ch.unicode());}
+
+    const PwdGenConstraints constraints;
+    QString conversion_table; //Number -> QChar conversion table for the allowed character set
+    size_t digits_per_qword; //Characters needed to write any qword, in base conversion_table.size()
+    RuntimeDivisor table_divisor;
+  private:
+    //Characters of the conversion table which count as caps and digits. Only ASCII characters do.
+    uint64_t caps_bitmap[2];
+    uint64_t digit_bitmap[2];
+
+    static bool in_bitmap(const uint64_t* bitmap, const ushort ch) {
+        return (ch < 128) && ((bitmap[ch >> 6] >> (ch & 63)) & 1);
+    }
+};
+
+QString build_conversion_table(const PwdGenConstraints& constraints) {
+    QString result;
+    for(char i = 0; i<26; ++i) result.append(QChar('a'+i)); //Minuscules
+    for(char i = 0; i<10; ++i) result.append(QChar('0'+i)); //Digits
+    if(constraints.case_sensitivity) {
+        for(char i = 0; i<26; ++i) result.append(QChar('A'+i)); //Caps
+    }
+    result.append(constraints.extra_symbols); //Extra symbols
+
+    return result;
+}
+
+PwdGenPlan::PwdGenPlan(const PwdGenConstraints& source) : constraints(source),
+                                                          conversion_table(build_conversion_table(source)),
+                                                          digits_per_qword(0),
+                                                          table_divisor(conversion_table.size()) {
+    for(uint64_t mask = 0xffffffffffffffff; mask; mask/= conversion_table.size()) ++digits_per_qword;
+
+    memset((void*) caps_bitmap, 0, sizeof(caps_bitmap));
+    memset((void*) digit_bitmap, 0, sizeof(digit_bitmap));
+    for(int i = 0; i < conversion_table.size(); ++i) {
+        ushort ch = conversion_table.at(i).unicode();
+        if((ch >= 'A') && (ch <= 'Z')) caps_bitmap[ch >> 6]|= (uint64_t) 1 << (ch & 63);
+        if((ch >= '0') && (ch <= '9')) digit_bitmap[ch >> 6]|= (uint64_t) 1 << (ch & 63);
+    }
+}
+
+//Owns every plan built so far. There are only as many of them as distinct sets of constraints
+//in the service database, so they are kept until Hashish exits.
+class PwdGenPlanRegistry {
+  public:
+    ~PwdGenPlanRegistry();
+    const PwdGenPlan* fetch(const PwdGenConstraints& constraints); //NULL if out of memory
+  private:
+    QMutex mutex;
+    QHash<QString, PwdGenPlan*> plans;
+};
+
+PwdGenPlanRegistry::~PwdGenPlanRegistry() {
+    QHash<QString, PwdGenPlan*>::iterator plan;
+    for(plan = plans.begin(); plan != plans.end(); ++plan) delete plan.value();
+}
+
+const PwdGenPlan* PwdGenPlanRegistry::fetch(const PwdGenConstraints& constraints) {
+    QString key = QString::number(constraints.case_sensitivity) + ' '
+                + QString::number(constraints.number_of_caps) + ' '
+                + QString::number(constraints.number_of_digits) + ' '
+                + QString::number(constraints.maximal_length) + ' '
+                + constraints.extra_symbols;
+
+    QMutexLocker lock(&mutex);
+    PwdGenPlan* plan = plans.value(key);
+    if(!plan) {
+        plan = new PwdGenPlan(constraints);
+        if(!plan) {
+            log_error(DEFAULT_PASSWORD_GENERATOR_NAME, ERR_BAD_ALLOC.arg(QString("plan")));
+            return NULL;
+        }
+        plans.insert(key, plan);
+    }
+
+    return plan;
+}
+
+PwdGenPlanRegistry plan_registry;
+
+QString* DefaultPasswordGenerator::generate_password(const uint64_t* hashed_key,
+                                              HMAC* hmac,
+                                              CryptoHash* hash,
+                                              PwdGenConstraints* constraints,
+                                              PwdGenCachedData* cached_data,
+                                              QString& dest_buffer) {
+    //Fetch the plan of these constraints, unless the one cached in them is still valid
+    const PwdGenPlan* plan = constraints->plan;
+    if(!plan || !(plan->constraints == *constraints)) {
+        //Check if the requested constraints are actually matchable
+        bool tmp_result = matchable_constraints(constraints);
+        if(!tmp_result) return NULL;
+
+        plan = plan_registry.fetch(*constraints);
+        if(!plan) return NULL;
+        constraints->plan = plan;
+    }
+
+    //Prepare HMAC storage space, on the stack for usual hash lengths
+    size_t hmac_length = hash->hash_length();
+    uint64_t hmac_stack_buffer[HMAC_STACK_LENGTH];
+    uint64_t* hmac_buffer = hmac_stack_buffer;
+    if(hmac_length > HMAC_STACK_LENGTH) {
+        hmac_buffer = new uint64_t[hmac_length];
+        if(!hmac_buffer) {
+            log_error(DEFAULT_PASSWORD_GENERATOR_NAME, ERR_BAD_ALLOC.arg(QString("hmac_buffer")));
+            return NULL;
+        }
+    }
+
+    //Compute HMAC(hashed_key, cached_date->constraint_counter) and convert it to a string,
+    //try to make the result match constraints. If it fails, increment the counter and start over.
+    bool first_run = true;
+    bool matched;
+    do {
+        TRACE_SPAN(TRACE_GENERATOR_ATTEMPT);
+        if(!first_run) {
+            cached_data->constraint_counter+= 1;
+        } else {
+            first_run = false;
+        }
+
+        uint64_t* hmac_result = hmac->hmac(hash->hash_length(),
+                                           hashed_key,
+                                           1,
+                                           &(cached_data->constraint_counter),
+                                           hash,
+                                           hmac_buffer);
+        if(!hmac_result) {
+            memset((void*) hmac_buffer, 0, hmac_length*sizeof(uint64_t));
+            if(hmac_buffer != hmac_stack_buffer) delete[] hmac_buffer;
+            return NULL;
+        }
+        {
+            TRACE_SPAN(TRACE_STRING_CONVERSION);
+            hmac_to_qstring(hmac_length, hmac_result, *plan, dest_buffer);
+        }
+        matched = match_constraints(dest_buffer, *plan);
+    } while(matched == false);
+
+    memset((void*) hmac_buffer, 0, hmac_length*sizeof(uint64_t));
+    if(hmac_buffer != hmac_stack_buffer) delete[] hmac_buffer;
+    return &dest_buffer;
+}
+
+template <class Divisor> void hmac_to_chars(const size_t hmac_length,
+                                            const uint64_t* hmac,
+                                            const Divisor& table_length,
+                                            const size_t digits_per_qword,
+                                            const QChar* conversion_table,
+                                            QChar* dest_buffer) {
+    for(size_t hmac_index = 0; hmac_index < hmac_length; ++hmac_index) {
+        uint64_t hmac_digit = hmac[hmac_index];
+        for(size_t i = 0; i < digits_per_qword; ++i) {
+            uint64_t quotient = table_length.quotient(hmac_digit);
+            *(dest_buffer++) = conversion_table[hmac_digit - quotient*table_length.divisor()];
+            hmac_digit = quotient;
+        }
+    }
+}
+
+QString& DefaultPasswordGenerator::hmac_to_qstring(size_t hmac_length,
+                                                   uint64_t* hmac,
+                                                   const PwdGenPlan& plan,
+                                                   QString& dest_buffer) {
+    //Size the result once, then write characters in place
+    dest_buffer.resize(hmac_length*plan.digits_per_qword);
+    QChar* result = dest_buffer.data();
+    const QChar* table = plan.conversion_table.constData();
+
+    switch(plan.conversion_table.size()) {
+      case 26+10:
+        hmac_to_chars(hmac_length, hmac, ConstantDivisor<26+10>(), plan.digits_per_qword, table, result);
+        break;
+      case 26+10+26:
+        hmac_to_chars(hmac_length, hmac, ConstantDivisor<26+10+26>(), plan.digits_per_qword, table, result);
+        break;
+      default:
+        hmac_to_chars(hmac_length, hmac, plan.table_divisor, plan.digits_per_qword, table, result);
+    }
+
+    return dest_buffer;
+}
+
+bool DefaultPasswordGenerator::match_constraints(QString& potential_result, const PwdGenPlan& plan) {
+    const PwdGenConstraints& constraints = plan.constraints;
+
+    //Characters beyond the maximal length must be removed
+    int excess_chars = 0;
+    if(constraints.maximal_length && (potential_result.size() > constraints.maximal_length)) {
+        excess_chars = potential_result.size() - constraints.maximal_length;
+    }
+    if(!excess_chars && !constraints.number_of_digits && !constraints.number_of_caps) return true;
+
+    //In a single pass, keep the first digits and caps required by constraints, and remove the
+    //first other characters until the desired length is reached. The result is compacted in place.
+    int digit_amount = 0;
+    int caps_amount = 0;
+    int removed_chars = 0;
+    int result_size = 0;
+    QChar* result = potential_result.data();
+    for(int i = 0; i < potential_result.size(); ++i) {
+        const QChar current_char = result[i];
+        if((digit_amount < constraints.number_of_digits) && plan.is_digit(current_char)) {
+            ++digit_amount;
+        } else if((caps_amount < constraints.number_of_caps) && plan.is_cap(current_char)) {
+            ++caps_amount;
+        } else if(removed_chars < excess_chars) {
+            ++removed_chars;
+            continue;
+        }
+        result[result_size] = current_char;
+        ++result_size;
+    }
+    if(digit_amount < constraints.number_of_digits) return false;
+    if(caps_amount < constraints.number_of_caps) return false;
+    if(removed_chars < excess_chars) return false;
+
+    potential_result.resize(result_size);
+    return true;
+}
+
+bool DefaultPasswordGenerator::matchable_constraints(PwdGenConstraints* constraints) {
+    //number_of_caps constraint may only be matched if case sensitivity is enabled
+    if((constraints->case_sensitivity == false) && constraints->number_of_caps) {
+        static const QString ERR_IMPOSSIBLE_CAPS("Unmatchable constraint : nonzero minimal number of caps without case sensitivity.");
+        log_error(DEFAULT_PASSWORD_GENERATOR_NAME, ERR_IMPOSSIBLE_CAPS);
+        return false;
+    }
+
+    //maximal_length, if any, must be superior to the total number of requested specific characters
+    int requested_specific_chars = constraints->number_of_digits + constraints->number_of_caps;
+    if((constraints->maximal_length) && (constraints->maximal_length < requested_specific_chars)) {
+        static const QString ERR_IMPOSSIBLE_MAX_LENGTH("Unmatchable constraint : more caps and digits required than the maximal length.");
+        log_error(DEFAULT_PASSWORD_GENERATOR_NAME, ERR_IMPOSSIBLE_MAX_LENGTH);
+        return false;
+    }
+
+    return true;
+}
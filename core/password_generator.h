@@ -26,6 +26,9 @@
 
 #include <crypto_hash.h>
 #include <hmac.h>
+#include <parsing_tools.h>
+
+class PwdGenPlan;
 
 struct PwdGenConstraints {
     bool case_sensitivity;
@@ -34,11 +37,15 @@ struct PwdGenConstraints {
     int maximal_length; //0 means unlimited
     QString extra_symbols; //As a default, we allow latin characters (both lower and upper case)
                            //and numbers. Extra symbols can be added by putting them in that string
+    const PwdGenPlan* plan; //Generation plan of these constraints, cached by the default generator.
+                            //It is checked against the other members before use.
     PwdGenConstraints() : case_sensitivity(false),
                           number_of_caps(0),
                           number_of_digits(0),
-                          maximal_length(15) {}
-    bool parse_constraint_desc(QTextStream &service_istream);
+                          maximal_length(15),
+                          plan(NULL) {}
+    bool operator==(const PwdGenConstraints& other) const; //Compares constraints, not plans
+    bool parse_constraint_desc(ConfigTokenizer &service_tokenizer);
     bool write_constraint_desc(QTextStream &service_ostream);
 };
 extern const PwdGenConstraints default_constraints;
@@ -51,14 +58,14 @@ struct PwdGenCachedData {
                                  //
                                  //This is set to 0 when the password has not been generated yet
     PwdGenCachedData() : constraint_counter(0) {}
-    bool parse_cached_data_desc(QTextStream &service_istream);
+    bool parse_cached_data_desc(ConfigTokenizer &service_tokenizer);
     bool write_cached_data_desc(QTextStream &service_ostream);
 };
 extern const PwdGenCachedData default_cached_data;
 
 class PasswordGenerator {
   public:
-    virtual QString* generate_password(uint64_t* hashed_key,
+    virtual QString* generate_password(const uint64_t* hashed_key,
                                        HMAC* hmac,
                                        CryptoHash* hash,
                                        PwdGenConstraints* constraints,
@@ -72,11 +79,11 @@ PasswordGenerator* generator_database(const QString& generator_name); //Fetches
 bool test_password_generators(); //Check all finalized password generators against their known test vectors
 
 
+//Stateless, so that a single instance may be used by several threads at once. What is derived
+//from constraints is cached in shared, immutable plans (see password_generator.cpp).
 class DefaultPasswordGenerator : public PasswordGenerator {
   public:
-    DefaultPasswordGenerator() : conversion_table(NULL) {}
-    ~DefaultPasswordGenerator() {if(conversion_table) delete[] conversion_table;}
-    virtual QString* generate_password(uint64_t* hashed_key,
+    virtual QString* generate_password(const uint64_t* hashed_key,
                                        HMAC* hmac,
                                        CryptoHash* hash,
                                        PwdGenConstraints* constraints,
@@ -84,12 +91,11 @@ class DefaultPasswordGenerator : public PasswordGenerator {
                                        QString& dest_buffer);
     virtual QString name() {return "Default generator";}
   private:
-    size_t conversion_table_length;
-    QChar* conversion_table;
-
-    bool generate_conversion_table(PwdGenConstraints* constraints);
-    QString& hmac_to_qstring(size_t hmac_length, uint64_t* hmac, QString& dest_buffer);
-    bool match_constraints(QString& potential_result, PwdGenConstraints* constraints);
+    QString& hmac_to_qstring(size_t hmac_length,
+                             uint64_t* hmac,
+                             const PwdGenPlan& plan,
+                             QString& dest_buffer);
+    bool match_constraints(QString& potential_result, const PwdGenPlan& plan);
     bool matchable_constraints(PwdGenConstraints* constraints);
 };
 
@@ -0,0 +1,245 @@
+/* PBKDF2 : standard password-based key derivation (RFC 2898, NIST SP 800-132) with HMAC-SHA512
+   as its pseudorandom function, so that service keys may be derived in a way other tools can
+   reproduce.
+
+      Copyright (C) 2011  Hadrien Grasland
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA */
+
+#include <QByteArray>
+#include <QString>
+#include <string.h>
+
+#include <crypto_hash.h>
+#include <error_management.h>
+#include <pbkdf2.h>
+
+const QString PBKDF2_NAME("PBKDF2HMACSHA512");
+
+const QString ERR_NO_ITERATIONS("PBKDF2 needs at least one iteration");
+
+void qwords_from_be_bytes(const size_t length, const unsigned char* bytes, uint64_t* dest_buffer) {
+    for(size_t i = 0; i < length; ++i) {
+        const unsigned char* qword = bytes + 8*i;
+        dest_buffer[i] = ((uint64_t) qword[0] << 56) | ((uint64_t) qword[1] << 48) | ((uint64_t) qword[2] << 40)
+                       | ((uint64_t) qword[3] << 32) | ((uint64_t) qword[4] << 24) | ((uint64_t) qword[5] << 16)
+                       | ((uint64_t) qword[6] << 8) | (uint64_t) qword[7];
+    }
+}
+
+void hmac_sha512_key_pads(const char* key,
+                          size_t key_length,
+                          unsigned char* inner_key_pad,
+                          unsigned char* outer_key_pad) {
+    unsigned char key_block[128];
+    memset((void*) key_block, 0, 128);
+    if(key_length > 128) {
+        SHA512Stream stream;
+        stream.update(key, key_length);
+        stream.finish(key_block);
+    } else {
+        memcpy((void*) key_block, (const void*) key, key_length);
+    }
+    for(int i = 0; i < 128; ++i) {
+        inner_key_pad[i] = key_block[i] ^ 0x36;
+        outer_key_pad[i] = key_block[i] ^ 0x5c;
+    }
+    memset((void*) key_block, 0, 128);
+}
+
+PBKDF2HMACSHA512::PBKDF2HMACSHA512(const char* password, size_t password_length) {
+    //The password is the HMAC key. Run its pads through SHA-512 once and for all.
+    hmac_sha512_key_pads(password, password_length, inner_key_pad, outer_key_pad);
+    uint64_t block[16];
+    sha_512_hash.initial_hash_value(inner_midstate);
+    qwords_from_be_bytes(16, inner_key_pad, block);
+    sha_512_hash.compress(inner_midstate, block);
+    sha_512_hash.initial_hash_value(outer_midstate);
+    qwords_from_be_bytes(16, outer_key_pad, block);
+    sha_512_hash.compress(outer_midstate, block);
+
+    memset((void*) block, 0, 16*sizeof(uint64_t));
+}
+
+PBKDF2HMACSHA512::~PBKDF2HMACSHA512() {
+    memset((void*) inner_key_pad, 0, 128);
+    memset((void*) outer_key_pad, 0, 128);
+    memset((void*) inner_midstate, 0, 8*sizeof(uint64_t));
+    memset((void*) outer_midstate, 0, 8*sizeof(uint64_t));
+}
+
+unsigned char* PBKDF2HMACSHA512::derive(const char* salt,
+                                        size_t salt_length,
+                                        uint64_t iterations,
+                                        size_t key_length,
+                                        unsigned char* dest_buffer) {
+    if(!iterations) {
+        log_error(PBKDF2_NAME, ERR_NO_ITERATIONS);
+        return NULL;
+    }
+
+    //The derived key is made of 64-byte blocks T_1, T_2... the last one being truncated
+    uint64_t block[8];
+    for(size_t offset = 0; offset < key_length; offset+= 64) {
+        derive_block(salt, salt_length, offset/64 + 1, iterations, block);
+        for(size_t i = 0; (i < 64) && (offset + i < key_length); ++i) {
+            dest_buffer[offset + i] = (unsigned char) (block[i/8] >> (56 - 8*(i%8)));
+        }
+    }
+
+    memset((void*) block, 0, 8*sizeof(uint64_t));
+    return dest_buffer;
+}
+
+uint64_t* PBKDF2HMACSHA512::derive_qwords(const char* salt,
+                                          size_t salt_length,
+                                          uint64_t iterations,
+                                          size_t key_length,
+                                          uint64_t* dest_buffer) {
+    if(!iterations) {
+        log_error(PBKDF2_NAME, ERR_NO_ITERATIONS);
+        return NULL;
+    }
+
+    uint64_t block[8];
+    for(size_t offset = 0; offset < key_length; offset+= 8) {
+        derive_block(salt, salt_length, offset/8 + 1, iterations, block);
+        size_t copied_length = (key_length - offset < 8) ? key_length - offset : 8;
+        memcpy((void*) (dest_buffer + offset), (const void*) block, copied_length*sizeof(uint64_t));
+    }
+
+    memset((void*) block, 0, 8*sizeof(uint64_t));
+    return dest_buffer;
+}
+
+void PBKDF2HMACSHA512::derive_block(const char* salt,
+                                    size_t salt_length,
+                                    uint32_t block_index,
+                                    uint64_t iterations,
+                                    uint64_t* dest_buffer) {
+    //U_1 = HMAC(password, salt + INT(block_index)) has a message of any length, so it goes
+    //through the byte-oriented hash
+    unsigned char index_bytes[4];
+    for(int i = 0; i < 4; ++i) index_bytes[i] = (unsigned char) (block_index >> (24 - 8*i));
+    unsigned char digest[64];
+    SHA512Stream stream;
+    stream.update((const char*) inner_key_pad, 128);
+    stream.update(salt, salt_length);
+    stream.update((const char*) index_bytes, 4);
+    stream.finish(digest);
+    stream.update((const char*) outer_key_pad, 128);
+    stream.update((const char*) digest, 64);
+    stream.finish(digest);
+
+    //T = U_1 ^ U_2 ^ ... ^ U_iterations
+    uint64_t u[8];
+    qwords_from_be_bytes(8, digest, u);
+    memcpy((void*) dest_buffer, (const void*) u, 8*sizeof(uint64_t));
+    iterate(iterations - 1, u, dest_buffer);
+
+    memset((void*) digest, 0, 64);
+    memset((void*) u, 0, 8*sizeof(uint64_t));
+}
+
+void PBKDF2HMACSHA512::iterate(uint64_t iterations, uint64_t* u, uint64_t* t) {
+    //Every later HMAC hashes a 64-byte message : the previous U for the inner hash, the inner
+    //digest for the outer one. Both follow a key pad block, so their padded blocks are the
+    //message, bit "1", zeroes and a total length of 128+64 bytes, and only the message changes.
+    uint64_t inner_block[16], outer_block[16];
+    memcpy((void*) inner_block, (const void*) u, 8*sizeof(uint64_t));
+    inner_block[8] = 0x8000000000000000ULL;
+    memset((void*) (inner_block + 9), 0, 6*sizeof(uint64_t));
+    inner_block[15] = (128 + 64)*8;
+    memcpy((void*) (outer_block + 8), (const void*) (inner_block + 8), 8*sizeof(uint64_t));
+
+    //Each state is resumed from its midstate right inside the other block, so that the digest of
+    //one hash directly becomes the message of the next
+    for(uint64_t i = 0; i < iterations; ++i) {
+        memcpy((void*) outer_block, (const void*) inner_midstate, 8*sizeof(uint64_t));
+        sha_512_hash.compress(outer_block, inner_block);
+        memcpy((void*) inner_block, (const void*) outer_midstate, 8*sizeof(uint64_t));
+        sha_512_hash.compress(inner_block, outer_block);
+        for(int j = 0; j < 8; ++j) t[j]^= inner_block[j];
+    }
+
+    memset((void*) inner_block, 0, 16*sizeof(uint64_t));
+    memset((void*) outer_block, 0, 16*sizeof(uint64_t));
+}
+
+struct PBKDF2TestVector {
+    const char* password;
+    size_t password_length;
+    const char* salt;
+    size_t salt_length;
+    uint64_t iterations;
+    size_t key_length;
+    const char* key;
+};
+
+bool test_pbkdf2() {
+    //The inputs of RFC 6070, with SHA-512, then SP 800-132-sized salts (128 bits), a password
+    //longer than a SHA-512 block and an empty one. Truncated and multi-block keys are covered.
+    static const PBKDF2TestVector VECTORS[] = {
+        {"password", 8, "salt", 4, 1, 64,
+         "867f70cf1ade02cff3752599a3a53dc4af34c7a669815ae5d513554e1c8cf252"
+         "c02d470a285a0501bad999bfe943c08f050235d7d68b1da55e63f73b60a57fce"},
+        {"password", 8, "salt", 4, 2, 64,
+         "e1d9c16aa681708a45f5c7c4e215ceb66e011a2e9f0040713f18aefdb866d53c"
+         "f76cab2868a39b9f7840edce4fef5a82be67335c77a6068e04112754f27ccf4e"},
+        {"password", 8, "salt", 4, 4096, 64,
+         "d197b1b33db0143e018b12f3d1d1479e6cdebdcc97c5c0f87f6902e072f457b5"
+         "143f30602641b3d55cd335988cb36b84376060ecd532e039b742a239434af2d5"},
+        {"passwordPASSWORDpassword", 24, "saltSALTsaltSALTsaltSALTsaltSALTsalt", 36, 4096, 100,
+         "8c0511f4c6e597c6ac6315d8f0362e225f3c501495ba23b868c005174dc4ee71"
+         "115b59f9e60cd9532fa33e0f75aefe30225c583a186cd82bd4daea9724a3d3b8"
+         "04f75bdd41494fa324cab24bcc680fb3b96a30cf5d21fac3c2875913919f3399"
+         "b1d9ce7e"},
+        {"pass\0word", 9, "sa\0lt", 5, 4096, 16,
+         "9d9e9c4cd21fe4be24d5b8244c759665"},
+        {"The quick brown fox jumps over the lazy dog. The quick brown fox jumps over the lazy dog. "
+         "The quick brown fox jumps over the lazy dog. The quick brown fox jumps over the lazy dog. ", 180,
+         "\x00\x01\x02\x03\x04\x05\x06\x07\x08\x09\x0a\x0b\x0c\x0d\x0e\x0f", 16, 1000, 64,
+         "f79cd030885cd3a9b782162ecc99ab90a25e7152261e1a7a77c84a496c3f35d7"
+         "3534085d9fbb9aa600c80ddf749ae8ad2e7beaf128aad02c8b52c253046aa444"},
+        {"", 0, "salt", 4, 1, 40,
+         "00ef42cdbfc98d29db20976608e455567fdddf141f6eb03b5a85addd25974f5d"
+         "2375bd5082b803e8"}};
+    static const QString ERR_KEY_MISMATCH("Vector %1 : got key %2\nExpected key : %3");
+    unsigned char key[100];
+
+    for(size_t i = 0; i < sizeof(VECTORS)/sizeof(PBKDF2TestVector); ++i) {
+        const PBKDF2TestVector& vector = VECTORS[i];
+        PBKDF2HMACSHA512 pbkdf2(vector.password, vector.password_length);
+        pbkdf2.derive(vector.salt, vector.salt_length, vector.iterations, vector.key_length, key);
+        QByteArray hex_key = QByteArray((const char*) key, vector.key_length).toHex();
+        if(hex_key != vector.key) {
+            log_error(PBKDF2_NAME, ERR_KEY_MISMATCH.arg(i).arg(QString(hex_key)).arg(vector.key));
+            return false;
+        }
+    }
+
+    //Quadword keys are the same bytes, read as big-endian quadwords
+    static const QString ERR_QWORD_MISMATCH("Quadword key differs from byte key");
+    uint64_t qword_key[9];
+    PBKDF2HMACSHA512 pbkdf2(VECTORS[3].password, VECTORS[3].password_length);
+    pbkdf2.derive_qwords(VECTORS[3].salt, VECTORS[3].salt_length, VECTORS[3].iterations, 9, qword_key);
+    for(int i = 0; i < 72; ++i) key[i] = (unsigned char) (qword_key[i/8] >> (56 - 8*(i%8)));
+    if(QByteArray((const char*) key, 72).toHex() != QByteArray(VECTORS[3].key, 144)) {
+        log_error(PBKDF2_NAME, ERR_QWORD_MISMATCH);
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,69 @@
+/* PBKDF2 : standard password-based key derivation (RFC 2898, NIST SP 800-132) with HMAC-SHA512
+   as its pseudorandom function, so that service keys may be derived in a way other tools can
+   reproduce.
+
+      Copyright (C) 2011  Hadrien Grasland
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA */
+
+#ifndef PBKDF2_H
+#define PBKDF2_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+//PBKDF2-HMAC-SHA512 on byte strings. The HMAC key (the password) is the same for every HMAC of a
+//derivation, so the SHA-512 states reached after its inner and outer pad blocks are computed once,
+//on construction. Each iteration then resumes them, and costs exactly two compressions of
+//preformatted blocks, without allocation nor concatenation. Wiped on destruction.
+class PBKDF2HMACSHA512 {
+  public:
+    PBKDF2HMACSHA512(const char* password, size_t password_length);
+    ~PBKDF2HMACSHA512();
+
+    //Writes key_length bytes of derived key. Iterations must be at least 1.
+    unsigned char* derive(const char* salt,
+                          size_t salt_length,
+                          uint64_t iterations,
+                          size_t key_length,
+                          unsigned char* dest_buffer);
+    //Same, as big-endian quadwords (the derived key's bytes, 8 at a time)
+    uint64_t* derive_qwords(const char* salt,
+                            size_t salt_length,
+                            uint64_t iterations,
+                            size_t key_length,
+                            uint64_t* dest_buffer);
+  private:
+    unsigned char inner_key_pad[128];
+    unsigned char outer_key_pad[128];
+    uint64_t inner_midstate[8]; //SHA-512 state after the inner key pad
+    uint64_t outer_midstate[8]; //Same for the outer key pad
+
+    void derive_block(const char* salt, size_t salt_length, uint32_t block_index, uint64_t iterations, uint64_t* dest_buffer);
+    void iterate(uint64_t iterations, uint64_t* u, uint64_t* t);
+
+    PBKDF2HMACSHA512(const PBKDF2HMACSHA512&);
+    PBKDF2HMACSHA512& operator=(const PBKDF2HMACSHA512&);
+};
+bool test_pbkdf2(); //Check PBKDF2-HMAC-SHA512 against known-good derived keys
+
+//Inner and outer pads (128 bytes each) of an HMAC-SHA512 key, as in RFC 2104 : the key, zero-padded
+//to a SHA-512 block or replaced by its digest if it is longer, XORed with 0x36 and 0x5c
+void hmac_sha512_key_pads(const char* key,
+                          size_t key_length,
+                          unsigned char* inner_key_pad,
+                          unsigned char* outer_key_pad);
+
+#endif // PBKDF2_H
@@ -0,0 +1,514 @@
+/* Service functions useful for transforming QStrings into the qword arrays that are used
+   in cryptographic functions
+
+      Copyright (C) 2011  Hadrien Grasland
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA */
+#include <string.h>
+#ifdef __SSE2__
+    #include <emmintrin.h>
+#endif
+
+#include <error_management.h>
+#include <qstring_to_qwords.h>
+
+const QString QSTRING_TO_QWORDS_NAME("QStringToQwords");
+
+const QString ERR_CONVERSION_MISMATCH("%1 disagrees with its reference implementation.");
+
+const char HEX_DIGITS[] = "0123456789abcdef";
+const char HEX_PREFIX[] = "0x";
+const int QWORD_HEX_LENGTH = 16; //Hex digits in a qword
+const char QWORD_SEPARATOR = ' ';
+const int QWORD_RAW_LENGTH = 4; //UTF-16 characters in a qword
+
+//Qwords are written with their most significant digits first
+inline uint64_t qword_from_bytes(const unsigned char* bytes) {
+    uint64_t result = 0;
+    for(int i = 0; i < 8; ++i) result = (result << 8) | bytes[i];
+    return result;
+}
+
+inline void qword_to_bytes(const uint64_t qword, unsigned char* bytes) {
+    for(int i = 0; i < 8; ++i) bytes[i] = (unsigned char) (qword >> (56 - 8*i));
+}
+
+inline ushort char_code(const char ch) {return (unsigned char) ch;}
+inline ushort char_code(const ushort ch) {return ch;}
+
+inline int hex_digit_value(const ushort ch) {
+    //-1 if ch is not an hex digit. Upper-case digits are accepted, though Hashish never writes them.
+    if((ch >= '0') && (ch <= '9')) return ch - '0';
+    ushort lower_ch = ch | 0x20;
+    if((lower_ch >= 'a') && (lower_ch <= 'f')) return lower_ch - 'a' + 10;
+    return -1;
+}
+
+//Scalar kernels, which are the reference for the SSE2 ones and are used where SSE2 is not
+//available. The raw ones convert whole groups of 4 characters, the hex ones convert one qword
+//to and from its 16 digits. CharType is either ushort (UTF-16) or char (Latin-1) : only ASCII
+//characters are ever written, and anything else is rejected.
+void raw_groups_to_qwords_scalar(const size_t group_count, const ushort* text, uint64_t* dest_buffer) {
+    for(size_t i = 0; i < group_count; ++i, text+= QWORD_RAW_LENGTH) {
+        dest_buffer[i] = ((uint64_t) text[0] << 48) | ((uint64_t) text[1] << 32)
+                       | ((uint64_t) text[2] << 16) | (uint64_t) text[3];
+    }
+}
+
+void qwords_to_raw_groups_scalar(const size_t group_count, const uint64_t* data, ushort* dest_text) {
+    for(size_t i = 0; i < group_count; ++i, dest_text+= QWORD_RAW_LENGTH) {
+        dest_text[0] = (ushort) (data[i] >> 48);
+        dest_text[1] = (ushort) (data[i] >> 32);
+        dest_text[2] = (ushort) (data[i] >> 16);
+        dest_text[3] = (ushort) data[i];
+    }
+}
+
+template <typename CharType> void qword_to_hex_scalar(const uint64_t qword, CharType* dest_text) {
+    for(int i = 0; i < QWORD_HEX_LENGTH; ++i) {
+        dest_text[i] = HEX_DIGITS[(qword >> (60 - 4*i)) & 0xf];
+    }
+}
+
+template <typename CharType> bool qword_from_hex_scalar(const CharType* text, uint64_t& qword) {
+    qword = 0;
+    for(int i = 0; i < QWORD_HEX_LENGTH; ++i) {
+        int digit = hex_digit_value(char_code(text[i]));
+        if(digit < 0) return false;
+        qword = (qword << 4) | digit;
+    }
+    return true;
+}
+
+#ifdef __SSE2__
+
+//On x86, characters are stored little-endian, so a group of 4 characters becomes a qword by
+//reversing the order of its 16-bit words. Two groups are converted at a time.
+inline __m128i reverse_words(const __m128i data) {
+    return _mm_shufflehi_epi16(_mm_shufflelo_epi16(data, _MM_SHUFFLE(0, 1, 2, 3)), _MM_SHUFFLE(0, 1, 2, 3));
+}
+
+void raw_groups_to_qwords_sse2(const size_t group_count, const ushort* text, uint64_t* dest_buffer) {
+    size_t i;
+    for(i = 0; i+2 <= group_count; i+= 2) {
+        __m128i characters = _mm_loadu_si128((const __m128i*) (text + QWORD_RAW_LENGTH*i));
+        _mm_storeu_si128((__m128i*) (dest_buffer + i), reverse_words(characters));
+    }
+    raw_groups_to_qwords_scalar(group_count - i, text + QWORD_RAW_LENGTH*i, dest_buffer + i);
+}
+
+void qwords_to_raw_groups_sse2(const size_t group_count, const uint64_t* data, ushort* dest_text) {
+    size_t i;
+    for(i = 0; i+2 <= group_count; i+= 2) {
+        __m128i qwords = _mm_loadu_si128((const __m128i*) (data + i));
+        _mm_storeu_si128((__m128i*) (dest_text + QWORD_RAW_LENGTH*i), reverse_words(qwords));
+    }
+    qwords_to_raw_groups_scalar(group_count - i, data + i, dest_text + QWORD_RAW_LENGTH*i);
+}
+
+//Nibbles are spread over bytes and turned into digits 16 at a time
+inline __m128i qword_to_hex_digits(const uint64_t qword) {
+    unsigned char bytes[8];
+    qword_to_bytes(qword, bytes);
+    __m128i packed = _mm_loadl_epi64((const __m128i*) bytes);
+    __m128i low_nibble_mask = _mm_set1_epi8(0x0f);
+    __m128i high_nibbles = _mm_and_si128(_mm_srli_epi16(packed, 4), low_nibble_mask);
+    __m128i low_nibbles = _mm_and_si128(packed, low_nibble_mask);
+    __m128i nibbles = _mm_unpacklo_epi8(high_nibbles, low_nibbles);
+    __m128i letters = _mm_cmpgt_epi8(nibbles, _mm_set1_epi8(9));
+    __m128i digits = _mm_add_epi8(nibbles, _mm_set1_epi8('0'));
+    return _mm_add_epi8(digits, _mm_and_si128(letters, _mm_set1_epi8('a' - '0' - 10)));
+}
+
+inline void qword_to_hex_sse2(const uint64_t qword, char* dest_text) {
+    _mm_storeu_si128((__m128i*) dest_text, qword_to_hex_digits(qword));
+}
+
+inline void qword_to_hex_sse2(const uint64_t qword, ushort* dest_text) {
+    __m128i digits = qword_to_hex_digits(qword);
+    _mm_storeu_si128((__m128i*) dest_text, _mm_unpacklo_epi8(digits, _mm_setzero_si128()));
+    _mm_storeu_si128((__m128i*) (dest_text+8), _mm_unpackhi_epi8(digits, _mm_setzero_si128()));
+}
+
+//Digits are validated and converted 16 at a time, then pairs of nibbles are packed into bytes
+inline bool qword_from_hex_digits(const __m128i digits, uint64_t& qword) {
+    __m128i decimal_values = _mm_sub_epi8(digits, _mm_set1_epi8('0'));
+    __m128i is_decimal = _mm_cmpeq_epi8(_mm_min_epu8(decimal_values, _mm_set1_epi8(9)), decimal_values);
+    __m128i letter_values = _mm_sub_epi8(_mm_or_si128(digits, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+    __m128i is_letter = _mm_cmpeq_epi8(_mm_min_epu8(letter_values, _mm_set1_epi8(5)), letter_values);
+    if(_mm_movemask_epi8(_mm_or_si128(is_decimal, is_letter)) != 0xffff) return false;
+    __m128i nibbles = _mm_or_si128(_mm_and_si128(is_decimal, decimal_values),
+                                   _mm_and_si128(is_letter, _mm_add_epi8(letter_values, _mm_set1_epi8(10))));
+
+    __m128i high_nibbles = _mm_slli_epi16(_mm_and_si128(nibbles, _mm_set1_epi16(0x00ff)), 4);
+    __m128i low_nibbles = _mm_srli_epi16(nibbles, 8);
+    __m128i packed = _mm_packus_epi16(_mm_or_si128(high_nibbles, low_nibbles), _mm_setzero_si128());
+    unsigned char bytes[16];
+    _mm_storeu_si128((__m128i*) bytes, packed);
+    qword = qword_from_bytes(bytes);
+    return true;
+}
+
+inline bool qword_from_hex_sse2(const char* text, uint64_t& qword) {
+    return qword_from_hex_digits(_mm_loadu_si128((const __m128i*) text), qword);
+}
+
+inline bool qword_from_hex_sse2(const ushort* text, uint64_t& qword) {
+    //Non-Latin-1 characters saturate to 0xff while being packed, which is not a digit either
+    __m128i first_half = _mm_loadu_si128((const __m128i*) text);
+    __m128i second_half = _mm_loadu_si128((const __m128i*) (text+8));
+    return qword_from_hex_digits(_mm_packus_epi16(first_half, second_half), qword);
+}
+
+#endif
+
+//Fastest available kernels
+inline void raw_groups_to_qwords(const size_t group_count, const ushort* text, uint64_t* dest_buffer) {
+    #ifdef __SSE2__
+        raw_groups_to_qwords_sse2(group_count, text, dest_buffer);
+    #else
+        raw_groups_to_qwords_scalar(group_count, text, dest_buffer);
+    #endif
+}
+
+inline void qwords_to_raw_groups(const size_t group_count, const uint64_t* data, ushort* dest_text) {
+    #ifdef __SSE2__
+        qwords_to_raw_groups_sse2(group_count, data, dest_text);
+    #else
+        qwords_to_raw_groups_scalar(group_count, data, dest_text);
+    #endif
+}
+
+template <typename CharType> inline void qword_to_hex(const uint64_t qword, CharType* dest_text) {
+    #ifdef __SSE2__
+        qword_to_hex_sse2(qword, dest_text);
+    #else
+        qword_to_hex_scalar(qword, dest_text);
+    #endif
+}
+
+template <typename CharType> inline bool qword_from_hex(const CharType* text, uint64_t& qword) {
+    #ifdef __SSE2__
+        return qword_from_hex_sse2(text, qword);
+    #else
+        return qword_from_hex_scalar(text, qword);
+    #endif
+}
+
+template <typename CharType> void qwords_to_hex_text(const size_t data_length,
+                                                     const uint64_t* data,
+                                                     CharType* dest_text) {
+    dest_text[0] = HEX_PREFIX[0];
+    dest_text[1] = HEX_PREFIX[1];
+    CharType* current_text = dest_text + 2;
+    for(size_t i = 0; i < data_length; ++i) {
+        if(i) *(current_text++) = QWORD_SEPARATOR;
+        qword_to_hex(data[i], current_text);
+        current_text+= QWORD_HEX_LENGTH;
+    }
+}
+
+template <typename CharType> uint64_t* qwords_from_hex_text(const size_t text_length,
+                                                            const CharType* text,
+                                                            uint64_t* dest_buffer) {
+    //Check the prefix, then each separator and qword
+    size_t qw_length = hex_text_qword_length(text_length);
+    if(!qw_length) return NULL;
+    if((text[0] != HEX_PREFIX[0]) || (text[1] != HEX_PREFIX[1])) return NULL;
+    const CharType* current_text = text + 2;
+    for(size_t i = 0; i < qw_length; ++i) {
+        if(i && (*(current_text++) != QWORD_SEPARATOR)) return NULL;
+        if(!qword_from_hex(current_text, dest_buffer[i])) return NULL;
+        current_text+= QWORD_HEX_LENGTH;
+    }
+
+    return dest_buffer;
+}
+
+size_t qword_length_raw(const QString& data) {
+    return qword_length_raw_text(data.size());
+}
+
+uint64_t* qwords_from_raw_str(const QString& data,
+                              uint64_t* dest_buffer) {
+    return qwords_from_raw_text(data.size(), data.constData(), dest_buffer);
+}
+
+QString* qwords_to_raw_str(const size_t data_length,
+                           const uint64_t* data,
+                           QString& dest_buffer) {
+    //Size the string once, so that no partial copy of the text is left behind by reallocations
+    dest_buffer.clear();
+    dest_buffer.resize(raw_text_length(data_length, data));
+    qwords_to_raw_text(data_length, data, dest_buffer.data());
+
+    return &dest_buffer;
+}
+
+size_t qword_length_raw_text(const size_t text_length) {
+    return (text_length + QWORD_RAW_LENGTH - 1)/QWORD_RAW_LENGTH;
+}
+
+size_t raw_text_length(const size_t data_length, const uint64_t* data) {
+    //Every qword holds 4 characters, but null characters of the last one are left out
+    if(!data_length) return 0;
+    size_t result = QWORD_RAW_LENGTH*(data_length-1);
+    for(int shift = 48; shift >= 0; shift-= 16) {
+        if((data[data_length-1] >> shift) & 0xffff) ++result;
+    }
+
+    return result;
+}
+
+uint64_t* qwords_from_raw_text(const size_t text_length,
+                               const QChar* text,
+                               uint64_t* dest_buffer) {
+    //Full groups of 4 characters, then the remaining characters packed in the last qword's
+    //lowest bits
+    const ushort* characters = (const ushort*) text;
+    size_t group_count = text_length/QWORD_RAW_LENGTH;
+    raw_groups_to_qwords(group_count, characters, dest_buffer);
+    size_t remaining_characters = text_length % QWORD_RAW_LENGTH;
+    if(remaining_characters) {
+        uint64_t last_qword = 0;
+        for(size_t i = QWORD_RAW_LENGTH*group_count; i < text_length; ++i) {
+            last_qword = (last_qword << 16) | characters[i];
+        }
+        dest_buffer[group_count] = last_qword;
+    }
+
+    return dest_buffer;
+}
+
+void qwords_to_raw_text(const size_t data_length,
+                        const uint64_t* data,
+                        QChar* dest_text) {
+    if(!data_length) return;
+    ushort* characters = (ushort*) dest_text;
+    qwords_to_raw_groups(data_length-1, data, characters);
+    characters+= QWORD_RAW_LENGTH*(data_length-1);
+    for(int shift = 48; shift >= 0; shift-= 16) {
+        ushort character = (data[data_length-1] >> shift) & 0xffff;
+        if(character) *(characters++) = character;
+    }
+}
+
+size_t hex_text_length(const size_t data_length) {
+    //"0x", then qwords separated by spaces
+    if(!data_length) return 2;
+    return 2 + data_length*(QWORD_HEX_LENGTH+1) - 1;
+}
+
+size_t hex_text_qword_length(const size_t text_length) {
+    //Inverse of hex_text_length, for texts holding at least one qword
+    if(text_length < 2 + QWORD_HEX_LENGTH) return 0;
+    if((text_length - 1) % (QWORD_HEX_LENGTH+1)) return 0;
+    return (text_length - 1)/(QWORD_HEX_LENGTH+1);
+}
+
+void qwords_to_hex_text(const size_t data_length,
+                        const uint64_t* data,
+                        QChar* dest_text) {
+    qwords_to_hex_text<ushort>(data_length, data, (ushort*) dest_text);
+}
+
+void qwords_to_hex_text(const size_t data_length,
+                        const uint64_t* data,
+                        char* dest_text) {
+    qwords_to_hex_text<char>(data_length, data, dest_text);
+}
+
+uint64_t* qwords_from_hex_text(const size_t text_length,
+                               const QChar* text,
+                               uint64_t* dest_buffer) {
+    return qwords_from_hex_text<ushort>(text_length, (const ushort*) text, dest_buffer);
+}
+
+uint64_t* qwords_from_hex_text(const size_t text_length,
+                               const char* text,
+                               uint64_t* dest_buffer) {
+    return qwords_from_hex_text<char>(text_length, text, dest_buffer);
+}
+
+size_t qword_length_hex(const QString& data) {
+    return hex_text_qword_length(data.size());
+}
+
+uint64_t* qwords_from_hex_str(const QString& data,
+                              uint64_t* dest_buffer) {
+    return qwords_from_hex_text(data.size(), data.constData(), dest_buffer);
+}
+
+QString* qwords_to_hex_str(const size_t data_length,
+                           const uint64_t* data,
+                           QString& dest_buffer) {
+    dest_buffer.resize(hex_text_length(data_length));
+    qwords_to_hex_text(data_length, data, dest_buffer.data());
+
+    return &dest_buffer;
+}
+
+//Original character-by-character raw conversions, which define the encoding
+uint64_t* reference_qwords_from_raw_str(const QString& data,
+                                        uint64_t* dest_buffer) {
+    uint64_t* result_parser = dest_buffer-1;
+    for(int i = 0; i < data.size(); ++i) {
+        if(i%4 == 0) {
+            ++result_parser;
+            *result_parser = 0;
+        }
+        *result_parser*= 65536;
+        *result_parser+= data.at(i).unicode();
+    }
+
+    return dest_buffer;
+}
+
+QString* reference_qwords_to_raw_str(const size_t data_length,
+                                     const uint64_t* data,
+                                     QString& dest_buffer) {
+    dest_buffer.clear();
+    uint64_t current_data;
+    ushort c1 = 0, c2 = 0, c3 = 0, c4 = 0;
+    for(size_t i = 0; i < data_length; ++i) {
+        current_data = data[i];
+        c4 = current_data % 65536;
+        current_data/= 65536;
+        c3 = current_data % 65536;
+        current_data/= 65536;
+        c2 = current_data % 65536;
+        current_data/= 65536;
+        c1 = current_data % 65536;
+        if(i == data_length - 1) break;
+        dest_buffer.append(QChar(c1));
+        dest_buffer.append(QChar(c2));
+        dest_buffer.append(QChar(c3));
+        dest_buffer.append(QChar(c4));
+    }
+    if(c1) dest_buffer.append(QChar(c1));
+    if(c2) dest_buffer.append(QChar(c2));
+    if(c3) dest_buffer.append(QChar(c3));
+    if(c4) dest_buffer.append(QChar(c4));
+
+    return &dest_buffer;
+}
+
+inline uint64_t next_random_qword(uint64_t& state) {
+    //Xorshift generator : tests must be reproducible, not unpredictable
+    state^= state << 13;
+    state^= state >> 7;
+    state^= state << 17;
+    return state;
+}
+
+bool test_raw_conversions(uint64_t& random_state) {
+    const int MAX_TEST_LENGTH = 37; //Characters or qwords, covers every alignment of the SSE2 loops
+    QString text, result_text, expected_text;
+    uint64_t qwords[MAX_TEST_LENGTH], expected_qwords[MAX_TEST_LENGTH];
+    for(int length = 0; length <= MAX_TEST_LENGTH; ++length) {
+        for(int run = 0; run < 16; ++run) {
+            //Strings, with null characters and full-range UTF-16 code units
+            text.resize(length);
+            for(int i = 0; i < length; ++i) {
+                uint64_t random = next_random_qword(random_state);
+                text[i] = QChar((ushort) ((random & 3) ? random >> 16 : random % 128));
+            }
+            size_t qw_length = qword_length_raw(text);
+            if(qw_length != (size_t) (length+3)/4) {
+                log_error(QSTRING_TO_QWORDS_NAME, ERR_CONVERSION_MISMATCH.arg("qword_length_raw"));
+                return false;
+            }
+            qwords_from_raw_str(text, qwords);
+            reference_qwords_from_raw_str(text, expected_qwords);
+            if(memcmp(qwords, expected_qwords, qw_length*sizeof(uint64_t)) != 0) {
+                log_error(QSTRING_TO_QWORDS_NAME, ERR_CONVERSION_MISMATCH.arg("qwords_from_raw_str"));
+                return false;
+            }
+
+            //Qwords, with null characters in the last one
+            for(int i = 0; i < length; ++i) {
+                qwords[i] = next_random_qword(random_state);
+                if((i == length-1) && (run % 2)) qwords[i]&= next_random_qword(random_state) & 0xffff0000ffff0000ULL;
+            }
+            qwords_to_raw_str(length, qwords, result_text);
+            reference_qwords_to_raw_str(length, qwords, expected_text);
+            if(result_text != expected_text) {
+                log_error(QSTRING_TO_QWORDS_NAME, ERR_CONVERSION_MISMATCH.arg("qwords_to_raw_str"));
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+bool test_hex_conversions(uint64_t& random_state) {
+    const int MAX_TEST_LENGTH = 9;
+    uint64_t qwords[MAX_TEST_LENGTH], decoded_qwords[MAX_TEST_LENGTH], expected_qwords[MAX_TEST_LENGTH];
+    char text[MAX_TEST_LENGTH*(QWORD_HEX_LENGTH+1)+1];
+    QString utf16_text;
+    for(int length = 1; length <= MAX_TEST_LENGTH; ++length) {
+        for(int run = 0; run < 16; ++run) {
+            for(int i = 0; i < length; ++i) qwords[i] = next_random_qword(random_state);
+            size_t text_length = hex_text_length(length);
+
+            //Encoding, in Latin-1 and UTF-16, against the scalar kernel
+            qwords_to_hex_text(length, qwords, text);
+            qwords_to_hex_str(length, qwords, utf16_text);
+            bool success = (utf16_text.size() == (int) text_length) && (hex_text_qword_length(text_length) == (size_t) length);
+            for(int i = 0; success && (i < length); ++i) {
+                char expected_digits[QWORD_HEX_LENGTH];
+                qword_to_hex_scalar(qwords[i], expected_digits);
+                const char* digits = text + 2 + i*(QWORD_HEX_LENGTH+1);
+                success = (memcmp(digits, expected_digits, QWORD_HEX_LENGTH) == 0);
+                for(int j = 0; success && (j < QWORD_HEX_LENGTH); ++j) {
+                    success = (utf16_text.at(2 + i*(QWORD_HEX_LENGTH+1) + j) == QChar(digits[j]));
+                }
+            }
+            if(!success) {
+                log_error(QSTRING_TO_QWORDS_NAME, ERR_CONVERSION_MISMATCH.arg("qwords_to_hex_text"));
+                return false;
+            }
+
+            //Decoding of valid and damaged text, against the scalar kernel
+            if(run % 2) {
+                uint64_t random = next_random_qword(random_state);
+                text[2 + random % (text_length-2)] = (char) (random >> 32);
+            }
+            bool decoded = (qwords_from_hex_text(text_length, text, decoded_qwords) != NULL);
+            bool expected_decoding = true;
+            for(int i = 0; expected_decoding && (i < length); ++i) {
+                const char* digits = text + 2 + i*(QWORD_HEX_LENGTH+1);
+                if(i) expected_decoding = (digits[-1] == QWORD_SEPARATOR);
+                if(expected_decoding) expected_decoding = qword_from_hex_scalar(digits, expected_qwords[i]);
+            }
+            if((decoded != expected_decoding)
+               || (decoded && (memcmp(decoded_qwords, expected_qwords, length*sizeof(uint64_t)) != 0))) {
+                log_error(QSTRING_TO_QWORDS_NAME, ERR_CONVERSION_MISMATCH.arg("qwords_from_hex_text"));
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+bool test_qword_conversions() {
+    uint64_t random_state = 88172645463325252ULL;
+    if(!test_raw_conversions(random_state)) return false;
+    if(!test_hex_conversions(random_state)) return false;
+
+    return true;
+}
@@ -37,17 +37,51 @@ QString* qwords_to_raw_str(const size_t data_length,
                            const uint64_t* data,
                            QString& dest_buffer);
 
+//  As for hex data below, they are built on lower-level functions working on caller-provided
+//  QChar buffers, which convert several qwords at once where SSE2 is available.
+
+size_t qword_length_raw_text(const size_t text_length); //Qwords needed to store text_length characters
+size_t raw_text_length(const size_t data_length, //Characters needed to write data back
+                       const uint64_t* data);
+uint64_t* qwords_from_raw_text(const size_t text_length,
+                               const QChar* text,
+                               uint64_t* dest_buffer);
+void qwords_to_raw_text(const size_t data_length,
+                        const uint64_t* data,
+                        QChar* dest_text);
+
 
 // -  The "hex" transformations map qwords into their hexadecimal expression, written as
 //  "0x0123456789abcdef 0123456789abcdef 0123456789abcdef 0123456789abcdef".
 //  They are suitable for expressing a qword array in a human-readable way and processing
 //  such expressions.
 
-size_t qword_length_hex(const QString& data);
+size_t qword_length_hex(const QString& data); //0 if the string cannot be hex data
 QString* qwords_to_hex_str(const size_t data_length,
                            const uint64_t* data,
                            QString& dest_buffer);
-uint64_t* qwords_from_hex_str(const QString& data,
+uint64_t* qwords_from_hex_str(const QString& data, //NULL if the string is not valid hex data
                               uint64_t* dest_buffer);
 
+//  The hex transformations are built on a lower-level codec, which reads and writes UTF-16 (QChar)
+//  or Latin-1 (char) text in caller-provided buffers. Lengths are known in advance, and whole
+//  qwords are converted at once (using SSE2 where available).
+
+size_t hex_text_length(const size_t data_length); //Characters needed to write data_length qwords
+size_t hex_text_qword_length(const size_t text_length); //0 if text of that length cannot be hex data
+void qwords_to_hex_text(const size_t data_length,
+                        const uint64_t* data,
+                        QChar* dest_text);
+void qwords_to_hex_text(const size_t data_length,
+                        const uint64_t* data,
+                        char* dest_text);
+uint64_t* qwords_from_hex_text(const size_t text_length,
+                               const QChar* text,
+                               uint64_t* dest_buffer);
+uint64_t* qwords_from_hex_text(const size_t text_length,
+                               const char* text,
+                               uint64_t* dest_buffer);
+
+bool test_qword_conversions(); //Check the vectorized conversions against their scalar reference
+
 #endif // QSTRING_TO_QWORDS_H
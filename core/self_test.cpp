@@ -0,0 +1,148 @@
+/* Self-test thread : checks Hashish's cryptographic functions in the background at startup,
+   remembering successful runs so that they need not be repeated as long as the binary (which
+   embeds the test vectors) does not change.
+
+      Copyright (C) 2011  Hadrien Grasland
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA */
+
+#include <QByteArray>
+#include <QFile>
+#include <QTextStream>
+#include <QVector>
+#include <string.h>
+
+#include <crypto_hash.h>
+#include <error_management.h>
+#include <parsing_tools.h>
+#include <qstring_to_qwords.h>
+#include <self_test.h>
+#include <test_suite.h>
+
+const QString SELF_TEST_THREAD_NAME("SelfTestThread");
+
+const QString ID_CACHE_KEY("key : ");
+enum SelfTestCacheID {CACHE_KEY = 0};
+const QString* const SELF_TEST_CACHE_IDS[] = {&ID_CACHE_KEY};
+const KeywordTable self_test_cache_keywords(SELF_TEST_CACHE_IDS, sizeof(SELF_TEST_CACHE_IDS)/sizeof(QString*));
+
+const QString SELF_TEST_CACHE_HEADER("*** Hashish self-test cache v1 ***");
+
+const int FILE_CHUNK_LENGTH = 65536; //Files are hashed by chunks of that many bytes
+
+SelfTestThread::SelfTestThread(const QString& executable_filepath,
+                               const QString& cache_filepath,
+                               QObject* parent) : QThread(parent),
+                                                  cache_filepath(cache_filepath),
+                                                  executable_filepath(executable_filepath),
+                                                  passed(false) {}
+
+void SelfTestThread::run() {
+    passed = false;
+
+    //Identify the current binary and test vectors
+    size_t key_length = sha_512_hash.hash_length();
+    uint64_t key[key_length];
+    QString key_str;
+    bool key_available = (compute_cache_key(key) != NULL);
+    if(key_available) qwords_to_hex_str(key_length, key, key_str);
+
+    //If the full test suite has already passed on them, only check that the hardware still
+    //does its mathematics right. Otherwise, run the full test suite and remember the result.
+    if(key_available && read_cache(key_str)) {
+        passed = quick_self_test();
+    } else {
+        passed = full_self_test();
+        if(passed && key_available) write_cache(key_str);
+    }
+    if(!passed) QFile::remove(cache_filepath);
+
+    emit self_test_finished(passed);
+}
+
+uint64_t* SelfTestThread::compute_cache_key(uint64_t* dest_buffer) {
+    //Test vectors are compiled in, so the hash of the executable identifies them too
+    return hash_file(executable_filepath, dest_buffer);
+}
+
+uint64_t* SelfTestThread::hash_file(const QString& filepath, uint64_t* dest_buffer) {
+    QFile file(filepath);
+    if(file.open(QIODevice::ReadOnly) == false) {
+        log_error(SELF_TEST_THREAD_NAME, ERR_FILE_OPEN_FAILURE.arg(filepath));
+        return NULL;
+    }
+
+    //Hash the file chunk by chunk so that memory usage does not depend on its size. Each chunk
+    //is zero-padded to a qword boundary and followed by its length in bytes.
+    size_t hash_length = sha_512_hash.hash_length();
+    const size_t chunk_qwords = FILE_CHUNK_LENGTH/8 + 1;
+    QVector<uint64_t> chunk(chunk_qwords);
+    QVector<uint64_t> chunk_hashes;
+    while(file.atEnd() == false) {
+        QByteArray chunk_bytes = file.read(FILE_CHUNK_LENGTH);
+        if(chunk_bytes.isEmpty()) break;
+        size_t chunk_length = (chunk_bytes.size()+7)/8;
+        memset((void*) chunk.data(), 0, chunk_length*sizeof(uint64_t));
+        for(int i = 0; i < chunk_bytes.size(); ++i) {
+            chunk[i/8]|= ((uint64_t) (unsigned char) chunk_bytes.at(i)) << (56 - 8*(i%8));
+        }
+        chunk[chunk_length] = chunk_bytes.size();
+
+        int previous_size = chunk_hashes.size();
+        chunk_hashes.resize(previous_size + hash_length);
+        if(!sha_512_hash.hash(chunk_length+1, chunk.data(), chunk_hashes.data()+previous_size)) return NULL;
+    }
+    file.close();
+
+    //Empty files still get a well-defined hash
+    if(chunk_hashes.isEmpty()) chunk_hashes.fill(0, 1);
+
+    return sha_512_hash.hash(chunk_hashes.size(), chunk_hashes.data(), dest_buffer);
+}
+
+bool SelfTestThread::read_cache(const QString& expected_key) {
+    QFile cache_file(cache_filepath);
+    if(cache_file.exists() == false) return false;
+    if(cache_file.open(QIODevice::ReadOnly) == false) return false;
+
+    QByteArray cache_data = cache_file.readAll();
+    cache_file.close();
+    ConfigTokenizer cache_tokenizer(cache_data);
+    if(!cache_tokenizer.read_header(SELF_TEST_CACHE_HEADER)) return false;
+
+    //Check the hash of the binary for which tests passed
+    ConfigField field;
+    while(cache_tokenizer.next_field(self_test_cache_keywords, field)) {
+        if(field.id == CACHE_KEY) return (field.to_string() == expected_key);
+    }
+
+    return false;
+}
+
+bool SelfTestThread::write_cache(const QString& key) {
+    QFile cache_file(cache_filepath);
+    if(cache_file.open(QIODevice::WriteOnly | QIODevice::Truncate) == false) {
+        log_error(SELF_TEST_THREAD_NAME, ERR_FILE_OPEN_FAILURE.arg(cache_filepath));
+        return false;
+    }
+
+    QTextStream cache_ostream(&cache_file);
+    cache_ostream << SELF_TEST_CACHE_HEADER << endl << endl;
+    cache_ostream << ID_CACHE_KEY << key << endl;
+    cache_ostream.flush();
+    cache_file.close();
+
+    return true;
+}
@@ -0,0 +1,57 @@
+/* Self-test thread : checks Hashish's cryptographic functions in the background at startup,
+   remembering successful runs so that they need not be repeated as long as the binary (which
+   embeds the test vectors) does not change.
+
+      Copyright (C) 2011  Hadrien Grasland
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA */
+
+#ifndef SELF_TEST_H
+#define SELF_TEST_H
+
+#include <QString>
+#include <QThread>
+#include <stddef.h>
+#include <stdint.h>
+
+//The cache file holds a hash of the executable for which the full test suite last passed. When it
+//matches, only a quick known-answer test is run.
+class SelfTestThread : public QThread {
+    Q_OBJECT
+
+  public:
+    SelfTestThread(const QString& executable_filepath,
+                   const QString& cache_filepath,
+                   QObject* parent = NULL);
+    bool tests_passed() {return passed;}
+
+  signals:
+    void self_test_finished(bool passed);
+
+  protected:
+    void run();
+
+  private:
+    QString cache_filepath;
+    QString executable_filepath;
+    bool passed;
+
+    uint64_t* compute_cache_key(uint64_t* dest_buffer);
+    uint64_t* hash_file(const QString& filepath, uint64_t* dest_buffer);
+    bool read_cache(const QString& expected_key);
+    bool write_cache(const QString& key);
+};
+
+#endif // SELF_TEST_H
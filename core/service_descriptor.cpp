@@ -21,15 +21,21 @@
 #include <time.h>
 
 #include <error_management.h>
+#include <key_cache.h>
 #include <parsing_tools.h>
+#include <pbkdf2.h>
 #include <qstring_to_qwords.h>
 #include <service_descriptor.h>
+#include <tracing.h>
 
 const QString SERVICE_DESCRIPTOR_NAME("ServiceDescriptor");
 
+#define PBKDF2_BENCHMARK_STEP 256 //PBKDF2 iterations between two clock checks during benchmarks
+
 const QString ID_SERVICE_NAME("service_name : ");
 const QString ID_HASH_USED("hash_used : ");
 const QString ID_HMAC_USED("hmac_used : ");
+const QString ID_KEY_DERIVATION("key_derivation : ");
 const QString ID_ITERATIONS("iterations : ");
 const QString ID_NONCE("nonce : ");
 const QString ID_PASSWORD_TYPE("password_type : ");
@@ -39,12 +45,78 @@ const QString ID_CACHED_DATA("cached_data : ");
 const QString ID_CIPHER_USED("cipher_used : ");
 const QString ID_ENCRYPTED_PW("encrypted_pw : ");
 
+//Identifiers which may start a line of a descriptor, in dispatch order
+enum ServiceDescriptorID {SERVICE_NAME = 0,
+                          HASH_USED,
+                          HMAC_USED,
+                          KEY_DERIVATION,
+                          ITERATIONS,
+                          NONCE,
+                          PASSWORD_TYPE,
+                          GENERATOR_USED,
+                          CONSTRAINTS,
+                          CACHED_DATA,
+                          CIPHER_USED,
+                          ENCRYPTED_PW};
+const QString* const SERVICE_DESC_IDS[] = {&ID_SERVICE_NAME,
+                                           &ID_HASH_USED,
+                                           &ID_HMAC_USED,
+                                           &ID_KEY_DERIVATION,
+                                           &ID_ITERATIONS,
+                                           &ID_NONCE,
+                                           &ID_PASSWORD_TYPE,
+                                           &ID_GENERATOR_USED,
+                                           &ID_CONSTRAINTS,
+                                           &ID_CACHED_DATA,
+                                           &ID_CIPHER_USED,
+                                           &ID_ENCRYPTED_PW};
+const KeywordTable service_desc_keywords(SERVICE_DESC_IDS, sizeof(SERVICE_DESC_IDS)/sizeof(QString*));
+
 const QString SERVICE_DESCRIPTOR_HEADER("*** Hashish service descriptor v1 ***");
 
+QwordPassword::QwordPassword(const QString& password) : length(qword_length_raw(password)),
+                                                         utf8_length(0),
+                                                         utf8(NULL) {
+    qwords = new uint64_t[length];
+    if(!qwords) {
+        log_error(SERVICE_DESCRIPTOR_NAME, ERR_BAD_ALLOC.arg(QString("qwords")));
+        length = 0;
+        return;
+    }
+    qwords_from_raw_str(password, qwords);
+
+    //Only keep a wiped copy of the UTF-8 bytes
+    QByteArray utf8_password = password.toUtf8();
+    utf8_length = utf8_password.size();
+    utf8 = new char[utf8_length + 1];
+    if(!utf8) {
+        log_error(SERVICE_DESCRIPTOR_NAME, ERR_BAD_ALLOC.arg(QString("utf8")));
+        memset((void*) qwords, 0, length*sizeof(uint64_t));
+        delete[] qwords;
+        qwords = NULL;
+        length = 0;
+        utf8_length = 0;
+    } else {
+        memcpy((void*) utf8, (const void*) utf8_password.constData(), utf8_length);
+    }
+    memset((void*) utf8_password.data(), 0, utf8_password.size());
+}
+
+QwordPassword::~QwordPassword() {
+    if(utf8) {
+        memset((void*) utf8, 0, utf8_length);
+        delete[] utf8;
+    }
+    if(!qwords) return;
+    memset((void*) qwords, 0, length*sizeof(uint64_t));
+    delete[] qwords;
+}
+
 ServiceDescriptor::ServiceDescriptor(QString initial_name,
                                      uint64_t default_iterations) : service_name(initial_name),
                                                                     hash_used(&default_hash),
                                                                     hmac_used(&default_hmac),
+                                                                    key_derivation(ITERATED_HASH),
                                                                     iterations(default_iterations),
                                                                     nonce(0),
                                                                     password_type(GENERATED),
@@ -70,12 +142,16 @@ ServiceDescriptor::ServiceDescriptor(QString initial_name,
 ServiceDescriptor::ServiceDescriptor(const ServiceDescriptor& source) : service_name(source.service_name),
                                                                         hash_used(source.hash_used),
                                                                         hmac_used(source.hmac_used),
+                                                                        key_derivation(source.key_derivation),
                                                                         iterations(source.iterations),
                                                                         nonce(source.nonce),
                                                                         password_type(source.password_type),
                                                                         generator_used(source.generator_used),
+                                                                        constraints(NULL),
+                                                                        cached_data(NULL),
                                                                         cipher_used(source.cipher_used),
                                                                         encrypted_pw_length(source.encrypted_pw_length),
+                                                                        encrypted_pw(NULL),
                                                                         service_file(NULL) {
     if(source.constraints) {
         constraints = new PwdGenConstraints;
@@ -117,6 +193,7 @@ ServiceDescriptor& ServiceDescriptor::operator=(const ServiceDescriptor& source)
     service_name = source.service_name;
     hash_used = source.hash_used;
     hmac_used = source.hmac_used;
+    key_derivation = source.key_derivation;
     iterations = source.iterations;
     nonce = source.nonce;
     password_type = source.password_type;
@@ -165,15 +242,33 @@ uint64_t ServiceDescriptor::benchmark_iterations(uint64_t acceptable_latency) {
     //Determine the final time at which the benchmark must stop
     clock_t final_time = clock() + (acceptable_latency*CLOCKS_PER_SEC)/1000;
 
-    //Run compute_password in benchmark mode, which makes it stop just before key hashing and
-    //return a casted key block that is ready to hash
     size_t hashed_key_length = hash_used->hash_length();
     uint64_t* hashed_key = new uint64_t[hashed_key_length];
     if(!hashed_key) {
         log_error(SERVICE_DESCRIPTOR_NAME, ERR_BAD_ALLOC.arg(QString("hashed_key")));
         return 0;
     }
-    uint64_t* tmp_result = compute_hashed_key(dummy_pw, hashed_key, true);
+
+    //PBKDF2 derives whole keys, PBKDF2_BENCHMARK_STEP iterations at a time. Its setup costs as much
+    //as a couple of iterations, which is negligible.
+    if(key_derivation == PBKDF2_HMAC_SHA512) {
+        QByteArray salt = service_name.toUtf8();
+        QByteArray utf8_dummy_pw = dummy_pw.toUtf8();
+        PBKDF2HMACSHA512 pbkdf2(utf8_dummy_pw.constData(), utf8_dummy_pw.size());
+        uint64_t current_iteration = 0;
+        while(clock() < final_time) {
+            current_iteration+= PBKDF2_BENCHMARK_STEP;
+            pbkdf2.derive_qwords(salt.constData(), salt.size(), PBKDF2_BENCHMARK_STEP, hashed_key_length, hashed_key);
+        }
+        delete[] hashed_key;
+        return current_iteration;
+    }
+
+    //Run compute_password in benchmark mode, which makes it stop just before key hashing and
+    //return a casted key block that is ready to hash
+    QwordPassword qw_dummy_pw(dummy_pw);
+    uint64_t* tmp_result = NULL;
+    if(qw_dummy_pw.qwords) tmp_result = compute_hashed_key(qw_dummy_pw, hashed_key, true);
     if(!tmp_result) {
         delete[] hashed_key;
         return 0;
@@ -197,6 +292,16 @@ uint64_t ServiceDescriptor::benchmark_iterations(uint64_t acceptable_latency) {
 
 QString* ServiceDescriptor::compute_password(const QString& master_pw,
                                              QString& dest_buffer) {
+    QwordPassword qw_master_pw(master_pw);
+    if(!qw_master_pw.qwords) return NULL;
+
+    return compute_password(qw_master_pw, dest_buffer);
+}
+
+QString* ServiceDescriptor::compute_password(const QwordPassword& master_pw,
+                                             QString& dest_buffer) {
+    TRACE_SPAN(TRACE_COMPUTE_PASSWORD);
+
     //Compute a hashed key from the master password, service name, nonce, etc...
     size_t hashed_key_length = hash_used->hash_length();
     uint64_t* hashed_key = new uint64_t[hashed_key_length];
@@ -228,6 +333,17 @@ QString* ServiceDescriptor::compute_password(const QString& master_pw,
 
 bool ServiceDescriptor::encrypt_password(const QString& master_pw,
                                          const QString& service_pw) {
+    QwordPassword qw_master_pw(master_pw);
+    if(!qw_master_pw.qwords) return false;
+
+    return encrypt_password(qw_master_pw, service_pw);
+}
+
+bool ServiceDescriptor::encrypt_password(const QwordPassword& master_pw,
+                                         const QString& service_pw,
+                                         const bool cache_key) {
+    TRACE_SPAN(TRACE_ENCRYPT_PASSWORD);
+
     //Create a qword version of the service password
     size_t qw_service_length = qword_length_raw(service_pw);
     uint64_t* qw_service = new uint64_t[qw_service_length];
@@ -246,7 +362,7 @@ bool ServiceDescriptor::encrypt_password(const QString& master_pw,
         delete[] qw_service;
         return false;
     }
-    uint64_t* tmp_result = compute_hashed_key(master_pw, hashed_key);
+    uint64_t* tmp_result = compute_hashed_key(master_pw, hashed_key, false, cache_key);
     if(!tmp_result) {
         memset((void*) qw_service, 0, qw_service_length*sizeof(uint64_t));
         delete[] qw_service;
@@ -269,11 +385,14 @@ bool ServiceDescriptor::encrypt_password(const QString& master_pw,
     }
 
     //Compute the encrypted password
-    tmp_result = cipher_used->encrypt(hashed_key,
-                                      qw_service_length,
-                                      qw_service,
-                                      hash_used,
-                                      encrypted_pw);
+    {
+        TRACE_SPAN(TRACE_CIPHER);
+        tmp_result = cipher_used->encrypt(hashed_key,
+                                          qw_service_length,
+                                          qw_service,
+                                          hash_used,
+                                          encrypted_pw);
+    }
     memset((void*) qw_service, 0, qw_service_length*sizeof(uint64_t));
     delete[] qw_service;
     memset((void*) hashed_key, 0, hashed_key_length*sizeof(uint64_t));
@@ -286,6 +405,7 @@ bool ServiceDescriptor::encrypt_password(const QString& master_pw,
 }
 
 bool ServiceDescriptor::load_from_file(const QString& descriptor_filepath) {
+    TRACE_SPAN(TRACE_DESCRIPTOR_LOAD);
     bool success;
     //Access service descriptor file. If it does not exist, abort.
     if(!service_file) service_file = new QFile;
@@ -305,23 +425,22 @@ bool ServiceDescriptor::load_from_file(const QString& descriptor_filepath) {
         log_error(SERVICE_DESCRIPTOR_NAME, ERR_FILE_OPEN_FAILURE.arg(descriptor_filepath));
         return false;
     }
-    QTextStream service_istream(service_file);
-    QString header = service_istream.readLine();
-    if(header != SERVICE_DESCRIPTOR_HEADER) {
+    QByteArray descriptor_data = service_file->readAll();
+    service_file->close();
+    ConfigTokenizer service_tokenizer(descriptor_data);
+    if(!service_tokenizer.read_header(SERVICE_DESCRIPTOR_HEADER)) {
         log_error(SERVICE_DESCRIPTOR_NAME, ERR_FILE_HEADER_INCORRECT.arg(descriptor_filepath));
-        service_istream.flush();
-        service_file->close();
         return false;
     }
 
     //Read service descriptor from the file
-    success = parse_service_desc(service_istream);
-    service_file->close();
+    success = parse_service_desc(service_tokenizer);
     if(!success) return false;
     return true;
 }
 
 bool ServiceDescriptor::save_to_file(const QString& descriptor_filepath) {
+    TRACE_SPAN(TRACE_DESCRIPTOR_SAVE);
     bool success;
     //Access service descriptor file. If it exists, make a backup copy.
     if(!service_file) service_file = new QFile;
@@ -359,14 +478,31 @@ bool ServiceDescriptor::save_to_file(const QString& descriptor_filepath) {
     return true;
 }
 
+QString* ServiceDescriptor::save_to_string(QString& dest_buffer) {
+    //Write header, then contents
+    dest_buffer.clear();
+    QTextStream service_ostream(&dest_buffer);
+    service_ostream << SERVICE_DESCRIPTOR_HEADER << endl << endl;
+    bool success = write_service_desc(service_ostream);
+    service_ostream.flush();
+    if(!success) {
+        dest_buffer.clear();
+        return NULL;
+    }
+
+    return &dest_buffer;
+}
+
 void ServiceDescriptor::reset(const QString& initial_name, const uint64_t default_iterations) {
     *this = ServiceDescriptor(initial_name, default_iterations);
 }
 
-uint64_t* ServiceDescriptor::compute_hashed_key(const QString& master_pw,
+uint64_t* ServiceDescriptor::compute_hashed_key(const QwordPassword& master_pw,
                                                 uint64_t* dest_buffer,
-                                                bool benchmark_mode) {
-    //Generate service_nonce = service_name + delim + nonce where delim is (uint64_t) 0
+                                                bool benchmark_mode,
+                                                bool cache_key) {
+    //Generate service_nonce = service_name + delim + nonce where delim is (uint64_t) key_derivation,
+    //so that keys derived in different ways never share a stretched key cache entry
     size_t service_nonce_length = qword_length_raw(service_name) + 2;
     uint64_t* service_nonce = new uint64_t[service_nonce_length];
     if(!service_nonce) {
@@ -375,7 +511,7 @@ uint64_t* ServiceDescriptor::compute_hashed_key(const QString& master_pw,
     }
 
     qwords_from_raw_str(service_name, service_nonce);
-    service_nonce[service_nonce_length - 2] = 0;
+    service_nonce[service_nonce_length - 2] = key_derivation;
     service_nonce[service_nonce_length - 1] = nonce;
 
     //Compute initial_key = HMAC(master_pw, service_nonce)
@@ -398,53 +534,78 @@ uint64_t* ServiceDescriptor::compute_hashed_key(const QString& master_pw,
         return NULL;
     }
 
-    //Compute hashed_key = hash^iterations(initial_key)
+    //Compute hashed_key = hash^iterations(initial_key), or the PBKDF2 key, unless it has been cached
+    //recently
     size_t hashed_key_length = initial_key_length;
     uint64_t* hashed_key = dest_buffer;
+    if(!benchmark_mode && cache_key && stretched_key_cache.fetch(hash_used, iterations, initial_key_length, initial_key, hashed_key)) {
+        memset((void*) initial_key, 0, initial_key_length*sizeof(uint64_t));
+        delete[] initial_key;
+        return hashed_key;
+    }
     memcpy((void*) hashed_key, (const void*) initial_key, hashed_key_length*sizeof(uint64_t));
-    memset((void*) initial_key, 0, initial_key_length*sizeof(uint64_t));
-    delete[] initial_key;
 
-    if(benchmark_mode) return hashed_key; //In benchmark mode, we stop just before hashing
-    for(size_t i = 0; i<iterations; ++i) {
-        tmp_result = hash_used->hash(hashed_key_length, hashed_key, hashed_key);
+    if(!benchmark_mode) { //In benchmark mode, we stop just before hashing
+        TRACE_SPAN(TRACE_STRETCHING);
+        switch(key_derivation) {
+          case ITERATED_HASH:
+            for(size_t i = 0; tmp_result && (i<iterations); ++i) {
+                tmp_result = hash_used->hash(hashed_key_length, hashed_key, hashed_key);
+            }
+            break;
+          case PBKDF2_HMAC_SHA512:
+            tmp_result = compute_pbkdf2_key(master_pw, hashed_key_length, hashed_key);
+            break;
+          default: //Never hand out the unstretched key
+            log_error(SERVICE_DESCRIPTOR_NAME, ERR_UNSUPPORTED_KEY_DERIVATION.arg((int) key_derivation));
+            tmp_result = NULL;
+            break;
+        }
         if(!tmp_result) {
             memset((void*) hashed_key, 0, hashed_key_length*sizeof(uint64_t));
+            memset((void*) initial_key, 0, initial_key_length*sizeof(uint64_t));
+            delete[] initial_key;
             return NULL;
         }
+        if(cache_key) stretched_key_cache.store(hash_used, iterations, initial_key_length, initial_key, hashed_key);
     }
 
+    memset((void*) initial_key, 0, initial_key_length*sizeof(uint64_t));
+    delete[] initial_key;
     return hashed_key;
 }
 
-uint64_t* ServiceDescriptor::compute_initial_key(const QString& master_pw,
+uint64_t* ServiceDescriptor::compute_initial_key(const QwordPassword& master_pw,
                                                  size_t service_nonce_length,
                                                  uint64_t* service_nonce,
                                                  uint64_t* dest_buffer) {
-    //Convert master_pw to a qword form suitable for hash computations
-    size_t qw_password_length = qword_length_raw(master_pw);
-    uint64_t* qw_password = new uint64_t[qw_password_length];
-    if(!qw_password) {
-        log_error(SERVICE_DESCRIPTOR_NAME, ERR_BAD_ALLOC.arg(QString("qw_password")));
-        return NULL;
-    }
-    qwords_from_raw_str(master_pw, qw_password);
+    TRACE_SPAN(TRACE_INITIAL_KEY);
 
     //Compute HMAC(master_pw, service_nonce), return result
-    uint64_t* result = hmac_used->hmac(qw_password_length,
-                                       qw_password,
+    uint64_t* result = hmac_used->hmac(master_pw.length,
+                                       master_pw.qwords,
                                        service_nonce_length,
                                        service_nonce,
                                        hash_used,
                                        dest_buffer);
-    memset((void*) qw_password, 0, qw_password_length*sizeof(uint64_t));
-    delete[] qw_password;
     if(!result) return NULL;
 
     return result;
 
 }
 
+uint64_t* ServiceDescriptor::compute_pbkdf2_key(const QwordPassword& master_pw,
+                                                size_t key_length,
+                                                uint64_t* dest_buffer) {
+    //PBKDF2(UTF-8 master password, UTF-8 service name + nonce as 8 big-endian bytes), read as
+    //big-endian quadwords, so that other PBKDF2 implementations can recompute the key
+    QByteArray salt = service_name.toUtf8();
+    for(int i = 0; i < 8; ++i) salt.append((char) (nonce >> (56 - 8*i)));
+
+    PBKDF2HMACSHA512 pbkdf2(master_pw.utf8, master_pw.utf8_length);
+    return pbkdf2.derive_qwords(salt.constData(), salt.size(), iterations, key_length, dest_buffer);
+}
+
 QString* ServiceDescriptor::decrypt_password(uint64_t* hashed_key, QString& dest_buffer) {
     //Prepare space for the qword version of the decrypted password
     size_t decrypted_pw_length = encrypted_pw_length;
@@ -455,11 +616,15 @@ QString* ServiceDescriptor::decrypt_password(uint64_t* hashed_key, QString& dest
     }
 
     //Perform decryption
-    uint64_t* decryption_result = cipher_used->decrypt(hashed_key,
-                                                       encrypted_pw_length,
-                                                       encrypted_pw,
-                                                       hash_used,
-                                                       decrypted_pw);
+    uint64_t* decryption_result;
+    {
+        TRACE_SPAN(TRACE_CIPHER);
+        decryption_result = cipher_used->decrypt(hashed_key,
+                                                 encrypted_pw_length,
+                                                 encrypted_pw,
+                                                 hash_used,
+                                                 decrypted_pw);
+    }
     if(!decryption_result) {
         memset((void*) decrypted_pw, 0, decrypted_pw_length*sizeof(uint64_t));
         delete[] decrypted_pw;
@@ -467,17 +632,21 @@ QString* ServiceDescriptor::decrypt_password(uint64_t* hashed_key, QString& dest
     }
 
     //Convert result back to a QString
-    QString* result = qwords_to_raw_str(encrypted_pw_length, decrypted_pw, dest_buffer);
+    QString* result;
+    {
+        TRACE_SPAN(TRACE_STRING_CONVERSION);
+        result = qwords_to_raw_str(encrypted_pw_length, decrypted_pw, dest_buffer);
+    }
     memset((void*) decrypted_pw, 0, decrypted_pw_length*sizeof(uint64_t));
     delete[] decrypted_pw;
     return result;
 }
 
-bool ServiceDescriptor::encrypted_pw_from_qstring(QString& line) {
+bool ServiceDescriptor::encrypted_pw_from_hex(const size_t text_length, const char* text) {
     //Attempt to compute encrypted password length. If it fails, the password is malformed : abort.
-    size_t tmp_encrypted_pw_length = qword_length_hex(line);
+    size_t tmp_encrypted_pw_length = hex_text_qword_length(text_length);
     if(!tmp_encrypted_pw_length) {
-        log_error(SERVICE_DESCRIPTOR_NAME, ERR_BAD_HEX_DATA.arg(line));
+        log_error(SERVICE_DESCRIPTOR_NAME, ERR_BAD_HEX_DATA.arg(QString::fromLatin1(text, text_length)));
         return false;
     }
 
@@ -490,10 +659,10 @@ bool ServiceDescriptor::encrypted_pw_from_qstring(QString& line) {
         return false;
     }
 
-    //Decode encrypted password
-    uint64_t* result = qwords_from_hex_str(line, encrypted_pw);
+    //Decode encrypted password, straight from the descriptor's text
+    uint64_t* result = qwords_from_hex_text(text_length, text, encrypted_pw);
     if(!result) {
-        log_error(SERVICE_DESCRIPTOR_NAME, ERR_BAD_HEX_DATA.arg(line));
+        log_error(SERVICE_DESCRIPTOR_NAME, ERR_BAD_HEX_DATA.arg(QString::fromLatin1(text, text_length)));
         return false;
     }
 
@@ -515,111 +684,91 @@ QString* ServiceDescriptor::generate_password(uint64_t* hashed_key, QString& des
                                              dest_buffer);
 }
 
-bool ServiceDescriptor::parse_service_desc(QTextStream &service_istream) {
+bool ServiceDescriptor::parse_service_desc(ConfigTokenizer &service_tokenizer) {
     bool success;
-    QString line;
-    while(service_istream.atEnd() == false) {
-        //Read and clean up a line of text, ignoring comments
-        line = service_istream.readLine();
-        isolate_content(line);
-        if(line.isEmpty()) continue;
-
-        //Check service name
-        if(has_id(line, ID_SERVICE_NAME)) {
-            remove_id(line, ID_SERVICE_NAME);
-            service_name = line;
-            continue;
-        }
-
-        //Check cryptographic hash
-        if(has_id(line, ID_HASH_USED)) {
-            remove_id(line, ID_HASH_USED);
-            CryptoHash* requested_hash = crypto_hash_database(line);
+    ConfigField field;
+    while(service_tokenizer.next_field(service_desc_keywords, field)) {
+        switch(field.id) {
+          case SERVICE_NAME:
+            service_name = field.to_string();
+            break;
+
+          case HASH_USED: {
+            CryptoHash* requested_hash = crypto_hash_database(field.to_string());
             if(!requested_hash) {
-                log_error(SERVICE_DESCRIPTOR_NAME, ERR_UNSUPPORTED_HASH.arg(line));
+                log_error(SERVICE_DESCRIPTOR_NAME, ERR_UNSUPPORTED_HASH.arg(field.to_string()));
                 return false;
             }
             hash_used = requested_hash;
-            continue;
-        }
+            break;
+          }
 
-        //Check HMAC
-        if(has_id(line, ID_HMAC_USED)) {
-            remove_id(line, ID_HMAC_USED);
-            HMAC* requested_hmac = hmac_database(line);
+          case HMAC_USED: {
+            HMAC* requested_hmac = hmac_database(field.to_string());
             if(!requested_hmac) {
-                log_error(SERVICE_DESCRIPTOR_NAME, ERR_UNSUPPORTED_HMAC.arg(line));
+                log_error(SERVICE_DESCRIPTOR_NAME, ERR_UNSUPPORTED_HMAC.arg(field.to_string()));
                 return false;
             }
             hmac_used = requested_hmac;
-            continue;
-        }
+            break;
+          }
 
-        //Check number of hash iterations
-        if(has_id(line, ID_ITERATIONS)) {
-            remove_id(line, ID_ITERATIONS);
-            iterations = line.toULongLong();
-            continue;
-        }
+          case KEY_DERIVATION: {
+            int requested_derivation = field.to_int();
+            if((requested_derivation != ITERATED_HASH) && (requested_derivation != PBKDF2_HMAC_SHA512)) {
+                log_error(SERVICE_DESCRIPTOR_NAME, ERR_UNSUPPORTED_KEY_DERIVATION.arg(field.to_string()));
+                return false;
+            }
+            key_derivation = (KeyDerivation) requested_derivation;
+            break;
+          }
 
-        //Check hash nonce
-        if(has_id(line, ID_NONCE)) {
-            remove_id(line, ID_NONCE);
-            nonce = line.toULongLong();
-            continue;
-        }
+          case ITERATIONS:
+            iterations = field.to_ulonglong();
+            break;
 
-        //Check password type
-        if(has_id(line, ID_PASSWORD_TYPE)) {
-            remove_id(line, ID_PASSWORD_TYPE);
-            password_type = (PasswordType) line.toInt();
-            continue;
-        }
+          case NONCE:
+            nonce = field.to_ulonglong();
+            break;
 
-        //Check password generator
-        if(has_id(line, ID_GENERATOR_USED)) {
-            remove_id(line, ID_GENERATOR_USED);
-            PasswordGenerator* requested_generator = generator_database(line);
+          case PASSWORD_TYPE:
+            password_type = (PasswordType) field.to_int();
+            break;
+
+          case GENERATOR_USED: {
+            PasswordGenerator* requested_generator = generator_database(field.to_string());
             if(!requested_generator) {
-                log_error(SERVICE_DESCRIPTOR_NAME, ERR_UNSUPPORTED_PW_GEN.arg(line));
+                log_error(SERVICE_DESCRIPTOR_NAME, ERR_UNSUPPORTED_PW_GEN.arg(field.to_string()));
                 return false;
             }
             generator_used = requested_generator;
-            continue;
-        }
+            break;
+          }
 
-        //Check constraints
-        if(has_id(line, ID_CONSTRAINTS)) {
-            success = constraints->parse_constraint_desc(service_istream);
+          case CONSTRAINTS:
+            success = constraints->parse_constraint_desc(service_tokenizer);
             if(!success) return false;
-            continue;
-        }
+            break;
 
-        //Check cached data
-        if(has_id(line, ID_CACHED_DATA)) {
-            success = cached_data->parse_cached_data_desc(service_istream);
+          case CACHED_DATA:
+            success = cached_data->parse_cached_data_desc(service_tokenizer);
             if(!success) return false;
-            continue;
-        }
+            break;
 
-        //Check password cipher
-        if(has_id(line, ID_CIPHER_USED)) {
-            remove_id(line, ID_CIPHER_USED);
-            PasswordCipher* requested_cipher = cipher_database(line);
+          case CIPHER_USED: {
+            PasswordCipher* requested_cipher = cipher_database(field.to_string());
             if(!requested_cipher) {
-                log_error(SERVICE_DESCRIPTOR_NAME, ERR_UNSUPPORTED_CIPHER.arg(line));
+                log_error(SERVICE_DESCRIPTOR_NAME, ERR_UNSUPPORTED_CIPHER.arg(field.to_string()));
                 return false;
             }
             cipher_used = requested_cipher;
-            continue;
-        }
+            break;
+          }
 
-        //Check encrypted password (and its length)
-        if(has_id(line, ID_ENCRYPTED_PW)) {
-            remove_id(line, ID_ENCRYPTED_PW);
-            success = encrypted_pw_from_qstring(line);
+          case ENCRYPTED_PW:
+            success = encrypted_pw_from_hex(field.value_length, field.value);
             if(!success) return false;
-            continue;
+            break;
         }
     }
 
@@ -632,6 +781,8 @@ bool ServiceDescriptor::write_service_desc(QTextStream &service_ostream) {
 
     if(hash_used) service_ostream << ID_HASH_USED << hash_used->name() << endl;
     if(hmac_used) service_ostream << ID_HMAC_USED << hmac_used->name() << endl;
+    //Omitted for iterated hashing, so that older versions still read those descriptors
+    if(key_derivation != ITERATED_HASH) service_ostream << ID_KEY_DERIVATION << (int) key_derivation << endl;
     service_ostream << ID_ITERATIONS << iterations << endl;
     service_ostream << ID_NONCE << nonce << endl << endl;
 
@@ -659,3 +810,41 @@ bool ServiceDescriptor::write_service_desc(QTextStream &service_ostream) {
 
     return true;
 }
+
+bool test_service_descriptors() {
+    static const QString ERR_DERIVATION_ACCEPTED("Key derivation %1 was accepted");
+    static const QString ERR_DERIVATION_REFUSED("Key derivation %1 was refused");
+    static const char DESCRIPTOR_TEMPLATE[] = "\n"
+                                              "\n"
+                                              "service_name : Test\n"
+                                              "\n"
+                                              "key_derivation : %1\n"
+                                              "iterations : 1\n"
+                                              "nonce : 0\n";
+
+    //Supported derivations load, others make the whole descriptor fail
+    const int derivations[] = {ITERATED_HASH, PBKDF2_HMAC_SHA512, 7};
+    const bool supported[] = {true, true, false};
+    for(int i = 0; i < 3; ++i) {
+        QByteArray descriptor_data = (SERVICE_DESCRIPTOR_HEADER + QString(DESCRIPTOR_TEMPLATE).arg(derivations[i])).toUtf8();
+        ConfigTokenizer service_tokenizer(descriptor_data);
+        ServiceDescriptor descriptor;
+        bool loaded = service_tokenizer.read_header(SERVICE_DESCRIPTOR_HEADER) &&
+                      descriptor.parse_service_desc(service_tokenizer);
+        if(loaded != supported[i]) {
+            log_error(SERVICE_DESCRIPTOR_NAME, (loaded ? ERR_DERIVATION_ACCEPTED : ERR_DERIVATION_REFUSED).arg(derivations[i]));
+            return false;
+        }
+    }
+
+    //A descriptor which got an unknown derivation anyway yields no password at all
+    ServiceDescriptor descriptor("Test", 1);
+    descriptor.key_derivation = (KeyDerivation) 7;
+    QString password;
+    if(descriptor.compute_password(QString("master"), password)) {
+        log_error(SERVICE_DESCRIPTOR_NAME, ERR_DERIVATION_ACCEPTED.arg(7));
+        return false;
+    }
+
+    return true;
+}
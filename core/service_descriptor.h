@@ -28,10 +28,30 @@
 
 #include <crypto_hash.h>
 #include <hmac.h>
+#include <parsing_tools.h>
 #include <password_cipher.h>
 #include <password_generator.h>
 
 enum PasswordType {GENERATED = 0, ENCRYPTED};
+//Key stretching : hash^iterations(HMAC(master password, service name + nonce)), with the service's
+//hash and HMAC, or standard PBKDF2-HMAC-SHA512 which other tools can reproduce (see pbkdf2.h)
+enum KeyDerivation {ITERATED_HASH = 0, PBKDF2_HMAC_SHA512};
+
+//Master password in qword form, so that it is only converted once when computing the passwords of
+//many services, along with its UTF-8 bytes for PBKDF2. Wiped on destruction.
+struct QwordPassword {
+  public:
+    size_t length;
+    uint64_t* qwords; //NULL if allocation failed
+    size_t utf8_length;
+    char* utf8; //NULL if allocation failed
+
+    QwordPassword(const QString& password);
+    ~QwordPassword();
+  private:
+    QwordPassword(const QwordPassword&);
+    QwordPassword& operator=(const QwordPassword&);
+};
 
 struct ServiceDescriptor {
   public:
@@ -41,6 +61,7 @@ struct ServiceDescriptor {
     //Hashed key generation parameters
     CryptoHash* hash_used;
     HMAC* hmac_used;
+    KeyDerivation key_derivation;
     uint64_t iterations;
     uint64_t nonce;
 
@@ -69,33 +90,48 @@ struct ServiceDescriptor {
     //Computes the service password, given a master password
     QString* compute_password(const QString& master_pw,
                               QString& dest_buffer);
+    QString* compute_password(const QwordPassword& master_pw,
+                              QString& dest_buffer);
 
     //Encrypt a service password and store it in encrypted_password. Switch to encryption mode.
+    //Bulk imports leave the stretched key cache alone (cache_key = false), since they would only
+    //evict the keys of services which are actually in use.
     bool encrypt_password(const QString& master_pw,
                           const QString& service_pw);
+    bool encrypt_password(const QwordPassword& master_pw,
+                          const QString& service_pw,
+                          const bool cache_key = true);
 
     //Load and save services from "descriptor files"
     bool load_from_file(const QString& descriptor_filepath);
     bool save_to_file(const QString& descriptor_filepath);
+    QString* save_to_string(QString& dest_buffer); //Same format as descriptor files
 
     //Reinitialize the service descriptor to its initial password-generating state.
     void reset(const QString& initial_name, const uint64_t default_iterations);
   private:
     QFile* service_file;
 
-    uint64_t* compute_hashed_key(const QString& master_pw,
+    uint64_t* compute_hashed_key(const QwordPassword& master_pw,
                                  uint64_t* dest_buffer,
-                                 bool benchmark_mode = false);
-    uint64_t* compute_initial_key(const QString& master_pw,
+                                 bool benchmark_mode = false,
+                                 bool cache_key = true);
+    uint64_t* compute_initial_key(const QwordPassword& master_pw,
                                   size_t service_nonce_length,
                                   uint64_t* service_nonce,
                                   uint64_t* dest_buffer);
+    uint64_t* compute_pbkdf2_key(const QwordPassword& master_pw,
+                                 size_t key_length,
+                                 uint64_t* dest_buffer);
     QString* decrypt_password(uint64_t* hashed_key, QString& dest_buffer);
-    bool encrypted_pw_from_qstring(QString& line);
+    bool encrypted_pw_from_hex(const size_t text_length, const char* text);
     bool encrypted_pw_to_qstring(QString& line);
     QString* generate_password(uint64_t* hashed_key, QString& dest_buffer);
-    bool parse_service_desc(QTextStream &service_istream);
+    bool parse_service_desc(ConfigTokenizer &service_tokenizer);
     bool write_service_desc(QTextStream &service_ostream);
+    friend bool test_service_descriptors();
 };
 
+bool test_service_descriptors(); //Check that descriptors with an unknown key derivation are refused
+
 #endif // SERVICE_DESCRIPTOR_H
@@ -0,0 +1,426 @@
+/* Service import : reads credentials out of other password managers' exports (CSV, KeePass XML)
+   and encrypts them in parallel, so that legacy passwords can be moved to Hashish in bulk.
+
+      Copyright (C) 2011  Hadrien Grasland
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA */
+
+#include <QBuffer>
+#include <QLatin1String>
+#include <QRunnable>
+#include <string.h>
+
+#include <error_management.h>
+#include <service_import.h>
+
+const QString SERVICE_IMPORT_NAME("ServiceImport");
+
+const QString CSV_FORMAT("csv");
+const QString KEEPASS_XML_FORMAT("keepass-xml");
+
+//Header names of the CSV columns which are used, lowercase
+const char* const CSV_NAME_COLUMNS[] = {"title", "name", "account", "service"};
+const char* const CSV_PASSWORD_COLUMNS[] = {"password", "login_password"};
+const char* const CSV_URL_COLUMNS[] = {"url", "login_uri", "web site"};
+
+CredentialReader* new_credential_reader(const QString& format, QIODevice* input) {
+    CredentialReader* reader = NULL;
+    if(format == CSV_FORMAT) reader = new CSVCredentialReader(input);
+    if(format == KEEPASS_XML_FORMAT) reader = new KeePassXMLCredentialReader(input);
+    if(!reader && (format == CSV_FORMAT || format == KEEPASS_XML_FORMAT)) {
+        log_error(SERVICE_IMPORT_NAME, ERR_BAD_ALLOC.arg(QString("reader")));
+    }
+
+    return reader;
+}
+
+QString credential_format(const QString& file_path) {
+    if(file_path.endsWith(".csv", Qt::CaseInsensitive)) return CSV_FORMAT;
+    if(file_path.endsWith(".xml", Qt::CaseInsensitive)) return KEEPASS_XML_FORMAT;
+    return QString();
+}
+
+int find_column(const QStringList& header, const char* const* column_names, const size_t name_count) {
+    for(int i = 0; i < header.count(); ++i) {
+        QString column = header.at(i).trimmed().toLower();
+        for(size_t j = 0; j < name_count; ++j) {
+            if(column == QLatin1String(column_names[j])) return i;
+        }
+    }
+
+    return -1;
+}
+
+CSVCredentialReader::CSVCredentialReader(QIODevice* input) : input(input),
+                                                             header_read(false),
+                                                             name_column(-1),
+                                                             password_column(-1),
+                                                             url_column(-1) {}
+
+bool CSVCredentialReader::read_next(ImportedCredential& dest) {
+    QStringList fields;
+    if(!header_read) {
+        static const QString ERR_NO_CSV_COLUMNS("The CSV header has no service name or no password column");
+        if(!read_record(fields)) return false;
+        if(!fields.isEmpty() && fields[0].startsWith(QChar(0xfeff))) fields[0].remove(0, 1); //UTF-8 byte order mark
+        name_column = find_column(fields, CSV_NAME_COLUMNS, sizeof(CSV_NAME_COLUMNS)/sizeof(char*));
+        password_column = find_column(fields, CSV_PASSWORD_COLUMNS, sizeof(CSV_PASSWORD_COLUMNS)/sizeof(char*));
+        url_column = find_column(fields, CSV_URL_COLUMNS, sizeof(CSV_URL_COLUMNS)/sizeof(char*));
+        if((password_column == -1) || ((name_column == -1) && (url_column == -1))) {
+            error_message = ERR_NO_CSV_COLUMNS;
+            return false;
+        }
+        header_read = true;
+    }
+
+    while(read_record(fields)) {
+        if((fields.count() == 1) && fields[0].isEmpty()) continue; //Blank line
+
+        dest.service_name = fields.value(name_column).trimmed();
+        if(dest.service_name.isEmpty()) dest.service_name = fields.value(url_column).trimmed();
+        dest.password = fields.value(password_column);
+        for(int i = 0; i < fields.count(); ++i) fields[i].clear();
+        return true;
+    }
+
+    return false;
+}
+
+bool CSVCredentialReader::read_record(QStringList& fields) {
+    static const QString ERR_UNTERMINATED_QUOTE("The last CSV record has an unterminated quoted field");
+    fields.clear();
+    QByteArray line = input->readLine();
+    if(line.isEmpty()) return false;
+
+    //Fields are gathered as bytes, and decoded once complete
+    QByteArray field;
+    bool quoted = false;
+    int i = 0;
+    for(;;) {
+        if(i == line.size()) {
+            if(!quoted) break;
+
+            //The line break belongs to a quoted field, which goes on on the next line
+            memset((void*) line.data(), 0, line.size());
+            line = input->readLine();
+            if(line.isEmpty()) {
+                memset((void*) field.data(), 0, field.size());
+                error_message = ERR_UNTERMINATED_QUOTE;
+                return false;
+            }
+            i = 0;
+        }
+
+        char c = line.at(i++);
+        if(quoted) {
+            if(c != '"') {
+                field.append(c);
+            } else if((i < line.size()) && (line.at(i) == '"')) {
+                field.append(c); //Escaped quote
+                ++i;
+            } else {
+                quoted = false;
+            }
+            continue;
+        }
+        switch(c) {
+          case '"':
+            quoted = true;
+            break;
+          case ',':
+            fields.append(QString::fromUtf8(field.constData(), field.size()));
+            memset((void*) field.data(), 0, field.size());
+            field.clear();
+            break;
+          case '\r':
+          case '\n':
+            break;
+          default:
+            field.append(c);
+        }
+    }
+    fields.append(QString::fromUtf8(field.constData(), field.size()));
+
+    memset((void*) field.data(), 0, field.size());
+    memset((void*) line.data(), 0, line.size());
+    return true;
+}
+
+KeePassXMLCredentialReader::KeePassXMLCredentialReader(QIODevice* input) : xml(input) {}
+
+bool KeePassXMLCredentialReader::read_next(ImportedCredential& dest) {
+    //KeePass 2 and KeePassX use the same structure, with different element names
+    while(!xml.atEnd()) {
+        xml.readNext();
+        if(xml.isEndElement()) {
+            if((xml.name() == QLatin1String("Group")) || (xml.name() == QLatin1String("group"))) {
+                if(!recycled_groups.isEmpty()) recycled_groups.removeLast();
+            }
+            continue;
+        }
+        if(!xml.isStartElement()) continue;
+
+        if(xml.name() == QLatin1String("RecycleBinUUID")) {
+            recycle_bin_uuid = xml.readElementText();
+        } else if((xml.name() == QLatin1String("Group")) || (xml.name() == QLatin1String("group"))) {
+            //Subgroups of the recycle bin are recycled too
+            recycled_groups.append(!recycled_groups.isEmpty() && recycled_groups.last());
+        } else if((xml.name() == QLatin1String("UUID")) && !recycled_groups.isEmpty()) {
+            //Entries are read whole below, so this is the UUID of the current group
+            if(!recycle_bin_uuid.isEmpty() && (xml.readElementText() == recycle_bin_uuid)) recycled_groups.last() = true;
+        } else if((xml.name() == QLatin1String("Entry")) || (xml.name() == QLatin1String("entry"))) {
+            bool recycled = !recycled_groups.isEmpty() && recycled_groups.last();
+            bool success;
+            if(xml.name() == QLatin1String("Entry")) {
+                success = read_keepass2_entry(dest);
+            } else {
+                success = read_keepassx_entry(dest);
+            }
+            if(!success) break;
+            if(recycled) {
+                dest.clear();
+                continue;
+            }
+            return true;
+        }
+    }
+
+    if(xml.hasError() && error_message.isEmpty()) {
+        static const QString ERR_BAD_XML("Line %1 of the XML export : %2");
+        error_message = ERR_BAD_XML.arg(xml.lineNumber()).arg(xml.errorString());
+    }
+    return false;
+}
+
+bool KeePassXMLCredentialReader::read_keepass2_entry(ImportedCredential& dest) {
+    //Fields are <String><Key>Title</Key><Value>...</Value></String> elements. Former versions of
+    //the entry, in <History>, are skipped along with other elements.
+    static const QString ERR_PROTECTED_VALUE("The XML export contains encrypted values, which KeePass only writes in its own database files");
+    dest.clear();
+    QString url;
+    while(xml.readNextStartElement()) {
+        if(xml.name() != QLatin1String("String")) {
+            xml.skipCurrentElement();
+            continue;
+        }
+
+        QString key, value;
+        while(xml.readNextStartElement()) {
+            if(xml.name() == QLatin1String("Key")) {
+                key = xml.readElementText();
+            } else if(xml.name() == QLatin1String("Value")) {
+                if(xml.attributes().value("Protected") == QLatin1String("True")) {
+                    error_message = ERR_PROTECTED_VALUE;
+                    return false;
+                }
+                value = xml.readElementText();
+            } else {
+                xml.skipCurrentElement();
+            }
+        }
+        if(key == QLatin1String("Title")) dest.service_name = value.trimmed();
+        if(key == QLatin1String("Password")) dest.password = value;
+        if(key == QLatin1String("URL")) url = value.trimmed();
+        value.clear();
+    }
+    if(xml.hasError()) return false;
+
+    if(dest.service_name.isEmpty()) dest.service_name = url;
+    return true;
+}
+
+bool KeePassXMLCredentialReader::read_keepassx_entry(ImportedCredential& dest) {
+    //Fields are elements of their own : <title>, <password>, <url>...
+    dest.clear();
+    QString url;
+    while(xml.readNextStartElement()) {
+        if(xml.name() == QLatin1String("title")) {
+            dest.service_name = xml.readElementText().trimmed();
+        } else if(xml.name() == QLatin1String("password")) {
+            dest.password = xml.readElementText();
+        } else if(xml.name() == QLatin1String("url")) {
+            url = xml.readElementText().trimmed();
+        } else {
+            xml.skipCurrentElement();
+        }
+    }
+    if(xml.hasError()) return false;
+
+    if(dest.service_name.isEmpty()) dest.service_name = url;
+    return true;
+}
+
+//Encrypts the password of one imported service and writes its descriptor. The service outlives it.
+class ImportJob : public QRunnable {
+  public:
+    ImportJob(const QwordPassword& master_pw,
+              const ServiceDescriptor& prototype,
+              ImportedService& service,
+              const QString& password,
+              const QString& descriptor_filepath,
+              QSemaphore& free_slots) : master_pw(master_pw),
+                                        prototype(prototype),
+                                        service(service),
+                                        password(password),
+                                        descriptor_filepath(descriptor_filepath),
+                                        free_slots(free_slots) {
+        setAutoDelete(true);
+    }
+    void run() {
+        ServiceDescriptor descriptor(prototype);
+        descriptor.service_name = service.service_name;
+        service.saved = descriptor.encrypt_password(master_pw, password, false) &&
+                        descriptor.save_to_file(descriptor_filepath);
+        password.fill(QChar(0));
+        password.clear();
+        free_slots.release();
+    }
+  private:
+    const QwordPassword& master_pw;
+    const ServiceDescriptor& prototype;
+    ImportedService& service;
+    QString password;
+    QString descriptor_filepath;
+    QSemaphore& free_slots;
+};
+
+ImportBatch::ImportBatch(const QString& master_password,
+                         const ServiceDescriptor& prototype) : master_pw(master_password),
+                                                               prototype(prototype),
+                                                               free_slots(IMPORT_PENDING_RECORDS) {}
+
+ImportBatch::~ImportBatch() {
+    wait();
+    while(services.isEmpty() == false) delete services.takeFirst();
+}
+
+bool ImportBatch::add(const ImportedCredential& credential, const QString& descriptor_filepath) {
+    if(!master_pw.qwords) return false;
+
+    //Wait until one of the pending passwords has been encrypted
+    free_slots.acquire();
+
+    ImportedService* service = new ImportedService;
+    if(!service) {
+        log_error(SERVICE_IMPORT_NAME, ERR_BAD_ALLOC.arg(QString("service")));
+        free_slots.release();
+        return false;
+    }
+    service->service_name = credential.service_name;
+    service->saved = false;
+    services.append(service);
+
+    ImportJob* job = new ImportJob(master_pw, prototype, *service, credential.password, descriptor_filepath, free_slots);
+    if(!job) {
+        log_error(SERVICE_IMPORT_NAME, ERR_BAD_ALLOC.arg(QString("job")));
+        free_slots.release();
+        return false;
+    }
+    workers.start(job);
+
+    return true;
+}
+
+void ImportBatch::wait() {
+    workers.waitForDone();
+}
+
+bool ImportBatch::saved(const int index) const {
+    return services.at(index)->saved;
+}
+
+bool check_credentials(const QString& format, const QByteArray& data, const char* const* expected, const int expected_count) {
+    static const QString ERR_CREDENTIAL_MISMATCH("%1 reader : got credential %2, expected %3");
+    static const QString ERR_CREDENTIAL_COUNT("%1 reader : got %2 credentials, expected %3");
+    static const QString ERR_READER_FAILED("%1 reader : %2");
+    QByteArray input_data = data;
+    QBuffer input(&input_data);
+    input.open(QIODevice::ReadOnly);
+    CredentialReader* reader = new_credential_reader(format, &input);
+    if(!reader) return false;
+
+    //Expected credentials are "name" then "password"
+    ImportedCredential credential;
+    int count = 0;
+    bool success = true;
+    while(success && reader->read_next(credential)) {
+        QString got = credential.service_name + '/' + credential.password;
+        if(count < expected_count) {
+            QString expected_credential = QString::fromUtf8(expected[2*count]) + '/' + QString::fromUtf8(expected[2*count+1]);
+            if(got != expected_credential) {
+                log_error(SERVICE_IMPORT_NAME, ERR_CREDENTIAL_MISMATCH.arg(format).arg(got).arg(expected_credential));
+                success = false;
+            }
+        }
+        ++count;
+    }
+    if(success && !reader->error().isEmpty()) {
+        log_error(SERVICE_IMPORT_NAME, ERR_READER_FAILED.arg(format).arg(reader->error()));
+        success = false;
+    }
+    if(success && (count != expected_count)) {
+        log_error(SERVICE_IMPORT_NAME, ERR_CREDENTIAL_COUNT.arg(format).arg(count).arg(expected_count));
+        success = false;
+    }
+
+    delete reader;
+    return success;
+}
+
+bool test_credential_readers() {
+    //Quoting, line breaks in fields, a byte order mark, CRLF line ends, a blank line and a missing
+    //name which falls back to the URL
+    static const char CSV_EXPORT[] = "\xef\xbb\xbf\"Group\",\"Title\",\"Username\",\"Password\",\"URL\"\r\n"
+                                     "\"Root\",\"Mail\",\"me\",\"p,a\"\"ss\",\"https://mail.example.com\"\r\n"
+                                     "\r\n"
+                                     "Root,Bank,me,\"multi\nline\",\r\n"
+                                     "Root,,me,caf\xc3\xa9,https://example.org\r\n";
+    static const char* const CSV_EXPECTED[] = {"Mail", "p,a\"ss",
+                                               "Bank", "multi\nline",
+                                               "https://example.org", "caf\xc3\xa9"};
+
+    //History and the recycle bin are left out, entities are decoded
+    static const char KEEPASS2_EXPORT[] = "<?xml version=\"1.0\" encoding=\"utf-8\" standalone=\"yes\"?>\n"
+                                          "<KeePassFile><Meta><RecycleBinUUID>cmVjeWNsZWQ=</RecycleBinUUID></Meta><Root>\n"
+                                          " <Group><UUID>cm9vdA==</UUID><Name>Root</Name>\n"
+                                          "  <Entry><UUID>ZW50cnk=</UUID>\n"
+                                          "   <String><Key>Title</Key><Value>Forum</Value></String>\n"
+                                          "   <String><Key>Password</Key><Value ProtectInMemory=\"True\">a&lt;b&amp;c</Value></String>\n"
+                                          "   <History><Entry><String><Key>Title</Key><Value>Old forum</Value></String></Entry></History>\n"
+                                          "  </Entry>\n"
+                                          "  <Group><UUID>cmVjeWNsZWQ=</UUID><Name>Recycle Bin</Name>\n"
+                                          "   <Entry><String><Key>Title</Key><Value>Deleted</Value></String></Entry>\n"
+                                          "  </Group>\n"
+                                          "  <Entry><String><Key>URL</Key><Value>https://shop.example.com</Value></String>\n"
+                                          "   <String><Key>Password</Key><Value>s3cret</Value></String></Entry>\n"
+                                          " </Group><DeletedObjects><DeletedObject><UUID>cmVjeWNsZWQ=</UUID></DeletedObject></DeletedObjects>\n"
+                                          "</Root></KeePassFile>\n";
+    static const char* const KEEPASS2_EXPECTED[] = {"Forum", "a<b&c",
+                                                    "https://shop.example.com", "s3cret"};
+
+    static const char KEEPASSX_EXPORT[] = "<!DOCTYPE KEEPASSX_DATABASE>\n"
+                                          "<database><group><title>Internet</title>\n"
+                                          " <entry><title>Wiki</title><username>me</username><password>w1k1</password></entry>\n"
+                                          " <group><title>Games</title><entry><title>Chess</title><password>e4e5</password></entry></group>\n"
+                                          "</group></database>\n";
+    static const char* const KEEPASSX_EXPECTED[] = {"Wiki", "w1k1",
+                                                    "Chess", "e4e5"};
+
+    if(!check_credentials(CSV_FORMAT, QByteArray(CSV_EXPORT), CSV_EXPECTED, 3)) return false;
+    if(!check_credentials(KEEPASS_XML_FORMAT, QByteArray(KEEPASS2_EXPORT), KEEPASS2_EXPECTED, 2)) return false;
+    if(!check_credentials(KEEPASS_XML_FORMAT, QByteArray(KEEPASSX_EXPORT), KEEPASSX_EXPECTED, 2)) return false;
+
+    return true;
+}
@@ -0,0 +1,120 @@
+/* Service import : reads credentials out of other password managers' exports (CSV, KeePass XML)
+   and encrypts them in parallel, so that legacy passwords can be moved to Hashish in bulk.
+
+      Copyright (C) 2011  Hadrien Grasland
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA */
+
+#ifndef SERVICE_IMPORT_H
+#define SERVICE_IMPORT_H
+
+#include <QIODevice>
+#include <QList>
+#include <QSemaphore>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+#include <QXmlStreamReader>
+
+#include <service_descriptor.h>
+
+#define IMPORT_PENDING_RECORDS 256 //Credentials read ahead of the encryption threads, at most
+
+//One credential of an export
+struct ImportedCredential {
+    QString service_name;
+    QString password;
+    void clear() {service_name.clear(); password.clear();}
+};
+
+//Reads credentials one at a time, so that exports are never loaded whole
+class CredentialReader {
+  public:
+    virtual ~CredentialReader() {}
+    virtual bool read_next(ImportedCredential& dest) = 0; //False at the end of the input, or on errors
+    const QString& error() const {return error_message;} //Empty unless reading stopped on an error
+  protected:
+    QString error_message;
+};
+CredentialReader* new_credential_reader(const QString& format, QIODevice* input); //NULL for unknown formats
+QString credential_format(const QString& file_path); //Guessed from the extension, empty if unknown
+bool test_credential_readers(); //Check both readers on small exports
+
+//CSV with a header line (RFC 4180 quoting), as exported by KeePass, KeePassX and web browsers.
+//Services are named after the first column called "title", "name", "account" or "service", or
+//else after the "url" column. Passwords come from the "password" or "login_password" column.
+class CSVCredentialReader : public CredentialReader {
+  public:
+    CSVCredentialReader(QIODevice* input);
+    bool read_next(ImportedCredential& dest);
+  private:
+    QIODevice* input;
+    bool header_read;
+    int name_column;
+    int password_column;
+    int url_column;
+
+    bool read_record(QStringList& fields); //One line, or more if quoted fields contain line breaks
+};
+
+//KeePass 2 XML exports (<KeePassFile>), and KeePassX XML exports (<database>). Entry titles name
+//services, or else their URL. Entry history and the recycle bin are left out.
+class KeePassXMLCredentialReader : public CredentialReader {
+  public:
+    KeePassXMLCredentialReader(QIODevice* input);
+    bool read_next(ImportedCredential& dest);
+  private:
+    QXmlStreamReader xml;
+    QString recycle_bin_uuid;
+    QList<bool> recycled_groups; //One flag per open group
+
+    bool read_keepass2_entry(ImportedCredential& dest);
+    bool read_keepassx_entry(ImportedCredential& dest);
+};
+
+//Outcome of an import, for reporting
+struct ImportReport {
+    int imported;
+    QStringList skipped; //One line per record which did not become a service, with the reason
+};
+
+//Service of an import, whose descriptor is being encrypted and written
+struct ImportedService {
+    QString service_name;
+    bool saved;
+};
+
+//Encrypts the passwords of imported services on a thread pool, while the export is still being
+//read, and writes each descriptor file as soon as its password is encrypted. add() blocks while
+//IMPORT_PENDING_RECORDS passwords are waiting, and only service names are kept afterwards. The
+//master password is converted once for the whole import, and stretched keys are not cached.
+class ImportBatch {
+  public:
+    ImportBatch(const QString& master_password, const ServiceDescriptor& prototype);
+    ~ImportBatch(); //Waits for running encryptions, then wipes the master password
+    bool add(const ImportedCredential& credential, const QString& descriptor_filepath);
+    void wait(); //Returns once every added descriptor has been written or has failed
+    int count() const {return services.count();}
+    bool saved(const int index) const; //Call wait() first
+    const QString& service_name(const int index) const {return services.at(index)->service_name;}
+  private:
+    QwordPassword master_pw;
+    ServiceDescriptor prototype; //Every service starts as a copy of it
+    QList<ImportedService*> services;
+    QSemaphore free_slots;
+    QThreadPool workers; //One thread per core by default
+};
+
+#endif // SERVICE_IMPORT_H
@@ -0,0 +1,1215 @@
+/* Service manager : this QObject is the back-end of Hashish.
+   It loads, save, and manages services, computes passwords, etc...
+
+      Copyright (C) 2011  Hadrien Grasland
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA */
+
+#include <QCoreApplication>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QTimer>
+
+#include <crypto_hash.h>
+#include <error_management.h>
+#include <hmac.h>
+#include <key_cache.h>
+#include <parsing_tools.h>
+#include <password_cipher.h>
+#include <password_generator.h>
+#include <service_descriptor.h>
+#include <service_manager.h>
+#include <stdlib.h>
+
+const QString SERVICE_MANAGER_NAME("ServiceManager");
+
+const size_t DEFAULT_LATENCY = 50; //Default acceptable password generation latency in ms
+
+const QString ERROR_LOG_FILENAME("error_log.txt");
+
+const QString HASHISH_SOCKET_NAME("hashish_command_stream_%1"); //First argument is the user name
+const QByteArray LOCK_REQUEST("0 LOCK\n"); //See command_server.h for the protocol
+const QByteArray SHOW_REQUEST("0 SHOW\n");
+
+const QString ID_FILENAME("file_name : ");
+const QString ID_ITERATIONS("default_iterations : ");
+const QString ID_KEY_CACHE_TTL("key_cache_ttl : ");
+const QString ID_LATENCY("acceptable_latency : ");
+const QString ID_PBKDF2_ITERATIONS("default_pbkdf2_iterations : ");
+const QString ID_SERVICE("service : ");
+
+//Identifiers of the service database and settings files, in dispatch order
+enum ServiceDatabaseID {SERVICE = 0, FILENAME};
+const QString* const SERVICE_DB_IDS[] = {&ID_SERVICE, &ID_FILENAME};
+const KeywordTable service_db_keywords(SERVICE_DB_IDS, sizeof(SERVICE_DB_IDS)/sizeof(QString*));
+enum SettingsID {LATENCY = 0, ITERATIONS, PBKDF2_ITERATIONS, KEY_CACHE_TTL};
+const QString* const SETTINGS_IDS[] = {&ID_LATENCY, &ID_ITERATIONS, &ID_PBKDF2_ITERATIONS, &ID_KEY_CACHE_TTL};
+const KeywordTable settings_keywords(SETTINGS_IDS, sizeof(SETTINGS_IDS)/sizeof(QString*));
+
+const QString SERVICE_DATABASE_FILENAME("service_database.txt");
+
+const QString SERVICE_DATABASE_HEADER("*** Hashish service database v1 ***");
+
+const QString SELF_TEST_CACHE_FILENAME("self_test_cache.txt");
+
+const QString SERVICE_DIRECTORY_FILENAME("services");
+
+const QString SETTINGS_FILENAME("settings.txt");
+
+const QString SETTINGS_HEADER("*** Hashish settings v1 ***");
+
+bool is_service_filename(const QString& filename) {
+    //Hidden files, and the backups which ServiceDescriptor::save_to_file() leaves behind when it is
+    //interrupted, do not describe services
+    return !filename.startsWith('.') && !filename.endsWith('~');
+}
+
+uint64_t benchmark_key_derivation(const KeyDerivation key_derivation, const uint64_t latency) {
+    ServiceDescriptor tmp_desc;
+    tmp_desc.key_derivation = key_derivation;
+    return tmp_desc.benchmark_iterations(latency);
+}
+
+ServiceManager::ServiceManager(InstanceMode mode,
+                               const QString& data_location) : app_data_dir(NULL),
+                                                               command_server(NULL),
+                                                               key_cache_timer(NULL),
+                                                               key_cache_ttl(0),
+                                                               owns_error_output(false),
+                                                               self_test_thread(NULL),
+                                                               service_dir(NULL),
+                                                               store_reload_timer(NULL),
+                                                               store_watcher(NULL),
+                                                               tests_done(false),
+                                                               tests_passed(false),
+                                                               to_delete(NULL) {
+    start_ipc(mode);
+    if(running_instance_found && (mode != CLIENT_INSTANCE)) return;
+    open_application_data_directory(data_location);
+    open_error_output();
+    read_settings();
+    if(mode != CLIENT_INSTANCE) apply_key_cache_ttl();
+    open_service_directory();
+    read_service_database();
+    if(mode != CLIENT_INSTANCE) watch_store();
+}
+
+ServiceManager::~ServiceManager() {
+    if(self_test_thread) self_test_thread->wait();
+    stop_ipc();
+    stretched_key_cache.lock();
+    close_error_output();
+    password_buffer.clear();
+}
+
+bool ServiceManager::copy_service(const QString& service_name, ServiceDescriptor& dest_buffer) {
+    if(service_filenames.contains(service_name) == false) return false;
+
+    //Use the service cache when possible, but do not evict entries which the UI may be editing
+    ServiceDescriptorCache* cache_entry = find_in_cache(service_filenames[service_name]);
+    if(cache_entry) {
+        dest_buffer = cache_entry->descriptor;
+        return true;
+    }
+    return dest_buffer.load_from_file(service_dir->filePath(service_filenames[service_name]));
+}
+
+bool ServiceManager::create_snapshot(const QString& snapshot_location,
+                                     const QString& password,
+                                     const bool full,
+                                     SnapshotReport& report) {
+    //Archives are keyed like PBKDF2 services, so that opening one takes the same time
+    return ::create_snapshot(*app_data_dir,
+                             store_paths(),
+                             QDir(snapshot_location),
+                             password,
+                             current_iterations(PBKDF2_HMAC_SHA512),
+                             full,
+                             report);
+}
+
+QString ServiceManager::default_data_location() {
+    //Mirror QDesktopServices::storageLocation(QDesktopServices::DataLocation), which is part of
+    //QtGui, so that every front-end uses the same data
+    QString data_location;
+    #if defined(Q_OS_WIN32)
+        data_location = QString::fromLocal8Bit(getenv("LOCALAPPDATA"));
+        if(data_location.isEmpty()) data_location = QString::fromLocal8Bit(getenv("APPDATA"));
+    #elif defined(Q_OS_MAC)
+        data_location = QDir::homePath() + "/Library/Application Support";
+    #else
+        data_location = QString::fromLocal8Bit(getenv("XDG_DATA_HOME"));
+        if(data_location.isEmpty()) data_location = QDir::homePath() + "/.local/share";
+        data_location += "/data";
+    #endif
+    if(!QCoreApplication::organizationName().isEmpty()) {
+        data_location += '/' + QCoreApplication::organizationName();
+    }
+    if(!QCoreApplication::applicationName().isEmpty()) {
+        data_location += '/' + QCoreApplication::applicationName();
+    }
+
+    return QDir::cleanPath(data_location);
+}
+
+bool ServiceManager::import_services(CredentialReader& reader,
+                                     const QString& master_password,
+                                     const KeyDerivation key_derivation,
+                                     ImportReport& report) {
+    static const QString SKIPPED_NO_NAME("Record %1 : no service name");
+    static const QString SKIPPED_NO_PASSWORD("Record %1 (%2) : no password");
+    static const QString SKIPPED_EXISTING("Record %1 (%2) : a service with this name already exists");
+    report.imported = 0;
+    report.skipped.clear();
+
+    //Filenames are picked from a single listing of the service directory, instead of probing it
+    //once per service
+    QHash<QString, bool> taken_filenames;
+    QStringList service_dir_contents = service_dir->entryList();
+    for(int i = 0; i < service_dir_contents.count(); ++i) taken_filenames.insert(service_dir_contents[i], true);
+    QStringList new_filenames;
+    QString filename;
+    uint64_t file_number = 0;
+
+    //Descriptors are encrypted and written in the background while the rest of the export is being
+    //read
+    ServiceDescriptor prototype("", current_iterations(key_derivation));
+    prototype.key_derivation = key_derivation;
+    ImportBatch batch(master_password, prototype);
+    QHash<QString, bool> imported_names; //Lowercase, since service names are unique regardless of case
+    ImportedCredential credential;
+    bool success = true;
+    for(int record = 1; success && reader.read_next(credential); ++record) {
+        QString lowercase_name = credential.service_name.toLower();
+        if(credential.service_name.isEmpty()) {
+            report.skipped.append(SKIPPED_NO_NAME.arg(record));
+        } else if(credential.password.isEmpty()) {
+            report.skipped.append(SKIPPED_NO_PASSWORD.arg(record).arg(credential.service_name));
+        } else if(imported_names.contains(lowercase_name) || service_name_taken(credential.service_name)) {
+            report.skipped.append(SKIPPED_EXISTING.arg(record).arg(credential.service_name));
+        } else {
+            imported_names.insert(lowercase_name, true);
+            do {
+                filename.setNum(++file_number);
+                filename.append(".txt");
+            } while(taken_filenames.contains(filename));
+            new_filenames.append(filename);
+            success = batch.add(credential, service_dir->filePath(filename));
+        }
+        credential.clear();
+    }
+    batch.wait();
+    if(!reader.error().isEmpty()) {
+        log_error(SERVICE_MANAGER_NAME, reader.error());
+        success = false;
+    }
+    for(int i = 0; success && (i < batch.count()); ++i) success = batch.saved(i);
+    if(!success) {
+        for(int i = 0; i < new_filenames.count(); ++i) service_dir->remove(new_filenames[i]);
+        return false;
+    }
+
+    //Once every descriptor is written, update the index, the list models and the service database
+    //once for the whole import
+    for(int i = 0; i < batch.count(); ++i) {
+        const QString& service_name = batch.service_name(i);
+        service_name_list.append(service_name);
+        service_filenames[service_name] = new_filenames[i];
+    }
+    case_insensitive_sort(service_name_list);
+    if(!generate_service_database()) {
+        for(int i = 0; i < batch.count(); ++i) {
+            const QString& service_name = batch.service_name(i);
+            service_name_list.removeAt(case_insensitive_find(service_name_list, service_name));
+            service_filenames.remove(service_name);
+            service_dir->remove(new_filenames[i]);
+        }
+        return false;
+    }
+    emit service_index_reset();
+
+    report.imported = batch.count();
+    return true;
+}
+
+bool ServiceManager::lock_running_instance() {
+    //Only the instance which serves requests can have cached keys
+    QLocalSocket client_socket(this);
+    client_socket.connectToServer(socket_name());
+    if(!client_socket.waitForConnected(100)) return false;
+    client_socket.write(LOCK_REQUEST);
+    bool success = client_socket.waitForBytesWritten(100);
+    client_socket.disconnectFromServer();
+
+    return success;
+}
+
+bool ServiceManager::restore_snapshot(const QString& snapshot_location,
+                                      const uint64_t number,
+                                      const QString& password,
+                                      SnapshotReport& report) {
+    bool success = ::restore_snapshot(QDir(snapshot_location), number, password, app_data_dir, store_paths(), report);
+    if(!success) return false;
+
+    //Reload the restored store, forgetting cached descriptors
+    for(int i = 0; i < CACHE_SIZE; ++i) {
+        cached_services[i].service_filename.clear();
+        cached_services[i].last_used = 0;
+    }
+    delete settings_file;
+    delete service_db_file;
+    if(!read_settings()) return false;
+    if(!read_service_database()) return false;
+    if(store_watcher) return stamp_service_files();
+    return true;
+}
+
+bool ServiceManager::set_current_latency(uint64_t new_latency) {
+    uint64_t tmp_iterations = benchmark_key_derivation(ITERATED_HASH, new_latency);
+    if(!tmp_iterations) return false;
+    uint64_t tmp_pbkdf2_iterations = benchmark_key_derivation(PBKDF2_HMAC_SHA512, new_latency);
+    if(!tmp_pbkdf2_iterations) return false;
+
+    acceptable_latency = new_latency;
+    default_iterations = tmp_iterations;
+    default_pbkdf2_iterations = tmp_pbkdf2_iterations;
+    return generate_settings();
+}
+
+bool ServiceManager::set_key_cache_ttl(uint64_t new_ttl) {
+    uint64_t previous_ttl = key_cache_ttl;
+    key_cache_ttl = new_ttl;
+    if(!apply_key_cache_ttl()) {
+        key_cache_ttl = previous_ttl;
+        apply_key_cache_ttl();
+        return false;
+    }
+
+    return generate_settings();
+}
+
+bool ServiceManager::wait_for_self_test() {
+    start_self_test();
+    if(self_test_thread) {
+        //The thread's notification needs an event loop, so do not wait for it
+        self_test_thread->wait();
+        tests_passed = self_test_thread->tests_passed();
+        tests_done = true;
+    }
+
+    return tests_passed;
+}
+
+bool ServiceManager::write_service(const QString& former_name, const QString& new_name, ServiceDescriptor& service) {
+    //Make management structures follow the new service name
+    bool tmp_result = update_service_name(former_name, new_name);
+    if(!tmp_result) return false;
+
+    //Save the service to its dedicated file
+    QString filepath = service_dir->filePath(service_filenames[new_name]);
+    tmp_result = service.save_to_file(filepath);
+    if(!tmp_result) return false;
+
+    //Regenerate service database
+    return generate_service_database();
+}
+
+void ServiceManager::add_service(const QString& service_name) {
+    //Find a cache entry for our new service, set it up with a default descriptor
+    ServiceDescriptorCache& cache_entry = find_oldest_cache_entry();
+    cache_entry.descriptor.reset(service_name, default_iterations);
+    cache_entry.service_filename = "";
+    cache_entry.last_used = clock();
+    pin_cached_descriptor(&cache_entry.descriptor);
+
+    emit service_ready(cache_entry.descriptor);
+}
+
+void ServiceManager::generate_password(const QString& service_name, const QString& master_password) {
+    //Fetch service descriptor associated to the requested service id
+    ServiceDescriptor* service_desc = fetch_service(service_name);
+    if(!service_desc) {
+        emit password_generation_failed();
+        return;
+    }
+
+    //Compute service password
+    QString* result = service_desc->compute_password(master_password, password_buffer);
+    if(result) {
+        emit password_ready(password_buffer);
+    } else {
+        emit password_generation_failed();
+    }
+}
+
+void ServiceManager::lock_key_cache() {
+    stretched_key_cache.lock();
+}
+
+void ServiceManager::load_service(const QString& service_name) {
+    ServiceDescriptor* result = fetch_service(service_name);
+    if(result) {
+        pin_cached_descriptor(result);
+        emit service_ready(*result);
+    } else {
+        emit service_loading_failed();
+    }
+}
+
+void ServiceManager::remove_service(const QString& service_name) {
+    //Delete the service's entry in service_name_list and service_filenames. Delete its file.
+    remove_service_name(service_name);
+    QString service_filename = service_filenames[service_name];
+    service_filenames.remove(service_name);
+    service_file_stamps.remove(service_filename);
+    service_dir->remove(service_filename);
+
+    //Free the cache entry assocated to the service, if any
+    forget_cached_service(service_filename);
+
+    //Regenerate service database
+    generate_service_database();
+
+    emit service_removed();
+}
+
+void ServiceManager::reload_changed_services() {
+    //Services are found back from their file's name
+    QHash<QString, QString> file_services;
+    for(QHash<QString, QString>::iterator i = service_filenames.begin(); i != service_filenames.end(); ++i) {
+        file_services.insert(i.value(), i.key());
+    }
+
+    //Only reparse files which are new, or whose stamp changed since they were last parsed
+    QFileInfoList service_dir_contents = service_dir->entryInfoList(QDir::Files);
+    QHash<QString, bool> present_files;
+    QStringList changed_files;
+    ServiceDescriptor tmp_desc;
+    bool index_changed = false;
+    bool unsettled = false;
+    for(int i = 0; i < service_dir_contents.count(); ++i) {
+        const QFileInfo& file_info = service_dir_contents.at(i);
+        QString service_filename = file_info.fileName();
+        if(!is_service_filename(service_filename)) continue;
+        present_files.insert(service_filename, true);
+        if(service_file_stamps.contains(service_filename)) {
+            const ServiceFileStamp& stamp = service_file_stamps[service_filename];
+            if((stamp.last_modified == file_info.lastModified()) && (stamp.size == file_info.size())) continue;
+        }
+
+        changed_files.append(file_info.absoluteFilePath());
+
+        //Files may be parsed while they are being written : they are retried on the next change
+        if(!tmp_desc.load_from_file(file_info.absoluteFilePath())) continue;
+        forget_cached_service(service_filename);
+
+        //Follow the service's name in the index, unless another file already uses it
+        QString former_name = file_services.value(service_filename);
+        if(tmp_desc.service_name != former_name) {
+            if(service_name_taken(tmp_desc.service_name) &&
+               (tmp_desc.service_name.compare(former_name, Qt::CaseInsensitive) != 0)) {
+                static const QString ERR_NAME_CONFLICT("%1 is ignored, as another file already describes service %2");
+                log_event(LOG_WARNING, SERVICE_MANAGER_NAME, ERR_NAME_CONFLICT.arg(service_filename).arg(tmp_desc.service_name));
+                //Not parsed again until it changes
+                if(!stamp_service_file(file_info)) unsettled = true;
+                continue;
+            }
+            if(!former_name.isEmpty()) {
+                remove_service_name(former_name);
+                service_filenames.remove(former_name);
+            }
+            service_filenames[tmp_desc.service_name] = service_filename;
+            insert_service_name(tmp_desc.service_name);
+            index_changed = true;
+        }
+        if(!stamp_service_file(file_info)) unsettled = true;
+    }
+
+    //Drop services whose file is gone
+    for(QHash<QString, QString>::iterator i = file_services.begin(); i != file_services.end(); ++i) {
+        if(present_files.contains(i.key())) continue;
+        remove_service_name(i.value());
+        service_filenames.remove(i.value());
+        forget_cached_service(i.key());
+        index_changed = true;
+    }
+    QList<QString> stamped_files = service_file_stamps.keys();
+    for(int i = 0; i < stamped_files.count(); ++i) {
+        if(!present_files.contains(stamped_files[i])) service_file_stamps.remove(stamped_files[i]);
+    }
+
+    //Files which are replaced (rather than rewritten) stop being watched
+    if(store_watcher) watch_service_files(changed_files);
+
+    if(index_changed) generate_service_database();
+    if(unsettled && store_reload_timer) store_reload_timer->start(STORE_RELOAD_DELAY);
+}
+
+void ServiceManager::save_service(const QString& former_name, const QString& new_name, ServiceDescriptor& service) {
+    if(write_service(former_name, new_name, service)) {
+        emit service_saved();
+    } else {
+        emit service_saving_failed();
+    }
+}
+
+void ServiceManager::start_self_test() {
+    if(self_test_thread) return;
+
+    //Run the test suite in the background. The UI must not use cryptographic functions until
+    //it has completed, and is notified of this through self_test_finished().
+    self_test_thread = new SelfTestThread(QCoreApplication::applicationFilePath(),
+                                          app_data_dir->filePath(SELF_TEST_CACHE_FILENAME),
+                                          this);
+    if(!self_test_thread) {
+        log_error(SERVICE_MANAGER_NAME, ERR_BAD_ALLOC.arg(QString("self_test_thread")));
+        self_test_thread_finished(false);
+        return;
+    }
+    connect(self_test_thread,
+            SIGNAL(self_test_finished(bool)),
+            this,
+            SLOT(self_test_thread_finished(bool)));
+    self_test_thread->start(QThread::LowPriority);
+}
+
+void ServiceManager::self_test_thread_finished(bool passed) {
+    tests_passed = passed;
+    tests_done = true;
+    emit self_test_finished(passed);
+}
+
+void ServiceManager::expire_cached_keys() {
+    stretched_key_cache.expire();
+}
+
+void ServiceManager::store_changed() {
+    store_reload_timer->start(STORE_RELOAD_DELAY);
+}
+
+bool ServiceManager::apply_key_cache_ttl() {
+    if(!stretched_key_cache.set_ttl((int) key_cache_ttl)) return false;
+
+    //Idle keys are wiped periodically, as long as the cache is enabled
+    if(!key_cache_ttl) {
+        if(key_cache_timer) key_cache_timer->stop();
+        return true;
+    }
+    if(!key_cache_timer) {
+        key_cache_timer = new QTimer(this);
+        if(!key_cache_timer) {
+            log_error(SERVICE_MANAGER_NAME, ERR_BAD_ALLOC.arg(QString("key_cache_timer")));
+            stretched_key_cache.set_ttl(0);
+            return false;
+        }
+        connect(key_cache_timer, SIGNAL(timeout()), this, SLOT(expire_cached_keys()));
+    }
+    key_cache_timer->start(KEY_CACHE_EXPIRY_PERIOD);
+    return true;
+}
+
+void ServiceManager::case_insensitive_sort(QStringList& list) {
+    //Since Qt does not offer a serious way to sort a QStringList case insensitively, here is some
+    //ugly heap sort implementation that will do it
+
+    //First, we want to place the list in max-heap order.
+    //To do this, we explore each of its heap nodes, starting at the last parent node
+    for(int current_node = (list.count()/2)-1; current_node>=0; --current_node) {
+        //Sift down the current node so that all nodes below it are in heap order
+        sift_down(list, current_node, list.count() - 1);
+    }
+
+    QString swap_buffer;
+    for(int end = list.count()-1; end > 0; --end) {
+        //The root of a heap is its maximal value, put it at the end
+        swap_buffer = list.at(end);
+        list[end] = list[0];
+        list[0] = swap_buffer;
+
+        //Put the heap back in max-heap order, keeping previous max value in proper placement
+        sift_down(list, 0, end-1);
+    }
+}
+
+void ServiceManager::close_error_output() {
+    //Pending events are written before logging stops
+    if(owns_error_output) stop_error_logging();
+}
+
+ServiceDescriptor* ServiceManager::fetch_service(const QString& service_name) {
+    //First, we can only fetch descriptors that are associated to a filename.
+    bool success = service_filenames.contains(service_name);
+    if(!success) {
+        static const QString ERR_UNKNOWN_SERVICE("Unknown service name : %1");
+        log_error(SERVICE_MANAGER_NAME, ERR_UNKNOWN_SERVICE.arg(service_name));
+        return NULL;
+    }
+
+    //First try to find the requested service in the service cache
+    ServiceDescriptorCache* potential_result = find_in_cache(service_filenames[service_name]);
+    if(potential_result) return &(potential_result->descriptor);
+
+    //Look for the oldest cache entry (free entries have last_used = 0)
+    ServiceDescriptorCache& oldest_cache_entry = find_oldest_cache_entry();
+    ServiceDescriptor& oldest_descriptor = oldest_cache_entry.descriptor;
+    oldest_cache_entry.service_filename.clear();
+    oldest_cache_entry.last_used = 0;
+
+    //Fetch our descriptor's full file path and load it in the oldest cache entry.
+    QString filepath = service_dir->filePath(service_filenames[service_name]);
+    success = oldest_descriptor.load_from_file(filepath);
+    if(!success) return NULL;
+
+    //Record where the entry comes from, so that it can be found again and forgotten when its file
+    //changes, then update its last usage date and return the descriptor
+    oldest_cache_entry.service_filename = service_filenames[service_name];
+    oldest_cache_entry.last_used = clock();
+    return &oldest_descriptor;
+}
+
+ServiceDescriptorCache* ServiceManager::find_in_cache(const QString& service_filename) {
+    //Try to find the requested service in the service cache
+    for(int i = 0; i < CACHE_SIZE; ++i) {
+        if(cached_services[i].service_filename == service_filename) {
+            cached_services[i].last_used = clock();
+            return &(cached_services[i]);
+        }
+    }
+
+    return NULL;
+}
+
+QString* ServiceManager::find_new_service_filename() {
+    static QString potential_filename;
+    uint64_t i;
+    for(i = 1; i!=0; ++i) {
+        potential_filename.setNum(i);
+        potential_filename.append(".txt");
+        if(service_dir->exists(potential_filename) == false) break;
+    }
+    if(i == 0) {
+        static const QString ERR_NO_AVL_FILENAME("No suitable filename could be found for the new service.");
+        log_error(SERVICE_MANAGER_NAME, ERR_NO_AVL_FILENAME);
+        return NULL;
+    }
+
+    return &potential_filename;
+}
+
+ServiceDescriptorCache& ServiceManager::find_oldest_cache_entry() {
+    //Find the oldest cache entry, leaving alone the one which the UI may be editing
+    int oldest = -1;
+    for(int i = 0; i < CACHE_SIZE; ++i) {
+        if(cached_services[i].pinned) continue;
+        if((oldest == -1) || (cached_services[i].last_used < cached_services[oldest].last_used)) {
+            oldest = i;
+            if(cached_services[i].last_used == 0) break;
+        }
+    }
+
+    return cached_services[oldest];
+}
+
+void ServiceManager::forget_cached_service(const QString& service_filename) {
+    for(int i = 0; i < CACHE_SIZE; ++i) {
+        if(cached_services[i].service_filename == service_filename) {
+            cached_services[i].service_filename.clear();
+            cached_services[i].last_used = 0;
+        }
+    }
+}
+
+bool ServiceManager::generate_service_database(bool from_scratch) {
+    //Open database file in writing mode and write its header
+    bool success = service_db_file->open(QIODevice::WriteOnly | QIODevice::Truncate);
+    if(!success) {
+        log_error(SERVICE_MANAGER_NAME, ERR_FILE_OPEN_FAILURE.arg(service_db_file->fileName()));
+        return false;
+    }
+    QTextStream service_db_ostream(service_db_file);
+    service_db_ostream << SERVICE_DATABASE_HEADER << endl << endl;
+
+    if(!from_scratch) {
+        //Save service database from the in-memory copy
+        for(int i = 0; i < service_name_list.count(); ++i) {
+            const QString& current_service_name = service_name_list[i];
+            service_db_ostream << ID_SERVICE << current_service_name << endl;
+            service_db_ostream << ID_FILENAME << service_filenames[current_service_name] << endl << endl;
+        }
+    } else {
+        //If we have no existing database to rely on, parse files in service_dir
+        QStringList service_dir_contents = service_dir->entryList();
+        QString current_filename;
+        ServiceDescriptor tmp_desc;
+        for(int i = 0; i < service_dir_contents.count(); ++i) {
+            if(!is_service_filename(service_dir_contents[i])) continue;
+            current_filename = service_dir->filePath(service_dir_contents[i]);
+            success = tmp_desc.load_from_file(current_filename);
+            if(success) {
+                service_db_ostream << ID_SERVICE << tmp_desc.service_name << endl;
+                service_db_ostream << ID_FILENAME << service_dir_contents[i] << endl << endl;
+            }
+        }
+    }
+
+    service_db_file->close();
+    return true;
+}
+
+bool ServiceManager::generate_settings(bool from_scratch) {
+    //Open settings file in writing mode and write its header
+    bool success = settings_file->open(QIODevice::WriteOnly | QIODevice::Truncate);
+    if(!success) {
+        log_error(SERVICE_MANAGER_NAME, ERR_FILE_OPEN_FAILURE.arg(settings_file->fileName()));
+        return false;
+    }
+    QTextStream settings_ostream(settings_file);
+    settings_ostream << SETTINGS_HEADER << endl << endl;
+
+    if(!from_scratch) {
+        //Save settings from the in-memory copy
+        settings_ostream << ID_LATENCY << acceptable_latency << endl;
+        settings_ostream << ID_ITERATIONS << default_iterations << endl;
+        settings_ostream << ID_PBKDF2_ITERATIONS << default_pbkdf2_iterations << endl;
+        settings_ostream << ID_KEY_CACHE_TTL << key_cache_ttl << endl;
+    } else {
+        //Write default settings
+        settings_ostream << ID_LATENCY << DEFAULT_LATENCY << endl;
+        settings_ostream << ID_ITERATIONS << benchmark_key_derivation(ITERATED_HASH, DEFAULT_LATENCY) << endl;
+        settings_ostream << ID_PBKDF2_ITERATIONS << benchmark_key_derivation(PBKDF2_HMAC_SHA512, DEFAULT_LATENCY) << endl;
+        settings_ostream << ID_KEY_CACHE_TTL << 0 << endl;
+    }
+
+    settings_file->close();
+    return true;
+}
+
+void ServiceManager::insert_service_name(const QString& service_name) {
+    int service_index = case_insensitive_lower_bound(service_name_list, service_name);
+    service_name_list.insert(service_index, service_name);
+    emit service_index_inserted(service_index);
+}
+
+QDir* ServiceManager::open_application_data_directory(const QString& app_data_location) {
+    app_data_dir = new QDir(app_data_location);
+    if(!app_data_dir) {
+        log_error(SERVICE_MANAGER_NAME, ERR_BAD_ALLOC.arg(QString("app_data_dir")));
+        return NULL;
+    }
+
+    //If the directory does not exist, attempt to create it
+    if(app_data_dir->exists() == false) {
+        bool success = app_data_dir->mkpath(app_data_location);
+        if(!success) {
+            log_error(SERVICE_MANAGER_NAME, ERR_FOLDER_CREATION_FAILURE.arg(app_data_location));
+            return NULL;
+        }
+    }
+
+    return app_data_dir;
+}
+
+bool ServiceManager::open_error_output() {
+    //The log file is appended to, and rotated in the background when it gets too large.
+    //Applications which already log somewhere, like the self-test, keep their own log.
+    if(error_logging_active()) return true;
+    owns_error_output = start_error_logging(app_data_dir->filePath(ERROR_LOG_FILENAME));
+    return owns_error_output;
+}
+
+QDir* ServiceManager::open_service_directory() {
+    //Services are stored in a subdirectory of the application data directory
+    service_dir = new QDir(app_data_dir->filePath(SERVICE_DIRECTORY_FILENAME));
+    if(!service_dir) {
+        log_error(SERVICE_MANAGER_NAME, ERR_BAD_ALLOC.arg(QString("service_dir")));
+        return NULL;
+    }
+
+    //If the directory does not exist, attempt to create it
+    if(service_dir->exists() == false) {
+        bool success = app_data_dir->mkdir(SERVICE_DIRECTORY_FILENAME);
+        if(!success) {
+            log_error(SERVICE_MANAGER_NAME, ERR_FOLDER_CREATION_FAILURE.arg(SERVICE_DIRECTORY_FILENAME));
+            return NULL;
+        }
+    }
+
+    return service_dir;
+}
+
+bool ServiceManager::parse_service_db(ConfigTokenizer& service_db_tokenizer) {
+    service_name_list.clear();
+    service_filenames.clear();
+    QString service_name;
+    ConfigField field;
+    while(service_db_tokenizer.next_field(service_db_keywords, field)) {
+        switch(field.id) {
+          //When encountering a service declaration, set up a service name.
+          case SERVICE:
+            service_name = field.to_string();
+            break;
+
+          //At the moment, a service is only described by its name and filename, so once we have
+          //both a service name and a valid file name, we may create an entry.
+          case FILENAME: {
+            if(service_name.isEmpty()) break;
+            QString service_filename = field.to_string();
+            if(service_dir->exists(service_filename) == false) break;
+            service_name_list.append(service_name);
+            service_filenames[service_name] = service_filename;
+            service_name.clear();
+            break;
+          }
+        }
+    }
+    case_insensitive_sort(service_name_list);
+
+    emit service_index_reset();
+
+    return true;
+}
+
+bool ServiceManager::parse_settings(ConfigTokenizer& settings_tokenizer) {
+    acceptable_latency = DEFAULT_LATENCY;
+    default_iterations = 0;
+    default_pbkdf2_iterations = 0;
+    key_cache_ttl = 0;
+    ConfigField field;
+    while(settings_tokenizer.next_field(settings_keywords, field)) {
+        switch(field.id) {
+          case LATENCY:
+            acceptable_latency = field.to_ulonglong();
+            break;
+          case ITERATIONS:
+            default_iterations = field.to_ulonglong();
+            break;
+          case PBKDF2_ITERATIONS:
+            default_pbkdf2_iterations = field.to_ulonglong();
+            break;
+          case KEY_CACHE_TTL:
+            key_cache_ttl = field.to_ulonglong();
+            break;
+        }
+    }
+
+    return true;
+}
+
+QFile* ServiceManager::read_service_database() {
+    bool success;
+    //Access standard service database
+    service_db_file = new QFile(app_data_dir->filePath(SERVICE_DATABASE_FILENAME));
+    if(!service_db_file) {
+        log_error(SERVICE_MANAGER_NAME, ERR_BAD_ALLOC.arg(QString("service_db_file")));
+        return NULL;
+    }
+
+    //If it does not exist, generate it from scratch
+    if(service_db_file->exists() == false) {
+        success = generate_service_database(true);
+        if(!success) return NULL;
+    }
+
+    //Open the database, read its header to see if it is correct. If not, regenerate it.
+    success = service_db_file->open(QIODevice::ReadOnly);
+    if(!success) {
+        log_error(SERVICE_MANAGER_NAME, ERR_FILE_OPEN_FAILURE.arg(service_db_file->fileName()));
+        return NULL;
+    }
+    QByteArray service_db_data = service_db_file->readAll();
+    service_db_file->close();
+    ConfigTokenizer service_db_tokenizer(service_db_data);
+    if(!service_db_tokenizer.read_header(SERVICE_DATABASE_HEADER)) {
+        //The file is corrupted. Regenerate it from scratch and re-read it.
+        success = generate_service_database(true);
+        if(!success) return NULL;
+
+        success = service_db_file->open(QIODevice::ReadOnly);
+        if(!success) {
+            log_error(SERVICE_MANAGER_NAME, ERR_FILE_OPEN_FAILURE.arg(service_db_file->fileName()));
+            return NULL;
+        }
+        service_db_data = service_db_file->readAll();
+        service_db_file->close();
+        service_db_tokenizer = ConfigTokenizer(service_db_data);
+        service_db_tokenizer.read_header(SERVICE_DATABASE_HEADER);
+    }
+
+    //Extract service name list and a service names->filenames dictionnary
+    parse_service_db(service_db_tokenizer);
+
+    return service_db_file;
+}
+
+QFile* ServiceManager::read_settings() {
+    bool success;
+    //Access settings file
+    settings_file = new QFile(app_data_dir->filePath(SETTINGS_FILENAME));
+    if(!settings_file) {
+        log_error(SERVICE_MANAGER_NAME, ERR_BAD_ALLOC.arg(QString("settings_file")));
+        return NULL;
+    }
+
+    //If it does not exist, generate it from scratch
+    if(settings_file->exists() == false) {
+        success = generate_settings(true);
+        if(!success) return NULL;
+    }
+
+    //Open the database, read its header to see if it is correct. If not, regenerate file.
+    success = settings_file->open(QIODevice::ReadOnly);
+    if(!success) {
+        log_error(SERVICE_MANAGER_NAME, ERR_FILE_OPEN_FAILURE.arg(settings_file->fileName()));
+        return NULL;
+    }
+    QByteArray settings_data = settings_file->readAll();
+    settings_file->close();
+    ConfigTokenizer settings_tokenizer(settings_data);
+    if(!settings_tokenizer.read_header(SETTINGS_HEADER)) {
+        //The file is corrupted. Regenerate it from scratch and re-read it.
+        success = generate_settings(true);
+        if(!success) return NULL;
+
+        success = settings_file->open(QIODevice::ReadOnly);
+        if(!success) {
+            log_error(SERVICE_MANAGER_NAME, ERR_FILE_OPEN_FAILURE.arg(settings_file->fileName()));
+            return NULL;
+        }
+        settings_data = settings_file->readAll();
+        settings_file->close();
+        settings_tokenizer = ConfigTokenizer(settings_data);
+        settings_tokenizer.read_header(SETTINGS_HEADER);
+    }
+
+    //Extract settings. Those of older versions lack PBKDF2's calibration, so run it now.
+    parse_settings(settings_tokenizer);
+    if(!default_pbkdf2_iterations) {
+        default_pbkdf2_iterations = benchmark_key_derivation(PBKDF2_HMAC_SHA512, acceptable_latency);
+        if(!generate_settings()) return NULL;
+    }
+
+    return settings_file;
+}
+
+void ServiceManager::pin_cached_descriptor(const ServiceDescriptor* descriptor) {
+    for(int i = 0; i < CACHE_SIZE; ++i) cached_services[i].pinned = (&cached_services[i].descriptor == descriptor);
+}
+
+void ServiceManager::remove_service_name(const QString& service_name) {
+    int service_index = case_insensitive_find(service_name_list, service_name);
+    if(service_index == -1) return;
+    service_name_list.removeAt(service_index);
+    emit service_index_removed(service_index);
+}
+
+bool ServiceManager::service_name_taken(const QString& service_name) {
+    //Service names are unique regardless of case
+    int position = case_insensitive_lower_bound(service_name_list, service_name);
+    if(position == service_name_list.count()) return false;
+    return (service_name_list.at(position).compare(service_name, Qt::CaseInsensitive) == 0);
+}
+
+void ServiceManager::sift_down(QStringList& list, const int start, const int end) {
+    int root_node = start;
+    QString swap_buffer;
+
+    while(root_node*2+1 <= end) { //While current root node has at least one child, check if
+                                  //there is a larger child node to swap the root with
+        int left_child_node = root_node*2+1;
+        int right_child_node = left_child_node+1;
+        int swap_with = root_node;
+
+        //Start by comparing root value with left child value
+        const QString& root_value = list.at(root_node);
+        const QString& left_child_value = list.at(left_child_node);
+        if(root_value.compare(left_child_value, Qt::CaseInsensitive) < 0) {
+            swap_with = left_child_node;
+        }
+
+        //Next, compare swap_with node with right child, if it exists : we want to
+        //swap the root with its largest child
+        if(right_child_node <= end) {
+            const QString& swap_value = list.at(swap_with);
+            const QString& right_child_value = list.at(right_child_node);
+            if(swap_value.compare(right_child_value, Qt::CaseInsensitive) < 0) {
+                swap_with = right_child_node;
+            }
+        }
+
+        //Should we swap root_node with another node ?
+        if(swap_with != root_node) {
+            //If yes, perform the swap and iterate the algorithm on the child node
+            swap_buffer = list.at(root_node);
+            list[root_node] = list[swap_with];
+            list[swap_with] = swap_buffer;
+
+            root_node = swap_with;
+        } else {
+            //If not, the heap is sorted below the current root node
+            return;
+        }
+    }
+}
+
+bool ServiceManager::stamp_service_file(const QFileInfo& file_info) {
+    //File times may only have a one-second resolution, so a change made in the same second as the
+    //last parse could go unnoticed. Recently modified files are left unstamped and parsed again.
+    if(file_info.lastModified().secsTo(QDateTime::currentDateTime()) < STORE_SETTLE_TIME) {
+        service_file_stamps.remove(file_info.fileName());
+        return false;
+    }
+    ServiceFileStamp& stamp = service_file_stamps[file_info.fileName()];
+    stamp.last_modified = file_info.lastModified();
+    stamp.size = file_info.size();
+    return true;
+}
+
+bool ServiceManager::stamp_service_files() {
+    service_file_stamps.clear();
+    QFileInfoList service_dir_contents = service_dir->entryInfoList(QDir::Files);
+    QStringList service_files;
+    bool unsettled = false;
+    for(int i = 0; i < service_dir_contents.count(); ++i) {
+        const QFileInfo& file_info = service_dir_contents.at(i);
+        if(!is_service_filename(file_info.fileName())) continue;
+        if(!stamp_service_file(file_info)) unsettled = true;
+        service_files.append(file_info.absoluteFilePath());
+    }
+    watch_service_files(service_files);
+
+    //The database may not match files which were still changing
+    if(unsettled) store_reload_timer->start(STORE_RELOAD_DELAY);
+    return true;
+}
+
+bool ServiceManager::start_ipc(InstanceMode mode) {
+    QString full_socket_name = socket_name();
+
+    //Attempt to connect to an already running "server" instance of Hashish.
+    QLocalSocket client_socket(this);
+    client_socket.connectToServer(full_socket_name);
+    bool success = client_socket.waitForConnected(5);
+
+    if(success) {
+        running_instance_found = true;
+
+        //If a running instance is found, ask it to show itself in place of the new instance
+        if(mode == GUI_INSTANCE) {
+            client_socket.write(SHOW_REQUEST);
+            client_socket.waitForBytesWritten(100);
+        }
+        client_socket.disconnectFromServer();
+        return success;
+    } else {
+        running_instance_found = false;
+        if(mode == CLIENT_INSTANCE) return true;
+
+        //Become the server instance of Hashish, disabling any hung instance in the way
+        command_server = new CommandServer(*this, this);
+        if(!command_server) {
+            log_error(SERVICE_MANAGER_NAME, ERR_BAD_ALLOC.arg(QString("command_server")));
+            return false;
+        }
+        if(client_socket.error() != QLocalSocket::ServerNotFoundError) {
+            QLocalServer::removeServer(full_socket_name);
+        }
+        connect(command_server, SIGNAL(show_requested()), this, SIGNAL(new_instance_spawned()));
+        connect(this, SIGNAL(self_test_finished(bool)), command_server, SLOT(self_test_finished(bool)));
+        return command_server->listen(full_socket_name);
+    }
+}
+
+QString ServiceManager::socket_name() {
+    //Compute Hashish's full socket name (including username on supported platforms)
+    char* user_name = (char*) "";
+    #ifdef Q_OS_UNIX
+        user_name = getenv("USER");
+    #endif
+    #ifdef Q_OS_WIN32
+        user_name = getenv("USERNAME");
+    #endif
+    return HASHISH_SOCKET_NAME.arg(QString(user_name));
+}
+
+void ServiceManager::stop_ipc() {
+    if(command_server) command_server->close();
+}
+
+QStringList ServiceManager::store_paths() {
+    QStringList paths;
+    paths.append(SETTINGS_FILENAME);
+    paths.append(SERVICE_DATABASE_FILENAME);
+    QStringList service_dir_contents = service_dir->entryList(QDir::Files);
+    for(int i = 0; i < service_dir_contents.count(); ++i) {
+        if(!is_service_filename(service_dir_contents[i])) continue;
+        paths.append(SERVICE_DIRECTORY_FILENAME + '/' + service_dir_contents[i]);
+    }
+
+    return paths;
+}
+
+bool ServiceManager::update_service_name(const QString& former_name, const QString& new_name) {
+    //Update internal records
+    int service_index = case_insensitive_find(service_name_list, former_name);
+    if(service_index == -1) {
+        //The service has just been created
+        QString* tmp_filename = find_new_service_filename();
+        if(!tmp_filename) return false;
+        service_filenames[new_name] = *tmp_filename;
+    } else {
+        //The service already exists. If its name has not changed, there's nothing to do, otherwise update.
+        if(new_name == former_name) return true;
+        service_name_list.removeAt(service_index);
+        emit service_index_removed(service_index);
+
+        service_filenames[new_name] = service_filenames[former_name];
+        service_filenames.remove(former_name);
+    }
+
+    //Insert the new name at its sorted position, updating service list models along the way
+    insert_service_name(new_name);
+
+    return true;
+}
+
+bool ServiceManager::watch_store() {
+    //Changes are gathered until the service directory has been quiet for STORE_RELOAD_DELAY, then
+    //only the files which changed are parsed again (see reload_changed_services()). Directory
+    //events report files being added, removed, or replaced, file events report in-place writes.
+    store_reload_timer = new QTimer(this);
+    if(!store_reload_timer) {
+        log_error(SERVICE_MANAGER_NAME, ERR_BAD_ALLOC.arg(QString("store_reload_timer")));
+        return false;
+    }
+    store_reload_timer->setSingleShot(true);
+    connect(store_reload_timer, SIGNAL(timeout()), this, SLOT(reload_changed_services()));
+
+    store_watcher = new QFileSystemWatcher(this);
+    if(!store_watcher) {
+        log_error(SERVICE_MANAGER_NAME, ERR_BAD_ALLOC.arg(QString("store_watcher")));
+        return false;
+    }
+    connect(store_watcher, SIGNAL(directoryChanged(const QString&)), this, SLOT(store_changed()));
+    connect(store_watcher, SIGNAL(fileChanged(const QString&)), this, SLOT(store_changed()));
+    store_watcher->addPath(service_dir->absolutePath());
+
+    return stamp_service_files();
+}
+
+void ServiceManager::watch_service_files(const QStringList& paths) {
+    //Paths must not be watched twice
+    QStringList watched_list = store_watcher->files();
+    QHash<QString, bool> watched_files;
+    for(int i = 0; i < watched_list.count(); ++i) watched_files.insert(watched_list[i], true);
+    QStringList new_paths;
+    for(int i = 0; i < paths.count(); ++i) {
+        if(!watched_files.contains(paths[i])) new_paths.append(paths[i]);
+    }
+    if(!new_paths.isEmpty()) store_watcher->addPaths(new_paths);
+}
+
+bool test_service_cache() {
+    static const QString ERR_STALE_SERVICE("Service %1 has %2 iterations after a reload, expected %3");
+    static const QString ERR_EDITED_SERVICE_REPLACED("The service handed to the UI was replaced by a reload");
+    static const QString ERR_BACKUP_STORED("Backup %1 is taken for a service file");
+    static const QString ERR_NOT_CACHED("Service %1 is loaded again instead of being cached");
+
+    //A store whose settings are written beforehand, so that opening it does not run benchmarks
+    QDir data_dir(QDir::temp().filePath(QString("hashish-selftest-%1").arg(QCoreApplication::applicationPid())));
+    if(!data_dir.mkpath(data_dir.absolutePath())) {
+        log_error(SERVICE_MANAGER_NAME, ERR_FOLDER_CREATION_FAILURE.arg(data_dir.absolutePath()));
+        return false;
+    }
+    QFile settings_file(data_dir.filePath(SETTINGS_FILENAME));
+    if(!settings_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        log_error(SERVICE_MANAGER_NAME, ERR_FILE_OPEN_FAILURE.arg(settings_file.fileName()));
+        return false;
+    }
+    QTextStream settings_ostream(&settings_file);
+    settings_ostream << SETTINGS_HEADER << endl << endl;
+    settings_ostream << ID_LATENCY << DEFAULT_LATENCY << endl;
+    settings_ostream << ID_ITERATIONS << 1 << endl;
+    settings_ostream << ID_PBKDF2_ITERATIONS << 1 << endl;
+    settings_ostream << ID_KEY_CACHE_TTL << 0 << endl;
+    settings_ostream.flush();
+    settings_file.close();
+
+    bool success = true;
+    {
+        ServiceManager service_manager(CLIENT_INSTANCE, data_dir.absolutePath());
+        const char* const SERVICE_NAMES[] = {"Mail", "Bank"};
+        for(int i = 0; success && (i < 2); ++i) {
+            ServiceDescriptor service(SERVICE_NAMES[i], 1);
+            success = service_manager.write_service(SERVICE_NAMES[i], SERVICE_NAMES[i], service);
+        }
+
+        //Mail is being edited in the UI, Bank is only cached. Both files are then changed behind
+        //the manager's back, as a synchronization tool would.
+        ServiceDescriptor* edited_service = NULL;
+        if(success) {
+            service_manager.load_service("Mail");
+            edited_service = service_manager.fetch_service("Mail");
+            success = edited_service && service_manager.fetch_service("Bank");
+        }
+        if(success && (service_manager.fetch_service("Bank") != service_manager.fetch_service("Bank"))) {
+            log_error(SERVICE_MANAGER_NAME, ERR_NOT_CACHED.arg("Bank"));
+            success = false;
+        }
+        for(int i = 0; success && (i < 2); ++i) {
+            ServiceDescriptor changed_service(SERVICE_NAMES[i], 2 + i);
+            success = changed_service.save_to_file(service_manager.service_dir->filePath(service_manager.service_filenames[SERVICE_NAMES[i]]));
+        }
+
+        //A backup left by an interrupted save is not a service of its own
+        if(success) {
+            QString mail_filepath = service_manager.service_dir->filePath(service_manager.service_filenames["Mail"]);
+            success = QFile::copy(mail_filepath, mail_filepath + '~');
+        }
+
+        //Once reloaded, both services have their new contents, but the UI's copy is left alone
+        if(success) service_manager.reload_changed_services();
+        QStringList store_paths = service_manager.store_paths();
+        for(int i = 0; success && (i < store_paths.count()); ++i) {
+            if(store_paths[i].endsWith('~')) {
+                log_error(SERVICE_MANAGER_NAME, ERR_BACKUP_STORED.arg(store_paths[i]));
+                success = false;
+            }
+        }
+        for(int i = 0; success && (i < 2); ++i) {
+            ServiceDescriptor* service = service_manager.fetch_service(SERVICE_NAMES[i]);
+            if(!service || (service->iterations != (uint64_t) (2 + i))) {
+                log_error(SERVICE_MANAGER_NAME, ERR_STALE_SERVICE.arg(SERVICE_NAMES[i])
+                                                                 .arg(service ? service->iterations : 0)
+                                                                 .arg(2 + i));
+                success = false;
+            }
+        }
+        if(success && (edited_service->iterations != 1)) {
+            log_error(SERVICE_MANAGER_NAME, ERR_EDITED_SERVICE_REPLACED);
+            success = false;
+        }
+    }
+
+    //Remove the store
+    QDir service_dir(data_dir.filePath(SERVICE_DIRECTORY_FILENAME));
+    QStringList service_files = service_dir.entryList(QDir::Files | QDir::Hidden);
+    for(int i = 0; i < service_files.count(); ++i) service_dir.remove(service_files[i]);
+    data_dir.rmdir(SERVICE_DIRECTORY_FILENAME);
+    QStringList data_files = data_dir.entryList(QDir::Files | QDir::Hidden);
+    for(int i = 0; i < data_files.count(); ++i) data_dir.remove(data_files[i]);
+    data_dir.rmdir(data_dir.absolutePath());
+
+    return success;
+}
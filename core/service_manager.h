@@ -0,0 +1,195 @@
+/* Service manager : this QObject is the back-end of Hashish.
+   It loads, save, and manages services, computes passwords, etc...
+
+      Copyright (C) 2011  Hadrien Grasland
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA */
+
+#ifndef SERVICE_MANAGER_H
+#define SERVICE_MANAGER_H
+
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QHash>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QTextStream>
+#include <QTimer>
+#include <stddef.h>
+#include <time.h>
+
+#include <command_server.h>
+#include <parsing_tools.h>
+#include <self_test.h>
+#include <service_descriptor.h>
+#include <service_import.h>
+#include <store_snapshot.h>
+
+#define CACHE_SIZE 10 //Maximum amount of services to keep cached
+#define STORE_RELOAD_DELAY 500 //Time (in ms) without changes of the service directory before it is rescanned
+#define STORE_SETTLE_TIME 2 //Seconds after its last modification before a service file's stamp is trusted
+
+//How an instance of Hashish uses the per-user local socket (see command_server.h)
+enum InstanceMode {
+    GUI_INSTANCE = 0, //Serves requests, or asks the instance which does to show its main window
+    DAEMON_INSTANCE, //Serves requests, unless another instance already does
+    CLIENT_INSTANCE //Never serves requests (command line tools)
+};
+
+struct ServiceDescriptorCache {
+    ServiceDescriptor descriptor;
+    QString service_filename;
+    clock_t last_used;
+    bool pinned; //Handed to the UI by service_ready(), which may still be editing it : never reused
+    ServiceDescriptorCache() : last_used(0), pinned(false) {}
+};
+
+//What a service file looked like when it was last parsed, so that rescans only reparse changed files
+struct ServiceFileStamp {
+    QDateTime last_modified;
+    qint64 size;
+};
+
+class ServiceManager : public QObject {
+    Q_OBJECT
+
+  public:
+    ServiceManager(InstanceMode mode = GUI_INSTANCE,
+                   const QString& data_location = default_data_location());
+    ~ServiceManager();
+    bool already_running() {return running_instance_found;} //Another instance serves requests
+    bool copy_service(const QString& service_name, ServiceDescriptor& dest_buffer);
+    bool create_snapshot(const QString& snapshot_location, //Backs the store up (see store_snapshot.h)
+                         const QString& password,
+                         const bool full,
+                         SnapshotReport& report);
+    bool crypto_function_tests_done() {return tests_done;} //False while the self-test is running
+    bool crypto_function_tests_passed() {return tests_passed;}
+    uint64_t current_iterations(KeyDerivation key_derivation = ITERATED_HASH) { //Default for new services
+        return (key_derivation == PBKDF2_HMAC_SHA512) ? default_pbkdf2_iterations : default_iterations;
+    }
+    uint64_t current_key_cache_ttl() {return key_cache_ttl;} //In seconds, 0 when stretched keys are not cached
+    uint64_t current_latency() {return acceptable_latency;}
+    static QString default_data_location(); //Same as QDesktopServices::DataLocation
+    bool import_services(CredentialReader& reader, //Encrypts every credential of an export as a new
+                         const QString& master_password, //service. Records which cannot be imported
+                         const KeyDerivation key_derivation, //are reported and skipped. On errors,
+                         ImportReport& report); //no service is added.
+    bool lock_running_instance(); //Ask the instance which serves requests to wipe its cached keys
+    const QStringList& service_names() {return service_name_list;} //Sorted case-insensitively
+    bool restore_snapshot(const QString& snapshot_location, //Then reloads the store. Snapshot 0 is
+                          const uint64_t number, //the last one.
+                          const QString& password,
+                          SnapshotReport& report);
+    bool set_current_latency(uint64_t new_latency);
+    bool set_key_cache_ttl(uint64_t new_ttl); //See key_cache.h
+    bool wait_for_self_test(); //Starts the self-test if needed, waits for it, returns the result
+    bool write_service(const QString& former_name, const QString& new_name, ServiceDescriptor& service);
+
+  public slots:
+    void add_service(const QString& service_name);
+    void generate_password(const QString& service_name, const QString& master_password);
+    void load_service(const QString& service_name);
+    void lock_key_cache(); //Wipe cached stretched keys now
+    void reload_changed_services(); //Reparse service files which changed on disk (see watch_store())
+    void remove_service(const QString& service_name);
+    void save_service(const QString& previous_name, const QString& new_name, ServiceDescriptor& service);
+    void start_self_test(); //Check cryptographic functions in the background
+
+  signals:
+    void new_instance_spawned(); //Triggered each time a new instance of Hashish asks to be shown
+    void password_generation_failed();
+    void password_ready(const QString& password);
+    void self_test_finished(bool passed);
+    void service_loading_failed();
+    void service_saving_failed();
+    void service_ready(ServiceDescriptor& service);
+    void service_removed();
+    void service_saved();
+    void service_index_inserted(int index_row); //Keep service lists (e.g. GUI models) in sync
+    void service_index_removed(int index_row);
+    void service_index_reset();
+
+  private slots:
+    void expire_cached_keys();
+    void self_test_thread_finished(bool passed);
+    void store_changed(); //Restarts store_reload_timer, so that bursts of changes cause one rescan
+
+  private:
+    uint64_t acceptable_latency;
+    QDir* app_data_dir;
+    ServiceDescriptorCache cached_services[CACHE_SIZE];
+    CommandServer* command_server;
+    uint64_t default_iterations;
+    uint64_t default_pbkdf2_iterations;
+    QTimer* key_cache_timer;
+    uint64_t key_cache_ttl;
+    bool owns_error_output; //False when the application already logged elsewhere
+    QString password_buffer;
+    bool running_instance_found;
+    SelfTestThread* self_test_thread;
+    QFile* service_db_file;
+    QDir* service_dir;
+    QStringList service_name_list;
+    QHash<QString, ServiceFileStamp> service_file_stamps;
+    QHash<QString, QString> service_filenames;
+    QFile* settings_file;
+    QTimer* store_reload_timer;
+    QFileSystemWatcher* store_watcher;
+    bool tests_done;
+    bool tests_passed;
+    QObject* to_delete;
+
+    bool apply_key_cache_ttl();
+    void case_insensitive_sort(QStringList& list);
+    void close_error_output();
+    ServiceDescriptor* fetch_service(const QString& service_name);
+    ServiceDescriptorCache* find_in_cache(const QString& service_filename);
+    QString* find_new_service_filename();
+    ServiceDescriptorCache& find_oldest_cache_entry();
+    void forget_cached_service(const QString& service_filename); //Next uses reload it from its file
+    bool generate_service_database(bool from_scratch = false);
+    bool generate_settings(bool from_scratch = false);
+    QDir* open_application_data_directory(const QString& app_data_location);
+    bool open_error_output();
+    QDir* open_service_directory();
+    bool parse_service_db(ConfigTokenizer& service_db_tokenizer);
+    bool parse_settings(ConfigTokenizer& settings_tokenizer);
+    void pin_cached_descriptor(const ServiceDescriptor* descriptor); //Unpins the other entries
+    QFile* read_service_database();
+    QFile* read_settings();
+    void remove_service_name(const QString& service_name);
+    bool service_name_taken(const QString& service_name); //Case-insensitively
+    void sift_down(QStringList& list, const int start, const int end);
+    bool stamp_service_file(const QFileInfo& file_info); //False if it changed too recently to be trusted
+    bool stamp_service_files(); //Stamps and watches every service file
+    static QString socket_name();
+    bool start_ipc(InstanceMode mode);
+    void stop_ipc();
+    QStringList store_paths(); //Files of the store, relative to app_data_dir
+    void insert_service_name(const QString& service_name);
+    bool update_service_name(const QString& former_name, const QString& new_name);
+    void watch_service_files(const QStringList& paths); //Unless they already are
+    bool watch_store(); //Service files may be changed behind our back, e.g. by synchronization tools
+    friend bool test_service_cache();
+};
+
+bool test_service_cache(); //Edit cached services on disk, check that reloads are seen but spare the UI's
+
+#endif // SERVICE_MANAGER_H
@@ -0,0 +1,837 @@
+/* Store snapshots : compressed and encrypted backups of the service store, which may be
+   incremental, and their restoration.
+
+      Copyright (C) 2011  Hadrien Grasland
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA */
+
+#include <QBuffer>
+#include <QFile>
+#include <QFileInfo>
+#include <string.h>
+#include <time.h>
+#ifdef Q_OS_WIN32
+    #include <windows.h>
+    #include <ntsecapi.h>
+#endif
+
+#include <error_management.h>
+#include <pbkdf2.h>
+#include <store_snapshot.h>
+
+const QString STORE_SNAPSHOT_NAME("StoreSnapshot");
+
+const char SNAPSHOT_MAGIC[] = "HSHSNAP1";
+const int SNAPSHOT_HEADER_LENGTH = 8 + 3*8 + SNAPSHOT_SALT_LENGTH;
+const int SNAPSHOT_MAC_LENGTH = 64;
+
+const QString SNAPSHOT_FILENAME("snapshot_%1.hss");
+const QString PARTIAL_SNAPSHOT_SUFFIX(".part"); //Snapshots are renamed once complete
+const QString RESTORE_STAGING_DIRECTORY("snapshot_restore"); //In the data directory
+
+const QString ERR_BAD_SNAPSHOT("%1 : %2");
+const QString ERR_DAMAGED_SNAPSHOT("The snapshot is damaged");
+const QString ERR_TRUNCATED_SNAPSHOT("The snapshot is truncated");
+
+void put_be_uint(unsigned char* dest, const uint64_t value, const int length) {
+    for(int i = 0; i < length; ++i) dest[i] = (unsigned char) (value >> (8*(length - 1 - i)));
+}
+
+uint64_t get_be_uint(const unsigned char* bytes, const int length) {
+    uint64_t value = 0;
+    for(int i = 0; i < length; ++i) value = (value << 8) | bytes[i];
+    return value;
+}
+
+void serialize_header(const SnapshotHeader& header, unsigned char* dest_buffer) {
+    memcpy((void*) dest_buffer, (const void*) SNAPSHOT_MAGIC, 8);
+    put_be_uint(dest_buffer + 8, header.number, 8);
+    put_be_uint(dest_buffer + 16, header.base, 8);
+    put_be_uint(dest_buffer + 24, header.iterations, 8);
+    memcpy((void*) (dest_buffer + 32), (const void*) header.salt, SNAPSHOT_SALT_LENGTH);
+}
+
+QByteArray sha512_hex_digest(const QByteArray& data) {
+    SHA512Stream stream;
+    stream.update(data.constData(), data.size());
+    return stream.hex_digest();
+}
+
+bool valid_store_path(const QString& path) {
+    //Archive contents are only authenticated once fully read, so never let paths leave the store
+    if(path.isEmpty() || path.startsWith('/') || path.contains('\\') || path.contains(':')) return false;
+    QStringList components = path.split('/');
+    for(int i = 0; i < components.count(); ++i) {
+        const QString& component = components.at(i);
+        if(component.isEmpty() || (component == ".") || (component == "..")) return false;
+    }
+
+    return true;
+}
+
+HMACSHA512Stream::HMACSHA512Stream() {
+    memset((void*) inner_key_pad, 0x36, 128);
+    memset((void*) outer_key_pad, 0x5c, 128);
+    inner_stream.update((const char*) inner_key_pad, 128);
+}
+
+HMACSHA512Stream::~HMACSHA512Stream() {
+    memset((void*) inner_key_pad, 0, 128);
+    memset((void*) outer_key_pad, 0, 128);
+}
+
+void HMACSHA512Stream::set_key(const unsigned char* key, size_t key_length) {
+    hmac_sha512_key_pads((const char*) key, key_length, inner_key_pad, outer_key_pad);
+    inner_stream.reset();
+    inner_stream.update((const char*) inner_key_pad, 128);
+}
+
+void HMACSHA512Stream::update(const char* bytes, size_t length) {
+    inner_stream.update(bytes, length);
+}
+
+void HMACSHA512Stream::finish(unsigned char* digest) {
+    unsigned char inner_digest[64];
+    inner_stream.finish(inner_digest);
+    SHA512Stream outer_stream;
+    outer_stream.update((const char*) outer_key_pad, 128);
+    outer_stream.update((const char*) inner_digest, 64);
+    outer_stream.finish(digest);
+    memset((void*) inner_digest, 0, 64);
+
+    inner_stream.update((const char*) inner_key_pad, 128);
+}
+
+SnapshotCipher::SnapshotCipher() : keystream_offset(0) {
+    memset((void*) keystream_block, 0, 64);
+}
+
+SnapshotCipher::~SnapshotCipher() {
+    memset((void*) keystream_block, 0, 64);
+}
+
+bool SnapshotCipher::set_password(const QString& password, const SnapshotHeader& header) {
+    if((header.iterations == 0) || (header.iterations > SNAPSHOT_MAX_ITERATIONS)) return false;
+
+    QByteArray utf8_password = password.toUtf8();
+    unsigned char keys[128];
+    {
+        PBKDF2HMACSHA512 pbkdf2(utf8_password.constData(), utf8_password.size());
+        pbkdf2.derive((const char*) header.salt, SNAPSHOT_SALT_LENGTH, header.iterations, 128, keys);
+    }
+    memset((void*) utf8_password.data(), 0, utf8_password.size());
+    keystream_prf.set_key(keys, 64);
+    mac.set_key(keys + 64, 64);
+    memset((void*) keys, 0, 128);
+
+    keystream_offset = 0;
+    return true;
+}
+
+void SnapshotCipher::apply_keystream(char* bytes, size_t length) {
+    for(size_t i = 0; i < length; ++i, ++keystream_offset) {
+        size_t block_offset = keystream_offset % 64;
+        if(block_offset == 0) {
+            unsigned char counter[8];
+            put_be_uint(counter, keystream_offset/64, 8);
+            keystream_prf.update((const char*) counter, 8);
+            keystream_prf.finish(keystream_block);
+        }
+        bytes[i]^= keystream_block[block_offset];
+    }
+}
+
+SnapshotWriter::SnapshotWriter(QIODevice* output) : output(output) {}
+
+bool SnapshotWriter::start(const QString& password, const SnapshotHeader& header) {
+    unsigned char header_bytes[SNAPSHOT_HEADER_LENGTH];
+    serialize_header(header, header_bytes);
+    if(!cipher.set_password(password, header)) {
+        error_message = ERR_DAMAGED_SNAPSHOT;
+        return false;
+    }
+
+    //The header's MAC comes right after it, and the archive's MAC covers both
+    unsigned char header_mac[SNAPSHOT_MAC_LENGTH];
+    cipher.mac.update((const char*) header_bytes, SNAPSHOT_HEADER_LENGTH);
+    cipher.mac.finish(header_mac);
+    cipher.mac.update((const char*) header_bytes, SNAPSHOT_HEADER_LENGTH);
+    cipher.mac.update((const char*) header_mac, SNAPSHOT_MAC_LENGTH);
+    bool success = (output->write((const char*) header_bytes, SNAPSHOT_HEADER_LENGTH) == SNAPSHOT_HEADER_LENGTH);
+    if(success) success = (output->write((const char*) header_mac, SNAPSHOT_MAC_LENGTH) == SNAPSHOT_MAC_LENGTH);
+    if(!success) error_message = output->errorString();
+
+    return success;
+}
+
+bool SnapshotWriter::write_manifest(const SnapshotManifest& manifest) {
+    //sha512sum's format : digest, two spaces, path
+    QByteArray manifest_text;
+    for(int i = 0; i < manifest.paths.count(); ++i) {
+        const QString& path = manifest.paths.at(i);
+        manifest_text.append(manifest.digests.value(path));
+        manifest_text.append("  ");
+        manifest_text.append(path.toUtf8());
+        manifest_text.append('\n');
+    }
+
+    return write_record(SNAPSHOT_MANIFEST, QString(), qCompress(manifest_text));
+}
+
+bool SnapshotWriter::write_file(const QString& path, const QByteArray& contents) {
+    return write_record(SNAPSHOT_FILE, path, qCompress(contents));
+}
+
+bool SnapshotWriter::finish() {
+    if(!write_record(SNAPSHOT_END, QString(), QByteArray())) return false;
+
+    unsigned char archive_mac[SNAPSHOT_MAC_LENGTH];
+    cipher.mac.finish(archive_mac);
+    if(output->write((const char*) archive_mac, SNAPSHOT_MAC_LENGTH) != SNAPSHOT_MAC_LENGTH) {
+        error_message = output->errorString();
+        return false;
+    }
+
+    return true;
+}
+
+bool SnapshotWriter::write_record(const char type, const QString& path, const QByteArray& data) {
+    static const QString ERR_RECORD_TOO_LONG("%1 is too large for snapshots");
+    QByteArray utf8_path = path.toUtf8();
+    if((utf8_path.size() > SNAPSHOT_MAX_RECORD_LENGTH) || (data.size() > SNAPSHOT_MAX_RECORD_LENGTH)) {
+        error_message = ERR_RECORD_TOO_LONG.arg(path);
+        return false;
+    }
+
+    unsigned char record_header[5];
+    record_header[0] = (unsigned char) type;
+    put_be_uint(record_header + 1, utf8_path.size(), 4);
+    bool success = write_encrypted((const char*) record_header, 5);
+    if(success) success = write_encrypted(utf8_path.constData(), utf8_path.size());
+    put_be_uint(record_header, data.size(), 4);
+    if(success) success = write_encrypted((const char*) record_header, 4);
+    if(success) success = write_encrypted(data.constData(), data.size());
+
+    return success;
+}
+
+bool SnapshotWriter::write_encrypted(const char* bytes, size_t length) {
+    if(!length) return true;
+
+    QByteArray ciphertext(bytes, length);
+    cipher.apply_keystream(ciphertext.data(), length);
+    cipher.mac.update(ciphertext.constData(), length);
+    if(output->write(ciphertext) != (qint64) length) {
+        error_message = output->errorString();
+        return false;
+    }
+
+    return true;
+}
+
+SnapshotReader::SnapshotReader(QIODevice* input) : input(input) {
+    memset((void*) &archive_header, 0, sizeof(SnapshotHeader));
+}
+
+bool SnapshotReader::start(const QString& password) {
+    static const QString ERR_NOT_A_SNAPSHOT("This is not a Hashish snapshot");
+    static const QString ERR_WRONG_PASSWORD("Wrong password, or damaged snapshot header");
+    unsigned char header_bytes[SNAPSHOT_HEADER_LENGTH];
+    if(input->read((char*) header_bytes, SNAPSHOT_HEADER_LENGTH) != SNAPSHOT_HEADER_LENGTH) {
+        error_message = ERR_NOT_A_SNAPSHOT;
+        return false;
+    }
+    if(memcmp((const void*) header_bytes, (const void*) SNAPSHOT_MAGIC, 8) != 0) {
+        error_message = ERR_NOT_A_SNAPSHOT;
+        return false;
+    }
+    archive_header.number = get_be_uint(header_bytes + 8, 8);
+    archive_header.base = get_be_uint(header_bytes + 16, 8);
+    archive_header.iterations = get_be_uint(header_bytes + 24, 8);
+    memcpy((void*) archive_header.salt, (const void*) (header_bytes + 32), SNAPSHOT_SALT_LENGTH);
+    if(!cipher.set_password(password, archive_header)) {
+        error_message = ERR_DAMAGED_SNAPSHOT;
+        return false;
+    }
+
+    //Check the header's MAC before decrypting anything
+    unsigned char header_mac[SNAPSHOT_MAC_LENGTH], expected_mac[SNAPSHOT_MAC_LENGTH];
+    if(input->read((char*) header_mac, SNAPSHOT_MAC_LENGTH) != SNAPSHOT_MAC_LENGTH) {
+        error_message = ERR_TRUNCATED_SNAPSHOT;
+        return false;
+    }
+    cipher.mac.update((const char*) header_bytes, SNAPSHOT_HEADER_LENGTH);
+    cipher.mac.finish(expected_mac);
+    if(memcmp((const void*) header_mac, (const void*) expected_mac, SNAPSHOT_MAC_LENGTH) != 0) {
+        error_message = ERR_WRONG_PASSWORD;
+        return false;
+    }
+    cipher.mac.update((const char*) header_bytes, SNAPSHOT_HEADER_LENGTH);
+    cipher.mac.update((const char*) header_mac, SNAPSHOT_MAC_LENGTH);
+
+    //Then read the manifest
+    char type;
+    QString path;
+    QByteArray data;
+    if(!read_record(type, path, data)) return false;
+    if(type != SNAPSHOT_MANIFEST) {
+        error_message = ERR_DAMAGED_SNAPSHOT;
+        return false;
+    }
+    QByteArray manifest_text = qUncompress(data);
+    int line_start = 0;
+    while(line_start < manifest_text.size()) {
+        int line_end = manifest_text.indexOf('\n', line_start);
+        if(line_end == -1) line_end = manifest_text.size();
+        QByteArray line = manifest_text.mid(line_start, line_end - line_start);
+        line_start = line_end + 1;
+
+        if((line.size() <= 130) || (line.at(128) != ' ') || (line.at(129) != ' ')) {
+            error_message = ERR_DAMAGED_SNAPSHOT;
+            return false;
+        }
+        path = QString::fromUtf8(line.constData() + 130, line.size() - 130);
+        if(!valid_store_path(path) || archive_manifest.digests.contains(path)) {
+            error_message = ERR_DAMAGED_SNAPSHOT;
+            return false;
+        }
+        archive_manifest.paths.append(path);
+        archive_manifest.digests.insert(path, line.left(128));
+    }
+
+    return true;
+}
+
+bool SnapshotReader::read_file(QString& path, QByteArray& contents) {
+    char type;
+    QByteArray data;
+    if(!read_record(type, path, data)) return false;
+    if(type == SNAPSHOT_END) return false;
+    if(type != SNAPSHOT_FILE) {
+        error_message = ERR_DAMAGED_SNAPSHOT;
+        return false;
+    }
+
+    //Files must be those of the manifest, byte for byte
+    contents = qUncompress(data);
+    if(!archive_manifest.digests.contains(path) || (sha512_hex_digest(contents) != archive_manifest.digests.value(path))) {
+        error_message = ERR_DAMAGED_SNAPSHOT;
+        return false;
+    }
+
+    return true;
+}
+
+bool SnapshotReader::finish() {
+    unsigned char archive_mac[SNAPSHOT_MAC_LENGTH], expected_mac[SNAPSHOT_MAC_LENGTH];
+    if(input->read((char*) archive_mac, SNAPSHOT_MAC_LENGTH) != SNAPSHOT_MAC_LENGTH) {
+        error_message = ERR_TRUNCATED_SNAPSHOT;
+        return false;
+    }
+    cipher.mac.finish(expected_mac);
+    if((memcmp((const void*) archive_mac, (const void*) expected_mac, SNAPSHOT_MAC_LENGTH) != 0) || !input->atEnd()) {
+        error_message = ERR_DAMAGED_SNAPSHOT;
+        return false;
+    }
+
+    return true;
+}
+
+bool SnapshotReader::read_record(char& type, QString& path, QByteArray& data) {
+    if(!read_decrypted(&type, 1)) return false;
+    uint32_t length;
+    if(!read_length(length)) return false;
+    QByteArray utf8_path(length, '\0');
+    if(!read_decrypted(utf8_path.data(), length)) return false;
+    path = QString::fromUtf8(utf8_path.constData(), utf8_path.size());
+    if(!read_length(length)) return false;
+    data = QByteArray(length, '\0');
+    return read_decrypted(data.data(), length);
+}
+
+bool SnapshotReader::read_decrypted(char* dest_buffer, size_t length) {
+    if(!length) return true;
+
+    if(input->read(dest_buffer, length) != (qint64) length) {
+        error_message = ERR_TRUNCATED_SNAPSHOT;
+        return false;
+    }
+    cipher.mac.update(dest_buffer, length);
+    cipher.apply_keystream(dest_buffer, length);
+
+    return true;
+}
+
+bool SnapshotReader::read_length(uint32_t& length) {
+    unsigned char length_bytes[4];
+    if(!read_decrypted((char*) length_bytes, 4)) return false;
+    length = (uint32_t) get_be_uint(length_bytes, 4);
+    if(length > SNAPSHOT_MAX_RECORD_LENGTH) {
+        error_message = ERR_DAMAGED_SNAPSHOT;
+        return false;
+    }
+
+    return true;
+}
+
+QString snapshot_filename(const uint64_t number) {
+    return SNAPSHOT_FILENAME.arg(number);
+}
+
+uint64_t last_snapshot_number(const QDir& snapshot_dir) {
+    uint64_t last_number = 0;
+    QStringList snapshot_dir_contents = snapshot_dir.entryList(QDir::Files);
+    for(int i = 0; i < snapshot_dir_contents.count(); ++i) {
+        const QString& filename = snapshot_dir_contents.at(i);
+        if(!filename.startsWith("snapshot_") || !filename.endsWith(".hss")) continue;
+        bool valid_number;
+        uint64_t number = filename.mid(9, filename.size() - 13).toULongLong(&valid_number);
+        if(valid_number && (number > last_number)) last_number = number;
+    }
+
+    return last_number;
+}
+
+bool read_file_contents(const QString& file_path, QByteArray& dest_buffer) {
+    QFile file(file_path);
+    if(!file.open(QIODevice::ReadOnly)) {
+        log_error(STORE_SNAPSHOT_NAME, ERR_FILE_OPEN_FAILURE.arg(file_path));
+        return false;
+    }
+    dest_buffer = file.readAll();
+    file.close();
+
+    return true;
+}
+
+bool read_snapshot_manifest(const QString& snapshot_path, const QString& password, SnapshotManifest& dest) {
+    //Go through the whole archive, so that incremental snapshots never rely on damaged ones
+    QFile snapshot_file(snapshot_path);
+    if(!snapshot_file.open(QIODevice::ReadOnly)) {
+        log_error(STORE_SNAPSHOT_NAME, ERR_FILE_OPEN_FAILURE.arg(snapshot_path));
+        return false;
+    }
+    SnapshotReader reader(&snapshot_file);
+    bool success = reader.start(password);
+    QString path;
+    QByteArray contents;
+    while(success && reader.read_file(path, contents)) {}
+    if(success) success = reader.error().isEmpty() && reader.finish();
+    snapshot_file.close();
+    if(!success) {
+        log_error(STORE_SNAPSHOT_NAME, ERR_BAD_SNAPSHOT.arg(snapshot_path).arg(reader.error()));
+        return false;
+    }
+
+    dest = reader.manifest();
+    return true;
+}
+
+bool generate_salt(const SnapshotManifest& manifest, const uint64_t number, unsigned char* salt) {
+    static const QString ERR_NO_RANDOM_SOURCE("No system random source, snapshot salts would be predictable");
+
+    //A salt must never come back for a given password, or keystreams would. Salts come from the
+    //system's random source, mixed with the time and what is being saved. Without one, give up.
+    QByteArray random_bytes;
+    #if defined(Q_OS_UNIX)
+        QFile random_source("/dev/urandom");
+        if(random_source.open(QIODevice::ReadOnly | QIODevice::Unbuffered)) {
+            random_bytes = random_source.read(64);
+            random_source.close();
+        }
+    #elif defined(Q_OS_WIN32)
+        random_bytes.resize(64);
+        if(!RtlGenRandom((PVOID) random_bytes.data(), 64)) random_bytes.clear();
+    #endif
+    if(random_bytes.size() != 64) {
+        log_error(STORE_SNAPSHOT_NAME, ERR_NO_RANDOM_SOURCE);
+        return false;
+    }
+    SHA512Stream stream;
+    stream.update(random_bytes.constData(), random_bytes.size());
+    random_bytes.fill(0);
+    time_t current_time = time(NULL);
+    clock_t current_clock = clock();
+    stream.update((const char*) &current_time, sizeof(time_t));
+    stream.update((const char*) &current_clock, sizeof(clock_t));
+    stream.update((const char*) &number, sizeof(uint64_t));
+    for(int i = 0; i < manifest.paths.count(); ++i) {
+        QByteArray digest = manifest.digests.value(manifest.paths.at(i));
+        stream.update(digest.constData(), digest.size());
+    }
+
+    unsigned char digest[64];
+    stream.finish(digest);
+    memcpy((void*) salt, (const void*) digest, SNAPSHOT_SALT_LENGTH);
+    return true;
+}
+
+bool create_snapshot(const QDir& data_dir,
+                     const QStringList& store_paths,
+                     const QDir& snapshot_dir,
+                     const QString& password,
+                     const uint64_t iterations,
+                     const bool full,
+                     SnapshotReport& report) {
+    report.stored_files = 0;
+    report.total_files = store_paths.count();
+    if(!snapshot_dir.mkpath(snapshot_dir.absolutePath())) {
+        log_error(STORE_SNAPSHOT_NAME, ERR_FOLDER_CREATION_FAILURE.arg(snapshot_dir.absolutePath()));
+        return false;
+    }
+
+    //Hash the store
+    SnapshotManifest manifest;
+    QByteArray contents;
+    for(int i = 0; i < store_paths.count(); ++i) {
+        if(!read_file_contents(data_dir.filePath(store_paths.at(i)), contents)) return false;
+        manifest.paths.append(store_paths.at(i));
+        manifest.digests.insert(store_paths.at(i), sha512_hex_digest(contents));
+    }
+
+    //Incremental snapshots only store what changed since the last snapshot
+    SnapshotHeader header;
+    uint64_t last_number = last_snapshot_number(snapshot_dir);
+    SnapshotManifest previous_manifest;
+    if(!full && last_number) {
+        if(!read_snapshot_manifest(snapshot_dir.filePath(snapshot_filename(last_number)), password, previous_manifest)) {
+            return false;
+        }
+    }
+    header.number = last_number + 1;
+    header.base = full ? 0 : last_number;
+    header.iterations = iterations;
+    if(!generate_salt(manifest, header.number, header.salt)) return false;
+    report.number = header.number;
+    report.base = header.base;
+
+    //Write the snapshot under a temporary name, which it loses once complete
+    QString snapshot_path = snapshot_dir.filePath(snapshot_filename(header.number));
+    QFile snapshot_file(snapshot_path + PARTIAL_SNAPSHOT_SUFFIX);
+    if(!snapshot_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        log_error(STORE_SNAPSHOT_NAME, ERR_FILE_OPEN_FAILURE.arg(snapshot_file.fileName()));
+        return false;
+    }
+    SnapshotWriter writer(&snapshot_file);
+    bool success = writer.start(password, header) && writer.write_manifest(manifest);
+    for(int i = 0; success && (i < manifest.paths.count()); ++i) {
+        const QString& path = manifest.paths.at(i);
+        const QByteArray& digest = manifest.digests.value(path);
+        if(previous_manifest.digests.value(path) == digest) continue;
+
+        //Files are read again one at a time, and must not have changed since they were hashed
+        static const QString ERR_STORE_CHANGED("%1 changed while the snapshot was being written");
+        success = read_file_contents(data_dir.filePath(path), contents);
+        if(success && (sha512_hex_digest(contents) != digest)) {
+            log_error(STORE_SNAPSHOT_NAME, ERR_STORE_CHANGED.arg(path));
+            success = false;
+        }
+        if(success) success = writer.write_file(path, contents);
+        if(success) ++report.stored_files;
+    }
+    if(success) success = writer.finish();
+    if(!writer.error().isEmpty()) log_error(STORE_SNAPSHOT_NAME, ERR_BAD_SNAPSHOT.arg(snapshot_file.fileName()).arg(writer.error()));
+    snapshot_file.close();
+    if(success) success = snapshot_file.rename(snapshot_path);
+    if(!success) {
+        snapshot_file.remove();
+        return false;
+    }
+
+    return true;
+}
+
+bool remove_directory(const QString& directory_path) {
+    QDir directory(directory_path);
+    if(!directory.exists()) return true;
+    QFileInfoList directory_contents = directory.entryInfoList(QDir::AllEntries | QDir::NoDotAndDotDot | QDir::Hidden);
+    for(int i = 0; i < directory_contents.count(); ++i) {
+        const QFileInfo& entry = directory_contents.at(i);
+        bool success;
+        if(entry.isDir()) {
+            success = remove_directory(entry.absoluteFilePath());
+        } else {
+            success = QFile::remove(entry.absoluteFilePath());
+        }
+        if(!success) return false;
+    }
+
+    return directory.rmdir(directory.absolutePath());
+}
+
+bool write_staged_file(const QDir& staging_dir, const QString& path, const QByteArray& contents) {
+    int last_slash = path.lastIndexOf('/');
+    if((last_slash != -1) && !staging_dir.mkpath(path.left(last_slash))) {
+        log_error(STORE_SNAPSHOT_NAME, ERR_FOLDER_CREATION_FAILURE.arg(staging_dir.filePath(path.left(last_slash))));
+        return false;
+    }
+    QFile staged_file(staging_dir.filePath(path));
+    if(!staged_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        log_error(STORE_SNAPSHOT_NAME, ERR_FILE_OPEN_FAILURE.arg(staged_file.fileName()));
+        return false;
+    }
+    bool success = (staged_file.write(contents) == contents.size());
+    staged_file.close();
+
+    return success;
+}
+
+bool install_staged_files(const QDir& staging_dir, const SnapshotManifest& manifest, QDir& data_dir, const QStringList& store_paths) {
+    static const QString ERR_INSTALL_FAILURE("%1 could not be restored");
+    for(int i = 0; i < store_paths.count(); ++i) {
+        if(!manifest.digests.contains(store_paths.at(i))) data_dir.remove(store_paths.at(i));
+    }
+    for(int i = 0; i < manifest.paths.count(); ++i) {
+        const QString& path = manifest.paths.at(i);
+        int last_slash = path.lastIndexOf('/');
+        if(last_slash != -1) data_dir.mkpath(path.left(last_slash));
+        if(data_dir.exists(path)) data_dir.remove(path);
+        if(!QFile::rename(staging_dir.filePath(path), data_dir.filePath(path))) {
+            log_error(STORE_SNAPSHOT_NAME, ERR_INSTALL_FAILURE.arg(data_dir.filePath(path)));
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool restore_snapshot(const QDir& snapshot_dir,
+                      const uint64_t number,
+                      const QString& password,
+                      QDir* data_dir,
+                      const QStringList& store_paths,
+                      SnapshotReport& report) {
+    static const QString ERR_NO_SNAPSHOT("There is no snapshot in %1");
+    static const QString ERR_BROKEN_CHAIN("Files of %1 are missing from the snapshots it is incremental to");
+    report.number = number ? number : last_snapshot_number(snapshot_dir);
+    report.base = 0;
+    report.stored_files = 0;
+    report.total_files = 0;
+    if(!report.number) {
+        log_error(STORE_SNAPSHOT_NAME, ERR_NO_SNAPSHOT.arg(snapshot_dir.absolutePath()));
+        return false;
+    }
+
+    //Files are staged in the data directory until every archive has been checked
+    QString staging_path;
+    if(data_dir) {
+        staging_path = data_dir->filePath(RESTORE_STAGING_DIRECTORY);
+        if(!remove_directory(staging_path) || !data_dir->mkpath(RESTORE_STAGING_DIRECTORY)) {
+            log_error(STORE_SNAPSHOT_NAME, ERR_FOLDER_CREATION_FAILURE.arg(staging_path));
+            return false;
+        }
+    }
+    QDir staging_dir(staging_path);
+
+    //Walk the chain of snapshots back, taking each file of the requested snapshot from the newest
+    //archive which holds it
+    SnapshotManifest manifest;
+    QHash<QString, bool> missing_files;
+    uint64_t current_number = report.number;
+    bool success = true;
+    while(success) {
+        QString snapshot_path = snapshot_dir.filePath(snapshot_filename(current_number));
+        QFile snapshot_file(snapshot_path);
+        if(!snapshot_file.open(QIODevice::ReadOnly)) {
+            log_error(STORE_SNAPSHOT_NAME, ERR_FILE_OPEN_FAILURE.arg(snapshot_path));
+            success = false;
+            break;
+        }
+        SnapshotReader reader(&snapshot_file);
+        success = reader.start(password);
+        if(success && (reader.header().number != current_number)) success = false;
+        if(success && (current_number == report.number)) {
+            manifest = reader.manifest();
+            report.base = reader.header().base;
+            report.total_files = manifest.paths.count();
+            for(int i = 0; i < manifest.paths.count(); ++i) missing_files.insert(manifest.paths.at(i), true);
+        }
+
+        QString path;
+        QByteArray contents;
+        while(success && reader.read_file(path, contents)) {
+            if(!missing_files.contains(path)) continue;
+            if(reader.manifest().digests.value(path) != manifest.digests.value(path)) continue; //Older version
+            if(data_dir) success = write_staged_file(staging_dir, path, contents);
+            missing_files.remove(path);
+            ++report.stored_files;
+        }
+        if(success) success = reader.error().isEmpty() && reader.finish();
+        snapshot_file.close();
+        if(!success) {
+            QString error_message = reader.error().isEmpty() ? ERR_DAMAGED_SNAPSHOT : reader.error();
+            log_error(STORE_SNAPSHOT_NAME, ERR_BAD_SNAPSHOT.arg(snapshot_path).arg(error_message));
+            break;
+        }
+
+        //Base snapshots always come before the ones which are incremental to them
+        uint64_t base = reader.header().base;
+        if((missing_files.count() == 0) || (base == 0) || (base >= current_number)) break;
+        current_number = base;
+    }
+    if(success && (missing_files.count() != 0)) {
+        log_error(STORE_SNAPSHOT_NAME, ERR_BROKEN_CHAIN.arg(snapshot_filename(report.number)));
+        success = false;
+    }
+
+    if(success && data_dir) success = install_staged_files(staging_dir, manifest, *data_dir, store_paths);
+    if(data_dir) remove_directory(staging_path);
+    return success;
+}
+
+bool test_hmac_sha512_stream() {
+    //RFC 4231 test cases 1 to 4, 6 and 7 (test case 5 checks truncated outputs), fed in pieces,
+    //each message being authenticated twice to check that finish() starts a new one
+    struct HMACTestVector {
+        const char* key;
+        size_t key_length;
+        const char* message;
+        size_t message_length;
+        const char* mac;
+    };
+    static const QByteArray KEY_0B(20, '\x0b');
+    static const QByteArray KEY_AA(20, '\xaa');
+    static const QByteArray KEY_01_19("\x01\x02\x03\x04\x05\x06\x07\x08\x09\x0a\x0b\x0c\x0d\x0e\x0f\x10\x11\x12\x13\x14\x15\x16\x17\x18\x19");
+    static const QByteArray LONG_KEY_AA(131, '\xaa');
+    static const QByteArray DATA_DD(50, '\xdd');
+    static const QByteArray DATA_CD(50, '\xcd');
+    static const char LONG_KEY_MESSAGE[] = "Test Using Larger Than Block-Size Key - Hash Key First";
+    static const char LONG_DATA_MESSAGE[] = "This is a test using a larger than block-size key and a larger than block-size data. "
+                                            "The key needs to be hashed before being used by the HMAC algorithm.";
+    const HMACTestVector VECTORS[] = {
+        {KEY_0B.constData(), 20, "Hi There", 8,
+         "87aa7cdea5ef619d4ff0b4241a1d6cb02379f4e2ce4ec2787ad0b30545e17cde"
+         "daa833b7d6b8a702038b274eaea3f4e4be9d914eeb61f1702e696c203a126854"},
+        {"Jefe", 4, "what do ya want for nothing?", 28,
+         "164b7a7bfcf819e2e395fbe73b56e0a387bd64222e831fd610270cd7ea250554"
+         "9758bf75c05a994a6d034f65f8f0e6fdcaeab1a34d4a6b4b636e070a38bce737"},
+        {KEY_AA.constData(), 20, DATA_DD.constData(), 50,
+         "fa73b0089d56a284efb0f0756c890be9b1b5dbdd8ee81a3655f83e33b2279d39"
+         "bf3e848279a722c806b485a47e67c807b946a337bee8942674278859e13292fb"},
+        {KEY_01_19.constData(), 25, DATA_CD.constData(), 50,
+         "b0ba465637458c6990e5a8c5f61d4af7e576d97ff94b872de76f8050361ee3db"
+         "a91ca5c11aa25eb4d679275cc5788063a5f19741120c4f2de2adebeb10a298dd"},
+        {LONG_KEY_AA.constData(), 131, LONG_KEY_MESSAGE, sizeof(LONG_KEY_MESSAGE) - 1,
+         "80b24263c7c1a3ebb71493c1dd7be8b49b46d1f41b4aeec1121b013783f8f352"
+         "6b56d037e05f2598bd0fd2215d6a1e5295e64f73f63f0aec8b915a985d786598"},
+        {LONG_KEY_AA.constData(), 131, LONG_DATA_MESSAGE, sizeof(LONG_DATA_MESSAGE) - 1,
+         "e37b6a775dc87dbaa4dfa9f96e5e3ffddebd71f8867289865df5a32d20cdc944"
+         "b6022cac3c4982b10d5eeb55c3e4de15134676fb6de0446065c97440fa8c6a58"}};
+    static const QString ERR_MAC_MISMATCH("HMAC-SHA512 test case %1 : got MAC %2\nExpected MAC : %3");
+    const size_t piece_length = 37;
+
+    HMACSHA512Stream stream;
+    unsigned char mac[64];
+    for(size_t i = 0; i < sizeof(VECTORS)/sizeof(HMACTestVector); ++i) {
+        const HMACTestVector& vector = VECTORS[i];
+        stream.set_key((const unsigned char*) vector.key, vector.key_length);
+        for(int pass = 0; pass < 2; ++pass) {
+            for(size_t offset = 0; offset < vector.message_length; offset+= piece_length) {
+                size_t length = vector.message_length - offset;
+                stream.update(vector.message + offset, (length < piece_length) ? length : piece_length);
+            }
+            stream.finish(mac);
+            QByteArray hex_mac = QByteArray((const char*) mac, 64).toHex();
+            if(hex_mac != vector.mac) {
+                log_error(STORE_SNAPSHOT_NAME, ERR_MAC_MISMATCH.arg(i + 1).arg(QString(hex_mac)).arg(vector.mac));
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+bool test_store_snapshots() {
+    static const QString ERR_ROUND_TRIP("Snapshot round trip : %1");
+    static const QString ERR_UNDETECTED("Snapshot damage was not detected : %1");
+    static const char* const FILE_PATHS[] = {"settings.txt", "services/1.txt", "services/2.txt"};
+    static const char* const FILE_CONTENTS[] = {"acceptable_latency : 50\n", "service : Mail\n", ""};
+
+    if(!test_hmac_sha512_stream()) return false;
+
+    SnapshotManifest manifest;
+    for(int i = 0; i < 3; ++i) {
+        manifest.paths.append(FILE_PATHS[i]);
+        manifest.digests.insert(FILE_PATHS[i], sha512_hex_digest(QByteArray(FILE_CONTENTS[i])));
+    }
+    SnapshotHeader header;
+    header.number = 2;
+    header.base = 1;
+    header.iterations = 2;
+    memset((void*) header.salt, 0x5a, SNAPSHOT_SALT_LENGTH);
+
+    //Write a snapshot holding two of the files
+    QBuffer output;
+    output.open(QIODevice::WriteOnly);
+    SnapshotWriter writer(&output);
+    bool success = writer.start("master password", header) && writer.write_manifest(manifest);
+    if(success) success = writer.write_file(FILE_PATHS[0], QByteArray(FILE_CONTENTS[0]));
+    if(success) success = writer.write_file(FILE_PATHS[2], QByteArray(FILE_CONTENTS[2]));
+    if(success) success = writer.finish();
+    output.close();
+    if(!success) {
+        log_error(STORE_SNAPSHOT_NAME, ERR_ROUND_TRIP.arg(writer.error()));
+        return false;
+    }
+    QByteArray archive = output.data();
+
+    //Read it back
+    {
+        QBuffer input(&archive);
+        input.open(QIODevice::ReadOnly);
+        SnapshotReader reader(&input);
+        success = reader.start("master password");
+        success = success && (reader.header().number == 2) && (reader.header().base == 1);
+        success = success && (reader.manifest().paths.count() == 3);
+        for(int i = 0; success && (i < 3); ++i) {
+            success = (reader.manifest().digests.value(FILE_PATHS[i]) == manifest.digests.value(FILE_PATHS[i]));
+        }
+        QString path;
+        QByteArray contents;
+        for(int i = 0; success && (i <= 2); i+= 2) {
+            success = reader.read_file(path, contents) && (path == FILE_PATHS[i]) && (contents == FILE_CONTENTS[i]);
+        }
+        success = success && !reader.read_file(path, contents) && reader.error().isEmpty() && reader.finish();
+        if(!success) {
+            log_error(STORE_SNAPSHOT_NAME, ERR_ROUND_TRIP.arg(reader.error()));
+            return false;
+        }
+    }
+
+    //A wrong password, then damage anywhere in the archive, must make reading fail
+    for(int damaged_byte = -2; damaged_byte < archive.size(); damaged_byte+= 7) {
+        QByteArray damaged_archive = archive;
+        QString password("master password");
+        if(damaged_byte == -2) password = "master passwore";
+        if(damaged_byte == -1) damaged_archive.chop(1);
+        if(damaged_byte >= 0) damaged_archive[damaged_byte] = damaged_archive.at(damaged_byte) ^ 0x20;
+
+        QBuffer input(&damaged_archive);
+        input.open(QIODevice::ReadOnly);
+        SnapshotReader reader(&input);
+        success = reader.start(password);
+        QString path;
+        QByteArray contents;
+        while(success && reader.read_file(path, contents)) {}
+        if(success) success = reader.error().isEmpty() && reader.finish();
+        if(success) {
+            log_error(STORE_SNAPSHOT_NAME, ERR_UNDETECTED.arg(damaged_byte));
+            return false;
+        }
+    }
+
+    return true;
+}
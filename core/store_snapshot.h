@@ -0,0 +1,174 @@
+/* Store snapshots : compressed and encrypted backups of the service store, which may be
+   incremental, and their restoration.
+
+      Copyright (C) 2011  Hadrien Grasland
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA */
+
+#ifndef STORE_SNAPSHOT_H
+#define STORE_SNAPSHOT_H
+
+#include <QByteArray>
+#include <QDir>
+#include <QHash>
+#include <QIODevice>
+#include <QString>
+#include <QStringList>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <crypto_hash.h>
+
+#define SNAPSHOT_SALT_LENGTH 16 //Bytes of PBKDF2 salt, unique to each snapshot
+#define SNAPSHOT_MAX_ITERATIONS 16777216 //Of PBKDF2. More is taken for a damaged header, which
+                                         //could otherwise keep restorations busy for days.
+#define SNAPSHOT_MAX_RECORD_LENGTH 16777216 //Bytes. Longer records are taken for damage, before
+                                            //the archive's MAC can be checked.
+
+//Snapshots of a directory are files called snapshot_<number>.hss, numbered from 1. Each one is :
+//  - A plaintext header : "HSHSNAP1", number, base, PBKDF2 iterations (big-endian quadwords), salt
+//  - HMAC-SHA512 of the header, so that wrong passwords are told from damaged archives
+//  - Encrypted records : type byte, path length, path, data length, data (lengths are big-endian
+//    32-bit integers). The manifest record comes first, then file records, then an end record.
+//  - HMAC-SHA512 of everything above
+//The manifest lists every file of the store with its SHA-512, in sha512sum's format. File records
+//only hold files which changed since the base snapshot (all of them in full snapshots), compressed.
+enum SnapshotRecordType {SNAPSHOT_MANIFEST = 'M', SNAPSHOT_FILE = 'F', SNAPSHOT_END = 'E'};
+
+struct SnapshotHeader {
+    uint64_t number;
+    uint64_t base; //Snapshot which this one is incremental to, 0 for full snapshots
+    uint64_t iterations; //Of PBKDF2
+    unsigned char salt[SNAPSHOT_SALT_LENGTH];
+};
+
+//Files of a store, as paths relative to its data directory
+struct SnapshotManifest {
+    QStringList paths;
+    QHash<QString, QByteArray> digests; //Lowercase hexadecimal SHA-512 of each file
+    void clear() {paths.clear(); digests.clear();}
+};
+
+//HMAC-SHA512 of byte strings, fed incrementally. Wiped on destruction.
+class HMACSHA512Stream {
+  public:
+    HMACSHA512Stream();
+    ~HMACSHA512Stream();
+    void set_key(const unsigned char* key, size_t key_length); //Also starts a new message
+    void update(const char* bytes, size_t length);
+    void finish(unsigned char* digest); //Writes the 64-byte MAC, then starts a new message
+  private:
+    unsigned char inner_key_pad[128];
+    unsigned char outer_key_pad[128];
+    SHA512Stream inner_stream;
+
+    HMACSHA512Stream(const HMACSHA512Stream&);
+    HMACSHA512Stream& operator=(const HMACSHA512Stream&);
+};
+bool test_hmac_sha512_stream(); //Check RFC 4231 test cases
+
+//Keys of an archive are 128 bytes of PBKDF2-HMAC-SHA512 of the password and the archive's salt :
+//an encryption key, then a MAC key. Block i of the keystream is HMAC-SHA512(encryption key, i).
+class SnapshotCipher {
+  public:
+    SnapshotCipher();
+    ~SnapshotCipher();
+    bool set_password(const QString& password, const SnapshotHeader& header); //Runs PBKDF2
+    void apply_keystream(char* bytes, size_t length); //Encrypts or decrypts, in place
+    HMACSHA512Stream mac;
+  private:
+    HMACSHA512Stream keystream_prf;
+    unsigned char keystream_block[64];
+    uint64_t keystream_offset; //In bytes
+
+    SnapshotCipher(const SnapshotCipher&);
+    SnapshotCipher& operator=(const SnapshotCipher&);
+};
+
+//Writes a snapshot archive as records come, so that files need not be held in memory together
+class SnapshotWriter {
+  public:
+    SnapshotWriter(QIODevice* output);
+    bool start(const QString& password, const SnapshotHeader& header); //Runs PBKDF2
+    bool write_manifest(const SnapshotManifest& manifest);
+    bool write_file(const QString& path, const QByteArray& contents);
+    bool finish(); //Writes the end record and the MAC
+    const QString& error() const {return error_message;}
+  private:
+    QIODevice* output;
+    SnapshotCipher cipher;
+    QString error_message;
+
+    bool write_record(const char type, const QString& path, const QByteArray& data);
+    bool write_encrypted(const char* bytes, size_t length);
+};
+
+//Reads a snapshot archive in one streaming pass. Each file is checked against the manifest as it
+//is read, and the whole archive against its MAC by finish(), so that damage is always detected.
+class SnapshotReader {
+  public:
+    SnapshotReader(QIODevice* input);
+    bool start(const QString& password); //Reads the header and runs PBKDF2
+    const SnapshotHeader& header() const {return archive_header;}
+    const SnapshotManifest& manifest() const {return archive_manifest;} //Read by start()
+    bool read_file(QString& path, QByteArray& contents); //False at the end record, or on errors
+    bool finish(); //Checks the MAC. Call once read_file() returned false without error.
+    const QString& error() const {return error_message;} //Empty unless reading failed
+  private:
+    QIODevice* input;
+    SnapshotCipher cipher;
+    SnapshotHeader archive_header;
+    SnapshotManifest archive_manifest;
+    QString error_message;
+
+    bool read_record(char& type, QString& path, QByteArray& data);
+    bool read_decrypted(char* dest_buffer, size_t length);
+    bool read_length(uint32_t& length);
+};
+
+//Outcome of snapshot operations, for reporting
+struct SnapshotReport {
+    uint64_t number;
+    uint64_t base;
+    int stored_files; //Files held in the snapshot (or, on restoration, read from the chain)
+    int total_files; //Files of the store
+};
+
+QString snapshot_filename(const uint64_t number);
+uint64_t last_snapshot_number(const QDir& snapshot_dir); //0 when there is no snapshot yet
+
+//Write a snapshot of a store, whose files are given relative to data_dir, in snapshot_dir.
+//Snapshots are incremental to the last one of snapshot_dir, unless full is set.
+bool create_snapshot(const QDir& data_dir,
+                     const QStringList& store_paths,
+                     const QDir& snapshot_dir,
+                     const QString& password,
+                     const uint64_t iterations,
+                     const bool full,
+                     SnapshotReport& report);
+
+//Check a snapshot (the last one if number is 0) and the ones it is incremental to. Unless data_dir
+//is NULL, then restore it over the store, once every archive of the chain has been checked :
+//store_paths which the snapshot does not have are removed.
+bool restore_snapshot(const QDir& snapshot_dir,
+                      const uint64_t number,
+                      const QString& password,
+                      QDir* data_dir,
+                      const QStringList& store_paths,
+                      SnapshotReport& report);
+
+bool test_store_snapshots(); //Write archives in memory, read them back, and damage them
+
+#endif // STORE_SNAPSHOT_H
@@ -0,0 +1,120 @@
+/* Test suite : a set of function to automatically test cryptographic hashes and other
+  mathematical functions against known-good input/output combinations.
+
+      Copyright (C) 2011  Hadrien Grasland
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA */
+
+#include <QCoreApplication>
+#include <stdint.h>
+#include <string.h>
+
+#include <crypto_hash.h>
+#include <error_management.h>
+#include <hmac.h>
+#include <password_cipher.h>
+#include <password_generator.h>
+#include <pbkdf2.h>
+#include <qstring_to_qwords.h>
+#include <test_suite.h>
+
+const QString ERR_BAD_TEST_VECTOR("Test vector %1 of %2 is malformed.");
+const QString ERR_NO_TEST_VECTORS("No test vectors for %1.");
+const QString ERR_WRONG_RESULT("Got result : %1\nExpected   : %2");
+
+const QString WARNING_TESTS_FAILED(QCoreApplication::translate("CoreApplication", "It seems that Hashish has a problem with your computer, because it does its mathematics wrong. We recommend that you contact us about this problem, using the information which you will find in the About tab."));
+
+const TestVectorFile* test_vector_file(const QString& function_name) {
+    for(size_t i = 0; i < TEST_VECTOR_FILE_COUNT; ++i) {
+        if(function_name == QLatin1String(TEST_VECTOR_FILES[i].name)) return &(TEST_VECTOR_FILES[i]);
+    }
+
+    return NULL;
+}
+
+bool check_test_result(const QString& failing_component,
+                       size_t result_length,
+                       const uint64_t* result,
+                       const uint64_t* expected_result) {
+    if(memcmp((const void*) result, (const void*) expected_result, result_length*sizeof(uint64_t)) == 0) {
+        return true;
+    }
+
+    //Only convert results to text when something went wrong
+    QString result_str, expected_str;
+    qwords_to_hex_str(result_length, result, result_str);
+    qwords_to_hex_str(result_length, expected_result, expected_str);
+    log_error(failing_component, ERR_WRONG_RESULT.arg(result_str).arg(expected_str));
+    return false;
+}
+
+uint64_t* new_repeated_message(const QString& failing_component, const TestVector& vector) {
+    size_t long_message_length = vector.message_length*vector.repeat;
+    uint64_t* long_message = new uint64_t[long_message_length];
+    if(!long_message) {
+        log_error(failing_component, ERR_BAD_ALLOC.arg(QString("long_message")));
+        return NULL;
+    }
+    for(uint64_t i = 0; i < vector.repeat; ++i) {
+        memcpy((void*) (long_message + i*vector.message_length),
+               (const void*) vector.message,
+               vector.message_length*sizeof(uint64_t));
+    }
+
+    return long_message;
+}
+
+bool full_self_test() {
+    if(test_crypto_hashes() == false) return false;
+    if(test_hmacs() == false) return false;
+    if(test_pbkdf2() == false) return false;
+    if(test_password_ciphers() == false) return false;
+    if(test_password_generators() == false) return false;
+    if(test_qword_conversions() == false) return false;
+
+    return true;
+}
+
+const QString QUICK_SELF_TEST_NAME("QuickSelfTest");
+
+bool quick_self_test() {
+    //Use the first vector of the default hash and HMAC's test files
+    CryptoHash* hash = crypto_hash_database("SHA-512");
+    HMAC* hmac = hmac_database("RFC 2104");
+    if((!hash) || (!hmac)) return false;
+    const TestVectorFile* hash_tests = test_vector_file(hash->name());
+    const TestVectorFile* hmac_tests = test_vector_file(hmac->name());
+    if((!hash_tests) || (!hmac_tests)) {
+        log_error(QUICK_SELF_TEST_NAME, ERR_NO_TEST_VECTORS.arg(hash_tests ? hmac->name() : hash->name()));
+        return false;
+    }
+    const TestVector& hash_vector = hash_tests->vectors[0];
+    const TestVector& hmac_vector = hmac_tests->vectors[0];
+
+    size_t result_length = hash->hash_length();
+    uint64_t result[result_length];
+    if(!hash->hash(hash_vector.message_length, hash_vector.message, result)) return false;
+    if(!check_test_result(QUICK_SELF_TEST_NAME, result_length, result, hash_vector.result)) return false;
+
+    if(!hmac->hmac(hmac_vector.key_length,
+                   hmac_vector.key,
+                   hmac_vector.message_length,
+                   hmac_vector.message,
+                   hash,
+                   result)) return false;
+    if(!check_test_result(QUICK_SELF_TEST_NAME, result_length, result, hmac_vector.result)) return false;
+
+    return true;
+}
@@ -21,26 +21,38 @@
 #define TEST_SUITE_H
 
 #include <qstring.h>
+#include <stddef.h>
+#include <stdint.h>
 
+#include <test_vectors.h>
+
+extern const QString ERR_BAD_TEST_VECTOR; //Error that is logged when a test vector cannot be used by the
+                                          //function being tested. First argument is the vector's index,
+                                          //second argument is the name of the function.
+extern const QString ERR_NO_TEST_VECTORS; //Error that is logged when a function has no test vectors.
+                                          //Argument is the name of the function.
 extern const QString ERR_WRONG_RESULT; //Error that is logged when a test leads to the wrong result. First
                                        //argument is the result that is obtained, second argument is the
                                        //result that should have been obtained.
 
-//IDs that are used in test files
-extern const QString ID_CACHED_DATA;
-extern const QString ID_CONSTRAINTS;
-extern const QString ID_HASH;
-extern const QString ID_HMAC;
-extern const QString ID_KEY;
-extern const QString ID_MESSAGE;
-extern const QString ID_RESULT;
+extern const QString WARNING_TESTS_FAILED; //Warning to be displayed in the UI when some of the
+                                           //startup tests of Hashish have failed.
+
+//Fetch the test vectors of a cryptographic function (NULL if there are none)
+const TestVectorFile* test_vector_file(const QString& function_name);
 
-extern const QString TEST_FILE_HEADER; //Header of a test file
+//Compare a result with the expected one, logging an error on behalf of failing_component if
+//they differ
+bool check_test_result(const QString& failing_component,
+                       size_t result_length,
+                       const uint64_t* result,
+                       const uint64_t* expected_result);
 
-extern const QString TEST_VEC_FILEPATH; //Location of the test files (first argument is the name
-                                        //of the cryptographic function that is being tested)
+//Long message tests : allocate and fill a buffer with the vector's message, repeated as many
+//times as requested. The caller must delete[] it.
+uint64_t* new_repeated_message(const QString& failing_component, const TestVector& vector);
 
-extern const QString WARNING_TESTS_FAILED; //Warning to be displayed in the UI when some of the
-                                           //startup tests of Hashish have failed.
+bool full_self_test(); //Check all cryptographic functions against their known test vectors
+bool quick_self_test(); //Only check the default hash and HMAC against one known answer each
 
 #endif // TEST_SUITE_H
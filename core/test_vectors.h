@@ -0,0 +1,64 @@
+/* Test vectors : known-good results of Hashish's cryptographic functions, compiled into the
+   binary from the .testvecs files of the Tests directory by Tests/testvecs_to_cpp.py
+
+      Copyright (C) 2011  Hadrien Grasland
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA */
+
+#ifndef TEST_VECTORS_H
+#define TEST_VECTORS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+//A single test vector. Each cryptographic function only uses the fields that it needs, the
+//other ones are left empty (zero length and NULL pointer).
+struct TestVector {
+    //Input data
+    size_t key_length;
+    const uint64_t* key;
+    size_t message_length;
+    const uint64_t* message;
+    uint64_t repeat; //Long message tests : the actual message is "message" repeated that many times
+    uint64_t monte_carlo; //If nonzero, NIST Monte Carlo test with that many checkpoints. The message
+                          //is then the seed, and the result is the last checkpoint.
+
+    //Password generator parameters
+    bool case_sensitivity;
+    int number_of_caps;
+    int number_of_digits;
+    int maximal_length;
+    const char* extra_symbols; //UTF-8
+    uint64_t constraint_counter;
+
+    //Known-good result, either as qwords or as text (UTF-8)
+    size_t result_length;
+    const uint64_t* result;
+    const char* result_text;
+};
+
+//All test vectors of a cryptographic function
+struct TestVectorFile {
+    const char* name; //Name of the tested function
+    const char* hash; //Hash to be used by HMACs, ciphers and generators (NULL if none)
+    const char* hmac; //HMAC to be used by generators (NULL if none)
+    size_t vector_count;
+    const TestVector* vectors;
+};
+
+extern const TestVectorFile TEST_VECTOR_FILES[]; //Generated at build time
+extern const size_t TEST_VECTOR_FILE_COUNT;
+
+#endif // TEST_VECTORS_H
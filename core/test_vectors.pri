@@ -0,0 +1,16 @@
+# Compiles the test files of the top-level Tests directory into C++ tables (test_vector_data.cpp),
+# which the test suite uses instead of parsing them at runtime.
+
+isEmpty(PYTHON): PYTHON = python
+
+TEST_VECTOR_FILES = $$files($$PWD/../Tests/*.testvecs)
+
+test_vectors.input = TEST_VECTOR_FILES
+test_vectors.output = test_vector_data.cpp
+test_vectors.commands = $$PYTHON $$PWD/../Tests/testvecs_to_cpp.py $$PWD/../Tests ${QMAKE_FILE_OUT}
+test_vectors.depends = $$PWD/../Tests/testvecs_to_cpp.py $$PWD/test_vectors.h
+test_vectors.CONFIG += combine
+test_vectors.variable_out = SOURCES
+QMAKE_EXTRA_COMPILERS += test_vectors
+
+INCLUDEPATH += $$PWD
@@ -0,0 +1,354 @@
+/* Password pipeline tracing : spans around the stages of password computation, aggregated into
+   per-stage latency histograms and kept in a ring buffer for Chrome trace-event export.
+
+      Copyright (C) 2011  Hadrien Grasland
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA */
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QMutexLocker>
+#include <QThread>
+#include <algorithm>
+#include <string.h>
+
+#include <error_management.h>
+#include <tracing.h>
+
+const QString PIPELINE_TRACER_NAME("PipelineTracer");
+
+const char* const TRACE_STAGE_NAMES[TRACE_STAGE_COUNT] = {"compute_password",
+                                                          "initial_key",
+                                                          "stretching",
+                                                          "generator_attempt",
+                                                          "cipher",
+                                                          "string_conversion",
+                                                          "descriptor_load",
+                                                          "descriptor_save",
+                                                          "encrypt_password"};
+const int STAGE_NAME_COLUMN_WIDTH = 20; //In latency breakdowns
+const int VALUE_COLUMN_WIDTH = 11;
+
+PipelineTracer pipeline_tracer;
+
+const char* trace_stage_name(const TraceStage stage) {
+    return TRACE_STAGE_NAMES[stage];
+}
+
+TraceStageStatistics::TraceStageStatistics() : count(0),
+                                               total_ns(0),
+                                               max_ns(0) {
+    memset((void*) histogram, 0, sizeof(histogram));
+}
+
+void TraceStageStatistics::merge(const TraceStageStatistics& other) {
+    count+= other.count;
+    total_ns+= other.total_ns;
+    if(other.max_ns > max_ns) max_ns = other.max_ns;
+    for(int i = 0; i < TRACE_HISTOGRAM_BUCKETS; ++i) histogram[i]+= other.histogram[i];
+}
+
+uint64_t TraceStageStatistics::percentile_ns(const int percent) const {
+    if(!count) return 0;
+
+    //Nearest-rank percentile, located in the histogram
+    uint64_t rank = (percent*count + 99)/100;
+    if(rank < 1) rank = 1;
+    uint64_t seen_spans = 0;
+    for(int i = 0; i < TRACE_HISTOGRAM_BUCKETS; ++i) {
+        seen_spans+= histogram[i];
+        if(seen_spans < rank) continue;
+        uint64_t bucket_end = (uint64_t) 1 << (i+1);
+        return (bucket_end < max_ns) ? bucket_end : max_ns;
+    }
+
+    return max_ns;
+}
+
+TraceThreadBuffer::TraceThreadBuffer() : events(TRACE_EVENT_BUFFER_LENGTH),
+                                         next_event(0),
+                                         events_wrapped(false),
+                                         in_use(true) {}
+
+TraceBufferLease::~TraceBufferLease() {
+    tracer->release_buffer(buffer);
+}
+
+bool event_started_before(const TraceEvent& event1, const TraceEvent& event2) {
+    return (event1.start_ns < event2.start_ns);
+}
+
+PipelineTracer::PipelineTracer() {
+    clock.start();
+}
+
+PipelineTracer::~PipelineTracer() {
+    //The destroying thread's lease would otherwise outlive us
+    if(thread_buffers.hasLocalData()) thread_buffers.setLocalData(NULL);
+    for(int i = 0; i < buffers.count(); ++i) delete buffers[i];
+}
+
+void PipelineTracer::record(const TraceStage stage, const qint64 start_ns, const qint64 duration_ns) {
+    uint64_t duration = (duration_ns > 0) ? duration_ns : 0;
+    int bucket = 0;
+    while((duration >> (bucket+1)) && (bucket < TRACE_HISTOGRAM_BUCKETS-1)) ++bucket;
+    quintptr thread_id = (quintptr) QThread::currentThreadId();
+
+    //Find this thread's buffer, or get one on its first span
+    TraceBufferLease* lease = thread_buffers.localData();
+    if(!lease) {
+        TraceThreadBuffer* buffer = acquire_buffer();
+        if(!buffer) return;
+        lease = new TraceBufferLease;
+        if(!lease) {
+            log_error(PIPELINE_TRACER_NAME, ERR_BAD_ALLOC.arg(QString("lease")));
+            release_buffer(buffer);
+            return;
+        }
+        lease->tracer = this;
+        lease->buffer = buffer;
+        thread_buffers.setLocalData(lease);
+    }
+    TraceThreadBuffer& buffer = *(lease->buffer);
+
+    QMutexLocker lock(&buffer.mutex);
+    TraceStageStatistics& stats = buffer.stage_stats[stage];
+    ++stats.count;
+    stats.total_ns+= duration;
+    if(duration > stats.max_ns) stats.max_ns = duration;
+    ++stats.histogram[bucket];
+
+    TraceEvent& event = buffer.events[buffer.next_event];
+    event.stage = stage;
+    event.thread_id = thread_id;
+    event.start_ns = start_ns;
+    event.duration_ns = duration;
+    ++buffer.next_event;
+    if(buffer.next_event == TRACE_EVENT_BUFFER_LENGTH) {
+        buffer.next_event = 0;
+        buffer.events_wrapped = true;
+    }
+}
+
+void PipelineTracer::reset() {
+    QMutexLocker buffers_lock(&buffers_mutex);
+    for(int i = 0; i < buffers.count(); ++i) {
+        QMutexLocker lock(&(buffers[i]->mutex));
+        for(int j = 0; j < TRACE_STAGE_COUNT; ++j) buffers[i]->stage_stats[j] = TraceStageStatistics();
+        buffers[i]->next_event = 0;
+        buffers[i]->events_wrapped = false;
+    }
+}
+
+TraceStageStatistics PipelineTracer::statistics(const TraceStage stage) const {
+    TraceStageStatistics result;
+    QMutexLocker buffers_lock(&buffers_mutex);
+    for(int i = 0; i < buffers.count(); ++i) {
+        QMutexLocker lock(&(buffers[i]->mutex));
+        result.merge(buffers[i]->stage_stats[stage]);
+    }
+
+    return result;
+}
+
+QList<QByteArray> PipelineTracer::stats_values() const {
+    QList<QByteArray> values;
+    for(int i = 0; i < TRACE_STAGE_COUNT; ++i) {
+        TraceStageStatistics stats = statistics((TraceStage) i);
+        if(!stats.count) continue;
+        QByteArray prefix = QByteArray(trace_stage_name((TraceStage) i)) + '_';
+        values << prefix + "count=" + QByteArray::number((qulonglong) stats.count);
+        values << prefix + "mean_us=" + QByteArray::number(stats.total_ns / (1000.0*stats.count), 'f', 1);
+        values << prefix + "p50_us=" + QByteArray::number(stats.percentile_ns(50) / 1000.0, 'f', 1);
+        values << prefix + "p99_us=" + QByteArray::number(stats.percentile_ns(99) / 1000.0, 'f', 1);
+        values << prefix + "max_us=" + QByteArray::number(stats.max_ns / 1000.0, 'f', 1);
+    }
+
+    return values;
+}
+
+QString PipelineTracer::latency_breakdown() const {
+    //Stages are nested in top-level ones, so their share of the top-level time is shown
+    TraceStageStatistics top_level_stats = statistics(TRACE_COMPUTE_PASSWORD);
+    top_level_stats.merge(statistics(TRACE_ENCRYPT_PASSWORD));
+    QString result = QString("stage").leftJustified(STAGE_NAME_COLUMN_WIDTH);
+    result+= QString("count").rightJustified(VALUE_COLUMN_WIDTH);
+    result+= QString("mean (us)").rightJustified(VALUE_COLUMN_WIDTH);
+    result+= QString("p50 (us)").rightJustified(VALUE_COLUMN_WIDTH);
+    result+= QString("p99 (us)").rightJustified(VALUE_COLUMN_WIDTH);
+    result+= QString("max (us)").rightJustified(VALUE_COLUMN_WIDTH);
+    result+= QString("share").rightJustified(VALUE_COLUMN_WIDTH);
+    for(int i = 0; i < TRACE_STAGE_COUNT; ++i) {
+        TraceStageStatistics stats = statistics((TraceStage) i);
+        if(!stats.count) continue;
+        result+= '\n';
+        result+= QString(trace_stage_name((TraceStage) i)).leftJustified(STAGE_NAME_COLUMN_WIDTH);
+        result+= QString::number((qulonglong) stats.count).rightJustified(VALUE_COLUMN_WIDTH);
+        result+= QString::number(stats.total_ns / (1000.0*stats.count), 'f', 1).rightJustified(VALUE_COLUMN_WIDTH);
+        result+= QString::number(stats.percentile_ns(50) / 1000.0, 'f', 1).rightJustified(VALUE_COLUMN_WIDTH);
+        result+= QString::number(stats.percentile_ns(99) / 1000.0, 'f', 1).rightJustified(VALUE_COLUMN_WIDTH);
+        result+= QString::number(stats.max_ns / 1000.0, 'f', 1).rightJustified(VALUE_COLUMN_WIDTH);
+        if(top_level_stats.total_ns && (i != TRACE_DESCRIPTOR_LOAD) && (i != TRACE_DESCRIPTOR_SAVE)) {
+            double share = (100.0*stats.total_ns) / top_level_stats.total_ns;
+            result+= (QString::number(share, 'f', 1) + '%').rightJustified(VALUE_COLUMN_WIDTH);
+        }
+    }
+
+    return result;
+}
+
+QByteArray PipelineTracer::chrome_trace() const {
+    //Complete ("X") events, with timestamps and durations in microseconds
+    QByteArray process_id = QByteArray::number((qlonglong) QCoreApplication::applicationPid());
+    QByteArray result = "{\"traceEvents\":[";
+
+    //Merge the events of every thread, and keep the most recent ones, oldest first
+    QVector<TraceEvent> events;
+    buffers_mutex.lock();
+    for(int i = 0; i < buffers.count(); ++i) {
+        QMutexLocker lock(&(buffers[i]->mutex));
+        int event_count = buffers[i]->events_wrapped ? TRACE_EVENT_BUFFER_LENGTH : buffers[i]->next_event;
+        for(int j = 0; j < event_count; ++j) events.append(buffers[i]->events.at(j));
+    }
+    buffers_mutex.unlock();
+    std::sort(events.begin(), events.end(), event_started_before);
+    int first_event = (events.count() > TRACE_EVENT_BUFFER_LENGTH) ? events.count() - TRACE_EVENT_BUFFER_LENGTH : 0;
+
+    for(int i = first_event; i < events.count(); ++i) {
+        const TraceEvent& event = events.at(i);
+        if(i != first_event) result+= ',';
+        result+= "\n{\"name\":\"";
+        result+= trace_stage_name(event.stage);
+        result+= "\",\"cat\":\"hashish\",\"ph\":\"X\",\"ts\":";
+        result+= QByteArray::number(event.start_ns / 1000.0, 'f', 3);
+        result+= ",\"dur\":";
+        result+= QByteArray::number(event.duration_ns / 1000.0, 'f', 3);
+        result+= ",\"pid\":";
+        result+= process_id;
+        result+= ",\"tid\":";
+        result+= QByteArray::number((qulonglong) event.thread_id);
+        result+= '}';
+    }
+    result+= "\n],\"displayTimeUnit\":\"ns\"}\n";
+
+    return result;
+}
+
+bool PipelineTracer::export_chrome_trace(const QString& filepath) const {
+    QFile trace_file(filepath);
+    if(!trace_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        log_error(PIPELINE_TRACER_NAME, ERR_FILE_OPEN_FAILURE.arg(filepath));
+        return false;
+    }
+    QByteArray trace = chrome_trace();
+    bool success = (trace_file.write(trace) == trace.size());
+    trace_file.close();
+
+    return success;
+}
+
+TraceThreadBuffer* PipelineTracer::acquire_buffer() {
+    QMutexLocker buffers_lock(&buffers_mutex);
+    for(int i = 0; i < buffers.count(); ++i) {
+        if(!buffers[i]->in_use) {
+            buffers[i]->in_use = true;
+            return buffers[i];
+        }
+    }
+
+    TraceThreadBuffer* buffer = new TraceThreadBuffer;
+    if(!buffer) {
+        log_error(PIPELINE_TRACER_NAME, ERR_BAD_ALLOC.arg(QString("buffer")));
+        return NULL;
+    }
+    buffers.append(buffer);
+    return buffer;
+}
+
+void PipelineTracer::release_buffer(TraceThreadBuffer* buffer) {
+    //Spans of exited threads are kept, and merged with those of the next thread using the buffer
+    QMutexLocker buffers_lock(&buffers_mutex);
+    buffer->in_use = false;
+}
+
+//Records spans of one stage from its own thread
+class TracerTestThread : public QThread {
+  public:
+    TracerTestThread(PipelineTracer& tracer) : tracer(tracer) {}
+  protected:
+    void run() {
+        for(int i = 1; i <= 100; ++i) tracer.record(TRACE_INITIAL_KEY, 300000 + i, 1000);
+    }
+  private:
+    PipelineTracer& tracer;
+};
+
+bool test_pipeline_tracer() {
+    static const QString ERR_TRACER_MISMATCH("Unexpected %1 on synthetic spans");
+
+    //Spans of 1, 2... 100 us, then enough cipher spans to wrap the event buffer around
+    PipelineTracer tracer;
+    for(int i = 1; i <= 100; ++i) tracer.record(TRACE_STRETCHING, 1000*i, 1000*i);
+    for(int i = 0; i < TRACE_EVENT_BUFFER_LENGTH; ++i) tracer.record(TRACE_CIPHER, 200000 + i, 1);
+
+    TraceStageStatistics stats = tracer.statistics(TRACE_STRETCHING);
+    if((stats.count != 100) || (stats.total_ns != 5050000) || (stats.max_ns != 100000)) {
+        log_error(PIPELINE_TRACER_NAME, ERR_TRACER_MISMATCH.arg("stage statistics"));
+        return false;
+    }
+
+    //Histogram percentiles are bucket upper bounds : the 50th span (50 us) lies in [32768, 65536) ns
+    if((stats.percentile_ns(50) != 65536) || (stats.percentile_ns(100) != 100000)) {
+        log_error(PIPELINE_TRACER_NAME, ERR_TRACER_MISMATCH.arg("percentiles"));
+        return false;
+    }
+
+    //Only the most recent spans are exported, oldest first
+    QByteArray trace = tracer.chrome_trace();
+    if(trace.contains("\"stretching\"") || (trace.count("\"cipher\"") != TRACE_EVENT_BUFFER_LENGTH)
+       || !trace.startsWith("{\"traceEvents\":[") || !trace.contains("\"ts\":200.000,")) {
+        log_error(PIPELINE_TRACER_NAME, ERR_TRACER_MISMATCH.arg("trace export"));
+        return false;
+    }
+
+    //Spans of other threads are merged with ours, in statistics and in the exported trace
+    TracerTestThread test_thread(tracer);
+    test_thread.start();
+    test_thread.wait();
+    trace = tracer.chrome_trace();
+    if((tracer.statistics(TRACE_INITIAL_KEY).count != 100) || (trace.count("\"initial_key\"") != 100)
+       || (trace.count("\"cipher\"") != TRACE_EVENT_BUFFER_LENGTH - 100) || !trace.contains("\"ts\":200.100,")) {
+        log_error(PIPELINE_TRACER_NAME, ERR_TRACER_MISMATCH.arg("thread merging"));
+        return false;
+    }
+
+    tracer.reset();
+    if(tracer.statistics(TRACE_CIPHER).count || !tracer.stats_values().isEmpty()) {
+        log_error(PIPELINE_TRACER_NAME, ERR_TRACER_MISMATCH.arg("reset"));
+        return false;
+    }
+
+    //Shares are relative to every top-level span, which nested stages cannot exceed
+    tracer.record(TRACE_COMPUTE_PASSWORD, 0, 1000);
+    tracer.record(TRACE_ENCRYPT_PASSWORD, 2000, 1000);
+    tracer.record(TRACE_STRETCHING, 0, 500);
+    tracer.record(TRACE_STRETCHING, 2000, 500);
+    if(!tracer.latency_breakdown().contains(" 50.0%")) {
+        log_error(PIPELINE_TRACER_NAME, ERR_TRACER_MISMATCH.arg("latency breakdown"));
+        return false;
+    }
+
+    return true;
+}
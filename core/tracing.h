@@ -0,0 +1,140 @@
+/* Password pipeline tracing : spans around the stages of password computation, aggregated into
+   per-stage latency histograms and kept in a ring buffer for Chrome trace-event export.
+
+      Copyright (C) 2011  Hadrien Grasland
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA */
+
+#ifndef TRACING_H
+#define TRACING_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QList>
+#include <QMutex>
+#include <QString>
+#include <QThreadStorage>
+#include <QVector>
+#include <stdint.h>
+
+//Tracing is built in unless HASHISH_NO_TRACING is defined ("CONFIG += no_tracing" in qmake), in
+//which case spans compile to nothing and the tracer stays empty.
+#define TRACE_HISTOGRAM_BUCKETS 40 //Bucket i counts spans lasting [2^i, 2^(i+1)) ns
+#define TRACE_EVENT_BUFFER_LENGTH 4096 //Most recent spans kept for trace export, by each thread
+
+//Traced stages of the password pipeline
+//Every other stage is nested in one of the top-level ones, compute_password and encrypt_password.
+enum TraceStage {TRACE_COMPUTE_PASSWORD = 0, //Whole ServiceDescriptor::compute_password()
+                 TRACE_INITIAL_KEY, //HMAC of the master password and service nonce
+                 TRACE_STRETCHING, //Iterated hashing of the initial key
+                 TRACE_GENERATOR_ATTEMPT, //One HMAC -> string -> constraints matching attempt
+                 TRACE_CIPHER, //Password encryption or decryption
+                 TRACE_STRING_CONVERSION, //qwords -> password string
+                 TRACE_DESCRIPTOR_LOAD, //ServiceDescriptor::load_from_file()
+                 TRACE_DESCRIPTOR_SAVE, //ServiceDescriptor::save_to_file()
+                 TRACE_ENCRYPT_PASSWORD, //Whole ServiceDescriptor::encrypt_password()
+                 TRACE_STAGE_COUNT};
+
+const char* trace_stage_name(const TraceStage stage);
+
+struct TraceStageStatistics {
+    uint64_t count;
+    uint64_t total_ns;
+    uint64_t max_ns;
+    uint64_t histogram[TRACE_HISTOGRAM_BUCKETS];
+
+    TraceStageStatistics();
+    void merge(const TraceStageStatistics& other);
+    uint64_t percentile_ns(const int percent) const; //Upper bound of the matching bucket, at most max_ns
+};
+
+struct TraceEvent {
+    TraceStage stage;
+    quintptr thread_id;
+    qint64 start_ns; //Since the tracer was created
+    qint64 duration_ns;
+};
+
+//Spans recorded by one thread. Its lock is only contended by exports and resets.
+struct TraceThreadBuffer {
+    TraceThreadBuffer();
+    QMutex mutex;
+    TraceStageStatistics stage_stats[TRACE_STAGE_COUNT];
+    QVector<TraceEvent> events;
+    int next_event; //Oldest event once the buffer has wrapped around
+    bool events_wrapped;
+    bool in_use; //Guarded by the tracer's buffer list lock
+};
+
+class PipelineTracer;
+
+//Ties a buffer to the thread recording into it, and gives it back to the tracer on thread exit
+struct TraceBufferLease {
+    PipelineTracer* tracer;
+    TraceThreadBuffer* buffer;
+    ~TraceBufferLease();
+};
+
+//Thread-safe collector of finished spans. Each thread records into its own buffer, so that traced
+//threads do not serialize on a shared lock. Buffers are merged when results are asked for.
+//Tracers must outlive the threads which record into them, save the one destroying them.
+class PipelineTracer {
+  public:
+    PipelineTracer();
+    ~PipelineTracer();
+    qint64 now_ns() const {return clock.nsecsElapsed();}
+    void record(const TraceStage stage, const qint64 start_ns, const qint64 duration_ns);
+    void reset();
+
+    //Results
+    TraceStageStatistics statistics(const TraceStage stage) const;
+    QList<QByteArray> stats_values() const; //<stage>_<statistic>=<value> items, for the IPC STATS command
+    QString latency_breakdown() const; //One line per traced stage, for humans
+    QByteArray chrome_trace() const; //Recent spans in Chrome's trace-event JSON format
+    bool export_chrome_trace(const QString& filepath) const;
+  private:
+    QList<TraceThreadBuffer*> buffers; //Buffers of threads which have exited are reused
+    mutable QMutex buffers_mutex; //Taken on the first span of each thread, by exports and resets
+    QElapsedTimer clock;
+    QThreadStorage<TraceBufferLease*> thread_buffers;
+
+    TraceThreadBuffer* acquire_buffer();
+    void release_buffer(TraceThreadBuffer* buffer);
+    friend struct TraceBufferLease;
+};
+
+extern PipelineTracer pipeline_tracer;
+
+//Records the lifetime of a scope as a span of the given stage
+class TraceSpan {
+  public:
+    TraceSpan(const TraceStage stage) : stage(stage), start_ns(pipeline_tracer.now_ns()) {}
+    ~TraceSpan() {pipeline_tracer.record(stage, start_ns, pipeline_tracer.now_ns() - start_ns);}
+  private:
+    TraceStage stage;
+    qint64 start_ns;
+};
+
+#ifdef HASHISH_NO_TRACING
+    #define TRACING_ENABLED false
+    #define TRACE_SPAN(stage)
+#else
+    #define TRACING_ENABLED true
+    #define TRACE_SPAN(stage) TraceSpan trace_span_##stage(stage)
+#endif
+
+bool test_pipeline_tracer(); //Check statistics and trace export on synthetic spans
+
+#endif // TRACING_H
@@ -1,8 +1,6 @@
-/* This unit provides facilities for deleting objects after a short time has elapsed.
-   This is typically useful when an object wants to destroy itself, which it obviously
-   cannot do in one of its methods.
+/* Error display : shows error messages to users of the graphical interface.
 
-      Copyright (C) 2011-2012  Hadrien Grasland
+      Copyright (C) 2011  Hadrien Grasland
 
     This program is free software; you can redistribute it and/or modify
     it under the terms of the GNU General Public License as published by
@@ -18,24 +16,14 @@
     along with this program; if not, write to the Free Software
     Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA */
 
+#include <QMessageBox>
 
-#ifndef DELAYED_DELETION_H
-#define DELAYED_DELETION_H
+#include <error_display.h>
 
-#include <QThread>
-
-template <typename T> class DelayedDeletion : public QThread {
-  public:
-    unsigned long delay_ms;
-    T* target;
-    DelayedDeletion() : delay_ms(100), target(NULL) {}
-    void run() {
-        if(target) {
-            msleep(delay_ms);
-            delete target;
-            target = NULL;
-        }
-    }
-};
-
-#endif // DELAYED_DELETION_H
+void display_error_message(QWidget* host_window,
+                           const QString& error_summary,
+                           const QString& error_description) {
+    QMessageBox::critical(host_window,
+                          error_summary,
+                          generate_error_message(error_description));
+}
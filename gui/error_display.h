@@ -1,4 +1,4 @@
-/* Service functions that are useful for parsing Hashish's various configuration files
+/* Error display : shows error messages to users of the graphical interface.
 
       Copyright (C) 2011  Hadrien Grasland
 
@@ -16,16 +16,16 @@
     along with this program; if not, write to the Free Software
     Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA */
 
-#ifndef PARSING_TOOLS_H
-#define PARSING_TOOLS_H
+#ifndef ERROR_DISPLAY_H
+#define ERROR_DISPLAY_H
 
-#include <QChar>
 #include <QString>
+#include <QWidget>
 
-bool has_id(const QString& config_file_line, const QString& identifier); //Check config file line
-                                                                         //for an identifier
-void isolate_content(QString& config_file_line); //Removes spacing, comments, and other junk
-void remove_id(QString& config_file_line, const QString& identifier); //Removes an identifier from
-                                                                      //a config file line
+#include <error_management.h>
 
-#endif // PARSING_TOOLS_H
+void display_error_message(QWidget* host_window,
+                           const QString& error_summary,
+                           const QString& error_description);
+
+#endif // ERROR_DISPLAY_H
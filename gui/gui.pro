@@ -0,0 +1,61 @@
+# Hashish's graphical interface
+
+TARGET = hashish
+
+QMAKE_CXXFLAGS += -std=c++0x -U__STRICT_ANSI__ -Wall
+
+include(../core/hashish-core.pri)
+
+RESOURCES = ../hashish.qrc
+
+SOURCES += main.cpp \
+    return_filter.cpp \
+    main_window.cpp \
+    service_window.cpp \
+    service_list_model.cpp \
+    password_window.cpp \
+    settings_window.cpp \
+    about_window.cpp \
+    error_display.cpp
+
+HEADERS += return_filter.h \
+    main_window.h \
+    service_window.h \
+    service_list_model.h \
+    password_window.h \
+    settings_window.h \
+    about_window.h \
+    error_display.h
+
+TRANSLATIONS = ../hashish_fr.ts \
+               ../hashish_en.ts
+
+# make install rule
+unix {
+    isEmpty(PREFIX) {
+        PREFIX = /usr/local
+    }
+
+    binaries.path  = $$PREFIX/bin
+    binaries.files = $$TARGET
+    icon.path  = /usr/share/pixmaps/
+    icon.files = ../hashish.png
+
+    INSTALLS += binaries icon
+}
+
+#Windows resources
+windows {
+    RC_FILE = ../win_hashish.rc
+}
+
+OTHER_FILES += \
+    ../win_hashish.rc \
+    ../hashish_fr.ts \
+    ../hashish_fr.qm \
+    ../hashish_en.ts \
+    ../hashish_en.qm \
+    ../hashish.xcf \
+    ../hashish.ico \
+    ../hashish.desktop \
+    ../hashish.png
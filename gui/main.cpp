@@ -18,14 +18,21 @@
 
 #include <QApplication>
 #include <QLocale>
+#include <QTextStream>
 #include <QTranslator>
+#include <stdio.h>
 
 #include <main_window.h>
 #include <service_manager.h>
 
 int main(int argc, char *argv[])
 {
-    QApplication app(argc, argv);
+    //In daemon mode, Hashish only serves requests on its local socket (see command_server.h)
+    bool daemon_mode = false;
+    for(int i = 1; i < argc; ++i) {
+        if(QString(argv[i]) == "--daemon") daemon_mode = true;
+    }
+    QApplication app(argc, argv, !daemon_mode);
 
     //Translate application using available locales (+ English as a fallback)
     QString locale = QLocale::system().name();
@@ -36,15 +43,28 @@ int main(int argc, char *argv[])
 
     //Setup initial app environment
     app.setApplicationName(app.translate("CoreApplication", "Hashish"));
-    app.setWindowIcon(QIcon(":/hashish.png"));
+    if(!daemon_mode) app.setWindowIcon(QIcon(":/hashish.png"));
 
     //Initialize ServiceManager backend, do not tolerate multiple running instances
-    ServiceManager service_manager;
-    if(service_manager.already_running()) return 0;
+    ServiceManager service_manager(daemon_mode ? DAEMON_INSTANCE : GUI_INSTANCE);
+    if(service_manager.already_running()) {
+        if(!daemon_mode) return 0;
+        QTextStream(stderr) << app.translate("CoreApplication", "Hashish is already running.") << endl;
+        return 1;
+    }
+
+    //Daemons check cryptographic functions, then wait for requests
+    if(daemon_mode) {
+        service_manager.start_self_test();
+        return app.exec();
+    }
 
     //Create and display main window
     MainWindow* main_window = new MainWindow(service_manager);
     main_window->show();
 
+    //Check cryptographic functions in the background, the main window waits for the results
+    service_manager.start_self_test();
+
     return app.exec();
 }
@@ -72,11 +72,18 @@ MainWindow::MainWindow(ServiceManager& service_manager,
             this,
             SLOT(reset_main_window_size()));
 
-    //Display a warning if the cryptographic functions have not passed the required tests
-    if(service_manager.crypto_function_tests_passed() == false) {
-        QMessageBox::warning(this,
-                             tr("Self-check failed"),
-                             WARNING_TESTS_FAILED);
+    //Cryptographic functions are tested in the background. Until they are known to work, do not
+    //let the user generate passwords with them.
+    if(service_manager.crypto_function_tests_done()) {
+        self_test_finished(service_manager.crypto_function_tests_passed());
+    } else {
+        password_window->setEnabled(false);
+        service_window->setEnabled(false);
+        settings_window->setEnabled(false);
+        connect(service_man,
+                SIGNAL(self_test_finished(bool)),
+                this,
+                SLOT(self_test_finished(bool)));
     }
 
     //Recreate the main window each time a new instance of Hashish should be spawned
@@ -121,3 +128,17 @@ void MainWindow::reset_main_window_size() {
     tab_widget->adjustSize();
     adjustSize();
 }
+
+void MainWindow::self_test_finished(bool passed) {
+    password_window->setEnabled(true);
+    service_window->setEnabled(true);
+    settings_window->setEnabled(true);
+    if(tab_widget->currentIndex() == 0) password_window->setFocus();
+
+    //Display a warning if the cryptographic functions have not passed the required tests
+    if(passed == false) {
+        QMessageBox::warning(this,
+                             tr("Self-check failed"),
+                             WARNING_TESTS_FAILED);
+    }
+}
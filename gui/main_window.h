@@ -43,6 +43,7 @@ class MainWindow : public QWidget {
     void editing_done(const QString& new_service_name);
     void new_instance_spawned();
     void reset_main_window_size();
+    void self_test_finished(bool passed);
 
   private:
     AboutWindow* about_window;
@@ -20,7 +20,7 @@
 #include <QApplication>
 #include <QMessageBox>
 
-#include <error_management.h>
+#include <error_display.h>
 #include <password_window.h>
 
 PasswordWindow::PasswordWindow(ServiceManager& service_manager,
@@ -53,7 +53,7 @@ PasswordWindow::PasswordWindow(ServiceManager& service_manager,
     setLayout(vert_layout);
 
     //Initialize service ID autocompletion
-    service_names_mod = service_manager.available_services();
+    service_names_mod = new_service_list_model(service_manager, 0, this); //Eager, for completion
     service_completion = new QCompleter(service_names_mod);
     service_completion->setCaseSensitivity(Qt::CaseInsensitive);
     service_completion->setCompletionMode(QCompleter::InlineCompletion);
@@ -175,8 +175,7 @@ void PasswordWindow::service_edit_return_pressed() {
 
     //Second, the proposed service name must be valid.
     service_name_buffer = service_edit->text();
-    QStringList service_list = service_names_mod->stringList();
-    if(service_list.contains(service_name_buffer, Qt::CaseInsensitive) == false) {
+    if(service_names_mod->contains(service_name_buffer, Qt::CaseInsensitive) == false) {
         masterpw_edit->setFocus();
         return;
     }
@@ -192,8 +191,7 @@ void PasswordWindow::start_password_generation() {
     masterpw_buffer = masterpw_edit->text();
 
     //Check that tmp_service_name is valid, otherwise abort
-    QStringList service_list = service_names_mod->stringList();
-    if(service_list.contains(service_name_buffer, Qt::CaseSensitive) == false) {
+    if(service_names_mod->contains(service_name_buffer, Qt::CaseSensitive) == false) {
         static const QString invalid_service_warning(tr("Service <em>%1</em> is unknown, please choose a known service or register this one."));
         QMessageBox::warning(this,
                              tr("Invalid service name"),
@@ -231,19 +229,11 @@ void PasswordWindow::verify_service() {
 
     //Verify that the requested service name exists, correcting its case if needed.
     //Otherwise, offer to create it.
-    QStringList service_list = service_names_mod->stringList();
     QString service_name = service_edit->text();
-    if(service_list.contains(service_name, Qt::CaseSensitive) == false) {
-        QString correct_name;
-        for(int i = 0; i < service_list.count(); ++i) {
-            if(service_list.at(i).compare(service_name, Qt::CaseInsensitive) == 0) {
-                correct_name = service_list.at(i);
-                break;
-            }
-        }
-
-        if(!(correct_name.isEmpty())) {
-            service_edit->setText(correct_name);
+    if(service_names_mod->contains(service_name, Qt::CaseSensitive) == false) {
+        const QString* correct_name = service_names_mod->lookup(service_name);
+        if(correct_name) {
+            service_edit->setText(*correct_name);
         } else {
             static const QString unknown_service_warning(tr("Service <em>%1</em> is unknown, do you want to register it ?"));
             int choice = QMessageBox::question(this,
@@ -26,10 +26,10 @@
 #include <QLineEdit>
 #include <QFormLayout>
 #include <QString>
-#include <QStringListModel>
 #include <QVBoxLayout>
 
 #include <return_filter.h>
+#include <service_list_model.h>
 #include <service_manager.h>
 
 class PasswordWindow : public QWidget {
@@ -68,7 +68,7 @@ class PasswordWindow : public QWidget {
     QLineEdit* service_edit;
     ReturnFilter* service_edit_return_filter;
     QString service_name_buffer;
-    QStringListModel* service_names_mod;
+    ServiceListModel* service_names_mod;
 };
 
 #endif // PW_WINDOW_H
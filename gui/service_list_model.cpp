@@ -0,0 +1,191 @@
+/* Service list model : exposes the service manager's sorted service name index to Qt's
+   item views and completers, without copying it.
+
+      Copyright (C) 2011  Hadrien Grasland
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA */
+
+#include <error_management.h>
+#include <parsing_tools.h>
+#include <service_list_model.h>
+
+const QString SERVICE_LIST_MODEL_NAME("ServiceListModel");
+
+ServiceListModel::ServiceListModel(const QStringList& index,
+                                   int fetch_batch,
+                                   QObject* parent) : QAbstractListModel(parent),
+                                                      fetch_batch(fetch_batch),
+                                                      fetched_rows(0),
+                                                      filter_begin(0),
+                                                      filter_end(0),
+                                                      service_index(&index) {
+    update_filter_range();
+}
+
+bool ServiceListModel::canFetchMore(const QModelIndex& parent) const {
+    if(parent.isValid()) return false;
+
+    return fetched_rows < (filter_end - filter_begin);
+}
+
+QVariant ServiceListModel::data(const QModelIndex& index, int role) const {
+    if((role != Qt::DisplayRole) && (role != Qt::EditRole)) return QVariant();
+    if(!index.isValid() || (index.row() >= fetched_rows)) return QVariant();
+
+    return service_index->at(filter_begin + index.row());
+}
+
+void ServiceListModel::fetchMore(const QModelIndex& parent) {
+    if(parent.isValid()) return;
+
+    //Expose the next batch of rows to views
+    int remaining_rows = (filter_end - filter_begin) - fetched_rows;
+    int new_rows = remaining_rows;
+    if(fetch_batch && (new_rows > fetch_batch)) new_rows = fetch_batch;
+    if(new_rows <= 0) return;
+
+    beginInsertRows(QModelIndex(), fetched_rows, fetched_rows + new_rows - 1);
+    fetched_rows+= new_rows;
+    endInsertRows();
+}
+
+int ServiceListModel::rowCount(const QModelIndex& parent) const {
+    if(parent.isValid()) return 0;
+
+    return fetched_rows;
+}
+
+bool ServiceListModel::contains(const QString& service_name, Qt::CaseSensitivity cs) const {
+    if(cs == Qt::CaseInsensitive) return (lookup(service_name) != NULL);
+
+    return (case_insensitive_find(*service_index, service_name) != -1);
+}
+
+const QString* ServiceListModel::lookup(const QString& service_name) const {
+    int position = case_insensitive_lower_bound(*service_index, service_name);
+    if(position == service_index->count()) return NULL;
+    if(service_index->at(position).compare(service_name, Qt::CaseInsensitive) != 0) return NULL;
+
+    return &(service_index->at(position));
+}
+
+void ServiceListModel::set_filter(const QString& prefix) {
+    if(prefix == name_filter) return;
+
+    beginResetModel();
+    name_filter = prefix;
+    update_filter_range();
+    endResetModel();
+}
+
+void ServiceListModel::index_inserted(int index_row) {
+    const QString& new_name = service_index->at(index_row);
+
+    //Names which do not match the filter only shift the filtered range if inserted before it.
+    //Inserting right at the beginning of the range is ambiguous, so we check the name itself.
+    if(matches_filter(new_name) == false) {
+        if((index_row < filter_begin) ||
+           ((index_row == filter_begin) && (new_name.compare(name_filter, Qt::CaseInsensitive) < 0))) {
+            ++filter_begin;
+            ++filter_end;
+        }
+        return;
+    }
+
+    //Matching names are inserted in the filtered range. They only have to be exposed to views
+    //right away if they are inserted among already fetched rows.
+    int row = index_row - filter_begin;
+    bool all_fetched = (fetched_rows == (filter_end - filter_begin));
+    ++filter_end;
+    if(all_fetched || (row < fetched_rows)) {
+        beginInsertRows(QModelIndex(), row, row);
+        ++fetched_rows;
+        endInsertRows();
+    }
+}
+
+void ServiceListModel::index_removed(int index_row) {
+    if(index_row < filter_begin) {
+        --filter_begin;
+        --filter_end;
+        return;
+    }
+    if(index_row >= filter_end) return;
+
+    int row = index_row - filter_begin;
+    --filter_end;
+    if(row < fetched_rows) {
+        beginRemoveRows(QModelIndex(), row, row);
+        --fetched_rows;
+        endRemoveRows();
+    }
+}
+
+void ServiceListModel::index_reset() {
+    beginResetModel();
+    update_filter_range();
+    endResetModel();
+}
+
+bool ServiceListModel::matches_filter(const QString& name) const {
+    if(name_filter.isEmpty()) return true;
+
+    return name.startsWith(name_filter, Qt::CaseInsensitive);
+}
+
+void ServiceListModel::update_filter_range() {
+    if(name_filter.isEmpty()) {
+        filter_begin = 0;
+        filter_end = service_index->count();
+    } else {
+        //Services starting with the filter are sorted right after it, and followed by services
+        //which do not match it anymore. Binary search for the frontier between both.
+        filter_begin = case_insensitive_lower_bound(*service_index, name_filter);
+        int first = filter_begin;
+        int count = service_index->count() - filter_begin;
+        while(count > 0) {
+            int step = count/2;
+            int middle = first + step;
+            if(matches_filter(service_index->at(middle))) {
+                first = middle+1;
+                count-= step+1;
+            } else {
+                count = step;
+            }
+        }
+        filter_end = first;
+    }
+
+    //Start over with a single batch of rows, or all of them for eager models
+    fetched_rows = filter_end - filter_begin;
+    if(fetch_batch && (fetched_rows > fetch_batch)) fetched_rows = fetch_batch;
+}
+
+ServiceListModel* new_service_list_model(ServiceManager& service_manager,
+                                         int fetch_batch,
+                                         QObject* parent) {
+    ServiceListModel* model = new ServiceListModel(service_manager.service_names(), fetch_batch, parent);
+    if(!model) {
+        log_error(SERVICE_LIST_MODEL_NAME, ERR_BAD_ALLOC.arg(QString("model")));
+        return NULL;
+    }
+
+    //Forward modifications of the service name index to the model
+    QObject::connect(&service_manager, SIGNAL(service_index_inserted(int)), model, SLOT(index_inserted(int)));
+    QObject::connect(&service_manager, SIGNAL(service_index_removed(int)), model, SLOT(index_removed(int)));
+    QObject::connect(&service_manager, SIGNAL(service_index_reset()), model, SLOT(index_reset()));
+
+    return model;
+}
@@ -0,0 +1,85 @@
+/* Service list model : exposes the service manager's sorted service name index to Qt's
+   item views and completers, without copying it.
+
+      Copyright (C) 2011  Hadrien Grasland
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA */
+
+#ifndef SERVICE_LIST_MODEL_H
+#define SERVICE_LIST_MODEL_H
+
+#include <QAbstractListModel>
+#include <QModelIndex>
+#include <QString>
+#include <QStringList>
+#include <QVariant>
+
+#include <service_manager.h>
+
+#define DEFAULT_FETCH_BATCH 256 //Amount of rows exposed to views at a time by lazy models
+
+//Read-only list model working directly on the service manager's index, which is kept sorted
+//case-insensitively. Rows may be restricted to the services whose name starts with a given
+//prefix : since the index is sorted, this is a contiguous range that is found by binary search.
+//
+//Lazy models only expose rows to views in batches (through canFetchMore/fetchMore), eager models
+//(fetch_batch == 0) expose the whole range at once, which is what QCompleter expects.
+//
+//The service manager notifies the model of each change to the index, *after* performing it,
+//through the index_*() slots. Until then, the model keeps using its former row counts.
+class ServiceListModel : public QAbstractListModel {
+    Q_OBJECT
+
+  public:
+    ServiceListModel(const QStringList& index,
+                     int fetch_batch = DEFAULT_FETCH_BATCH,
+                     QObject* parent = NULL);
+
+    //QAbstractListModel interface
+    bool canFetchMore(const QModelIndex& parent) const;
+    QVariant data(const QModelIndex& index, int role) const;
+    void fetchMore(const QModelIndex& parent);
+    int rowCount(const QModelIndex& parent = QModelIndex()) const;
+
+    //Service name lookup, working on the whole index whatever the current filter is
+    bool contains(const QString& service_name, Qt::CaseSensitivity cs = Qt::CaseSensitive) const;
+    const QString* lookup(const QString& service_name) const; //Case-insensitive, returns the
+                                                              //properly cased name or NULL
+    const QString& filter() const {return name_filter;}
+    void set_filter(const QString& prefix); //Only display services whose name starts with prefix
+
+  public slots:
+    void index_inserted(int index_row); //A name has been inserted at this position of the index
+    void index_removed(int index_row); //The name at this position of the index has been removed
+    void index_reset(); //The index has been rebuilt from scratch
+
+  private:
+    int fetch_batch;
+    int fetched_rows;
+    int filter_begin; //Range of the index that matches name_filter, as [begin, end)
+    int filter_end;
+    QString name_filter;
+    const QStringList* service_index;
+
+    bool matches_filter(const QString& name) const;
+    void update_filter_range();
+};
+
+//Creates a model on the service manager's index, which it keeps in sync with the index
+ServiceListModel* new_service_list_model(ServiceManager& service_manager,
+                                         int fetch_batch,
+                                         QObject* parent);
+
+#endif // SERVICE_LIST_MODEL_H
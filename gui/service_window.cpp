@@ -20,11 +20,11 @@
 #include <QInputDialog>
 #include <QMessageBox>
 
-#include <error_management.h>
+#include <error_display.h>
 #include <service_window.h>
 
 ServiceWindow::ServiceWindow(ServiceManager& service_manager,
-                             const int min_service_width) {
+                             const int min_service_width) : service_mgr(&service_manager) {
     //Initialize service ID entry
     service_edit = new QLineEdit;
     setFocusProxy(service_edit);
@@ -53,9 +53,12 @@ ServiceWindow::ServiceWindow(ServiceManager& service_manager,
     generated_radio = new QRadioButton(tr("Generate a new password"));
     encrypted_radio = new QRadioButton(tr("Encrypt an existing password"));
     generated_radio->setChecked(true);
+    pbkdf2_check = new QCheckBox(tr("Use standard key derivation (PBKDF2-HMAC-SHA512)"));
+    pbkdf2_check->setToolTip(tr("Other tools which support PBKDF2 will be able to derive this service's key from your master password.\nThis can only be chosen when adding a service, since it changes the service's password."));
     pw_type_layout = new QVBoxLayout;
     pw_type_layout->addWidget(generated_radio);
     pw_type_layout->addWidget(encrypted_radio);
+    pw_type_layout->addWidget(pbkdf2_check);
     pw_type_group->setLayout(pw_type_layout);
     pw_type_group->hide();
 
@@ -127,12 +130,11 @@ ServiceWindow::ServiceWindow(ServiceManager& service_manager,
     setTabOrder(extra_symbols_edit, confirm_button);
     setTabOrder(password_edit, confirm_button);
 
-    //Set up service completion so that service_edit becomes a search box for service_view
-    service_names_mod = service_manager.available_services();
-    service_completion = new QCompleter(service_manager.available_services());
-    service_completion->setCaseSensitivity(Qt::CaseInsensitive);
-    service_completion->setModelSorting(QCompleter::CaseInsensitivelySortedModel);
-    service_view->setModel(service_completion->completionModel());
+    //Set up a filtered view on the service list so that service_edit becomes a search box for
+    //service_view. The model only shows services to the view as they are scrolled through.
+    service_names_mod = new_service_list_model(service_manager, DEFAULT_FETCH_BATCH, this);
+    service_view->setUniformItemSizes(true);
+    service_view->setModel(service_names_mod);
     connect(service_edit,
             SIGNAL(textEdited(QString)),
             this,
@@ -298,6 +300,8 @@ void ServiceWindow::service_ready(ServiceDescriptor& service) {
     }
     current_nonce = service.nonce;
     update_regen_label(current_nonce);
+    pbkdf2_check->setChecked(service.key_derivation == PBKDF2_HMAC_SHA512);
+    pbkdf2_check->setEnabled(add_mode);
     if(service.constraints) {
         case_sens_check->setChecked(service.constraints->case_sensitivity);
         caps_amount_spin->setValue(service.constraints->number_of_caps);
@@ -439,8 +443,12 @@ void ServiceWindow::confirm_clicked() {
         }
     }
 
-    //Commit changes to the service descriptor
-    if(add_mode) edited_service->service_name = new_service_name;
+    //Commit changes to the service descriptor. Key derivation must be set before encryption.
+    if(add_mode) {
+        edited_service->service_name = new_service_name;
+        edited_service->key_derivation = pbkdf2_check->isChecked() ? PBKDF2_HMAC_SHA512 : ITERATED_HASH;
+        edited_service->iterations = service_mgr->current_iterations(edited_service->key_derivation);
+    }
     if(generated_radio->isChecked()) {
         //For security purpose, passwords which are former encryption keys must be regened
         if((edited_service->nonce == current_nonce) && (edited_service->password_type == ENCRYPTED)) {
@@ -531,7 +539,7 @@ void ServiceWindow::regen_clicked() {
 
 void ServiceWindow::service_name_edited(const QString& new_text) {
     //Update service_view's contents
-    service_completion->setCompletionPrefix(new_text);
+    service_names_mod->set_filter(new_text);
 
     //If new_text is nonzero, select first item in service_view. If not, deselect
     //the contents of service_view
@@ -546,8 +554,7 @@ void ServiceWindow::service_name_edited(const QString& new_text) {
     }
 
     //Manage transition between button states
-    QStringList service_list = service_names_mod->stringList();
-    if(service_list.contains(new_text, Qt::CaseInsensitive)) {
+    if(service_names_mod->contains(new_text, Qt::CaseInsensitive)) {
         add_button->setEnabled(false);
         remove_button->setEnabled(true);
         edit_button->setEnabled(true);
@@ -614,15 +621,7 @@ void ServiceWindow::fix_service_edit_case() {
 }
 
 const QString* ServiceWindow::lookup_service_name(const QString& name) {
-    QStringList service_list = service_names_mod->stringList();
-
-    for(int i = 0; i < service_list.count(); ++i) {
-        if(service_list.at(i).compare(name, Qt::CaseInsensitive) == 0) {
-            return &(service_list.at(i));
-        }
-    }
-
-    return NULL;
+    return service_names_mod->lookup(name);
 }
 
 void ServiceWindow::start_editing() {
@@ -21,7 +21,6 @@
 #define SERVICE_WINDOW_H
 
 #include <QCheckBox>
-#include <QCompleter>
 #include <QFormLayout>
 #include <QGroupBox>
 #include <QHBoxLayout>
@@ -32,13 +31,13 @@
 #include <QRadioButton>
 #include <QSpinBox>
 #include <QString>
-#include <QStringListModel>
 #include <QVBoxLayout>
 #include <QWidget>
 
 #include <return_filter.h>
 #include <service_manager.h>
 #include <service_descriptor.h>
+#include <service_list_model.h>
 
 class ServiceWindow : public QWidget {
     Q_OBJECT
@@ -104,6 +103,7 @@ class ServiceWindow : public QWidget {
     ReturnFilter* password_edit_return_filter;
     QGroupBox* password_group;
     QHBoxLayout* password_layout;
+    QCheckBox* pbkdf2_check;
     QGroupBox* pw_type_group;
     QVBoxLayout* pw_type_layout;
     QPushButton* regen_button;
@@ -111,11 +111,11 @@ class ServiceWindow : public QWidget {
     QLabel* regen_label;
     QHBoxLayout* regen_layout;
     QPushButton* remove_button;
-    QCompleter* service_completion;
     QLineEdit* service_edit;
     QFormLayout* service_edit_layout;
     ReturnFilter* service_edit_return_filter;
-    QStringListModel* service_names_mod;
+    ServiceListModel* service_names_mod;
+    ServiceManager* service_mgr;
     QListView* service_view;
     QCheckBox* truncate_check;
     QVBoxLayout* vert_layout;
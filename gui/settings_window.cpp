@@ -0,0 +1,251 @@
+/* Hashish's settings window : allows setting up acceptable latency and other application-wide
+  parameters
+
+      Copyright (C) 2011  Hadrien Grasland
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA */
+
+#include <QFileDialog>
+#include <QFont>
+#include <QMessageBox>
+#include <QTimer>
+
+#include <error_display.h>
+#include <settings_window.h>
+#include <tracing.h>
+
+SettingsWindow::SettingsWindow(ServiceManager& service_manager,
+                               int min_acceptable_latency,
+                               int max_acceptable_latency) {
+    //Initialize latency settings area
+    size_t acceptable_latency = service_manager.current_latency();
+    latency_group = new QGroupBox(tr("Password generation latency"));
+    latency_help = new QLabel(tr("Here you can set up the time which you are ready to wait during password generation (this setting only applies to the services that will be added in the future)"));
+    latency_help->setWordWrap(true);
+    latency_slider = new QSlider(Qt::Horizontal);
+    latency_slider->setMinimum(min_acceptable_latency);
+    latency_slider->setMaximum(max_acceptable_latency);
+    latency_slider->setValue(acceptable_latency);
+    latency_label = new QLabel;
+    latency_changed(acceptable_latency);
+    latency_check_button = new QPushButton(tr("Check"));
+    setFocusProxy(latency_group);
+
+    latency_horz_layout = new QHBoxLayout;
+    latency_horz_layout->addWidget(latency_slider);
+    latency_horz_layout->addWidget(latency_label);
+    latency_horz_layout->addSpacing(10);
+    latency_horz_layout->addWidget(latency_check_button);
+    latency_layout = new QVBoxLayout;
+    latency_layout->addWidget(latency_help);
+    latency_layout->addLayout(latency_horz_layout);
+    latency_group->setLayout(latency_layout);
+
+    //Initialize stretched key cache settings area
+    key_cache_group = new QGroupBox(tr("Stretched key cache"));
+    key_cache_help = new QLabel(tr("Hashish can keep the stretched keys of recently used services in locked memory for some time, so that their passwords are generated instantly. Keys are forgotten when they have not been used for that long, or when you lock the cache (\"hashish-cli lock\" does the same from a screen locker)."));
+    key_cache_help->setWordWrap(true);
+    key_cache_ttl_spinbox = new QSpinBox;
+    key_cache_ttl_spinbox->setRange(0, 24*60);
+    key_cache_ttl_spinbox->setSuffix(tr(" min"));
+    key_cache_ttl_spinbox->setSpecialValueText(tr("Disabled"));
+    key_cache_ttl_spinbox->setValue(service_manager.current_key_cache_ttl() / 60);
+    key_cache_lock_button = new QPushButton(tr("&Lock now"));
+
+    key_cache_horz_layout = new QHBoxLayout;
+    key_cache_horz_layout->addWidget(key_cache_ttl_spinbox, 1);
+    key_cache_horz_layout->addSpacing(10);
+    key_cache_horz_layout->addWidget(key_cache_lock_button);
+    key_cache_layout = new QVBoxLayout;
+    key_cache_layout->addWidget(key_cache_help);
+    key_cache_layout->addLayout(key_cache_horz_layout);
+    key_cache_group->setLayout(key_cache_layout);
+
+    //Initialize the latency breakdown debug pane
+    tracing_group = new QGroupBox(tr("Latency breakdown (debug)"));
+    tracing_help = new QLabel(tr("Time spent in each stage of the password computations performed since Hashish was started, as a share of their total time (key stretching for password encryption is counted too)."));
+    tracing_help->setWordWrap(true);
+    tracing_label = new QLabel;
+    QFont tracing_font("Monospace");
+    tracing_font.setStyleHint(QFont::TypeWriter);
+    tracing_label->setFont(tracing_font);
+    tracing_label->setTextInteractionFlags(Qt::TextSelectableByMouse);
+    tracing_refresh_button = new QPushButton(tr("&Refresh"));
+    tracing_reset_button = new QPushButton(tr("R&eset"));
+    tracing_export_button = new QPushButton(tr("E&xport trace..."));
+    tracing_refresh();
+
+    tracing_button_layout = new QHBoxLayout;
+    tracing_button_layout->addWidget(tracing_refresh_button);
+    tracing_button_layout->addWidget(tracing_reset_button);
+    tracing_button_layout->addStretch();
+    tracing_button_layout->addWidget(tracing_export_button);
+    tracing_layout = new QVBoxLayout;
+    tracing_layout->addWidget(tracing_help);
+    tracing_layout->addWidget(tracing_label);
+    tracing_layout->addLayout(tracing_button_layout);
+    tracing_group->setLayout(tracing_layout);
+    tracing_group->setEnabled(TRACING_ENABLED);
+
+    //Initialize cancel and confirm buttons
+    cancel_button = new QPushButton(tr("&Cancel"));
+    confirm_button = new QPushButton(tr("C&onfirm"));
+    button_layout = new QHBoxLayout;
+    button_layout->addWidget(cancel_button, 1);
+    button_layout->addSpacing(10);
+    button_layout->addWidget(confirm_button, 2);
+
+    //Initialize global window layout
+    main_layout = new QVBoxLayout;
+    main_layout->addWidget(latency_group);
+    main_layout->addWidget(key_cache_group);
+    main_layout->addWidget(tracing_group);
+    main_layout->addStretch();
+    main_layout->addLayout(button_layout);
+    setLayout(main_layout);
+    setTabOrder(latency_slider, key_cache_ttl_spinbox);
+    setTabOrder(key_cache_ttl_spinbox, key_cache_lock_button);
+    setTabOrder(key_cache_lock_button, confirm_button);
+    setTabOrder(confirm_button, cancel_button);
+
+    //Keep latency_label up to date
+    connect(latency_slider,
+            SIGNAL(valueChanged(int)),
+            this,
+            SLOT(latency_changed(int)));
+
+    //Monitor action of the return key on the latency slider to make it
+    //press the test button
+    latency_slider_return_filter = new ReturnFilter;
+    connect(latency_slider_return_filter,
+            SIGNAL(return_pressed()),
+            latency_check_button,
+            SLOT(animateClick()));
+    latency_slider->installEventFilter(latency_slider_return_filter);
+
+    //Implement latency checks
+    connect(latency_check_button,
+            SIGNAL(clicked()),
+            this,
+            SLOT(latency_check_start()));
+
+    //Connect buttons to their event handlers
+    connect(key_cache_lock_button,
+            SIGNAL(clicked()),
+            this,
+            SLOT(key_cache_lock()));
+    connect(cancel_button,
+            SIGNAL(clicked()),
+            this,
+            SLOT(cancel_button_clicked()));
+    connect(confirm_button,
+            SIGNAL(clicked()),
+            this,
+            SLOT(confirm_button_clicked()));
+
+    //Connect the debug pane's buttons
+    connect(tracing_refresh_button,
+            SIGNAL(clicked()),
+            this,
+            SLOT(tracing_refresh()));
+    connect(tracing_reset_button,
+            SIGNAL(clicked()),
+            this,
+            SLOT(tracing_reset()));
+    connect(tracing_export_button,
+            SIGNAL(clicked()),
+            this,
+            SLOT(tracing_export()));
+
+    //Keep a pointer on the service manager, we'll need it for settings changes
+    service_mgr = &service_manager;
+}
+
+void SettingsWindow::cancel_button_clicked() {
+    size_t acceptable_latency = service_mgr->current_latency();
+
+    latency_slider->setValue(acceptable_latency);
+    key_cache_ttl_spinbox->setValue(service_mgr->current_key_cache_ttl() / 60);
+}
+
+void SettingsWindow::confirm_button_clicked() {
+    bool result = service_mgr->set_current_latency(latency_slider->value());
+    if(!result) {
+        static const QString error_summary(tr("Setting password generation latency failed"));
+        static const QString error_desc(tr("An error was encountered while setting the password generation latency."));
+        display_error_message(this, error_summary, error_desc);
+    }
+
+    result = service_mgr->set_key_cache_ttl(60*key_cache_ttl_spinbox->value());
+    if(!result) {
+        static const QString error_summary(tr("Setting up the stretched key cache failed"));
+        static const QString error_desc(tr("An error was encountered while setting up the stretched key cache. Your system may not allow Hashish to lock enough memory."));
+        display_error_message(this, error_summary, error_desc);
+        key_cache_ttl_spinbox->setValue(service_mgr->current_key_cache_ttl() / 60);
+    }
+}
+
+void SettingsWindow::key_cache_lock() {
+    service_mgr->lock_key_cache();
+}
+
+void SettingsWindow::latency_changed(int new_latency) {
+    latency_label->setText(tr("%n ms", "miliseconds", new_latency));
+}
+
+void SettingsWindow::latency_check_start() {
+    latency_check_button->setEnabled(false);
+    latency_slider->setFocus();
+
+    QTimer::singleShot(latency_slider->value(), this, SLOT(latency_check_stop()));
+}
+
+void SettingsWindow::latency_check_stop() {
+    latency_check_button->setEnabled(true);
+}
+
+void SettingsWindow::tracing_export() {
+    QString trace_filepath = QFileDialog::getSaveFileName(this,
+                                                          tr("Export trace"),
+                                                          "hashish_trace.json",
+                                                          tr("Chrome trace files (*.json)"));
+    if(trace_filepath.isEmpty()) return;
+
+    bool result = pipeline_tracer.export_chrome_trace(trace_filepath);
+    if(!result) {
+        static const QString error_summary(tr("Exporting the trace failed"));
+        static const QString error_desc(tr("An error was encountered while writing the trace file."));
+        display_error_message(this, error_summary, error_desc);
+    }
+}
+
+void SettingsWindow::tracing_refresh() {
+    if(!TRACING_ENABLED) {
+        tracing_label->setText(tr("Tracing has been disabled at compile time."));
+        return;
+    }
+
+    TraceStageStatistics password_stats = pipeline_tracer.statistics(TRACE_COMPUTE_PASSWORD);
+    if(!password_stats.count) {
+        tracing_label->setText(tr("No password has been computed yet."));
+        return;
+    }
+    tracing_label->setText(pipeline_tracer.latency_breakdown());
+}
+
+void SettingsWindow::tracing_reset() {
+    pipeline_tracer.reset();
+    tracing_refresh();
+}
@@ -25,6 +25,7 @@
 #include <QLabel>
 #include <QPushButton>
 #include <QSlider>
+#include <QSpinBox>
 #include <QVBoxLayout>
 #include <QWidget>
 
@@ -46,11 +47,21 @@ class SettingsWindow : public QWidget {
     void latency_changed(int new_latency);
     void latency_check_start();
     void latency_check_stop();
+    void key_cache_lock();
+    void tracing_export();
+    void tracing_refresh();
+    void tracing_reset();
 
   private:
     QHBoxLayout* button_layout;
     QPushButton* cancel_button;
     QPushButton* confirm_button;
+    QGroupBox* key_cache_group;
+    QLabel* key_cache_help;
+    QHBoxLayout* key_cache_horz_layout;
+    QVBoxLayout* key_cache_layout;
+    QPushButton* key_cache_lock_button;
+    QSpinBox* key_cache_ttl_spinbox;
     QPushButton* latency_check_button;
     QGroupBox* latency_group;
     QLabel* latency_label;
@@ -61,6 +72,14 @@ class SettingsWindow : public QWidget {
     QVBoxLayout* latency_layout;
     QVBoxLayout* main_layout;
     ServiceManager* service_mgr;
+    QHBoxLayout* tracing_button_layout;
+    QPushButton* tracing_export_button;
+    QGroupBox* tracing_group;
+    QLabel* tracing_help;
+    QLabel* tracing_label;
+    QVBoxLayout* tracing_layout;
+    QPushButton* tracing_refresh_button;
+    QPushButton* tracing_reset_button;
 };
 
 #endif // SETTINGS_WINDOW_H
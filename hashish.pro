@@ -1,79 +1,27 @@
-QMAKE_CXXFLAGS += -std=c++0x -U__STRICT_ANSI__ -Wall
+# Hashish is made of a core library, which holds the cryptographic functions and the service
+# storage and does not depend on QtGui, and of the front ends which use it : the graphical
+# interface, the command line tool, the self-test program and the benchmarks.
 
-QT += network
+TEMPLATE = subdirs
 
-RESOURCES = hashish.qrc
+SUBDIRS = core \
+    gui \
+    cli \
+    selftest \
+    bench
 
-SOURCES += main.cpp \
-    return_filter.cpp \
-    main_window.cpp \
-    service_window.cpp \
-    crypto_hash.cpp \
-    password_generator.cpp \
-    hmac.cpp \
-    qstring_to_qwords.cpp \
-    password_cipher.cpp \
-    service_descriptor.cpp \
-    service_manager.cpp \
-    parsing_tools.cpp \
-    password_window.cpp \
-    settings_window.cpp \
-    about_window.cpp \
-    error_management.cpp \
-    test_suite.cpp
-
-HEADERS += return_filter.h \
-    main_window.h \
-    service_window.h \
-    service_descriptor.h \
-    crypto_hash.h \
-    password_generator.h \
-    hmac.h \
-    qstring_to_qwords.h \
-    password_cipher.h \
-    service_manager.h \
-    parsing_tools.h \
-    password_window.h \
-    settings_window.h \
-    about_window.h \
-    error_management.h \
-    test_suite.h
-
-TRANSLATIONS = hashish_fr.ts \
-               hashish_en.ts
-
-# make install rule
-unix {
-    isEmpty(PREFIX) {
-        PREFIX = /usr/local
-    }
-
-    binaries.path  = $$PREFIX/bin
-    binaries.files = $$TARGET
-    icon.path  = /usr/share/pixmaps/
-    icon.files = hashish.png
-
-    INSTALLS += binaries icon
-}
-
-#Windows resources
-windows {
-    RC_FILE = win_hashish.rc
-}
+gui.depends = core
+cli.depends = core
+selftest.depends = core
+bench.depends = core
 
 OTHER_FILES += \
-    win_hashish.rc \
-    hashish_fr.ts \
-    hashish_fr.qm \
-    hashish_en.ts \
-    hashish_en.qm \
-    hashish.xcf \
-    hashish.ico \
-    hashish.desktop \
-    hashish.png \
+    README \
     COPYING \
     Tests/SHA-512.testvecs \
+    Tests/BLAKE2b-512.testvecs \
+    Tests/SHA3-512.testvecs \
     "Tests/RFC 2104.testvecs" \
     "Tests/OFB-chained XOR cipher.testvecs" \
     "Tests/Default generator.testvecs" \
-    README
+    Tests/testvecs_to_cpp.py
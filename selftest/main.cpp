@@ -0,0 +1,73 @@
+/* Hashish's headless self-test : checks all cryptographic functions against their known test
+   vectors, logging failures on the standard error output.
+
+      Copyright (C) 2011  Hadrien Grasland
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA */
+
+#include <QCoreApplication>
+#include <QTextStream>
+#include <stdio.h>
+
+#include <crypto_hash.h>
+#include <delayed_deletion.h>
+#include <error_management.h>
+#include <hmac.h>
+#include <key_cache.h>
+#include <password_cipher.h>
+#include <password_generator.h>
+#include <pbkdf2.h>
+#include <qstring_to_qwords.h>
+#include <service_descriptor.h>
+#include <service_import.h>
+#include <service_manager.h>
+#include <store_snapshot.h>
+#include <test_suite.h>
+#include <tracing.h>
+
+bool run_test(QTextStream& out, const QString& test_name, bool (*test)()) {
+    bool passed = test();
+    out << (passed ? "PASS : " : "FAIL : ") << test_name << endl;
+    return passed;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QTextStream err_stream(stderr);
+    QTextStream out_stream(stdout);
+    start_error_logging(err_stream);
+
+    //Run every test, even after a failure, so that all problems are reported at once
+    bool passed = true;
+    passed&= run_test(out_stream, "cryptographic hashes", test_crypto_hashes);
+    passed&= run_test(out_stream, "HMACs", test_hmacs);
+    passed&= run_test(out_stream, "PBKDF2", test_pbkdf2);
+    passed&= run_test(out_stream, "password ciphers", test_password_ciphers);
+    passed&= run_test(out_stream, "password generators", test_password_generators);
+    passed&= run_test(out_stream, "qword conversions", test_qword_conversions);
+    passed&= run_test(out_stream, "pipeline tracer", test_pipeline_tracer);
+    passed&= run_test(out_stream, "stretched key cache", test_key_cache);
+    passed&= run_test(out_stream, "delayed deletion", test_delayed_deletion);
+    passed&= run_test(out_stream, "credential readers", test_credential_readers);
+    passed&= run_test(out_stream, "service descriptors", test_service_descriptors);
+    passed&= run_test(out_stream, "store snapshots", test_store_snapshots);
+    passed&= run_test(out_stream, "service cache", test_service_cache);
+    passed&= run_test(out_stream, "quick self-test", quick_self_test);
+
+    stop_error_logging();
+    return passed ? 0 : 1;
+}
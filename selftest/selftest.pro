@@ -0,0 +1,17 @@
+# Headless test program : runs Hashish's whole cryptographic test suite without any window, and
+# reports the result through its exit code ("make check" runs it).
+
+TARGET = hashish-selftest
+CONFIG += console
+CONFIG -= app_bundle
+QT -= gui
+
+QMAKE_CXXFLAGS += -std=c++0x -U__STRICT_ANSI__ -Wall
+
+include(../core/hashish-core.pri)
+
+SOURCES += main.cpp
+
+check.commands = ./$$TARGET
+check.depends = $$TARGET
+QMAKE_EXTRA_TARGETS += check